@@ -0,0 +1,172 @@
+/**
+ * Copyright (c) 2023, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <numeric>
+
+#include "aho_corasick.hh"
+
+#include "config.h"
+
+namespace lnav {
+
+static unsigned char
+fold_byte(char ch)
+{
+    auto retval = (unsigned char) ch;
+
+    if ('A' <= retval && retval <= 'Z') {
+        retval += 'a' - 'A';
+    }
+    return retval;
+}
+
+aho_corasick::aho_corasick()
+{
+    // The root node.
+    this->ac_nodes.emplace_back();
+}
+
+void
+aho_corasick::add(string_fragment literal)
+{
+    if (literal.empty()) {
+        return;
+    }
+
+    uint32_t state = 0;
+    for (auto ch : literal) {
+        auto byte = fold_byte(ch);
+        auto iter = this->ac_edges.find(edge_key(state, byte));
+
+        if (iter != this->ac_edges.end()) {
+            state = iter->second;
+            continue;
+        }
+
+        node child;
+
+        child.n_parent = state;
+        child.n_depth = this->ac_nodes[state].n_depth + 1;
+        child.n_byte = byte;
+        this->ac_nodes.emplace_back(child);
+        auto child_state = (uint32_t) (this->ac_nodes.size() - 1);
+        this->ac_edges[edge_key(state, byte)] = child_state;
+        state = child_state;
+    }
+
+    if (!this->ac_nodes[state].n_terminal) {
+        this->ac_nodes[state].n_terminal = true;
+        this->ac_literal_count += 1;
+    }
+    this->ac_built = false;
+}
+
+bool
+aho_corasick::next_state(uint32_t state,
+                         unsigned char byte,
+                         uint32_t& next) const
+{
+    auto iter = this->ac_edges.find(edge_key(state, byte));
+
+    if (iter == this->ac_edges.end()) {
+        return false;
+    }
+
+    next = iter->second;
+    return true;
+}
+
+void
+aho_corasick::build()
+{
+    // The failure link of a node always points to a shallower node, so
+    // visiting the nodes in order of depth computes each link after the
+    // links it depends on.
+    std::vector<uint32_t> order(this->ac_nodes.size());
+
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(
+        order.begin(), order.end(), [this](uint32_t lhs, uint32_t rhs) {
+            return this->ac_nodes[lhs].n_depth < this->ac_nodes[rhs].n_depth;
+        });
+
+    for (auto state : order) {
+        auto& curr = this->ac_nodes[state];
+
+        if (curr.n_depth <= 1) {
+            curr.n_fail = 0;
+        } else {
+            auto fail = this->ac_nodes[curr.n_parent].n_fail;
+            uint32_t next;
+
+            while (!this->next_state(fail, curr.n_byte, next) && fail != 0) {
+                fail = this->ac_nodes[fail].n_fail;
+            }
+            curr.n_fail = this->next_state(fail, curr.n_byte, next) ? next : 0;
+        }
+        curr.n_match = curr.n_terminal
+            || (state != 0 && this->ac_nodes[curr.n_fail].n_match);
+    }
+
+    this->ac_built = true;
+}
+
+bool
+aho_corasick::find_in(string_fragment sf)
+{
+    if (this->empty()) {
+        return false;
+    }
+    if (!this->ac_built) {
+        this->build();
+    }
+
+    uint32_t state = 0;
+    for (auto ch : sf) {
+        auto byte = fold_byte(ch);
+        uint32_t next;
+
+        while (!this->next_state(state, byte, next)) {
+            if (state == 0) {
+                next = 0;
+                break;
+            }
+            state = this->ac_nodes[state].n_fail;
+        }
+        state = next;
+        if (this->ac_nodes[state].n_match) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+}  // namespace lnav
@@ -0,0 +1,95 @@
+/**
+ * Copyright (c) 2023, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef lnav_aho_corasick_hh
+#define lnav_aho_corasick_hh
+
+#include <vector>
+
+#include <stdint.h>
+
+#include "intern_string.hh"
+#include "robin_hood/robin_hood.h"
+
+namespace lnav {
+
+/**
+ * An Aho-Corasick automaton for checking if a string contains any one of a
+ * set of literal strings.  The cost of a search depends on the length of the
+ * string that is searched and not on the number of literals.  Matching is
+ * case-insensitive for ASCII letters.
+ */
+class aho_corasick {
+public:
+    aho_corasick();
+
+    /**
+     * Add a literal to the set.  Empty literals are ignored.  The failure
+     * links are recomputed by the next call to find_in().
+     */
+    void add(string_fragment literal);
+
+    /** @return The number of distinct literals in the set. */
+    size_t size() const { return this->ac_literal_count; }
+
+    bool empty() const { return this->ac_literal_count == 0; }
+
+    /** @return True if any of the literals occurs in the given string. */
+    bool find_in(string_fragment sf);
+
+private:
+    struct node {
+        uint32_t n_parent{0};
+        uint32_t n_fail{0};
+        uint32_t n_depth{0};
+        unsigned char n_byte{0};
+        /** True if a literal ends at this node. */
+        bool n_terminal{false};
+        /** True if a literal ends at this node or any of its suffixes. */
+        bool n_match{false};
+    };
+
+    static uint64_t edge_key(uint32_t state, unsigned char byte)
+    {
+        return (uint64_t{state} << 8U) | byte;
+    }
+
+    bool next_state(uint32_t state, unsigned char byte, uint32_t& next) const;
+
+    void build();
+
+    std::vector<node> ac_nodes;
+    robin_hood::unordered_flat_map<uint64_t, uint32_t> ac_edges;
+    size_t ac_literal_count{0};
+    bool ac_built{true};
+};
+
+}  // namespace lnav
+
+#endif
@@ -0,0 +1,94 @@
+/**
+ * Copyright (c) 2023, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string>
+
+#include "aho_corasick.hh"
+#include "config.h"
+#include "doctest/doctest.h"
+
+TEST_CASE("aho_corasick::find_in")
+{
+    lnav::aho_corasick ac;
+
+    CHECK_FALSE(ac.find_in(string_fragment::from_const("anything")));
+
+    ac.add(string_fragment::from_const("he"));
+    ac.add(string_fragment::from_const("she"));
+    ac.add(string_fragment::from_const("his"));
+    ac.add(string_fragment::from_const("hers"));
+    ac.add(string_fragment::from_const("hers"));
+    ac.add(string_fragment::from_const(""));
+
+    CHECK(ac.size() == 4);
+    CHECK(ac.find_in(string_fragment::from_const("ushers")));
+    CHECK(ac.find_in(string_fragment::from_const("this")));
+    CHECK(ac.find_in(string_fragment::from_const("SHE")));
+    CHECK_FALSE(ac.find_in(string_fragment::from_const("hi sir")));
+    CHECK_FALSE(ac.find_in(string_fragment::from_const("")));
+
+    ac.add(string_fragment::from_const("sir"));
+    CHECK(ac.find_in(string_fragment::from_const("hi sir")));
+}
+
+TEST_CASE("aho_corasick::suffix-match")
+{
+    lnav::aho_corasick ac;
+
+    // "bcd" is only reachable through the failure link of "abc".
+    ac.add(string_fragment::from_const("abcx"));
+    ac.add(string_fragment::from_const("bcd"));
+    ac.add(string_fragment::from_const("c"));
+
+    CHECK(ac.find_in(string_fragment::from_const("abcd")));
+
+    lnav::aho_corasick ac2;
+
+    ac2.add(string_fragment::from_const("abcx"));
+    ac2.add(string_fragment::from_const("bcd"));
+
+    CHECK(ac2.find_in(string_fragment::from_const("zabcd")));
+    CHECK_FALSE(ac2.find_in(string_fragment::from_const("zabc")));
+}
+
+TEST_CASE("aho_corasick::many")
+{
+    lnav::aho_corasick ac;
+
+    for (int lpc = 0; lpc < 10000; lpc += 2) {
+        auto id = "req-" + std::to_string(lpc) + ";";
+
+        ac.add(string_fragment::from_str(id));
+    }
+
+    CHECK(ac.size() == 5000);
+    CHECK(ac.find_in(string_fragment::from_const("GET /x req-9998; 200")));
+    CHECK_FALSE(ac.find_in(string_fragment::from_const("GET /x req-9999; 200")));
+    CHECK_FALSE(ac.find_in(string_fragment::from_const("GET /x req-99; 200")));
+}
@@ -358,13 +358,58 @@ attr_line_t::subline(size_t start, size_t len) const
 void
 attr_line_t::split_lines(std::vector<attr_line_t>& lines) const
 {
+    std::vector<line_range> line_ranges;
     size_t pos = 0, next_line;
 
     while ((next_line = this->al_string.find('\n', pos)) != std::string::npos) {
-        lines.emplace_back(this->subline(pos, next_line - pos));
+        line_ranges.emplace_back(pos, next_line);
         pos = next_line + 1;
     }
-    lines.emplace_back(this->subline(pos));
+    line_ranges.emplace_back(pos, this->al_string.length());
+
+    auto first_line = lines.size();
+    for (const auto& lr : line_ranges) {
+        lines.emplace_back(this->al_string.substr(lr.lr_start, lr.length()));
+    }
+
+    // Only check the lines that an attribute could overlap instead of
+    // checking every attribute against every line.
+    auto line_after = [&line_ranges](int off) {
+        return std::upper_bound(
+            line_ranges.begin(),
+            line_ranges.end(),
+            off,
+            [](int lhs, const line_range& rhs) { return lhs < rhs.lr_start; });
+    };
+    for (const auto& sa : this->al_attrs) {
+        auto low = sa.sa_range.lr_start;
+        if (sa.sa_range.lr_end > 0) {
+            low = std::min(low, sa.sa_range.lr_end - 1);
+        }
+        auto lr_iter = line_after(low);
+        if (lr_iter != line_ranges.begin()) {
+            --lr_iter;
+        }
+        auto lr_end_iter = sa.sa_range.lr_end == -1
+            ? line_ranges.end()
+            : line_after(
+                std::max(sa.sa_range.lr_start, sa.sa_range.lr_end - 1));
+
+        for (; lr_iter < lr_end_iter; ++lr_iter) {
+            const auto& lr = *lr_iter;
+
+            if (!lr.intersects(sa.sa_range)) {
+                continue;
+            }
+
+            auto& line = lines[first_line
+                               + std::distance(line_ranges.begin(), lr_iter)];
+            auto ilr = lr.intersection(sa.sa_range).shift(0, -lr.lr_start);
+            line.al_attrs.emplace_back(ilr,
+                                       std::make_pair(sa.sa_type, sa.sa_value));
+            ensure(ilr.lr_end <= (int) line.al_string.length());
+        }
+    }
 }
 
 attr_line_t&
@@ -89,3 +89,37 @@ TEST_CASE("attr_line_t::unicode-wrap")
           "   be wrapped and\n"
           "   indented");
 }
+
+TEST_CASE("attr_line_t::split_lines")
+{
+    attr_line_t al;
+
+    al.append("abc"_symbol)
+        .append("\n\n")
+        .append("def ")
+        .append("ghi\njkl"_comment)
+        .append("\nmno");
+    al.al_attrs.emplace_back(line_range{0, -1},
+                             VC_ROLE.value(role_t::VCR_TEXT));
+
+    auto lines = al.split_lines();
+
+    REQUIRE(lines.size() == 5);
+    CHECK(lines[0].get_string() == "abc");
+    CHECK(lines[1].get_string().empty());
+    CHECK(lines[2].get_string() == "def ghi");
+    CHECK(lines[3].get_string() == "jkl");
+
+    REQUIRE(lines[0].get_attrs().size() == 2);
+    CHECK(lines[0].get_attrs()[0].sa_range.lr_start == 0);
+    CHECK(lines[0].get_attrs()[0].sa_range.lr_end == 3);
+    CHECK(lines[1].get_attrs().size() == 1);
+    REQUIRE(lines[2].get_attrs().size() == 2);
+    CHECK(lines[2].get_attrs()[0].sa_range.lr_start == 4);
+    CHECK(lines[2].get_attrs()[0].sa_range.lr_end == 7);
+    REQUIRE(lines[3].get_attrs().size() == 2);
+    CHECK(lines[3].get_attrs()[0].sa_range.lr_start == 0);
+    CHECK(lines[3].get_attrs()[0].sa_range.lr_end == 3);
+    CHECK(lines[4].get_string() == "mno");
+    CHECK(lines[4].get_attrs().size() == 1);
+}
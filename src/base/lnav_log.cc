@@ -32,6 +32,7 @@
 #include <assert.h>
 #include <ctype.h>
 #include <fcntl.h>
+#include <pthread.h>
 #include <signal.h>
 #include <stdarg.h>
 #include <stdio.h>
@@ -52,6 +53,8 @@
 #endif
 
 #include <algorithm>
+#include <atomic>
+#include <condition_variable>
 #include <mutex>
 #include <thread>
 #include <vector>
@@ -88,8 +91,17 @@
 #include "lnav_log.hh"
 #include "opt_util.hh"
 
-static const size_t BUFFER_SIZE = 256 * 1024;
-static const size_t MAX_LOG_LINE_SIZE = 2 * 1024;
+/**
+ * The size of each thread's ring of log records, must be a power of two.
+ */
+static constexpr size_t RING_SIZE = 256 * 1024;
+static constexpr size_t MAX_LOG_LINE_SIZE = 2 * 1024;
+/**
+ * The maximum number of bytes of arguments saved with a record, strings are
+ * truncated to fit.
+ */
+static constexpr size_t MAX_ARGS_SIZE = 2 * 1024;
+static constexpr size_t MAX_RINGS = 128;
 
 static const char* CRASH_MSG
     = "\n"
@@ -107,15 +119,6 @@ nonstd::optional<FILE*> lnav_log_file;
 lnav_log_level_t lnav_log_level = lnav_log_level_t::DEBUG;
 const char* lnav_log_crash_dir;
 nonstd::optional<const struct termios*> lnav_log_orig_termios;
-// NOTE: This mutex is leaked so that it is not destroyed during exit.
-// Otherwise, any attempts to log will fail.
-static std::mutex*
-lnav_log_mutex()
-{
-    static auto* retval = new std::mutex();
-
-    return retval;
-}
 
 static std::vector<log_state_dumper*>&
 DUMPER_LIST()
@@ -127,25 +130,18 @@ DUMPER_LIST()
 static std::vector<log_crash_recoverer*> CRASH_LIST;
 
 struct thid {
-    static uint32_t COUNTER;
+    static std::atomic<uint32_t> COUNTER;
 
     thid() noexcept : t_id(COUNTER++) {}
 
     uint32_t t_id;
 };
 
-uint32_t thid::COUNTER = 0;
+std::atomic<uint32_t> thid::COUNTER{0};
 
 thread_local thid current_thid;
 thread_local std::string thread_log_prefix;
 
-static struct {
-    size_t lr_length;
-    off_t lr_frag_start;
-    off_t lr_frag_end;
-    char lr_data[BUFFER_SIZE];
-} log_ring = {0, BUFFER_SIZE, 0, {}};
-
 static const char* LEVEL_NAMES[] = {
     "T",
     "D",
@@ -154,36 +150,925 @@ static const char* LEVEL_NAMES[] = {
     "E",
 };
 
-static char*
-log_alloc()
+namespace {
+
+/**
+ * The type of an argument saved for a conversion in a format string.
+ */
+enum class arg_type : uint8_t {
+    none,
+    percent,
+    count,
+    int_,
+    long_,
+    llong,
+    size,
+    ptrdiff,
+    intmax,
+    dbl,
+    ldbl,
+    str,
+    ptr,
+};
+
+struct conversion {
+    /** One past the conversion character. */
+    const char* c_end;
+    /** The number of '*' widths and precisions that come before the value. */
+    int c_stars{0};
+    arg_type c_type{arg_type::none};
+};
+
+/**
+ * Parse the printf conversion that starts at the '%' in 'fmt'.
+ */
+conversion
+parse_conversion(const char* fmt)
 {
-    off_t data_end = log_ring.lr_length + MAX_LOG_LINE_SIZE;
+    conversion retval;
+    const auto* p = fmt + 1;
+
+    while (*p && strchr("-+ #0'", *p) != nullptr) {
+        p += 1;
+    }
+    if (*p == '*') {
+        retval.c_stars += 1;
+        p += 1;
+    }
+    while (isdigit(*p)) {
+        p += 1;
+    }
+    if (*p == '.') {
+        p += 1;
+        if (*p == '*') {
+            retval.c_stars += 1;
+            p += 1;
+        }
+        while (isdigit(*p)) {
+            p += 1;
+        }
+    }
+
+    auto int_type = arg_type::int_;
+    auto ldbl = false;
+    switch (*p) {
+        case 'h':
+            p += (p[1] == 'h') ? 2 : 1;
+            break;
+        case 'l':
+            if (p[1] == 'l') {
+                int_type = arg_type::llong;
+                p += 2;
+            } else {
+                int_type = arg_type::long_;
+                p += 1;
+            }
+            break;
+        case 'q':
+            int_type = arg_type::llong;
+            p += 1;
+            break;
+        case 'j':
+            int_type = arg_type::intmax;
+            p += 1;
+            break;
+        case 'z':
+            int_type = arg_type::size;
+            p += 1;
+            break;
+        case 't':
+            int_type = arg_type::ptrdiff;
+            p += 1;
+            break;
+        case 'L':
+            ldbl = true;
+            p += 1;
+            break;
+    }
+
+    switch (*p) {
+        case '\0':
+            retval.c_end = p;
+            retval.c_stars = 0;
+            return retval;
+        case '%':
+            retval.c_type = arg_type::percent;
+            break;
+        case 'n':
+            retval.c_type = arg_type::count;
+            break;
+        case 'd':
+        case 'i':
+        case 'o':
+        case 'u':
+        case 'x':
+        case 'X':
+        case 'c':
+            retval.c_type = int_type;
+            break;
+        case 'e':
+        case 'E':
+        case 'f':
+        case 'F':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':
+            retval.c_type = ldbl ? arg_type::ldbl : arg_type::dbl;
+            break;
+        case 's':
+            retval.c_type = arg_type::str;
+            break;
+        case 'p':
+            retval.c_type = arg_type::ptr;
+            break;
+        default:
+            retval.c_stars = 0;
+            break;
+    }
+    retval.c_end = p + 1;
+
+    return retval;
+}
+
+enum class record_kind : uint8_t {
+    message,
+    extra,
+    extra_complete,
+};
+
+/**
+ * The fixed part of a log record, it is followed by the raw arguments for
+ * the format string.  Formatting is deferred until the record is read out
+ * of the ring.
+ */
+struct record_header {
+    uint32_t rh_size;
+    uint32_t rh_thid;
+    record_kind rh_kind;
+    lnav_log_level_t rh_level;
+    int rh_line_number;
+    struct timespec rh_time;
+    const char* rh_src_file;
+    const char* rh_fmt;
+};
+
+constexpr size_t MAX_RECORD_SIZE = sizeof(record_header) + MAX_ARGS_SIZE + 8;
+
+/**
+ * A ring of log records that is written to by a single thread.  Readers
+ * use the head and tail positions, which only ever increase, to detect
+ * records that were overwritten while they were being copied.
+ */
+struct log_ring {
+    std::atomic<uint64_t> lr_head{0};
+    std::atomic<uint64_t> lr_tail{0};
+    std::atomic<bool> lr_in_use{false};
+    /** Set for the ring that is shared by threads that could not get one. */
+    std::mutex* lr_shared_lock{nullptr};
+    char lr_data[RING_SIZE];
+
+    void copy_in(uint64_t pos, const void* src, size_t len)
+    {
+        auto off = pos & (RING_SIZE - 1);
+        auto first = std::min(len, RING_SIZE - off);
+
+        memcpy(&this->lr_data[off], src, first);
+        memcpy(this->lr_data, (const char*) src + first, len - first);
+    }
 
-    if (data_end >= (off_t) BUFFER_SIZE) {
-        const char* new_start = &log_ring.lr_data[MAX_LOG_LINE_SIZE];
+    void copy_out(uint64_t pos, void* dst, size_t len) const
+    {
+        auto off = pos & (RING_SIZE - 1);
+        auto first = std::min(len, RING_SIZE - off);
+
+        memcpy(dst, &this->lr_data[off], first);
+        memcpy((char*) dst + first, this->lr_data, len - first);
+    }
+
+    void append(const record_header& hdr, const char* args)
+    {
+        auto pos = this->lr_head.load(std::memory_order_relaxed);
+        auto tail = this->lr_tail.load(std::memory_order_relaxed);
+
+        while (pos + hdr.rh_size - tail > RING_SIZE) {
+            uint32_t old_size;
+
+            this->copy_out(tail, &old_size, sizeof(old_size));
+            tail += old_size;
+        }
+        // Readers check the tail after copying a record, so it has to be
+        // visible before any of the old records are overwritten.
+        this->lr_tail.store(tail, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        this->copy_in(pos, &hdr, sizeof(hdr));
+        this->copy_in(
+            pos + sizeof(hdr), args, hdr.rh_size - sizeof(hdr));
+        this->lr_head.store(pos + hdr.rh_size, std::memory_order_release);
+    }
 
-        new_start = (const char*) memchr(
-            new_start, '\n', log_ring.lr_length - MAX_LOG_LINE_SIZE);
-        log_ring.lr_frag_start = new_start - log_ring.lr_data;
-        log_ring.lr_frag_end = log_ring.lr_length;
-        log_ring.lr_length = 0;
+    /**
+     * Copy the record at 'pos' into 'dst'.
+     *
+     * @param pos The position of the record to read, it is moved to the
+     *   oldest record if the one there has been overwritten.
+     * @param dst The buffer to copy into, it must have room for
+     *   MAX_RECORD_SIZE bytes, or just the header if 'header_only' is set.
+     * @return True if a record was copied.
+     */
+    bool read(uint64_t& pos, char* dst, bool header_only = false) const
+    {
+        while (true) {
+            auto head = this->lr_head.load(std::memory_order_acquire);
+            auto tail = this->lr_tail.load(std::memory_order_acquire);
 
-        assert(log_ring.lr_frag_start >= 0);
-        assert(log_ring.lr_frag_start <= (off_t) BUFFER_SIZE);
-    } else if (data_end >= log_ring.lr_frag_start) {
-        const char* new_start = &log_ring.lr_data[log_ring.lr_frag_start];
+            if (pos < tail) {
+                pos = tail;
+            }
+            if (pos >= head) {
+                return false;
+            }
 
-        new_start = (const char*) memchr(
-            new_start, '\n', log_ring.lr_frag_end - log_ring.lr_frag_start);
-        assert(new_start != nullptr);
-        log_ring.lr_frag_start = new_start - log_ring.lr_data;
-        assert(log_ring.lr_frag_start >= 0);
-        assert(log_ring.lr_frag_start <= (off_t) BUFFER_SIZE);
+            record_header hdr;
+            this->copy_out(pos, &hdr, sizeof(hdr));
+            auto valid = hdr.rh_size >= sizeof(hdr)
+                && hdr.rh_size <= MAX_RECORD_SIZE && pos + hdr.rh_size <= head;
+            if (valid) {
+                this->copy_out(
+                    pos, dst, header_only ? sizeof(hdr) : hdr.rh_size);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (valid
+                && this->lr_tail.load(std::memory_order_relaxed) <= pos)
+            {
+                return true;
+            }
+        }
     }
+};
+
+std::atomic<log_ring*> RINGS[MAX_RINGS];
+std::atomic<size_t> RING_COUNT{0};
 
-    return &log_ring.lr_data[log_ring.lr_length];
+// NOTE: The locks are leaked so that they are not destroyed during exit
+// and are created on first use since messages can be logged by static
+// initializers.  They are replaced in a forked child.
+
+/** Serializes the creation of rings, not the writes to them. */
+std::mutex*&
+ring_registry_mutex()
+{
+    static auto* retval = new std::mutex();
+
+    return retval;
+}
+
+log_ring*
+overflow_ring()
+{
+    static auto* retval = [] {
+        auto* ring = new log_ring;
+
+        ring->lr_shared_lock = new std::mutex();
+        return ring;
+    }();
+
+    return retval;
 }
 
+thread_local log_ring* thread_ring = nullptr;
+thread_local struct timespec thread_last_time;
+
+/**
+ * Gives the thread's ring back when the thread exits so that it can be
+ * reused by a new thread.  The records in the ring are kept for crash dumps.
+ */
+struct ring_releaser {
+    ~ring_releaser()
+    {
+        if (thread_ring != nullptr && thread_ring->lr_shared_lock == nullptr)
+        {
+            thread_ring->lr_in_use.store(false);
+        }
+        thread_ring = overflow_ring();
+    }
+};
+
+thread_local ring_releaser thread_ring_releaser;
+
+log_ring*
+current_ring()
+{
+    if (thread_ring != nullptr) {
+        return thread_ring;
+    }
+
+    std::lock_guard<std::mutex> lg(*ring_registry_mutex());
+    auto count = RING_COUNT.load();
+
+    for (size_t lpc = 0; lpc < count; lpc++) {
+        auto* ring = RINGS[lpc].load();
+        auto expected = false;
+
+        if (ring->lr_in_use.compare_exchange_strong(expected, true)) {
+            thread_ring = ring;
+            break;
+        }
+    }
+    if (thread_ring == nullptr) {
+        if (count < MAX_RINGS) {
+            auto* ring = new log_ring;
+
+            ring->lr_in_use = true;
+            RINGS[count].store(ring);
+            RING_COUNT.store(count + 1);
+            thread_ring = ring;
+        } else {
+            thread_ring = overflow_ring();
+        }
+    }
+    // Touch the releaser so it is constructed for this thread.
+    (void) &thread_ring_releaser;
+
+    return thread_ring;
+}
+
+/**
+ * Buffer for the raw arguments of a record.
+ */
+struct arg_writer {
+    char aw_data[MAX_ARGS_SIZE];
+    size_t aw_len{0};
+    bool aw_full{false};
+
+    template<typename T>
+    void put(T value)
+    {
+        if (this->aw_full || this->aw_len + sizeof(value) > MAX_ARGS_SIZE) {
+            this->aw_full = true;
+            return;
+        }
+        memcpy(&this->aw_data[this->aw_len], &value, sizeof(value));
+        this->aw_len += sizeof(value);
+    }
+
+    void put_str(const char* str, int precision)
+    {
+        if (str == nullptr) {
+            str = "(null)";
+        }
+
+        auto len = precision >= 0 ? strnlen(str, precision) : strlen(str);
+        if (this->aw_full
+            || this->aw_len + sizeof(uint32_t) >= MAX_ARGS_SIZE)
+        {
+            this->aw_full = true;
+            return;
+        }
+        len = std::min(len, MAX_ARGS_SIZE - this->aw_len - sizeof(uint32_t));
+        this->put((uint32_t) len);
+        memcpy(&this->aw_data[this->aw_len], str, len);
+        this->aw_len += len;
+    }
+};
+
+void
+save_args(arg_writer& aw, const char* fmt, va_list args)
+{
+    for (const auto* p = strchr(fmt, '%'); p != nullptr && !aw.aw_full;
+         p = strchr(p, '%'))
+    {
+        auto conv = parse_conversion(p);
+        int stars[2] = {0, -1};
+
+        for (int lpc = 0; lpc < conv.c_stars; lpc++) {
+            stars[lpc] = va_arg(args, int);
+            aw.put(stars[lpc]);
+        }
+        switch (conv.c_type) {
+            case arg_type::none:
+            case arg_type::percent:
+                break;
+            case arg_type::count:
+                (void) va_arg(args, int*);
+                break;
+            case arg_type::int_:
+                aw.put(va_arg(args, int));
+                break;
+            case arg_type::long_:
+                aw.put(va_arg(args, long));
+                break;
+            case arg_type::llong:
+                aw.put(va_arg(args, long long));
+                break;
+            case arg_type::size:
+                aw.put(va_arg(args, size_t));
+                break;
+            case arg_type::ptrdiff:
+                aw.put(va_arg(args, ptrdiff_t));
+                break;
+            case arg_type::intmax:
+                aw.put(va_arg(args, intmax_t));
+                break;
+            case arg_type::dbl:
+                aw.put(va_arg(args, double));
+                break;
+            case arg_type::ldbl:
+                aw.put(va_arg(args, long double));
+                break;
+            case arg_type::str: {
+                // The precision is the last star, if there was one.
+                auto precision = conv.c_stars > 0 ? stars[conv.c_stars - 1]
+                                                  : -1;
+                const auto* dot = static_cast<const char*>(
+                    memchr(p, '.', conv.c_end - p));
+
+                if (dot != nullptr && dot[1] != '*') {
+                    precision = atoi(dot + 1);
+                } else if (dot == nullptr) {
+                    precision = -1;
+                }
+                aw.put_str(va_arg(args, const char*), precision);
+                break;
+            }
+            case arg_type::ptr:
+                aw.put(va_arg(args, void*));
+                break;
+        }
+        p = conv.c_end;
+    }
+}
+
+void
+write_record(record_kind kind,
+             lnav_log_level_t level,
+             const char* src_file,
+             int line_number,
+             const char* fmt,
+             va_list args)
+{
+    arg_writer aw;
+    record_header hdr;
+
+    if (kind == record_kind::message) {
+        clock_gettime(CLOCK_REALTIME, &thread_last_time);
+    }
+    if (fmt != nullptr) {
+        save_args(aw, fmt, args);
+    }
+    hdr.rh_size = (sizeof(hdr) + aw.aw_len + 7) & ~7U;
+    hdr.rh_thid = current_thid.t_id;
+    hdr.rh_kind = kind;
+    hdr.rh_level = level;
+    hdr.rh_line_number = line_number;
+    hdr.rh_time = thread_last_time;
+    hdr.rh_src_file = src_file;
+    hdr.rh_fmt = fmt;
+
+    auto* ring = current_ring();
+    if (ring->lr_shared_lock != nullptr) {
+        std::lock_guard<std::mutex> lg(*ring->lr_shared_lock);
+
+        ring->append(hdr, aw.aw_data);
+    } else {
+        ring->append(hdr, aw.aw_data);
+    }
+}
+
+/**
+ * Reads back the arguments saved by save_args().
+ */
+struct arg_reader {
+    const char* ar_data;
+    size_t ar_len;
+    size_t ar_offset{0};
+
+    template<typename T>
+    bool get(T& value_out)
+    {
+        if (this->ar_offset + sizeof(value_out) > this->ar_len) {
+            return false;
+        }
+        memcpy(&value_out, &this->ar_data[this->ar_offset], sizeof(value_out));
+        this->ar_offset += sizeof(value_out);
+        return true;
+    }
+};
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+template<typename T>
+int
+format_arg(
+    char* dst, size_t len, const char* spec, int nstars, const int* stars, T value)
+{
+    switch (nstars) {
+        case 0:
+            return snprintf(dst, len, spec, value);
+        case 1:
+            return snprintf(dst, len, spec, stars[0], value);
+        default:
+            return snprintf(dst, len, spec, stars[0], stars[1], value);
+    }
+}
+#pragma GCC diagnostic pop
+
+template<typename T>
+bool
+format_saved_arg(arg_reader& ar,
+                 char* dst,
+                 size_t len,
+                 const char* spec,
+                 int nstars,
+                 const int* stars,
+                 int& rc_out)
+{
+    T value;
+
+    if (!ar.get(value)) {
+        return false;
+    }
+    rc_out = format_arg(dst, len, spec, nstars, stars, value);
+    return true;
+}
+
+/**
+ * Format the text of a record, without the prefix, into 'dst'.
+ *
+ * @return The number of bytes written.
+ */
+size_t
+format_args(
+    const char* fmt, arg_reader& ar, char* str_value, char* dst, size_t len)
+{
+    size_t retval = 0;
+    const auto* p = fmt;
+
+    while (*p && retval + 1 < len) {
+        if (*p != '%') {
+            const auto* pct = strchr(p, '%');
+            auto run_len = pct == nullptr ? strlen(p) : (size_t) (pct - p);
+
+            run_len = std::min(run_len, len - 1 - retval);
+            memcpy(&dst[retval], p, run_len);
+            retval += run_len;
+            p += run_len;
+            continue;
+        }
+
+        auto conv = parse_conversion(p);
+        char spec[32];
+        auto spec_len = (size_t) (conv.c_end - p);
+        int stars[2] = {0, 0};
+        int rc = 0;
+        auto ok = spec_len < sizeof(spec);
+
+        if (ok) {
+            memcpy(spec, p, spec_len);
+            spec[spec_len] = '\0';
+        }
+        for (int lpc = 0; lpc < conv.c_stars && ok; lpc++) {
+            ok = ar.get(stars[lpc]);
+        }
+        if (!ok) {
+            break;
+        }
+
+        auto* out = &dst[retval];
+        auto out_len = len - retval;
+        switch (conv.c_type) {
+            case arg_type::none:
+                rc = std::min(spec_len, out_len - 1);
+                memcpy(out, p, rc);
+                break;
+            case arg_type::percent:
+                out[0] = '%';
+                rc = 1;
+                break;
+            case arg_type::count:
+                break;
+            case arg_type::int_:
+                ok = format_saved_arg<int>(
+                    ar, out, out_len, spec, conv.c_stars, stars, rc);
+                break;
+            case arg_type::long_:
+                ok = format_saved_arg<long>(
+                    ar, out, out_len, spec, conv.c_stars, stars, rc);
+                break;
+            case arg_type::llong:
+                ok = format_saved_arg<long long>(
+                    ar, out, out_len, spec, conv.c_stars, stars, rc);
+                break;
+            case arg_type::size:
+                ok = format_saved_arg<size_t>(
+                    ar, out, out_len, spec, conv.c_stars, stars, rc);
+                break;
+            case arg_type::ptrdiff:
+                ok = format_saved_arg<ptrdiff_t>(
+                    ar, out, out_len, spec, conv.c_stars, stars, rc);
+                break;
+            case arg_type::intmax:
+                ok = format_saved_arg<intmax_t>(
+                    ar, out, out_len, spec, conv.c_stars, stars, rc);
+                break;
+            case arg_type::dbl:
+                ok = format_saved_arg<double>(
+                    ar, out, out_len, spec, conv.c_stars, stars, rc);
+                break;
+            case arg_type::ldbl:
+                ok = format_saved_arg<long double>(
+                    ar, out, out_len, spec, conv.c_stars, stars, rc);
+                break;
+            case arg_type::str: {
+                uint32_t str_len;
+
+                ok = ar.get(str_len) && ar.ar_offset + str_len <= ar.ar_len;
+                if (ok) {
+                    memcpy(str_value, &ar.ar_data[ar.ar_offset], str_len);
+                    str_value[str_len] = '\0';
+                    ar.ar_offset += str_len;
+                    rc = format_arg(out,
+                                    out_len,
+                                    spec,
+                                    conv.c_stars,
+                                    stars,
+                                    (const char*) str_value);
+                }
+                break;
+            }
+            case arg_type::ptr:
+                ok = format_saved_arg<void*>(
+                    ar, out, out_len, spec, conv.c_stars, stars, rc);
+                break;
+        }
+        if (!ok) {
+            break;
+        }
+        if (rc > 0) {
+            retval += std::min((size_t) rc, out_len - 1);
+        }
+        p = conv.c_end;
+    }
+
+    return retval;
+}
+
+/**
+ * The scratch space used to format records.  They are not allocated on
+ * demand so that records can be formatted in the crash handler.
+ */
+struct dump_buffers {
+    char db_record[MAX_RECORD_SIZE];
+    char db_str_value[MAX_ARGS_SIZE + 1];
+    char db_line[MAX_LOG_LINE_SIZE + 1];
+};
+
+/**
+ * Format a record copied out of a ring into a line of text.
+ *
+ * @return The number of bytes written to the line buffer.
+ */
+size_t
+format_record(dump_buffers& bufs)
+{
+    const auto* record = bufs.db_record;
+    auto* dst = bufs.db_line;
+    auto len = sizeof(bufs.db_line);
+    record_header hdr;
+    size_t retval = 0;
+
+    memcpy(&hdr, record, sizeof(hdr));
+    if (hdr.rh_kind == record_kind::message) {
+        struct tm localtm;
+        const char* src_file = hdr.rh_src_file;
+
+        // get the base name of the file.  NB: can't use basename() since it
+        // can modify its argument
+        for (int lpc = 0; hdr.rh_src_file[lpc]; lpc++) {
+            if (hdr.rh_src_file[lpc] == '/' || hdr.rh_src_file[lpc] == '\\') {
+                src_file = &hdr.rh_src_file[lpc + 1];
+            }
+        }
+
+        localtime_r(&hdr.rh_time.tv_sec, &localtm);
+        auto rc = snprintf(
+            dst,
+            len,
+            "%4d-%02d-%02dT%02d:%02d:%02d.%03d %s t%u %s:%d ",
+            localtm.tm_year + 1900,
+            localtm.tm_mon + 1,
+            localtm.tm_mday,
+            localtm.tm_hour,
+            localtm.tm_min,
+            localtm.tm_sec,
+            (int) (hdr.rh_time.tv_nsec / 1000000),
+            LEVEL_NAMES[lnav::enums::to_underlying(hdr.rh_level)],
+            hdr.rh_thid,
+            src_file,
+            hdr.rh_line_number);
+        if (rc > 0) {
+            retval = std::min((size_t) rc, len - 1);
+        }
+    }
+    if (hdr.rh_fmt != nullptr) {
+        arg_reader ar{record + sizeof(hdr), hdr.rh_size - sizeof(hdr)};
+
+        retval += format_args(hdr.rh_fmt,
+                              ar,
+                              bufs.db_str_value,
+                              &dst[retval],
+                              len - 1 - retval);
+    }
+    if (hdr.rh_kind != record_kind::extra) {
+        dst[retval] = '\n';
+        retval += 1;
+    }
+
+    return retval;
+}
+
+/**
+ * The read positions in each of the rings.
+ */
+struct ring_cursor {
+    uint64_t rc_pos[MAX_RINGS];
+    bool rc_started[MAX_RINGS];
+    size_t rc_last_ring{MAX_RINGS};
+};
+
+/**
+ * Format the records after the cursor's position in each ring, in the
+ * order that they were logged, and pass them to 'sink'.  No memory is
+ * allocated so that this can be used from the crash handler.
+ */
+template<typename F>
+void
+dump_records(ring_cursor& rc, dump_buffers& bufs, F sink)
+{
+    auto count = std::min(RING_COUNT.load(), MAX_RINGS);
+
+    for (size_t lpc = 0; lpc < count; lpc++) {
+        if (!rc.rc_started[lpc]) {
+            rc.rc_pos[lpc] = 0;
+            rc.rc_started[lpc] = true;
+        }
+    }
+
+    while (true) {
+        nonstd::optional<size_t> next_ring;
+        struct timespec next_time {};
+
+        for (size_t lpc = 0; lpc < count; lpc++) {
+            auto* ring = RINGS[lpc].load();
+            record_header hdr;
+
+            if (!ring->read(rc.rc_pos[lpc], (char*) &hdr, true)) {
+                continue;
+            }
+            // Prefer the ring that was just read from when the times are
+            // equal so that the continuations of a message stay with it.
+            if (!next_ring || hdr.rh_time.tv_sec < next_time.tv_sec
+                || (hdr.rh_time.tv_sec == next_time.tv_sec
+                    && (hdr.rh_time.tv_nsec < next_time.tv_nsec
+                        || (hdr.rh_time.tv_nsec == next_time.tv_nsec
+                            && lpc == rc.rc_last_ring))))
+            {
+                next_ring = lpc;
+                next_time = hdr.rh_time;
+            }
+        }
+        if (!next_ring) {
+            break;
+        }
+
+        auto* ring = RINGS[next_ring.value()].load();
+        auto& pos = rc.rc_pos[next_ring.value()];
+        if (!ring->read(pos, bufs.db_record)) {
+            continue;
+        }
+
+        record_header hdr;
+        memcpy(&hdr, bufs.db_record, sizeof(hdr));
+        pos += hdr.rh_size;
+        rc.rc_last_ring = next_ring.value();
+        sink(bufs.db_line, format_record(bufs));
+    }
+}
+
+/** The position in each ring that has been written to the debug file. */
+ring_cursor FILE_CURSOR;
+
+std::mutex*&
+file_mutex()
+{
+    static auto* retval = new std::mutex();
+
+    return retval;
+}
+
+std::mutex*&
+writer_mutex()
+{
+    static auto* retval = new std::mutex();
+
+    return retval;
+}
+
+std::condition_variable*&
+writer_cond()
+{
+    static auto* retval = new std::condition_variable();
+
+    return retval;
+}
+std::atomic<bool> writer_started{false};
+
+void
+flush_to_file_locked()
+{
+    static dump_buffers bufs;
+
+    lnav_log_file | [](auto file) {
+        dump_records(FILE_CURSOR, bufs, [file](const char* line, size_t len) {
+            fwrite(line, 1, len, file);
+        });
+        fflush(file);
+    };
+}
+
+void
+flush_to_file()
+{
+    std::lock_guard<std::mutex> lg(*file_mutex());
+
+    flush_to_file_locked();
+}
+
+/**
+ * Start the thread that writes the records to the debug file in the
+ * background.
+ */
+void
+start_writer()
+{
+    std::lock_guard<std::mutex> lg(*writer_mutex());
+
+    if (writer_started.load()) {
+        return;
+    }
+
+    static auto once = [] {
+        atexit(log_flush);
+        pthread_atfork(nullptr, nullptr, [] {
+            // Only the forking thread exists in the child, so any locks
+            // held by others are replaced and the writer is started again.
+            ring_registry_mutex() = new std::mutex();
+            file_mutex() = new std::mutex();
+            writer_mutex() = new std::mutex();
+            writer_cond() = new std::condition_variable();
+            writer_started.store(false);
+            overflow_ring()->lr_shared_lock = new std::mutex();
+
+            // Don't copy the parent's history into the child's debug file.
+            auto count = std::min(RING_COUNT.load(), MAX_RINGS);
+            for (size_t lpc = 0; lpc < count; lpc++) {
+                FILE_CURSOR.rc_pos[lpc] = RINGS[lpc].load()->lr_head.load();
+                FILE_CURSOR.rc_started[lpc] = true;
+            }
+        });
+        return true;
+    }();
+    (void) once;
+
+    writer_started.store(true);
+    std::thread([] {
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lk(*writer_mutex());
+
+                writer_cond()->wait_for(lk, std::chrono::milliseconds(250));
+            }
+            flush_to_file();
+        }
+    }).detach();
+}
+
+void
+after_write(lnav_log_level_t level)
+{
+    if (!lnav_log_file) {
+        return;
+    }
+    if (!writer_started.load(std::memory_order_relaxed)) {
+        start_writer();
+    }
+    if (level >= lnav_log_level_t::ERROR) {
+        writer_cond()->notify_one();
+    }
+}
+
+}  // namespace
+
 void
 log_argv(int argc, char* argv[])
 {
@@ -296,100 +1181,48 @@ log_msg(lnav_log_level_t level,
         const char* fmt,
         ...)
 {
-    struct timeval curr_time;
-    struct tm localtm;
-    ssize_t prefix_size;
     va_list args;
-    ssize_t rc;
 
     if (level < lnav_log_level) {
         return;
     }
 
-    std::lock_guard<std::mutex> log_lock(*lnav_log_mutex());
-
-    {
-        // get the base name of the file.  NB: can't use basename() since it
-        // can modify its argument
-        const char* last_slash = src_file;
-
-        for (int lpc = 0; src_file[lpc]; lpc++) {
-            if (src_file[lpc] == '/' || src_file[lpc] == '\\') {
-                last_slash = &src_file[lpc + 1];
-            }
-        }
-
-        src_file = last_slash;
-    }
-
     va_start(args, fmt);
-    gettimeofday(&curr_time, nullptr);
-    localtime_r(&curr_time.tv_sec, &localtm);
-    auto line = log_alloc();
-    prefix_size = snprintf(line,
-                           MAX_LOG_LINE_SIZE,
-                           "%4d-%02d-%02dT%02d:%02d:%02d.%03d %s t%u %s:%d ",
-                           localtm.tm_year + 1900,
-                           localtm.tm_mon + 1,
-                           localtm.tm_mday,
-                           localtm.tm_hour,
-                           localtm.tm_min,
-                           localtm.tm_sec,
-                           (int) (curr_time.tv_usec / 1000),
-                           LEVEL_NAMES[lnav::enums::to_underlying(level)],
-                           current_thid.t_id,
-                           src_file,
-                           line_number);
-#if 0
-    if (!thread_log_prefix.empty()) {
-        prefix_size += snprintf(
-            &line[prefix_size], MAX_LOG_LINE_SIZE - prefix_size,
-            "%s ",
-            thread_log_prefix.c_str());
-    }
-#endif
-    rc = vsnprintf(
-        &line[prefix_size], MAX_LOG_LINE_SIZE - prefix_size, fmt, args);
-    if (rc >= (ssize_t) (MAX_LOG_LINE_SIZE - prefix_size)) {
-        rc = MAX_LOG_LINE_SIZE - prefix_size - 1;
-    }
-    line[prefix_size + rc] = '\n';
-    log_ring.lr_length += prefix_size + rc + 1;
-    lnav_log_file | [&](auto file) {
-        fwrite(line, 1, prefix_size + rc + 1, file);
-        fflush(file);
-    };
+    write_record(record_kind::message, level, src_file, line_number, fmt, args);
     va_end(args);
+    after_write(level);
 }
 
 void
 log_msg_extra(const char* fmt, ...)
 {
-    std::lock_guard<std::mutex> mg(*lnav_log_mutex());
     va_list args;
 
     va_start(args, fmt);
-    auto line = log_alloc();
-    auto rc = vsnprintf(line, MAX_LOG_LINE_SIZE - 1, fmt, args);
-    log_ring.lr_length += rc;
-    lnav_log_file | [&](auto file) {
-        fwrite(line, 1, rc, file);
-        fflush(file);
-    };
+    write_record(
+        record_kind::extra, lnav_log_level_t::INFO, nullptr, 0, fmt, args);
     va_end(args);
+    after_write(lnav_log_level_t::INFO);
 }
 
 void
 log_msg_extra_complete()
 {
-    std::lock_guard<std::mutex> mg(*lnav_log_mutex());
-    auto line = log_alloc();
-    line[0] = '\n';
-    log_ring.lr_length += 1;
-    lnav_log_file | [&](auto file) {
-        fwrite(line, 1, 1, file);
-        fflush(file);
-    };
+    va_list args{};
+
+    write_record(record_kind::extra_complete,
+                 lnav_log_level_t::INFO,
+                 nullptr,
+                 0,
+                 nullptr,
+                 args);
+    after_write(lnav_log_level_t::INFO);
+}
+
+void
+log_flush()
+{
+    flush_to_file();
 }
 
 #pragma GCC diagnostic push
@@ -405,13 +1238,22 @@ sigabrt(int sig, siginfo_t* info, void* ctx)
 #endif
     struct tm localtm;
     time_t curr_time;
+    static dump_buffers bufs;
+    static ring_cursor crash_cursor;
 
     if (lnav_log_crash_dir == nullptr) {
-        printf("%*s", (int) log_ring.lr_length, log_ring.lr_data);
+        dump_records(crash_cursor, bufs, [](const char* line, size_t len) {
+            fwrite(line, 1, len, stdout);
+        });
         return;
     }
 
     log_error("Received signal: %d", sig);
+    // The writer thread might be the one that crashed, so don't wait for it.
+    if (file_mutex()->try_lock()) {
+        flush_to_file_locked();
+        file_mutex()->unlock();
+    }
 
 #ifdef HAVE_EXECINFO_H
     frame_count = backtrace(frames, 128);
@@ -434,12 +1276,11 @@ sigabrt(int sig, siginfo_t* info, void* ctx)
              "%s/latest-crash.log",
              lnav_log_crash_dir);
     if ((fd = open(crash_path, O_CREAT | O_TRUNC | O_RDWR, 0600)) != -1) {
-        if (log_ring.lr_frag_start < (off_t) BUFFER_SIZE) {
-            (void) write(fd,
-                         &log_ring.lr_data[log_ring.lr_frag_start],
-                         log_ring.lr_frag_end - log_ring.lr_frag_start);
-        }
-        (void) write(fd, log_ring.lr_data, log_ring.lr_length);
+        auto write_line = [fd](const char* line, size_t len) {
+            (void) write(fd, line, len);
+        };
+
+        dump_records(crash_cursor, bufs, write_line);
 #ifdef HAVE_EXECINFO_H
         backtrace_symbols_fd(frames, frame_count, fd);
 #endif
@@ -485,22 +1326,14 @@ sigabrt(int sig, siginfo_t* info, void* ctx)
             }
         }
 #endif
-        log_ring.lr_length = 0;
-        log_ring.lr_frag_start = BUFFER_SIZE;
-        log_ring.lr_frag_end = 0;
-
         log_host_info();
 
         for (auto lsd : DUMPER_LIST()) {
             lsd->log_state();
         }
 
-        if (log_ring.lr_frag_start < (off_t) BUFFER_SIZE) {
-            write(fd,
-                  &log_ring.lr_data[log_ring.lr_frag_start],
-                  log_ring.lr_frag_end - log_ring.lr_frag_start);
-        }
-        write(fd, log_ring.lr_data, log_ring.lr_length);
+        // Only the records logged since the first dump are written.
+        dump_records(crash_cursor, bufs, write_line);
         if (getenv("DUMP_CRASH") != nullptr) {
             char buffer[1024];
             int rc;
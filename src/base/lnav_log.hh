@@ -60,6 +60,12 @@ void log_rusage_raw(enum lnav_log_level_t level,
                     const char* src_file,
                     int line_number,
                     const struct rusage& ru);
+/**
+ * Record a log message.  The arguments are saved in a ring for the current
+ * thread and the message is not formatted until the records are written
+ * out to the debug file or a crash log.  So, the format string and source
+ * file name must be string literals.
+ */
 void log_msg(enum lnav_log_level_t level,
              const char* src_file,
              int line_number,
@@ -67,6 +73,11 @@ void log_msg(enum lnav_log_level_t level,
              ...);
 void log_msg_extra(const char* fmt, ...);
 void log_msg_extra_complete();
+/**
+ * Write any records that have not been written to the debug file yet.
+ * This is normally done in the background.
+ */
+void log_flush();
 void log_install_handlers();
 void log_abort() lnav_dead2;
 void log_pipe_err(int fd);
@@ -0,0 +1,109 @@
+/**
+ * Copyright (c) 2023, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string>
+#include <thread>
+
+#include <stdio.h>
+
+#include "config.h"
+#include "doctest/doctest.h"
+#include "lnav_log.hh"
+
+static std::string
+read_log(FILE* file)
+{
+    std::string retval;
+    char buffer[4096];
+    size_t rc;
+
+    log_flush();
+    fseek(file, 0, SEEK_SET);
+    while ((rc = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        retval.append(buffer, rc);
+    }
+
+    return retval;
+}
+
+TEST_CASE("log_msg-deferred-format")
+{
+    auto* file = tmpfile();
+    lnav_log_file = file;
+
+    {
+        std::string value = "transient";
+
+        log_info("str=%s int=%d long=%ld size=%zu dbl=%.2f pct=100%%",
+                 value.c_str(),
+                 -42,
+                 1234567890123L,
+                 (size_t) 7,
+                 3.14159);
+        value.assign("overwritten");
+    }
+    log_error("partial=%.*s width=[%5s] star=[%*d]", 3, "abcdef", "ab", 4, 9);
+    log_info("extra");
+    log_msg_extra(" %d", 1);
+    log_msg_extra(" %s", "two");
+    log_msg_extra_complete();
+
+    std::thread([] { log_warning("from another thread %d", 5); }).join();
+
+    auto content = read_log(file);
+    CHECK(content.find(" I t") != std::string::npos);
+    CHECK(content.find("str=transient int=-42 long=1234567890123 size=7 "
+                       "dbl=3.14 pct=100%\n")
+          != std::string::npos);
+    CHECK(content.find("partial=abc width=[   ab] star=[   9]\n")
+          != std::string::npos);
+    CHECK(content.find("lnav_log.tests.cc:") != std::string::npos);
+    CHECK(content.find("extra\n 1 two\n") != std::string::npos);
+    CHECK(content.find("from another thread 5\n") != std::string::npos);
+
+    // The background writer might still be using the file, so leave it open.
+    lnav_log_file = nonstd::nullopt;
+}
+
+TEST_CASE("log_msg-ring-wraps")
+{
+    auto* file = tmpfile();
+    lnav_log_file = file;
+
+    for (int lpc = 0; lpc < 20000; lpc++) {
+        log_debug("filler message %d %s", lpc, "with some padding text");
+    }
+
+    auto content = read_log(file);
+    CHECK(content.find("filler message 19999 with some padding text\n")
+          != std::string::npos);
+
+    // The background writer might still be using the file, so leave it open.
+    lnav_log_file = nonstd::nullopt;
+}
@@ -0,0 +1,333 @@
+/**
+ * Copyright (c) 2022, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <cmath>
+
+#include "sketch.hh"
+
+#include "config.h"
+
+namespace lnav {
+namespace sketch {
+
+constexpr int distinct_counter::PRECISION;
+constexpr size_t distinct_counter::REGISTER_COUNT;
+constexpr size_t heavy_hitters::DEFAULT_CAPACITY;
+constexpr double quantiles::RELATIVE_ACCURACY;
+
+void
+distinct_counter::add(string_fragment sf)
+{
+    uint64_t hash = hash_str(sf.data(), sf.length());
+    auto index = hash >> (64 - PRECISION);
+    auto rest = hash << PRECISION;
+    uint8_t rank
+        = rest == 0 ? (64 - PRECISION + 1) : __builtin_clzll(rest) + 1;
+
+    if (rank > this->dc_registers[index]) {
+        this->dc_registers[index] = rank;
+    }
+}
+
+void
+distinct_counter::merge(const distinct_counter& other)
+{
+    for (size_t lpc = 0; lpc < REGISTER_COUNT; lpc++) {
+        this->dc_registers[lpc]
+            = std::max(this->dc_registers[lpc], other.dc_registers[lpc]);
+    }
+}
+
+uint64_t
+distinct_counter::estimate() const
+{
+    static const double M = REGISTER_COUNT;
+    static const double ALPHA = 0.7213 / (1.0 + 1.079 / M);
+
+    double sum = 0.0;
+    size_t zeros = 0;
+
+    for (auto reg : this->dc_registers) {
+        sum += std::ldexp(1.0, -reg);
+        if (reg == 0) {
+            zeros += 1;
+        }
+    }
+
+    auto retval = ALPHA * M * M / sum;
+    if (retval <= 2.5 * M && zeros > 0) {
+        // Use linear counting for small cardinalities.
+        retval = M * std::log(M / (double) zeros);
+    }
+
+    return std::llround(retval);
+}
+
+double
+distinct_counter::standard_error()
+{
+    return 1.04 / std::sqrt((double) REGISTER_COUNT);
+}
+
+void
+heavy_hitters::add(string_fragment sf)
+{
+    for (auto& ent : this->hh_entries) {
+        if (sf == ent.e_value) {
+            ent.e_count += 1;
+            return;
+        }
+    }
+
+    if (this->hh_entries.size() < this->hh_capacity) {
+        this->hh_entries.emplace_back(entry{sf.to_string(), 1, 0});
+        return;
+    }
+
+    // Replace the least frequent value and inherit its count as the error.
+    auto min_iter = std::min_element(
+        this->hh_entries.begin(),
+        this->hh_entries.end(),
+        [](const auto& lhs, const auto& rhs) {
+            return lhs.e_count < rhs.e_count;
+        });
+    min_iter->e_value = sf.to_string();
+    min_iter->e_error = min_iter->e_count;
+    min_iter->e_count += 1;
+}
+
+uint64_t
+heavy_hitters::min_count() const
+{
+    if (this->hh_entries.size() < this->hh_capacity) {
+        return 0;
+    }
+
+    uint64_t retval = UINT64_MAX;
+    for (const auto& ent : this->hh_entries) {
+        retval = std::min(retval, ent.e_count);
+    }
+
+    return retval;
+}
+
+void
+heavy_hitters::merge(const heavy_hitters& other)
+{
+    auto this_min = this->min_count();
+    auto other_min = other.min_count();
+    std::vector<bool> other_used(other.hh_entries.size());
+
+    // A value missing from one summary could have been seen up to that
+    // summary's minimum count, so that is added to the count and error.
+    for (auto& ent : this->hh_entries) {
+        auto found = false;
+
+        for (size_t lpc = 0; lpc < other.hh_entries.size(); lpc++) {
+            const auto& other_ent = other.hh_entries[lpc];
+
+            if (ent.e_value == other_ent.e_value) {
+                ent.e_count += other_ent.e_count;
+                ent.e_error += other_ent.e_error;
+                other_used[lpc] = true;
+                found = true;
+                break;
+            }
+        }
+        if (!found) {
+            ent.e_count += other_min;
+            ent.e_error += other_min;
+        }
+    }
+    for (size_t lpc = 0; lpc < other.hh_entries.size(); lpc++) {
+        if (other_used[lpc]) {
+            continue;
+        }
+
+        auto ent = other.hh_entries[lpc];
+        ent.e_count += this_min;
+        ent.e_error += this_min;
+        this->hh_entries.emplace_back(std::move(ent));
+    }
+
+    std::stable_sort(this->hh_entries.begin(),
+                     this->hh_entries.end(),
+                     [](const auto& lhs, const auto& rhs) {
+                         return lhs.e_count > rhs.e_count;
+                     });
+    if (this->hh_entries.size() > this->hh_capacity) {
+        this->hh_entries.resize(this->hh_capacity);
+    }
+}
+
+std::vector<heavy_hitters::entry>
+heavy_hitters::top(size_t count) const
+{
+    auto retval = this->hh_entries;
+
+    std::stable_sort(
+        retval.begin(), retval.end(), [](const auto& lhs, const auto& rhs) {
+            return lhs.e_count > rhs.e_count;
+        });
+    if (retval.size() > count) {
+        retval.resize(count);
+    }
+
+    return retval;
+}
+
+static const double GAMMA = (1.0 + quantiles::RELATIVE_ACCURACY)
+    / (1.0 - quantiles::RELATIVE_ACCURACY);
+static const double LOG_GAMMA = std::log(GAMMA);
+
+int32_t
+quantiles::bucket_for(double value)
+{
+    return (int32_t) std::ceil(std::log(value) / LOG_GAMMA);
+}
+
+double
+quantiles::value_for(int32_t bucket)
+{
+    return 2.0 * std::pow(GAMMA, bucket) / (GAMMA + 1.0);
+}
+
+void
+quantiles::add(double value)
+{
+    if (!std::isfinite(value)) {
+        return;
+    }
+
+    if (this->q_count == 0) {
+        this->q_min = this->q_max = value;
+    } else {
+        this->q_min = std::min(this->q_min, value);
+        this->q_max = std::max(this->q_max, value);
+    }
+    this->q_count += 1;
+    if (value > 0.0) {
+        this->q_positive[bucket_for(value)] += 1;
+    } else if (value < 0.0) {
+        this->q_negative[bucket_for(-value)] += 1;
+    } else {
+        this->q_zero_count += 1;
+    }
+}
+
+void
+quantiles::merge(const quantiles& other)
+{
+    if (other.q_count == 0) {
+        return;
+    }
+
+    if (this->q_count == 0) {
+        this->q_min = other.q_min;
+        this->q_max = other.q_max;
+    } else {
+        this->q_min = std::min(this->q_min, other.q_min);
+        this->q_max = std::max(this->q_max, other.q_max);
+    }
+    this->q_count += other.q_count;
+    this->q_zero_count += other.q_zero_count;
+    for (const auto& pair : other.q_positive) {
+        this->q_positive[pair.first] += pair.second;
+    }
+    for (const auto& pair : other.q_negative) {
+        this->q_negative[pair.first] += pair.second;
+    }
+}
+
+nonstd::optional<double>
+quantiles::quantile(double q) const
+{
+    if (this->q_count == 0 || q < 0.0 || q > 1.0) {
+        return nonstd::nullopt;
+    }
+
+    auto rank = (uint64_t) (q * (double) (this->q_count - 1));
+    uint64_t seen = 0;
+    nonstd::optional<double> retval;
+
+    for (auto iter = this->q_negative.rbegin();
+         iter != this->q_negative.rend() && !retval;
+         ++iter)
+    {
+        seen += iter->second;
+        if (seen > rank) {
+            retval = -value_for(iter->first);
+        }
+    }
+    if (!retval) {
+        seen += this->q_zero_count;
+        if (seen > rank) {
+            retval = 0.0;
+        }
+    }
+    for (auto iter = this->q_positive.begin();
+         iter != this->q_positive.end() && !retval;
+         ++iter)
+    {
+        seen += iter->second;
+        if (seen > rank) {
+            retval = value_for(iter->first);
+        }
+    }
+
+    if (!retval) {
+        return this->q_max;
+    }
+
+    return std::min(std::max(retval.value(), this->q_min), this->q_max);
+}
+
+nonstd::optional<double>
+quantiles::min() const
+{
+    if (this->q_count == 0) {
+        return nonstd::nullopt;
+    }
+
+    return this->q_min;
+}
+
+nonstd::optional<double>
+quantiles::max() const
+{
+    if (this->q_count == 0) {
+        return nonstd::nullopt;
+    }
+
+    return this->q_max;
+}
+
+}  // namespace sketch
+}  // namespace lnav
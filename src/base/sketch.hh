@@ -0,0 +1,158 @@
+/**
+ * Copyright (c) 2022, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef lnav_sketch_hh
+#define lnav_sketch_hh
+
+#include <array>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <stdint.h>
+
+#include "intern_string.hh"
+#include "optional.hpp"
+
+namespace lnav {
+namespace sketch {
+
+/**
+ * A HyperLogLog counter for estimating the number of distinct values.
+ */
+class distinct_counter {
+public:
+    static constexpr int PRECISION = 10;
+    static constexpr size_t REGISTER_COUNT = 1U << PRECISION;
+
+    void add(string_fragment sf);
+
+    void merge(const distinct_counter& other);
+
+    uint64_t estimate() const;
+
+    /** The relative standard error of the estimate. */
+    static double standard_error();
+
+private:
+    std::array<uint8_t, REGISTER_COUNT> dc_registers{};
+};
+
+/**
+ * A "Space-Saving" summary of the most frequent values.  The count for a
+ * value is an overestimate of at most hh_error.
+ */
+class heavy_hitters {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 64;
+
+    struct entry {
+        std::string e_value;
+        uint64_t e_count{0};
+        uint64_t e_error{0};
+    };
+
+    void add(string_fragment sf);
+
+    void merge(const heavy_hitters& other);
+
+    /** @return The entries, sorted by count in descending order. */
+    std::vector<entry> top(size_t count) const;
+
+private:
+    uint64_t min_count() const;
+
+    size_t hh_capacity{DEFAULT_CAPACITY};
+    std::vector<entry> hh_entries;
+};
+
+/**
+ * A quantile summary that puts values into logarithmically sized buckets,
+ * so that any quantile estimate is within a fixed relative error of the
+ * actual value.
+ */
+class quantiles {
+public:
+    static constexpr double RELATIVE_ACCURACY = 0.01;
+
+    void add(double value);
+
+    void merge(const quantiles& other);
+
+    nonstd::optional<double> quantile(double q) const;
+
+    uint64_t count() const { return this->q_count; }
+
+    nonstd::optional<double> min() const;
+    nonstd::optional<double> max() const;
+
+private:
+    static int32_t bucket_for(double value);
+    static double value_for(int32_t bucket);
+
+    uint64_t q_count{0};
+    uint64_t q_zero_count{0};
+    double q_min{0};
+    double q_max{0};
+    std::map<int32_t, uint64_t> q_positive;
+    std::map<int32_t, uint64_t> q_negative;
+};
+
+/**
+ * The sketches that are kept for a single field.
+ */
+struct field_summary {
+    uint64_t fs_count{0};
+    distinct_counter fs_distinct;
+    heavy_hitters fs_top;
+    quantiles fs_quantiles;
+
+    void add(string_fragment sf, nonstd::optional<double> num)
+    {
+        this->fs_count += 1;
+        this->fs_distinct.add(sf);
+        this->fs_top.add(sf);
+        if (num) {
+            this->fs_quantiles.add(num.value());
+        }
+    }
+
+    void merge(const field_summary& other)
+    {
+        this->fs_count += other.fs_count;
+        this->fs_distinct.merge(other.fs_distinct);
+        this->fs_top.merge(other.fs_top);
+        this->fs_quantiles.merge(other.fs_quantiles);
+    }
+};
+
+}  // namespace sketch
+}  // namespace lnav
+
+#endif
@@ -0,0 +1,113 @@
+/**
+ * Copyright (c) 2022, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cmath>
+#include <string>
+
+#include "config.h"
+#include "doctest/doctest.h"
+#include "sketch.hh"
+
+TEST_CASE("sketch::distinct_counter")
+{
+    lnav::sketch::distinct_counter dc1, dc2;
+
+    CHECK(dc1.estimate() == 0);
+
+    for (int lpc = 0; lpc < 10000; lpc++) {
+        auto value = std::to_string(lpc);
+
+        dc1.add(string_fragment::from_str(value));
+        dc1.add(string_fragment::from_str(value));
+    }
+    for (int lpc = 5000; lpc < 20000; lpc++) {
+        auto value = std::to_string(lpc);
+
+        dc2.add(string_fragment::from_str(value));
+    }
+
+    auto err = lnav::sketch::distinct_counter::standard_error() * 3;
+    CHECK(std::abs((double) dc1.estimate() - 10000.0) < 10000.0 * err);
+    dc1.merge(dc2);
+    CHECK(std::abs((double) dc1.estimate() - 20000.0) < 20000.0 * err);
+}
+
+TEST_CASE("sketch::heavy_hitters")
+{
+    lnav::sketch::heavy_hitters hh1, hh2;
+
+    for (int lpc = 0; lpc < 1000; lpc++) {
+        hh1.add(string_fragment::from_const("a"));
+        if (lpc % 2 == 0) {
+            hh1.add(string_fragment::from_const("b"));
+        }
+        auto noise = std::to_string(lpc);
+        hh1.add(string_fragment::from_str(noise));
+    }
+    for (int lpc = 0; lpc < 800; lpc++) {
+        hh2.add(string_fragment::from_const("b"));
+    }
+
+    auto top1 = hh1.top(2);
+    REQUIRE(top1.size() == 2);
+    CHECK(top1[0].e_value == "a");
+    CHECK(top1[1].e_value == "b");
+    CHECK(top1[0].e_count - top1[0].e_error <= 1000);
+    CHECK(top1[0].e_count >= 1000);
+
+    hh1.merge(hh2);
+    auto top2 = hh1.top(2);
+    REQUIRE(top2.size() == 2);
+    CHECK(top2[0].e_value == "b");
+    CHECK(top2[0].e_count >= 1300);
+    CHECK(top2[0].e_count - top2[0].e_error <= 1300);
+}
+
+TEST_CASE("sketch::quantiles")
+{
+    lnav::sketch::quantiles q1, q2;
+
+    CHECK(!q1.quantile(0.5));
+
+    for (int lpc = 1; lpc <= 1000; lpc++) {
+        q1.add(lpc);
+        q2.add(-lpc);
+    }
+
+    auto accuracy = lnav::sketch::quantiles::RELATIVE_ACCURACY;
+    CHECK(q1.quantile(0.0).value() == 1.0);
+    CHECK(q1.quantile(1.0).value() == 1000.0);
+    CHECK(std::abs(q1.quantile(0.5).value() - 500.0) <= 500.0 * accuracy);
+    CHECK(std::abs(q1.quantile(0.99).value() - 990.0) <= 990.0 * accuracy);
+
+    q1.merge(q2);
+    CHECK(q1.count() == 2000);
+    CHECK(q1.min().value() == -1000.0);
+    CHECK(std::abs(q1.quantile(0.25).value() + 500.0) <= 500.0 * accuracy);
+}
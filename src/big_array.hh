@@ -32,9 +32,11 @@
 #ifndef lnav_big_array_hh
 #define lnav_big_array_hh
 
+#include <string.h>
 #include <sys/mman.h>
 #include <unistd.h>
 
+#include "base/lnav_log.hh"
 #include "base/math_util.hh"
 
 template<typename T>
@@ -52,15 +54,10 @@ struct big_array {
             return false;
         }
 
-        if (this->ba_ptr) {
-            munmap(this->ba_ptr,
-                   roundup_size(this->ba_capacity * sizeof(T), getpagesize()));
-        }
-
-        this->ba_capacity = size + DEFAULT_INCREMENT;
+        auto new_capacity = size + DEFAULT_INCREMENT;
         void* result
             = mmap(nullptr,
-                   roundup_size(this->ba_capacity * sizeof(T), getpagesize()),
+                   roundup_size(new_capacity * sizeof(T), getpagesize()),
                    PROT_READ | PROT_WRITE,
                    MAP_ANONYMOUS | MAP_PRIVATE,
                    -1,
@@ -68,6 +65,15 @@ struct big_array {
 
         ensure(result != MAP_FAILED);
 
+        if (this->ba_ptr) {
+            // Carry over the existing elements so that callers do not have to
+            // rebuild the array from scratch when it grows.
+            memcpy(result, this->ba_ptr, this->ba_size * sizeof(T));
+            munmap(this->ba_ptr,
+                   roundup_size(this->ba_capacity * sizeof(T), getpagesize()));
+        }
+
+        this->ba_capacity = new_capacity;
         this->ba_ptr = (T*) result;
 
         return true;
@@ -27,6 +27,7 @@
  * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <algorithm>
 #include <vector>
 
 #include "command_executor.hh"
@@ -42,6 +43,7 @@
 #include "help_text_formatter.hh"
 #include "lnav.hh"
 #include "lnav.indexing.hh"
+#include "lnav.query_pool.hh"
 #include "lnav_config.hh"
 #include "lnav_util.hh"
 #include "log_format_loader.hh"
@@ -109,6 +111,39 @@ static Result<std::string, lnav::console::user_message> execute_from_file(
     int line_number,
     const std::string& cmdline);
 
+/**
+ * Wait for the queries started by ":write-query-csv-to" so that their
+ * results are complete before anything else can look at them or change the
+ * logs they are reading.
+ */
+static Result<std::string, lnav::console::user_message>
+wait_for_queries(exec_context& ec)
+{
+    auto errors = lnav::query_pool::wait();
+
+    if (!errors.empty()) {
+        return ec.make_error("background query failed -- {}",
+                             errors.front());
+    }
+
+    return Ok(std::string());
+}
+
+/**
+ * Commands that only change the filters can be applied together as part of a
+ * text_sub_source::filter_batch.  Anything else might look at the filtered
+ * content, so the pending changes need to be applied first.
+ */
+static bool
+is_filter_command(const readline_context::command_t& cmd)
+{
+    const auto& tags = cmd.c_help.ht_tags;
+
+    return std::any_of(tags.begin(), tags.end(), [](const char* tag) {
+        return strcmp(tag, "filtering") == 0;
+    });
+}
+
 Result<std::string, lnav::console::user_message>
 execute_command(exec_context& ec, const std::string& cmdline)
 {
@@ -124,6 +159,12 @@ execute_command(exec_context& ec, const std::string& cmdline)
         if ((iter = lnav_commands.find(args[0])) == lnav_commands.end()) {
             return ec.make_error("unknown command - {}", args[0]);
         }
+        if (args[0] != "write-query-csv-to") {
+            TRY(wait_for_queries(ec));
+        }
+        if (!is_filter_command(*iter->second)) {
+            text_sub_source::filter_batch::flush();
+        }
 
         ec.ec_current_help = &iter->second->c_help;
         auto retval = iter->second->c_func(ec, cmdline, args);
@@ -251,6 +292,10 @@ bind_sql_parameters(exec_context& ec, sqlite3_stmt* stmt)
 static void
 execute_search(const std::string& search_cmd)
 {
+    for (const auto& err : lnav::query_pool::wait()) {
+        log_error("background query failed -- %s", err.c_str());
+    }
+    text_sub_source::filter_batch::flush();
     lnav_data.ld_view_stack.top() | [&search_cmd](auto tc) {
         auto search_term
             = string_fragment(search_cmd)
@@ -272,6 +317,9 @@ execute_sql(exec_context& ec, const std::string& sql, std::string& alt_msg)
 
     log_info("Executing SQL: %s", sql.c_str());
 
+    TRY(wait_for_queries(ec));
+    text_sub_source::filter_batch::flush();
+
     auto old_mode = lnav_data.ld_mode;
     lnav_data.ld_mode = ln_mode_t::BUSY;
     auto mode_fin = finally([old_mode]() { lnav_data.ld_mode = old_mode; });
@@ -370,6 +418,12 @@ execute_sql(exec_context& ec, const std::string& sql, std::string& alt_msg)
             }
         }
 
+        // An update to the lnav_views, lnav_view_filters, or lnav_view_files
+        // tables can change the filters for many rows, so the refiltering is
+        // done once the statement is finished.  It cannot be done from the
+        // vtab commit since the refilter runs statements on this database.
+        text_sub_source::filter_batch fb;
+
         ec.ec_sql_callback(ec, stmt.in());
         while (!done) {
             retcode = sqlite3_step(stmt.in());
@@ -539,6 +593,7 @@ execute_file_contents(exec_context& ec,
 
     ec.ec_path_stack.emplace_back(path.parent_path());
     exec_context::output_guard og(ec);
+    text_sub_source::filter_batch fb;
     while ((line_size = getline(line.out(), &line_max_size, file)) != -1) {
         line_number += 1;
 
@@ -590,6 +645,8 @@ execute_file_contents(exec_context& ec,
     }
     ec.ec_path_stack.pop_back();
 
+    TRY(wait_for_queries(ec));
+
     return Ok(retval);
 }
 
@@ -731,7 +788,9 @@ execute_any(exec_context& ec, const std::string& cmdline_with_mode)
         if (ec.is_read_write() &&
             // only rebuild in a script or non-interactive mode so we don't
             // block the UI.
-            (lnav_data.ld_flags & LNF_HEADLESS || ec.ec_path_stack.size() > 1))
+            (lnav_data.ld_flags & LNF_HEADLESS || ec.ec_path_stack.size() > 1)
+            // let background queries keep running on the current snapshot
+            && !lnav::query_pool::busy())
         {
             rescan_files();
             rebuild_indexes_repeatedly();
@@ -827,13 +886,24 @@ execute_init_commands(
                         break;
                 }
 
-                rescan_files();
-                rebuild_indexes_repeatedly();
+                if (!lnav::query_pool::busy()) {
+                    rescan_files();
+                    rebuild_indexes_repeatedly();
+                }
             }
             if (dls.dls_rows.size() > 1) {
                 ensure_view(LNV_DB);
             }
         }
+        if (lnav::query_pool::busy()) {
+            auto wait_res = wait_for_queries(ec);
+
+            if (wait_res.isErr()) {
+                msgs.emplace_back(std::move(wait_res), "");
+            }
+            rescan_files();
+            rebuild_indexes_repeatedly();
+        }
     }
     lnav_data.ld_commands.clear();
 
@@ -871,12 +941,10 @@ sql_callback(exec_context& ec, sqlite3_stmt* stmt)
     auto& chart = dls.dls_chart;
     auto& vc = view_colors::singleton();
     int ncols = sqlite3_column_count(stmt);
-    int row_number;
     int lpc, retval = 0;
     auto set_vars = false;
 
-    row_number = dls.dls_rows.size();
-    dls.dls_rows.resize(row_number + 1);
+    dls.push_row();
     if (dls.dls_headers.empty()) {
         for (lpc = 0; lpc < ncols; lpc++) {
             int type = sqlite3_column_type(stmt, lpc);
@@ -31,10 +31,15 @@
 
 #include "db_sub_source.hh"
 
+#include <unistd.h>
+
 #include "base/date_time_scanner.hh"
+#include "base/fs_util.hh"
+#include "base/injector.hh"
 #include "base/itertools.hh"
 #include "base/time_util.hh"
 #include "config.h"
+#include "db_sub_source.cfg.hh"
 #include "scn/scn.h"
 #include "yajlpp/json_ptr.hh"
 
@@ -43,6 +48,245 @@ const char db_label_source::NULL_STR[] = "<NULL>";
 constexpr size_t MAX_COLUMN_WIDTH = 120;
 constexpr size_t MAX_JSON_WIDTH = 16 * 1024;
 
+/** The length used for NULL cells when a page is written to the file. */
+constexpr uint32_t NULL_CELL_LENGTH = UINT32_MAX;
+
+const db_row_store::row_t&
+db_row_store::operator[](size_t row) const
+{
+    auto page_index = row / PAGE_ROWS;
+    auto& pg = this->drs_pages[page_index];
+
+    if (pg.p_rows.empty()) {
+        this->load_page(page_index);
+    } else if (pg.p_offset != -1 && this->drs_loaded_pages.front() != page_index)
+    {
+        this->drs_loaded_pages.remove(page_index);
+        this->drs_loaded_pages.push_front(page_index);
+    }
+
+    return pg.p_rows[row % PAGE_ROWS];
+}
+
+void
+db_row_store::push_row()
+{
+    if (this->drs_row_count % PAGE_ROWS == 0) {
+        this->spill_pages();
+        this->drs_pages.emplace_back();
+        this->drs_pages.back().p_allocator
+            = std::make_unique<ArenaAlloc::Alloc<char>>(64 * 1024);
+    }
+
+    auto& pg = this->drs_pages.back();
+
+    pg.p_rows.emplace_back();
+    pg.p_rows.back().reserve(this->drs_column_count);
+    this->drs_row_count += 1;
+}
+
+string_fragment
+db_row_store::push_cell(string_fragment sf)
+{
+    auto& pg = this->drs_pages.back();
+    auto retval = sf.to_owned(*pg.p_allocator);
+    auto& row = pg.p_rows.back();
+    auto cell_size = sf.length() + 1 + sizeof(const char*);
+
+    row.push_back(retval.data());
+    this->drs_column_count = std::max(this->drs_column_count, row.size());
+    pg.p_memory_size += cell_size;
+    this->drs_memory_size += cell_size;
+
+    return retval;
+}
+
+void
+db_row_store::push_const_cell(const char* str)
+{
+    auto& pg = this->drs_pages.back();
+    auto& row = pg.p_rows.back();
+
+    row.push_back(str);
+    this->drs_column_count = std::max(this->drs_column_count, row.size());
+    pg.p_memory_size += sizeof(const char*);
+    this->drs_memory_size += sizeof(const char*);
+}
+
+void
+db_row_store::clear()
+{
+    this->drs_pages.clear();
+    this->drs_loaded_pages.clear();
+    this->drs_row_count = 0;
+    this->drs_column_count = 0;
+    this->drs_memory_size = 0;
+    this->drs_next_spill_page = 0;
+    this->drs_fd.reset();
+    this->drs_file_size = 0;
+}
+
+void
+db_row_store::spill_pages()
+{
+    const auto& cfg = injector::get<const db_sub_source_ns::config&>();
+
+    while (this->drs_memory_size > cfg.dc_max_memory_size
+           && this->drs_next_spill_page < this->drs_pages.size())
+    {
+        if (this->drs_fd == -1) {
+            auto open_res = lnav::filesystem::open_temp_file(
+                ghc::filesystem::temp_directory_path() / "lnav.db.XXXXXX");
+            if (open_res.isErr()) {
+                log_error("unable to page out query results: %s",
+                          open_res.unwrapErr().c_str());
+                return;
+            }
+
+            auto tmp_pair = open_res.unwrap();
+            ghc::filesystem::remove(tmp_pair.first);
+            this->drs_fd = std::move(tmp_pair.second);
+            log_info("query result is larger than %llu bytes, paging rows to "
+                     "a temporary file",
+                     (unsigned long long) cfg.dc_max_memory_size);
+        }
+
+        auto& pg = this->drs_pages[this->drs_next_spill_page];
+        if (!this->write_page(pg)) {
+            return;
+        }
+        this->drs_memory_size -= pg.p_memory_size;
+        pg.p_memory_size = 0;
+        pg.p_rows.clear();
+        pg.p_rows.shrink_to_fit();
+        pg.p_allocator.reset();
+        this->drs_next_spill_page += 1;
+    }
+}
+
+bool
+db_row_store::write_page(page& pg)
+{
+    std::vector<char> buffer;
+
+    for (const auto& row : pg.p_rows) {
+        uint32_t cell_count = row.size();
+
+        buffer.insert(buffer.end(),
+                      (const char*) &cell_count,
+                      (const char*) &cell_count + sizeof(cell_count));
+        for (const auto* cell : row) {
+            uint32_t cell_len = cell == db_label_source::NULL_STR
+                ? NULL_CELL_LENGTH
+                : strlen(cell);
+
+            buffer.insert(buffer.end(),
+                          (const char*) &cell_len,
+                          (const char*) &cell_len + sizeof(cell_len));
+            if (cell_len != NULL_CELL_LENGTH) {
+                buffer.insert(buffer.end(), cell, cell + cell_len + 1);
+            }
+        }
+    }
+
+    size_t bytes_written = 0;
+    while (bytes_written < buffer.size()) {
+        auto rc = pwrite(this->drs_fd,
+                         buffer.data() + bytes_written,
+                         buffer.size() - bytes_written,
+                         this->drs_file_size + bytes_written);
+        if (rc < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            log_error("unable to write query results page: %s",
+                      strerror(errno));
+            return false;
+        }
+        bytes_written += rc;
+    }
+
+    pg.p_offset = this->drs_file_size;
+    pg.p_length = buffer.size();
+    this->drs_file_size += buffer.size();
+
+    return true;
+}
+
+void
+db_row_store::load_page(size_t page_index) const
+{
+    auto& pg = this->drs_pages[page_index];
+    size_t row_count = this->drs_row_count - page_index * PAGE_ROWS;
+
+    if (row_count > PAGE_ROWS) {
+        row_count = PAGE_ROWS;
+    }
+
+    if (this->drs_loaded_pages.size() >= MAX_LOADED_PAGES) {
+        auto& old_pg = this->drs_pages[this->drs_loaded_pages.back()];
+
+        old_pg.p_rows.clear();
+        old_pg.p_rows.shrink_to_fit();
+        old_pg.p_data.clear();
+        old_pg.p_data.shrink_to_fit();
+        this->drs_loaded_pages.pop_back();
+    }
+    this->drs_loaded_pages.push_front(page_index);
+
+    pg.p_data.resize(pg.p_length);
+    size_t bytes_read = 0;
+    while (bytes_read < pg.p_length) {
+        auto rc = pread(this->drs_fd,
+                        pg.p_data.data() + bytes_read,
+                        pg.p_length - bytes_read,
+                        pg.p_offset + bytes_read);
+        if (rc <= 0) {
+            if (rc < 0 && errno == EINTR) {
+                continue;
+            }
+            log_error("unable to read query results page: %s",
+                      rc < 0 ? strerror(errno) : "unexpected end of file");
+            break;
+        }
+        bytes_read += rc;
+    }
+
+    size_t pos = 0;
+    pg.p_rows.resize(row_count);
+    for (auto& row : pg.p_rows) {
+        uint32_t cell_count = 0;
+
+        if (pos + sizeof(cell_count) <= bytes_read) {
+            memcpy(&cell_count, &pg.p_data[pos], sizeof(cell_count));
+            pos += sizeof(cell_count);
+        }
+        row.reserve(std::max((size_t) cell_count, this->drs_column_count));
+        for (uint32_t lpc = 0; lpc < cell_count; lpc++) {
+            uint32_t cell_len;
+
+            if (pos + sizeof(cell_len) > bytes_read) {
+                break;
+            }
+            memcpy(&cell_len, &pg.p_data[pos], sizeof(cell_len));
+            pos += sizeof(cell_len);
+            if (cell_len == NULL_CELL_LENGTH) {
+                row.push_back(db_label_source::NULL_STR);
+            } else if (pos + cell_len < bytes_read) {
+                row.push_back(&pg.p_data[pos]);
+                pos += cell_len + 1;
+            } else {
+                break;
+            }
+        }
+        // Pad out rows that could not be read completely, so that callers
+        // can still index every column.
+        while (row.size() < this->drs_column_count) {
+            row.push_back(db_label_source::NULL_STR);
+        }
+    }
+}
+
 void
 db_label_source::text_value_for_line(textview_curses& tc,
                                      int row,
@@ -167,29 +411,34 @@ void
 db_label_source::push_column(const scoped_value_t& sv)
 {
     auto& vc = view_colors::singleton();
-    int index = this->dls_rows.back().size();
+    int index = this->dls_rows[this->dls_rows.size() - 1].size();
     auto& hm = this->dls_headers[index];
 
     auto col_sf = sv.match(
-        [](const std::string& str) { return string_fragment::from_str(str); },
+        [this](const std::string& str) {
+            return this->dls_rows.push_cell(string_fragment::from_str(str));
+        },
         [this](const string_fragment& sf) {
-            return sf.to_owned(*this->dls_allocator);
+            return this->dls_rows.push_cell(sf);
         },
         [this](int64_t i) {
             fmt::memory_buffer buf;
 
             fmt::format_to(std::back_inserter(buf), FMT_STRING("{}"), i);
-            return string_fragment::from_memory_buffer(buf).to_owned(
-                *this->dls_allocator);
+            return this->dls_rows.push_cell(
+                string_fragment::from_memory_buffer(buf));
         },
         [this](double d) {
             fmt::memory_buffer buf;
 
             fmt::format_to(std::back_inserter(buf), FMT_STRING("{}"), d);
-            return string_fragment::from_memory_buffer(buf).to_owned(
-                *this->dls_allocator);
+            return this->dls_rows.push_cell(
+                string_fragment::from_memory_buffer(buf));
         },
-        [](null_value_t) { return string_fragment::from_const(NULL_STR); });
+        [this](null_value_t) {
+            this->dls_rows.push_const_cell(NULL_STR);
+            return string_fragment::from_const(NULL_STR);
+        });
 
     if (index == this->dls_time_column_index) {
         date_time_scanner dts;
@@ -211,7 +460,6 @@ db_label_source::push_column(const scoped_value_t& sv)
         }
     }
 
-    this->dls_rows.back().push_back(col_sf.data());
     hm.hm_column_size
         = std::max(this->dls_headers[index].hm_column_size,
                    (size_t) utf8_string_length(col_sf.data(), col_sf.length())
@@ -259,7 +507,6 @@ db_label_source::clear()
     this->dls_rows.clear();
     this->dls_time_column.clear();
     this->dls_cell_width.clear();
-    this->dls_allocator = std::make_unique<ArenaAlloc::Alloc<char>>(64 * 1024);
 }
 
 nonstd::optional<size_t>
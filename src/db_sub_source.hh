@@ -31,16 +31,93 @@
 #define db_sub_source_hh
 
 #include <iterator>
+#include <list>
 #include <string>
 #include <vector>
 
 #include <sqlite3.h>
 
 #include "ArenaAlloc/arenaalloc.h"
+#include "base/auto_fd.hh"
+#include "base/file_range.hh"
+#include "base/intern_string.hh"
 #include "hist_source.hh"
 #include "shlex.resolver.hh"
 #include "textview_curses.hh"
 
+/**
+ * The rows of a query result.  Rows are kept in pages of a fixed number of
+ * rows.  Once the cells take up more memory than allowed by the
+ * /tuning/db-view/max-memory-size option, full pages are written out to an
+ * unlinked temporary file and only read back in when a row in the page is
+ * accessed.  A few of the pages that were read back are kept in memory.
+ */
+class db_row_store {
+public:
+    using row_t = std::vector<const char*>;
+
+    static constexpr size_t PAGE_ROWS = 1024;
+    static constexpr size_t MAX_LOADED_PAGES = 4;
+
+    size_t size() const { return this->drs_row_count; }
+
+    bool empty() const { return this->drs_row_count == 0; }
+
+    /**
+     * @param row The index of the row.
+     * @return The cells in the row.  The reference is only valid until
+     *   rows in other pages are accessed.
+     */
+    const row_t& operator[](size_t row) const;
+
+    /** Start a new row at the end of the store. */
+    void push_row();
+
+    /**
+     * Copy a value into a new cell at the end of the last row.
+     *
+     * @return The copy of the value.
+     */
+    string_fragment push_cell(string_fragment sf);
+
+    /** Add a cell that is a pointer to the given constant string. */
+    void push_const_cell(const char* str);
+
+    void clear();
+
+    /** @return True if some of the rows have been moved out to a file. */
+    bool is_paged() const { return this->drs_fd != -1; }
+
+private:
+    struct page {
+        std::vector<row_t> p_rows;
+        std::unique_ptr<ArenaAlloc::Alloc<char>> p_allocator;
+        /** The contents of a page that was read back from the file. */
+        std::vector<char> p_data;
+        /** The number of bytes used by the page while it is in memory. */
+        size_t p_memory_size{0};
+        file_off_t p_offset{-1};
+        size_t p_length{0};
+    };
+
+    void spill_pages();
+
+    bool write_page(page& pg);
+
+    void load_page(size_t page_index) const;
+
+    mutable std::vector<page> drs_pages;
+    /** The pages that were read back from the file, most recent first. */
+    mutable std::list<size_t> drs_loaded_pages;
+    size_t drs_row_count{0};
+    size_t drs_column_count{0};
+    size_t drs_memory_size{0};
+    /** The index of the first page that has not been written to the file. */
+    size_t drs_next_spill_page{0};
+    auto_fd drs_fd;
+    file_off_t drs_file_size{0};
+};
+
 class db_label_source
     : public text_sub_source
     , public text_time_translator {
@@ -79,6 +156,8 @@ public:
 
     void push_header(const std::string& colstr, int type, bool graphable);
 
+    void push_row() { this->dls_rows.push_row(); }
+
     void push_column(const scoped_value_t& sv);
 
     void clear();
@@ -116,13 +195,11 @@ public:
 
     stacked_bar_chart<std::string> dls_chart;
     std::vector<header_meta> dls_headers;
-    std::vector<std::vector<const char*>> dls_rows;
+    db_row_store dls_rows;
     std::vector<struct timeval> dls_time_column;
     std::vector<size_t> dls_cell_width;
     int dls_time_column_index{-1};
     nonstd::optional<size_t> dls_time_column_invalidated_at;
-    std::unique_ptr<ArenaAlloc::Alloc<char>> dls_allocator{
-        std::make_unique<ArenaAlloc::Alloc<char>>(64 * 1024)};
 
     static const char NULL_STR[];
 };
@@ -27,6 +27,7 @@
  * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <algorithm>
 #include <utility>
 #include <vector>
 
@@ -37,6 +38,7 @@
 #include "base/lnav_log.hh"
 #include "base/opt_util.hh"
 #include "data_scanner.hh"
+#include "textview_curses.hh"
 
 namespace lnav {
 namespace document {
@@ -81,15 +83,117 @@ hier_node::lookup_path(const hier_node* root,
     return retval;
 }
 
+anchor_index::anchor_index(hier_node* root,
+                           const std::vector<section_interval_t>& intervals)
+{
+    hier_node::depth_first(root, [this](const hier_node* node) {
+        for (const auto& child_pair : node->hn_named_children) {
+            this->ai_offsets[text_anchors::to_anchor_string(child_pair.first)]
+                = child_pair.second->hn_start;
+        }
+    });
+
+    for (const auto& iv : intervals) {
+        if (!iv.value.is<std::string>()) {
+            continue;
+        }
+
+        this->ai_entries.emplace_back(entry{
+            iv.start,
+            iv.stop,
+            text_anchors::to_anchor_string(iv.value.get<std::string>()),
+            0,
+        });
+    }
+    std::stable_sort(this->ai_entries.begin(),
+                     this->ai_entries.end(),
+                     [](const entry& lhs, const entry& rhs) {
+                         if (lhs.e_start != rhs.e_start) {
+                             return lhs.e_start < rhs.e_start;
+                         }
+                         return lhs.e_stop > rhs.e_stop;
+                     });
+
+    // Link each section to the one enclosing it so that a lookup only
+    // has to walk up the nesting instead of scanning earlier siblings.
+    std::vector<size_t> open_entries;
+    for (size_t lpc = 0; lpc < this->ai_entries.size(); lpc++) {
+        auto& ent = this->ai_entries[lpc];
+
+        while (!open_entries.empty()
+               && this->ai_entries[open_entries.back()].e_stop < ent.e_start)
+        {
+            open_entries.pop_back();
+        }
+        ent.e_parent = open_entries.empty() ? lpc : open_entries.back();
+        open_entries.push_back(lpc);
+    }
+}
+
+nonstd::optional<file_off_t>
+anchor_index::offset_for(const std::string& anchor) const
+{
+    auto iter = this->ai_offsets.find(anchor);
+    if (iter == this->ai_offsets.end()) {
+        return nonstd::nullopt;
+    }
+
+    return iter->second;
+}
+
+nonstd::optional<std::string>
+anchor_index::anchor_for(file_off_t start, file_off_t stop) const
+{
+    auto iter = std::upper_bound(
+        this->ai_entries.begin(),
+        this->ai_entries.end(),
+        stop,
+        [](file_off_t lhs, const entry& rhs) { return lhs < rhs.e_start; });
+    if (iter == this->ai_entries.begin()) {
+        return nonstd::nullopt;
+    }
+
+    auto index = static_cast<size_t>(
+        std::distance(this->ai_entries.begin(), iter) - 1);
+    while (true) {
+        const auto& ent = this->ai_entries[index];
+
+        if (ent.e_stop >= start) {
+            return ent.e_anchor;
+        }
+        if (ent.e_parent == index) {
+            return nonstd::nullopt;
+        }
+        index = ent.e_parent;
+    }
+}
+
+std::unordered_set<std::string>
+anchor_index::get_anchors() const
+{
+    std::unordered_set<std::string> retval;
+
+    retval.reserve(this->ai_offsets.size());
+    for (const auto& pair : this->ai_offsets) {
+        retval.emplace(pair.first);
+    }
+
+    return retval;
+}
+
 struct metadata_builder {
     std::vector<section_interval_t> mb_intervals;
     std::unique_ptr<hier_node> mb_root_node;
 
     metadata to_metadata() &&
     {
+        auto anchors
+            = anchor_index(this->mb_root_node.get(), this->mb_intervals);
+
         return {
             std::move(this->mb_intervals),
             std::move(this->mb_root_node),
+            std::move(anchors),
         };
     }
 };
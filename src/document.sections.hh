@@ -32,6 +32,8 @@
 
 #include <map>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "base/attr_line.hh"
@@ -98,9 +100,49 @@ struct hier_node {
     }
 };
 
+/**
+ * An index of the anchors for the named sections of a document so that
+ * they can be looked up without walking the section tree.
+ */
+class anchor_index {
+public:
+    anchor_index() = default;
+
+    anchor_index(hier_node* root,
+                 const std::vector<section_interval_t>& intervals);
+
+    /**
+     * @return The starting offset of the section with the given anchor.
+     */
+    nonstd::optional<file_off_t> offset_for(const std::string& anchor) const;
+
+    /**
+     * @return The anchor of the innermost named section that overlaps the
+     *   given range.
+     */
+    nonstd::optional<std::string> anchor_for(file_off_t start,
+                                             file_off_t stop) const;
+
+    std::unordered_set<std::string> get_anchors() const;
+
+private:
+    struct entry {
+        file_off_t e_start;
+        file_off_t e_stop;
+        std::string e_anchor;
+        /** The enclosing section, or this entry itself at the top level. */
+        size_t e_parent;
+    };
+
+    std::unordered_map<std::string, file_off_t> ai_offsets;
+    /** The named sections sorted by their starting offset. */
+    std::vector<entry> ai_entries;
+};
+
 struct metadata {
     sections_tree_t m_sections_tree;
     std::unique_ptr<hier_node> m_sections_root;
+    anchor_index m_anchors;
 
     std::vector<breadcrumb::possibility> possibility_provider(
         const std::vector<section_key_t>& path);
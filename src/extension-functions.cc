@@ -11,7 +11,7 @@ String: replicate, charindex, leftstr, rightstr, ltrim, rtrim, trim,
 replace, reverse, proper, padl, padr, padc, strfilter.
 
 Aggregate: stdev, variance, mode, median, lower_quartile,
-upper_quartile.
+upper_quartile, percentile, approx_percentile.
 
 The string functions ltrim, rtrim, trim, replace are included in
 recent versions of SQLite and so by default do not build.
@@ -138,70 +138,15 @@ SQLITE_EXTENSION_INIT1
 #include <stdlib.h>
 #include <string.h>
 
-#ifndef _MAP_H_
-#    define _MAP_H_
+#include <inttypes.h>
+#include <stdint.h>
 
-#    include <inttypes.h>
-#    include <stdint.h>
+#include <algorithm>
+#include <memory>
+#include <vector>
 
-#    include "sqlite-extension-func.hh"
-
-/*
-** Simple binary tree implementation to use in median, mode and quartile
-*calculations
-** Tree is not necessarily balanced. That would require something like red&black
-*trees of AVL
-*/
-
-typedef int (*cmp_func)(const void*, const void*);
-typedef void (*map_iterator)(void*, int64_t, void*);
-
-typedef struct node {
-    struct node* l;
-    struct node* r;
-    void* data;
-    int64_t count;
-} node;
-
-typedef struct map {
-    node* base;
-    cmp_func cmp;
-    short free;
-} map;
-
-/*
-** creates a map given a comparison function
-*/
-map map_make(cmp_func cmp);
-
-/*
-** inserts the element e into map m
-*/
-void map_insert(map* m, void* e);
-
-/*
-** executes function iter over all elements in the map, in key increasing order
-*/
-void map_iterate(map* m, map_iterator iter, void* p);
-
-/*
-** frees all memory used by a map
-*/
-void map_destroy(map* m);
-
-/*
-** compares 2 integers
-** to use with map_make
-*/
-int int_cmp(const void* a, const void* b);
-
-/*
-** compares 2 doubles
-** to use with map_make
-*/
-int double_cmp(const void* a, const void* b);
-
-#endif /* _MAP_H_ */
+#include "base/sketch.hh"
+#include "sqlite-extension-func.hh"
 
 typedef uint8_t u8;
 typedef uint16_t u16;
@@ -1740,29 +1685,6 @@ struct StdevCtx {
     i64 cnt; /* number of elements */
 };
 
-/*
-** An instance of the following structure holds the context of a
-** mode() or median() aggregate computation.
-** Depends on structures defined in map.c (see map & map)
-** These aggregate functions only work for integers and floats although
-** they could be made to work for strings. This is usually considered
-*meaningless.
-** Only usuall order (for median), no use of collation functions (would this
-*even make sense?)
-*/
-typedef struct ModeCtx ModeCtx;
-struct ModeCtx {
-    i64 riM; /* integer value found so far */
-    double rdM; /* double value found so far */
-    i64 cnt; /* number of elements so far */
-    double pcnt; /* number of elements smaller than a percentile */
-    i64 mcnt; /* maximum number of occurrences (for mode) */
-    i64 mn; /* number of occurrences (for mode and percentiles) */
-    i64 is_double; /* whether the computation is being done for doubles (>0) or
-                      integers (=0) */
-    map* m; /* map structure used for the computation */
-    int done; /* whether the answer has been found */
-};
 
 /*
 ** called for each value received during a calculation of stdev or variance
@@ -1788,172 +1710,228 @@ varianceStep(sqlite3_context* context, int argc, sqlite3_value** argv)
 }
 
 /*
-** called for each value received during a calculation of mode of median
+** An instance of the following structure holds the values collected for a
+** mode(), median(), quartile, or percentile() aggregate computation.
+** The values are kept in a flat array and the order statistics are found
+** with a selection algorithm when the aggregate is finalized, so the cost
+** does not depend on the order the values arrive in.
+** These aggregate functions only work for integers and floats.  The values
+** are kept as integers until a float is seen.
+*/
+struct order_stats {
+    bool os_is_double{false};
+    std::vector<i64> os_ints;
+    std::vector<double> os_doubles;
+    double os_percent{0.0};
+
+    size_t size() const
+    {
+        return this->os_is_double ? this->os_doubles.size()
+                                  : this->os_ints.size();
+    }
+
+    void add(sqlite3_value* value, int type)
+    {
+        if (type == SQLITE_FLOAT && !this->os_is_double) {
+            this->os_doubles.assign(this->os_ints.begin(), this->os_ints.end());
+            this->os_ints.clear();
+            this->os_ints.shrink_to_fit();
+            this->os_is_double = true;
+        }
+        if (this->os_is_double) {
+            this->os_doubles.push_back(sqlite3_value_double(value));
+        } else {
+            this->os_ints.push_back(sqlite3_value_int64(value));
+        }
+    }
+};
+
+typedef struct OrderStatsCtx OrderStatsCtx;
+struct OrderStatsCtx {
+    order_stats* os;
+};
+
+/*
+** Checks the percent argument of percentile() and approx_percentile()
+*/
+static bool
+percent_arg(sqlite3_context* context, sqlite3_value* arg, double* percent_out)
+{
+    switch (sqlite3_value_numeric_type(arg)) {
+        case SQLITE_INTEGER:
+        case SQLITE_FLOAT:
+            *percent_out = sqlite3_value_double(arg);
+            if (0.0 <= *percent_out && *percent_out <= 100.0) {
+                return true;
+            }
+            break;
+        default:
+            break;
+    }
+
+    sqlite3_result_error(
+        context, "the percent must be a number between 0 and 100", -1);
+    return false;
+}
+
+/*
+** called for each value received during a calculation of mode, median,
+** quartiles or percentile
 */
 static void
-modeStep(sqlite3_context* context, int argc, sqlite3_value** argv)
+orderStatsStep(sqlite3_context* context, int argc, sqlite3_value** argv)
 {
-    ModeCtx* p;
-    i64 xi = 0;
-    double xd = 0.0;
-    i64* iptr;
-    double* dptr;
+    OrderStatsCtx* p;
     int type;
 
-    assert(argc == 1);
+    assert(argc == 1 || argc == 2);
     type = sqlite3_value_numeric_type(argv[0]);
 
     if (type == SQLITE_NULL)
         return;
 
-    p = (ModeCtx*) sqlite3_aggregate_context(context, sizeof(*p));
+    p = (OrderStatsCtx*) sqlite3_aggregate_context(context, sizeof(*p));
+    if (p == nullptr) {
+        sqlite3_result_error_nomem(context);
+        return;
+    }
 
-    if (0 == (p->m)) {
-        p->m = (map*) calloc(1, sizeof(map));
-        if (type == SQLITE_INTEGER) {
-            /* map will be used for integers */
-            *(p->m) = map_make(int_cmp);
-            p->is_double = 0;
-        } else {
-            p->is_double = 1;
-            /* map will be used for doubles */
-            *(p->m) = map_make(double_cmp);
+    if (p->os == nullptr) {
+        p->os = new order_stats();
+        if (argc == 2 && !percent_arg(context, argv[1], &p->os->os_percent)) {
+            return;
         }
     }
 
-    ++(p->cnt);
+    p->os->add(argv[0], type);
+}
 
-    if (0 == p->is_double) {
-        xi = sqlite3_value_int64(argv[0]);
-        iptr = (i64*) calloc(1, sizeof(i64));
-        *iptr = xi;
-        map_insert(p->m, iptr);
-    } else {
-        xd = sqlite3_value_double(argv[0]);
-        dptr = (double*) calloc(1, sizeof(double));
-        *dptr = xd;
-        map_insert(p->m, dptr);
+/*
+** Returns the order_stats for a finalizer and releases it from the context
+*/
+static std::unique_ptr<order_stats>
+orderStatsTake(sqlite3_context* context)
+{
+    OrderStatsCtx* p = (OrderStatsCtx*) sqlite3_aggregate_context(context, 0);
+    std::unique_ptr<order_stats> retval;
+
+    if (p != nullptr) {
+        retval.reset(p->os);
+        p->os = nullptr;
     }
+
+    return retval;
 }
 
 /*
-**  Auxiliary function that iterates all elements in a map and finds the mode
-**  (most frequent value)
+** Sorts the values and finds the most frequent one.  Ties produce no value.
 */
-static void
-modeIterate(void* e, i64 c, void* pp)
-{
-    i64 ei;
-    double ed;
-    ModeCtx* p = (ModeCtx*) pp;
-
-    if (0 == p->is_double) {
-        ei = *(int*) (e);
-
-        if (p->mcnt == c) {
-            ++p->mn;
-        } else if (p->mcnt < c) {
-            p->riM = ei;
-            p->mcnt = c;
-            p->mn = 1;
-        }
-    } else {
-        ed = *(double*) (e);
-
-        if (p->mcnt == c) {
-            ++p->mn;
-        } else if (p->mcnt < c) {
-            p->rdM = ed;
-            p->mcnt = c;
-            p->mn = 1;
+template<typename T>
+static nonstd::optional<T>
+find_mode(std::vector<T>& values)
+{
+    nonstd::optional<T> retval;
+    size_t max_count = 0;
+    auto max_ties = false;
+
+    std::sort(values.begin(), values.end());
+    for (auto iter = values.begin(); iter != values.end();) {
+        auto run_end = std::upper_bound(iter, values.end(), *iter);
+        auto count = (size_t) std::distance(iter, run_end);
+
+        if (count > max_count) {
+            max_count = count;
+            retval = *iter;
+            max_ties = false;
+        } else if (count == max_count) {
+            max_ties = true;
         }
+        iter = run_end;
     }
+
+    if (max_ties) {
+        return nonstd::nullopt;
+    }
+    return retval;
 }
 
 /*
-**  Auxiliary function that iterates all elements in a map and finds the median
-**  (the value such that the number of elements smaller is equal the number of
-**  elements larger)
+** Returns the mode value
 */
 static void
-medianIterate(void* e, i64 c, void* pp)
+modeFinalize(sqlite3_context* context)
 {
-    i64 ei;
-    double ed;
-    double iL;
-    double iR;
-    int il;
-    int ir;
-    ModeCtx* p = (ModeCtx*) pp;
-
-    if (p->done > 0)
+    auto os = orderStatsTake(context);
+
+    if (os == nullptr) {
         return;
+    }
 
-    iL = p->pcnt;
-    iR = p->cnt - p->pcnt;
-    il = p->mcnt + c;
-    ir = p->cnt - p->mcnt;
-
-    if (il >= iL) {
-        if (ir >= iR) {
-            ++p->mn;
-            if (0 == p->is_double) {
-                ei = *(int*) (e);
-                p->riM += ei;
-            } else {
-                ed = *(double*) (e);
-                p->rdM += ed;
-            }
-        } else {
-            p->done = 1;
+    if (os->os_is_double) {
+        auto mode = find_mode(os->os_doubles);
+
+        if (mode) {
+            sqlite3_result_double(context, mode.value());
+        }
+    } else {
+        auto mode = find_mode(os->os_ints);
+
+        if (mode) {
+            sqlite3_result_int64(context, mode.value());
         }
     }
-    p->mcnt += c;
 }
 
 /*
-** Returns the mode value
+** Finds the values at the one-based positions 'lo' and 'hi' of the sorted
+** values, where 'hi' is 'lo' or the position after it.
 */
-static void
-modeFinalize(sqlite3_context* context)
+template<typename T>
+static std::pair<T, T>
+select_pair(std::vector<T>& values, size_t lo, size_t hi)
 {
-    ModeCtx* p;
-    p = (ModeCtx*) sqlite3_aggregate_context(context, 0);
-    if (p && p->m) {
-        map_iterate(p->m, modeIterate, p);
-        map_destroy(p->m);
-        free(p->m);
-
-        if (1 == p->mn) {
-            if (0 == p->is_double)
-                sqlite3_result_int64(context, p->riM);
-            else
-                sqlite3_result_double(context, p->rdM);
-        }
+    auto lo_iter = values.begin() + (lo - 1);
+
+    std::nth_element(values.begin(), lo_iter, values.end());
+    if (hi == lo) {
+        return std::make_pair(*lo_iter, *lo_iter);
     }
+
+    return std::make_pair(*lo_iter,
+                          *std::min_element(std::next(lo_iter), values.end()));
 }
 
 /*
-** auxiliary function for percentiles
+** auxiliary function for the median and quartiles.  The result is the
+** average of the values at the positions between 'pcnt' and 'pcnt + 1'.
 */
 static void
-_medianFinalize(sqlite3_context* context)
+_medianFinalize(sqlite3_context* context, double fraction)
 {
-    ModeCtx* p;
-    p = (ModeCtx*) sqlite3_aggregate_context(context, 0);
-    if (p && p->m) {
-        p->done = 0;
-        map_iterate(p->m, medianIterate, p);
-        map_destroy(p->m);
-        free(p->m);
-
-        if (0 == p->is_double)
-            if (1 == p->mn)
-                sqlite3_result_int64(context, p->riM);
-            else
-                sqlite3_result_double(context, p->riM * 1.0 / p->mn);
-        else
-            sqlite3_result_double(context, p->rdM / p->mn);
+    auto os = orderStatsTake(context);
+
+    if (os == nullptr || os->size() == 0) {
+        return;
+    }
+
+    auto cnt = os->size();
+    auto pcnt = cnt * fraction;
+    auto lo = std::max((size_t) 1, (size_t) ceil(pcnt));
+    auto hi = std::max(lo, std::min(cnt, (size_t) floor(pcnt + 1.0)));
+
+    if (os->os_is_double) {
+        auto vals = select_pair(os->os_doubles, lo, hi);
+
+        sqlite3_result_double(context, (vals.first + vals.second) / 2.0);
+    } else {
+        auto vals = select_pair(os->os_ints, lo, hi);
+
+        if (vals.first == vals.second) {
+            sqlite3_result_int64(context, vals.first);
+        } else {
+            sqlite3_result_double(
+                context, ((double) vals.first + (double) vals.second) / 2.0);
+        }
     }
 }
 
@@ -1963,12 +1941,7 @@ _medianFinalize(sqlite3_context* context)
 static void
 medianFinalize(sqlite3_context* context)
 {
-    ModeCtx* p;
-    p = (ModeCtx*) sqlite3_aggregate_context(context, 0);
-    if (p != 0) {
-        p->pcnt = (p->cnt) / 2.0;
-        _medianFinalize(context);
-    }
+    _medianFinalize(context, 0.5);
 }
 
 /*
@@ -1977,12 +1950,7 @@ medianFinalize(sqlite3_context* context)
 static void
 lower_quartileFinalize(sqlite3_context* context)
 {
-    ModeCtx* p;
-    p = (ModeCtx*) sqlite3_aggregate_context(context, 0);
-    if (p != 0) {
-        p->pcnt = (p->cnt) / 4.0;
-        _medianFinalize(context);
-    }
+    _medianFinalize(context, 0.25);
 }
 
 /*
@@ -1991,11 +1959,95 @@ lower_quartileFinalize(sqlite3_context* context)
 static void
 upper_quartileFinalize(sqlite3_context* context)
 {
-    ModeCtx* p;
-    p = (ModeCtx*) sqlite3_aggregate_context(context, 0);
-    if (p != 0) {
-        p->pcnt = (p->cnt) * 3 / 4.0;
-        _medianFinalize(context);
+    _medianFinalize(context, 0.75);
+}
+
+/*
+** Returns the percentile value, interpolating between the two closest
+** values like the percentile() function in the SQLite extensions.
+*/
+static void
+percentileFinalize(sqlite3_context* context)
+{
+    auto os = orderStatsTake(context);
+
+    if (os == nullptr || os->size() == 0) {
+        return;
+    }
+
+    auto rank = (os->size() - 1) * os->os_percent / 100.0;
+    auto lo = (size_t) floor(rank) + 1;
+    auto hi = std::min(os->size(), lo + 1);
+    double lo_val, hi_val;
+
+    if (os->os_is_double) {
+        auto vals = select_pair(os->os_doubles, lo, hi);
+
+        lo_val = vals.first;
+        hi_val = vals.second;
+    } else {
+        auto vals = select_pair(os->os_ints, lo, hi);
+
+        lo_val = vals.first;
+        hi_val = vals.second;
+    }
+
+    sqlite3_result_double(context,
+                          lo_val + (hi_val - lo_val) * (rank - floor(rank)));
+}
+
+/*
+** An instance of the following structure holds the context of an
+** approx_percentile() aggregate computation.  The values are summarized in
+** a sketch that uses a bounded amount of memory.
+*/
+typedef struct ApproxPercentileCtx ApproxPercentileCtx;
+struct ApproxPercentileCtx {
+    lnav::sketch::quantiles* q;
+    double percent;
+};
+
+static void
+approxPercentileStep(sqlite3_context* context, int argc, sqlite3_value** argv)
+{
+    ApproxPercentileCtx* p;
+
+    assert(argc == 2);
+    if (sqlite3_value_numeric_type(argv[0]) == SQLITE_NULL)
+        return;
+
+    p = (ApproxPercentileCtx*) sqlite3_aggregate_context(context, sizeof(*p));
+    if (p == nullptr) {
+        sqlite3_result_error_nomem(context);
+        return;
+    }
+
+    if (p->q == nullptr) {
+        p->q = new lnav::sketch::quantiles();
+        if (!percent_arg(context, argv[1], &p->percent)) {
+            return;
+        }
+    }
+
+    p->q->add(sqlite3_value_double(argv[0]));
+}
+
+static void
+approxPercentileFinalize(sqlite3_context* context)
+{
+    ApproxPercentileCtx* p
+        = (ApproxPercentileCtx*) sqlite3_aggregate_context(context, 0);
+
+    if (p == nullptr || p->q == nullptr) {
+        return;
+    }
+
+    std::unique_ptr<lnav::sketch::quantiles> q(p->q);
+    p->q = nullptr;
+
+    auto res = q->quantile(p->percent / 100.0);
+    if (res) {
+        sqlite3_result_double(context, res.value());
     }
 }
 
@@ -2674,10 +2726,54 @@ common_extension_functions(struct FuncDef** basic_funcs,
         {"stdev", 1, 0, varianceStep, stdevFinalize},
         {"stddev", 1, 0, varianceStep, stdevFinalize},
         {"variance", 1, 0, varianceStep, varianceFinalize},
-        {"mode", 1, 0, modeStep, modeFinalize},
-        {"median", 1, 0, modeStep, medianFinalize},
-        {"lower_quartile", 1, 0, modeStep, lower_quartileFinalize},
-        {"upper_quartile", 1, 0, modeStep, upper_quartileFinalize},
+        {"mode", 1, 0, orderStatsStep, modeFinalize},
+        {"median", 1, 0, orderStatsStep, medianFinalize},
+        {"lower_quartile", 1, 0, orderStatsStep, lower_quartileFinalize},
+        {"upper_quartile", 1, 0, orderStatsStep, upper_quartileFinalize},
+        {
+            "percentile",
+            2,
+            0,
+            orderStatsStep,
+            percentileFinalize,
+            help_text("percentile")
+                .sql_function()
+                .with_summary("Returns the value at the given percentile of "
+                              "the values, interpolating between the two "
+                              "closest values")
+                .with_parameter({"value", "The values to rank"})
+                .with_parameter(
+                    {"percent", "The percentile to return, from 0 to 100"})
+                .with_tags({"math"})
+                .with_example({
+                    "To get the 90th percentile of a column of values",
+                    "SELECT percentile(column1, 90) FROM (VALUES "
+                    "(1), (2), (3), (4), (5), (6), (7), (8), (9), (10))",
+                }),
+        },
+        {
+            "approx_percentile",
+            2,
+            0,
+            approxPercentileStep,
+            approxPercentileFinalize,
+            help_text("approx_percentile")
+                .sql_function()
+                .with_summary("Returns an estimate of the value at the given "
+                              "percentile of the values.  The estimate is "
+                              "within one percent of the actual value and "
+                              "only a small, bounded amount of memory is used "
+                              "no matter how many values there are.")
+                .with_parameter({"value", "The values to rank"})
+                .with_parameter(
+                    {"percent", "The percentile to return, from 0 to 100"})
+                .with_tags({"math"})
+                .with_example({
+                    "To estimate the 99th percentile of a column of values",
+                    "SELECT approx_percentile(column1, 99) FROM (VALUES "
+                    "(10), (20), (30), (40), (50))",
+                }),
+        },
 
         {nullptr},
     };
@@ -2699,130 +2795,3 @@ sqlite3_extension_init(sqlite3* db,
     return 0;
 }
 #endif /* COMPILE_SQLITE_EXTENSIONS_AS_LOADABLE_MODULE */
-
-map
-map_make(cmp_func cmp)
-{
-    map r;
-    r.cmp = cmp;
-    r.base = 0;
-    r.free = 0;
-
-    return r;
-}
-
-void*
-xcalloc(size_t nmemb, size_t size, const char* s)
-{
-    void* ret = calloc(nmemb, size);
-    return ret;
-}
-
-static void
-xfree(void* p)
-{
-    free(p);
-}
-
-void
-node_insert(node** n, cmp_func cmp, void* e)
-{
-    int c;
-    node* nn;
-    if (*n == 0) {
-        nn = (node*) xcalloc(1, sizeof(node), "for node");
-        nn->data = e;
-        nn->count = 1;
-        *n = nn;
-    } else {
-        c = cmp((*n)->data, e);
-        if (0 == c) {
-            ++((*n)->count);
-            xfree(e);
-        } else if (c > 0) {
-            /* put it right here */
-            node_insert(&((*n)->l), cmp, e);
-        } else {
-            node_insert(&((*n)->r), cmp, e);
-        }
-    }
-}
-
-void
-map_insert(map* m, void* e)
-{
-    node_insert(&(m->base), m->cmp, e);
-}
-
-void
-node_iterate(node* n, map_iterator iter, void* p)
-{
-    if (n) {
-        if (n->l)
-            node_iterate(n->l, iter, p);
-        iter(n->data, n->count, p);
-        if (n->r)
-            node_iterate(n->r, iter, p);
-    }
-}
-
-void
-map_iterate(map* m, map_iterator iter, void* p)
-{
-    node_iterate(m->base, iter, p);
-}
-
-void
-node_destroy(node* n)
-{
-    if (0 != n) {
-        xfree(n->data);
-        if (n->l)
-            node_destroy(n->l);
-        if (n->r)
-            node_destroy(n->r);
-
-        xfree(n);
-    }
-}
-
-void
-map_destroy(map* m)
-{
-    node_destroy(m->base);
-}
-
-int
-int_cmp(const void* a, const void* b)
-{
-    int64_t aa = *(int64_t*) (a);
-    int64_t bb = *(int64_t*) (b);
-    /* printf("cmp %d <=> %d\n",aa,bb); */
-    if (aa == bb)
-        return 0;
-    else if (aa < bb)
-        return -1;
-    else
-        return 1;
-}
-
-int
-double_cmp(const void* a, const void* b)
-{
-    double aa = *(double*) (a);
-    double bb = *(double*) (b);
-    /* printf("cmp %d <=> %d\n",aa,bb); */
-    if (aa == bb)
-        return 0;
-    else if (aa < bb)
-        return -1;
-    else
-        return 1;
-}
-
-void
-print_elem(void* e, int64_t c, void* p)
-{
-    int ee = *(int*) (e);
-    printf("%d => %" PRId64 "\n", ee, c);
-}
@@ -0,0 +1,602 @@
+/**
+ * Copyright (c) 2022, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <array>
+
+#include "field_sketch_vtab.hh"
+
+#include "base/date_time_scanner.hh"
+#include "base/injector.hh"
+#include "base/lnav_log.hh"
+#include "config.h"
+#include "file_collection.hh"
+#include "log_vtab_impl.hh"
+#include "logfile.hh"
+#include "sql_help.hh"
+#include "sql_util.hh"
+#include "vtab_module.hh"
+
+/**
+ * The hidden columns that are passed as arguments to the sketch functions,
+ * relative to the first hidden column.
+ */
+enum {
+    SA_FIELD,
+    SA_START_TIME,
+    SA_END_TIME,
+    SA_MAX,
+};
+
+using sketch_arg_values = std::array<sqlite3_value*, SA_MAX>;
+
+/**
+ * Record the hidden columns that have a usable constraint in idxNum as a
+ * bitmask, and hand out the argvIndex values in column order to match.
+ */
+static void
+sketch_best_index(sqlite3_index_info* pIdxInfo, int first_col)
+{
+    vtab_index_constraints vic(pIdxInfo);
+    int used_mask = 0;
+    int cons_for_arg[SA_MAX];
+
+    for (auto iter = vic.begin(); iter != vic.end(); ++iter) {
+        if (iter->op != SQLITE_INDEX_CONSTRAINT_EQ) {
+            continue;
+        }
+
+        auto arg = iter->iColumn - first_col;
+        if (arg < 0 || arg >= SA_MAX || (used_mask & (1 << arg))) {
+            continue;
+        }
+
+        used_mask |= (1 << arg);
+        cons_for_arg[arg] = iter.i_index;
+    }
+
+    if (!(used_mask & (1 << SA_FIELD))) {
+        pIdxInfo->estimatedCost = 2147483647;
+        pIdxInfo->estimatedRows = 2147483647;
+        return;
+    }
+
+    int n_arg = 0;
+    for (int arg = 0; arg < SA_MAX; arg++) {
+        if (!(used_mask & (1 << arg))) {
+            continue;
+        }
+
+        auto& usage = pIdxInfo->aConstraintUsage[cons_for_arg[arg]];
+        usage.argvIndex = ++n_arg;
+    }
+    pIdxInfo->idxNum = used_mask;
+    pIdxInfo->estimatedCost = 1.0;
+    pIdxInfo->estimatedRows = 1;
+}
+
+/**
+ * Map the argv values passed to xFilter back to the hidden columns using the
+ * bitmask that was recorded by sketch_best_index().
+ */
+static sketch_arg_values
+sketch_decode_args(int idxNum, int argc, sqlite3_value** argv)
+{
+    sketch_arg_values retval{};
+    int argi = 0;
+
+    for (int arg = 0; arg < SA_MAX && argi < argc; arg++) {
+        if (idxNum & (1 << arg)) {
+            retval[arg] = argv[argi++];
+        }
+    }
+
+    return retval;
+}
+
+/**
+ * Parse the optional start/end time arguments to the sketch functions.
+ */
+static Result<nonstd::optional<time_t>, std::string>
+time_arg(sqlite3_value* value)
+{
+    if (value == nullptr || sqlite3_value_type(value) == SQLITE_NULL) {
+        return Ok(nonstd::optional<time_t>());
+    }
+
+    const auto* datestr = (const char*) sqlite3_value_text(value);
+    auto datelen = sqlite3_value_bytes(value);
+    date_time_scanner dts;
+    struct timeval tv;
+    struct exttm tm;
+
+    const auto* date_end = dts.scan(datestr, datelen, nullptr, &tm, tv);
+    if (date_end != (datestr + datelen)) {
+        return Err(fmt::format(FMT_STRING("Invalid timestamp: {}"), datestr));
+    }
+
+    return Ok(nonstd::optional<time_t>(tv.tv_sec));
+}
+
+/**
+ * The arguments passed to the sketch functions, which need to be returned
+ * as the values of the hidden columns so that SQLite's checks pass.
+ */
+struct sketch_args {
+    std::string sa_field;
+    nonstd::optional<std::string> sa_start_time;
+    nonstd::optional<std::string> sa_end_time;
+
+    void load(const sketch_arg_values& args)
+    {
+        this->sa_field.clear();
+        this->sa_start_time = nonstd::nullopt;
+        this->sa_end_time = nonstd::nullopt;
+        if (args[SA_FIELD] != nullptr
+            && sqlite3_value_type(args[SA_FIELD]) != SQLITE_NULL)
+        {
+            this->sa_field = (const char*) sqlite3_value_text(args[SA_FIELD]);
+        }
+        if (args[SA_START_TIME] != nullptr
+            && sqlite3_value_type(args[SA_START_TIME]) != SQLITE_NULL)
+        {
+            this->sa_start_time
+                = std::string((const char*) sqlite3_value_text(
+                    args[SA_START_TIME]));
+        }
+        if (args[SA_END_TIME] != nullptr
+            && sqlite3_value_type(args[SA_END_TIME]) != SQLITE_NULL)
+        {
+            this->sa_end_time = std::string(
+                (const char*) sqlite3_value_text(args[SA_END_TIME]));
+        }
+    }
+
+    void to_column(sqlite3_context* ctx, int index) const
+    {
+        switch (index) {
+            case SA_FIELD:
+                to_sqlite(ctx, this->sa_field);
+                break;
+            case SA_START_TIME:
+                to_sqlite(ctx, this->sa_start_time);
+                break;
+            case SA_END_TIME:
+                to_sqlite(ctx, this->sa_end_time);
+                break;
+        }
+    }
+};
+
+/**
+ * Merge the sketches for a field across all of the files and the time blocks
+ * that overlap the given range.
+ */
+static Result<lnav::sketch::field_summary, std::string>
+merge_sketches(const sketch_arg_values& args)
+{
+    lnav::sketch::field_summary retval;
+
+    if (args[SA_FIELD] == nullptr
+        || sqlite3_value_type(args[SA_FIELD]) != SQLITE3_TEXT)
+    {
+        return Err(std::string("Expecting a field name"));
+    }
+
+    auto field_name = intern_string::lookup(
+        (const char*) sqlite3_value_text(args[SA_FIELD]),
+        sqlite3_value_bytes(args[SA_FIELD]));
+    auto start_time = TRY(time_arg(args[SA_START_TIME]));
+    auto end_time = TRY(time_arg(args[SA_END_TIME]));
+    auto source_lock = log_vtab_data.lock_source();
+    auto& fc = injector::get<file_collection&>();
+
+    for (const auto& lf : fc.fc_files) {
+        const auto& sketches = lf->get_field_sketches();
+        auto iter = sketches.find(field_name);
+
+        if (iter == sketches.end()) {
+            continue;
+        }
+
+        for (const auto& block_pair : iter->second) {
+            if (start_time
+                && block_pair.first + FIELD_SKETCH_BLOCK_SECS
+                    <= start_time.value())
+            {
+                continue;
+            }
+            if (end_time && end_time.value() < block_pair.first) {
+                break;
+            }
+            retval.merge(block_pair.second);
+        }
+    }
+
+    return Ok(std::move(retval));
+}
+
+enum {
+    STV_COL_VALUE,
+    STV_COL_COUNT,
+    STV_COL_MAX_ERROR,
+    STV_COL_FIELD,
+    STV_COL_START_TIME,
+    STV_COL_END_TIME,
+};
+
+struct sketch_top_values {
+    static constexpr const char* NAME = "sketch_top_values";
+    static constexpr const char* CREATE_STMT = R"(
+-- The sketch_top_values() table-valued function returns the most frequent
+-- values of a field that has the "sketch" property set in its log format.
+CREATE TABLE sketch_top_values (
+    value TEXT,
+    count INTEGER,
+    max_error INTEGER,
+    field TEXT HIDDEN,
+    start_time TEXT HIDDEN,
+    end_time TEXT HIDDEN
+);
+)";
+
+    struct cursor {
+        sqlite3_vtab_cursor base;
+        sketch_args c_args;
+        std::vector<lnav::sketch::heavy_hitters::entry> c_entries;
+        size_t c_index{0};
+
+        cursor(sqlite3_vtab* vt) : base({vt}) {}
+
+        int reset() { return SQLITE_OK; }
+
+        int next()
+        {
+            if (this->c_index < this->c_entries.size()) {
+                this->c_index += 1;
+            }
+
+            return SQLITE_OK;
+        }
+
+        int eof() { return this->c_index >= this->c_entries.size(); }
+
+        int get_rowid(sqlite3_int64& rowid_out)
+        {
+            rowid_out = this->c_index;
+
+            return SQLITE_OK;
+        }
+    };
+
+    int get_column(const cursor& vc, sqlite3_context* ctx, int col)
+    {
+        const auto& ent = vc.c_entries[vc.c_index];
+
+        switch (col) {
+            case STV_COL_VALUE:
+                to_sqlite(ctx, ent.e_value);
+                break;
+            case STV_COL_COUNT:
+                sqlite3_result_int64(ctx, ent.e_count);
+                break;
+            case STV_COL_MAX_ERROR:
+                sqlite3_result_int64(ctx, ent.e_error);
+                break;
+            default:
+                vc.c_args.to_column(ctx, col - STV_COL_FIELD);
+                break;
+        }
+
+        return SQLITE_OK;
+    }
+};
+
+static int
+stvBestIndex(sqlite3_vtab* tab, sqlite3_index_info* pIdxInfo)
+{
+    sketch_best_index(pIdxInfo, STV_COL_FIELD);
+    return SQLITE_OK;
+}
+
+static int
+stvFilter(sqlite3_vtab_cursor* pVtabCursor,
+          int idxNum,
+          const char* idxStr,
+          int argc,
+          sqlite3_value** argv)
+{
+    auto* pCur = (sketch_top_values::cursor*) pVtabCursor;
+
+    pCur->c_entries.clear();
+    pCur->c_index = 0;
+    auto args = sketch_decode_args(idxNum, argc, argv);
+    pCur->c_args.load(args);
+
+    auto merge_res = merge_sketches(args);
+    if (merge_res.isErr()) {
+        pVtabCursor->pVtab->zErrMsg
+            = sqlite3_mprintf("%s", merge_res.unwrapErr().c_str());
+        return SQLITE_ERROR;
+    }
+
+    pCur->c_entries = merge_res.unwrap().fs_top.top(
+        lnav::sketch::heavy_hitters::DEFAULT_CAPACITY);
+
+    return SQLITE_OK;
+}
+
+enum {
+    SS_COL_COUNT,
+    SS_COL_DISTINCT_COUNT,
+    SS_COL_DISTINCT_ERROR,
+    SS_COL_MIN,
+    SS_COL_P50,
+    SS_COL_P90,
+    SS_COL_P95,
+    SS_COL_P99,
+    SS_COL_MAX,
+    SS_COL_QUANTILE_ERROR,
+    SS_COL_FIELD,
+    SS_COL_START_TIME,
+    SS_COL_END_TIME,
+};
+
+struct sketch_stats {
+    static constexpr const char* NAME = "sketch_stats";
+    static constexpr const char* CREATE_STMT = R"(
+-- The sketch_stats() table-valued function returns summary statistics for
+-- a field that has the "sketch" property set in its log format.
+CREATE TABLE sketch_stats (
+    count INTEGER,
+    distinct_count INTEGER,
+    distinct_error REAL,
+    min REAL,
+    p50 REAL,
+    p90 REAL,
+    p95 REAL,
+    p99 REAL,
+    max REAL,
+    quantile_error REAL,
+    field TEXT HIDDEN,
+    start_time TEXT HIDDEN,
+    end_time TEXT HIDDEN
+);
+)";
+
+    struct cursor {
+        sqlite3_vtab_cursor base;
+        sketch_args c_args;
+        lnav::sketch::field_summary c_summary;
+        bool c_done{true};
+
+        cursor(sqlite3_vtab* vt) : base({vt}) {}
+
+        int reset() { return SQLITE_OK; }
+
+        int next()
+        {
+            this->c_done = true;
+
+            return SQLITE_OK;
+        }
+
+        int eof() { return this->c_done; }
+
+        int get_rowid(sqlite3_int64& rowid_out)
+        {
+            rowid_out = 0;
+
+            return SQLITE_OK;
+        }
+    };
+
+    int get_column(const cursor& vc, sqlite3_context* ctx, int col)
+    {
+        const auto& summ = vc.c_summary;
+        nonstd::optional<double> num;
+
+        switch (col) {
+            case SS_COL_COUNT:
+                sqlite3_result_int64(ctx, summ.fs_count);
+                return SQLITE_OK;
+            case SS_COL_DISTINCT_COUNT:
+                sqlite3_result_int64(ctx, summ.fs_distinct.estimate());
+                return SQLITE_OK;
+            case SS_COL_DISTINCT_ERROR:
+                sqlite3_result_double(
+                    ctx, lnav::sketch::distinct_counter::standard_error());
+                return SQLITE_OK;
+            case SS_COL_MIN:
+                num = summ.fs_quantiles.min();
+                break;
+            case SS_COL_P50:
+                num = summ.fs_quantiles.quantile(0.50);
+                break;
+            case SS_COL_P90:
+                num = summ.fs_quantiles.quantile(0.90);
+                break;
+            case SS_COL_P95:
+                num = summ.fs_quantiles.quantile(0.95);
+                break;
+            case SS_COL_P99:
+                num = summ.fs_quantiles.quantile(0.99);
+                break;
+            case SS_COL_MAX:
+                num = summ.fs_quantiles.max();
+                break;
+            case SS_COL_QUANTILE_ERROR:
+                if (summ.fs_quantiles.count() > 0) {
+                    num = lnav::sketch::quantiles::RELATIVE_ACCURACY;
+                }
+                break;
+            default:
+                vc.c_args.to_column(ctx, col - SS_COL_FIELD);
+                return SQLITE_OK;
+        }
+
+        if (num) {
+            sqlite3_result_double(ctx, num.value());
+        } else {
+            sqlite3_result_null(ctx);
+        }
+
+        return SQLITE_OK;
+    }
+};
+
+static int
+ssBestIndex(sqlite3_vtab* tab, sqlite3_index_info* pIdxInfo)
+{
+    sketch_best_index(pIdxInfo, SS_COL_FIELD);
+    return SQLITE_OK;
+}
+
+static int
+ssFilter(sqlite3_vtab_cursor* pVtabCursor,
+         int idxNum,
+         const char* idxStr,
+         int argc,
+         sqlite3_value** argv)
+{
+    auto* pCur = (sketch_stats::cursor*) pVtabCursor;
+
+    pCur->c_done = true;
+    auto args = sketch_decode_args(idxNum, argc, argv);
+    pCur->c_args.load(args);
+
+    auto merge_res = merge_sketches(args);
+    if (merge_res.isErr()) {
+        pVtabCursor->pVtab->zErrMsg
+            = sqlite3_mprintf("%s", merge_res.unwrapErr().c_str());
+        return SQLITE_ERROR;
+    }
+
+    pCur->c_summary = merge_res.unwrap();
+    pCur->c_done = false;
+
+    return SQLITE_OK;
+}
+
+int
+register_field_sketch_vtab(sqlite3* db)
+{
+    static vtab_module<tvt_no_update<sketch_top_values>> TOP_VALUES_MODULE;
+    static help_text top_values_help
+        = help_text("sketch_top_values",
+                    "A table-valued function that returns the most frequent "
+                    "values of a log message field.  The values are "
+                    "estimated from summaries that are kept while indexing "
+                    "for fields that have the 'sketch' property set in their "
+                    "log format, so no messages need to be read.")
+              .sql_table_valued_function()
+              .with_parameter({"field", "The name of the field."})
+              .with_parameter(help_text{
+                  "start_time",
+                  "The start of the time range to summarize.  The "
+                  "summaries are kept in one hour blocks, so the range is "
+                  "rounded out to the nearest block."}
+                                  .optional())
+              .with_parameter(
+                  help_text{"end_time", "The end of the time range."}
+                      .optional())
+              .with_result({"value", "The field value."})
+              .with_result({"count",
+                            "The estimated number of messages with the "
+                            "value."})
+              .with_result({"max_error",
+                            "The amount that the count might be over the "
+                            "actual value."})
+              .with_tags({"logs"})
+              .with_example({
+                  "To get the ten most frequent client IPs",
+                  "SELECT * FROM sketch_top_values('c_ip') LIMIT 10",
+              });
+
+    int rc;
+
+    TOP_VALUES_MODULE.vm_module.xBestIndex = stvBestIndex;
+    TOP_VALUES_MODULE.vm_module.xFilter = stvFilter;
+
+    rc = TOP_VALUES_MODULE.create(db, "sketch_top_values");
+    sqlite_function_help.insert(
+        std::make_pair("sketch_top_values", &top_values_help));
+    top_values_help.index_tags();
+
+    ensure(rc == SQLITE_OK);
+
+    static vtab_module<tvt_no_update<sketch_stats>> STATS_MODULE;
+    static help_text stats_help
+        = help_text("sketch_stats",
+                    "A table-valued function that returns the number of "
+                    "distinct values and the quantiles of a log message "
+                    "field.  The values are estimated from summaries that "
+                    "are kept while indexing for fields that have the "
+                    "'sketch' property set in their log format, so no "
+                    "messages need to be read.")
+              .sql_table_valued_function()
+              .with_parameter({"field", "The name of the field."})
+              .with_parameter(help_text{
+                  "start_time",
+                  "The start of the time range to summarize.  The "
+                  "summaries are kept in one hour blocks, so the range is "
+                  "rounded out to the nearest block."}
+                                  .optional())
+              .with_parameter(
+                  help_text{"end_time", "The end of the time range."}
+                      .optional())
+              .with_result({"count", "The number of values."})
+              .with_result(
+                  {"distinct_count", "The estimated number of distinct values."})
+              .with_result({"distinct_error",
+                            "The relative standard error of distinct_count."})
+              .with_result({"min", "The smallest numeric value."})
+              .with_result({"p50", "The estimated median."})
+              .with_result({"p90", "The estimated 90th percentile."})
+              .with_result({"p95", "The estimated 95th percentile."})
+              .with_result({"p99", "The estimated 99th percentile."})
+              .with_result({"max", "The largest numeric value."})
+              .with_result({"quantile_error",
+                            "The maximum relative error of the percentiles."})
+              .with_tags({"logs"})
+              .with_example({
+                  "To get the 99th percentile of the sc_bytes field",
+                  "SELECT p99 FROM sketch_stats('sc_bytes')",
+              });
+
+    STATS_MODULE.vm_module.xBestIndex = ssBestIndex;
+    STATS_MODULE.vm_module.xFilter = ssFilter;
+
+    rc = STATS_MODULE.create(db, "sketch_stats");
+    sqlite_function_help.insert(std::make_pair("sketch_stats", &stats_help));
+    stats_help.index_tags();
+
+    ensure(rc == SQLITE_OK);
+
+    return rc;
+}
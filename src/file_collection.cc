@@ -107,15 +107,10 @@ file_collection::close_files(const std::vector<std::shared_ptr<logfile>>& files)
 void
 file_collection::regenerate_unique_file_names()
 {
-    unique_path_generator upg;
+    this->fc_unique_paths.sync(this->fc_files);
+    this->fc_unique_paths.generate();
 
-    for (const auto& lf : this->fc_files) {
-        upg.add_source(lf);
-    }
-
-    upg.generate();
-
-    this->fc_largest_path_length = 0;
+    this->fc_largest_path_length = this->fc_unique_paths.get_max_length();
     for (const auto& pair : this->fc_name_to_errors) {
         auto path = ghc::filesystem::path(pair.first).filename().string();
 
@@ -123,13 +118,6 @@ file_collection::regenerate_unique_file_names()
             this->fc_largest_path_length = path.length();
         }
     }
-    for (const auto& lf : this->fc_files) {
-        const auto& path = lf->get_unique_path();
-
-        if (path.length() > this->fc_largest_path_length) {
-            this->fc_largest_path_length = path.length();
-        }
-    }
     for (const auto& pair : this->fc_other_files) {
         switch (pair.second.ofd_format) {
             case file_format_t::UNKNOWN:
@@ -175,6 +163,7 @@ file_collection::merge(file_collection& other)
     }
     for (auto& pair : other.fc_renamed_files) {
         pair.first->set_filename(pair.second);
+        this->fc_unique_paths.invalidate(pair.first.get());
     }
     this->fc_closed_files.insert(other.fc_closed_files.begin(),
                                  other.fc_closed_files.end());
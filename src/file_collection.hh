@@ -45,6 +45,7 @@
 #include "logfile_fwd.hh"
 #include "safe/safe.h"
 #include "tailer/tailer.looper.hh"
+#include "unique_path.hh"
 
 struct tailer_progress {
     std::string tp_message;
@@ -141,6 +142,7 @@ struct file_collection {
     std::vector<struct stat> fc_new_stats;
     std::list<child_poller> fc_child_pollers;
     size_t fc_largest_path_length{0};
+    unique_path_index fc_unique_paths;
 
     file_collection()
         : fc_progress(std::make_shared<safe::Safe<scan_progress>>())
@@ -155,6 +157,7 @@ struct file_collection {
         this->fc_closed_files.clear();
         this->fc_other_files.clear();
         this->fc_new_stats.clear();
+        this->fc_unique_paths.clear();
     }
 
     file_collection rescan_files(bool required = false);
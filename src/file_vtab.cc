@@ -27,9 +27,11 @@
  * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <fcntl.h>
 #include <string.h>
 #include <unistd.h>
 
+#include "base/fs_util.hh"
 #include "base/injector.bind.hh"
 #include "base/lnav.gzip.hh"
 #include "base/lnav_log.hh"
@@ -114,7 +116,20 @@ CREATE TABLE lnav_file (
                 if (lf_stat.st_size > cfg.fvc_max_content_size) {
                     sqlite3_result_error(ctx, "file is too large", -1);
                 } else {
-                    auto fd = lf->get_fd();
+                    // The descriptor may have been released while the file
+                    // was idle, in which case it is reopened after checking
+                    // that the file was not replaced.
+                    auto fd_res = lf->dup_fd();
+                    if (fd_res.isErr()) {
+                        auto errmsg
+                            = fmt::format(FMT_STRING("unable to read file: {}"),
+                                          fd_res.unwrapErr());
+
+                        sqlite3_result_error(
+                            ctx, errmsg.c_str(), errmsg.length());
+                        break;
+                    }
+                    auto fd = fd_res.unwrap();
                     auto_mem<char> buf;
                     buf = (char*) malloc(lf_stat.st_size);
                     auto rc = pread(fd, buf, lf_stat.st_size, 0);
@@ -210,6 +225,7 @@ CREATE TABLE lnav_file (
                 loo.loo_include_in_session = true;
                 this->lf_collection.fc_file_names[path] = std::move(loo);
                 lf->set_filename(path);
+                this->lf_collection.fc_unique_paths.invalidate(lf.get());
                 this->lf_collection.regenerate_unique_file_names();
 
                 init_session();
@@ -48,18 +48,31 @@ line_filter_observer::logline_new_lines(const logfile& lf,
     }
 
     for (; ll_begin != ll_end; ++ll_begin) {
-        if (lf.get_format() != nullptr) {
-            lf.get_format()->get_subline(*ll_begin, sbr);
-        }
+        // A line that repeats the previous message gets the same result, so
+        // it does not need to be read or matched.
+        auto is_repeat = lf.has_repeats()
+            && lf.is_repeat(std::distance(lf.begin(), ll_begin));
+        auto have_line = false;
+
         for (auto& filter : this->lfo_filter_stack) {
             if (filter->lf_deleted) {
                 continue;
             }
             if (offset
-                >= this->lfo_filter_state.tfs_filter_count[filter->get_index()])
+                < this->lfo_filter_state.tfs_filter_count[filter->get_index()])
             {
-                filter->add_line(this->lfo_filter_state, ll_begin, sbr);
+                continue;
+            }
+            if (is_repeat
+                && filter->add_repeated_line(this->lfo_filter_state, ll_begin))
+            {
+                continue;
+            }
+            if (!have_line && lf.get_format() != nullptr) {
+                lf.get_format()->get_subline(*ll_begin, sbr);
             }
+            have_line = true;
+            filter->add_line(this->lfo_filter_state, ll_begin, sbr);
         }
     }
 }
@@ -229,6 +229,13 @@ filter_sub_source::list_input_handle_key(listview_curses& lv, int ch)
 
             auto tf = *(fs.begin() + lv.get_selection());
 
+            if (tf->get_lang() == filter_lang_t::SET) {
+                lnav_data.ld_filter_help_status_source.fss_error.set_value(
+                    "error: the strings for this filter come from %s",
+                    tf->get_id().c_str());
+                return true;
+            }
+
             this->fss_editing = true;
 
             auto tq = tf->get_lang() == filter_lang_t::SQL
@@ -318,7 +325,7 @@ filter_sub_source::text_value_for_line(textview_curses& tc,
             value_out.append(" IN ");
             break;
         case text_filter::EXCLUDE:
-            if (tf->get_lang() == filter_lang_t::REGEX) {
+            if (tf->get_lang() != filter_lang_t::SQL) {
                 value_out.append("OUT ");
             } else {
                 value_out.append("    ");
@@ -391,6 +398,7 @@ filter_sub_source::text_attrs_for_line(textview_curses& tc,
             readline_sqlite_highlighter(content, content.length());
             break;
         case filter_lang_t::NONE:
+        case filter_lang_t::SET:
             break;
     }
 
@@ -428,6 +436,7 @@ filter_sub_source::rl_change(readline_curses* rc)
 
     switch (tf->get_lang()) {
         case filter_lang_t::NONE:
+        case filter_lang_t::SET:
             break;
         case filter_lang_t::REGEX: {
             auto regex_res
@@ -575,6 +584,8 @@ filter_sub_source::rl_perform(readline_curses* rc)
                 }
                 break;
             }
+            case filter_lang_t::SET:
+                break;
         }
     }
 
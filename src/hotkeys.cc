@@ -477,49 +477,31 @@ handle_paging_key(int ch)
 
         case 's':
             if (lss) {
-                vis_line_t next_top = vis_line_t(tc->get_top() + 2);
-
                 if (!lss->is_time_offset_enabled()) {
                     lnav_data.ld_rl_view->set_alt_value(
                         HELP_MSG_1(T, "to disable elapsed-time mode"));
                 }
                 lss->set_time_offset(true);
-                while (next_top < tc->get_inner_height()) {
-                    if (!lss->find_line(lss->at(next_top))->is_message()) {
-                    } else if (lss->get_line_accel_direction(next_top)
-                               == log_accel::A_DECEL)
-                    {
-                        --next_top;
-                        tc->set_top(next_top);
-                        break;
-                    }
 
-                    ++next_top;
-                }
+                const auto& slowdowns = bm[&logfile_sub_source::BM_SLOWDOWNS];
+
+                slowdowns.next(tc->get_top() + 1_vl) |
+                    [&tc](auto vl) { tc->set_top(vl - 1_vl); };
             }
             break;
 
         case 'S':
             if (lss) {
-                vis_line_t next_top = tc->get_top();
-
                 if (!lss->is_time_offset_enabled()) {
                     lnav_data.ld_rl_view->set_alt_value(
                         HELP_MSG_1(T, "to disable elapsed-time mode"));
                 }
                 lss->set_time_offset(true);
-                while (0 <= next_top && next_top < tc->get_inner_height()) {
-                    if (!lss->find_line(lss->at(next_top))->is_message()) {
-                    } else if (lss->get_line_accel_direction(next_top)
-                               == log_accel::A_DECEL)
-                    {
-                        --next_top;
-                        tc->set_top(next_top);
-                        break;
-                    }
 
-                    --next_top;
-                }
+                const auto& slowdowns = bm[&logfile_sub_source::BM_SLOWDOWNS];
+
+                slowdowns.prev(tc->get_top() + 1_vl) |
+                    [&tc](auto vl) { tc->set_top(vl - 1_vl); };
             }
             break;
 
@@ -42,6 +42,7 @@
 #endif
 
 #include <algorithm>
+#include <mutex>
 #include <set>
 
 #ifdef HAVE_X86INTRIN_H
@@ -71,6 +72,22 @@ const ssize_t line_buffer::DEFAULT_LINE_BUFFER_SIZE = 256 * 1024;
 const ssize_t line_buffer::MAX_LINE_BUFFER_SIZE
     = 4 * 4 * line_buffer::DEFAULT_LINE_BUFFER_SIZE;
 
+static std::mutex RELEASABLE_MUTEX;
+
+/**
+ * The line buffers with an open descriptor that can be released when the
+ * file is idle.  The set is never freed since files can still be open while
+ * static objects are being destroyed.
+ */
+static std::set<line_buffer*>&
+releasable_buffers()
+{
+    static auto* retval = new std::set<line_buffer*>();
+
+    return *retval;
+}
+static std::atomic<uint64_t> READ_COUNTER{0};
+
 class io_looper : public isc::service<io_looper> {};
 
 struct io_looper_tag {};
@@ -133,7 +150,11 @@ private:
 
 #define Z_BUFSIZE      65536U
 #define SYNCPOINT_SIZE (1024 * 1024)
-line_buffer::gz_indexed::gz_indexed()
+
+constexpr size_t line_buffer::gz_indexed::MAX_SYNCPOINTS;
+
+line_buffer::gz_indexed::gz_indexed(size_t max_syncpoints)
+    : syncpoint_spacing(SYNCPOINT_SIZE), max_syncpoints(max_syncpoints)
 {
     if ((this->inbuf = (Bytef*) malloc(Z_BUFSIZE)) == NULL) {
         throw std::bad_alloc();
@@ -148,6 +169,7 @@ line_buffer::gz_indexed::close()
         inflateEnd(&this->strm);
         ::close(this->gz_fd);
         this->syncpoints.clear();
+        this->syncpoint_spacing = SYNCPOINT_SIZE;
         this->gz_fd = -1;
     }
 }
@@ -287,13 +309,13 @@ line_buffer::gz_indexed::stream_data(void* buf, size_t size)
                 break;
             }
 
-            if (this->strm.total_in >= last + SYNCPOINT_SIZE
+            if (this->strm.total_in >= last + this->syncpoint_spacing
                 && size > this->strm.avail_out + GZ_WINSIZE
                 && (this->strm.data_type & GZ_END_OF_BLOCK_MASK)
                 && !(this->strm.data_type & GZ_END_OF_FILE_MASK))
             {
-                this->syncpoints.emplace_back(this->strm, size);
-                last = this->strm.total_out;
+                this->add_syncpoint(size);
+                last = this->syncpoints.back().in;
             }
         } else if (this->strm.avail_out) {
             // Processed all the gz file data but didn't fill
@@ -314,13 +336,13 @@ line_buffer::gz_indexed::seek(off_t offset)
 
     indexDict* dict = nullptr;
     // Find highest syncpoint not past offset
-    // FIXME: Make this a binary-tree search
-    for (auto& d : this->syncpoints) {
-        if (d.out <= offset) {
-            dict = &d;
-        } else {
-            break;
-        }
+    auto iter = std::upper_bound(
+        this->syncpoints.begin(),
+        this->syncpoints.end(),
+        offset,
+        [](off_t off, const indexDict& d) { return off < d.out; });
+    if (iter != this->syncpoints.begin()) {
+        dict = &(*std::prev(iter));
     }
 
     // Choose highest available syncpoint, or keep current offset if it's ok
@@ -349,6 +371,46 @@ line_buffer::gz_indexed::seek(off_t offset)
     }
 }
 
+void
+line_buffer::gz_indexed::add_syncpoint(size_t size)
+{
+    if (this->syncpoints.size() >= this->max_syncpoints) {
+        // Thin out the index by keeping only the even syncpoints and
+        // spacing out the new ones to match.
+        size_t dst = 0;
+        for (size_t src = 0; src < this->syncpoints.size(); src += 2) {
+            if (dst != src) {
+                this->syncpoints[dst] = std::move(this->syncpoints[src]);
+            }
+            dst += 1;
+        }
+        this->syncpoints.erase(this->syncpoints.begin() + dst,
+                               this->syncpoints.end());
+        this->syncpoint_spacing *= 2;
+        log_info(
+            "%d: thinned gzip syncpoints to %zu (%zu bytes), spacing is now "
+            "%lld",
+            this->gz_fd,
+            this->syncpoints.size(),
+            this->syncpoint_memory(),
+            (long long) this->syncpoint_spacing);
+    }
+
+    this->syncpoints.emplace_back(this->strm, size);
+}
+
+size_t
+line_buffer::gz_indexed::syncpoint_memory() const
+{
+    size_t retval = this->syncpoints.capacity() * sizeof(indexDict);
+
+    for (const auto& d : this->syncpoints) {
+        retval += d.index.capacity();
+    }
+
+    return retval;
+}
+
 int
 line_buffer::gz_indexed::read(void* buf, size_t offset, size_t size)
 {
@@ -371,6 +433,8 @@ line_buffer::~line_buffer()
 {
     auto empty_fd = auto_fd();
 
+    this->remove_from_pool();
+
     // Make sure any shared refs take ownership of the data.
     this->lb_share_manager.invalidate_refs();
     this->set_fd(empty_fd);
@@ -381,6 +445,8 @@ line_buffer::set_fd(auto_fd& fd)
 {
     file_off_t newoff = 0;
 
+    this->remove_from_pool();
+
     {
         safe::WriteAccess<safe_gz_indexed> gi(this->lb_gz_file);
 
@@ -450,11 +516,141 @@ line_buffer::set_fd(auto_fd& fd)
     }
     this->lb_file_offset = newoff;
     this->lb_buffer.clear();
-    this->lb_fd = std::move(fd);
+    {
+        std::lock_guard<std::mutex> lg(this->lb_fd_mutex);
+
+        this->lb_fd = std::move(fd);
+        this->lb_fd_released = false;
+    }
 
     ensure(this->invariant());
 }
 
+void
+line_buffer::set_reopen_func(reopen_func func)
+{
+    std::lock_guard<std::mutex> fd_lg(this->lb_fd_mutex);
+
+    this->lb_reopen_func = std::move(func);
+    if (this->lb_fd != -1 && this->is_releasable()) {
+        std::lock_guard<std::mutex> lg(RELEASABLE_MUTEX);
+
+        releasable_buffers().insert(this);
+    }
+}
+
+void
+line_buffer::remove_from_pool()
+{
+    std::lock_guard<std::mutex> lg(RELEASABLE_MUTEX);
+
+    releasable_buffers().erase(this);
+}
+
+bool
+line_buffer::reacquire_fd()
+{
+    if (!this->lb_fd_released) {
+        return false;
+    }
+
+    auto open_res = this->lb_reopen_func();
+    if (open_res.isErr()) {
+        log_error("unable to reopen released file -- %s",
+                  open_res.unwrapErr().c_str());
+        return false;
+    }
+
+    this->lb_fd = open_res.unwrap();
+    this->lb_fd_released = false;
+    log_debug("%d: reopened released file", this->lb_fd.get());
+
+    std::lock_guard<std::mutex> lg(RELEASABLE_MUTEX);
+
+    releasable_buffers().insert(this);
+    return true;
+}
+
+Result<auto_fd, std::string>
+line_buffer::dup_fd()
+{
+    std::lock_guard<std::mutex> lg(this->lb_fd_mutex);
+
+    if (this->lb_fd_released) {
+        return this->lb_reopen_func();
+    }
+    if (this->lb_fd == -1) {
+        return Err(std::string("file is closed"));
+    }
+
+    auto retval = auto_fd(::dup(this->lb_fd));
+    if (retval == -1) {
+        return Err(std::string(strerror(errno)));
+    }
+
+    return Ok(std::move(retval));
+}
+
+bool
+line_buffer::release_fd_if_over(size_t max_open)
+{
+    std::lock_guard<std::mutex> fd_lg(this->lb_fd_mutex);
+    std::lock_guard<std::mutex> lg(RELEASABLE_MUTEX);
+
+    if (releasable_buffers().size() <= max_open
+        || releasable_buffers().erase(this) == 0)
+    {
+        return false;
+    }
+
+    this->lb_fd.reset();
+    this->lb_fd_released = true;
+
+    return true;
+}
+
+size_t
+line_buffer::release_idle_fds(size_t max_open)
+{
+    std::lock_guard<std::mutex> lg(RELEASABLE_MUTEX);
+
+    if (releasable_buffers().size() <= max_open) {
+        return 0;
+    }
+
+    std::vector<line_buffer*> by_age(releasable_buffers().begin(),
+                                     releasable_buffers().end());
+    auto to_release = by_age.size() - max_open;
+    size_t release_count = 0;
+
+    std::sort(by_age.begin(),
+              by_age.end(),
+              [](const line_buffer* lhs, const line_buffer* rhs) {
+                  return lhs->lb_last_read < rhs->lb_last_read;
+              });
+    for (auto* lb : by_age) {
+        if (release_count == to_release) {
+            break;
+        }
+
+        // Buffers that are being read from, possibly by a preload on
+        // another thread, are left alone until the next sweep.
+        std::unique_lock<std::mutex> fd_lock(lb->lb_fd_mutex,
+                                             std::try_to_lock);
+        if (!fd_lock.owns_lock()) {
+            continue;
+        }
+        lb->lb_fd.reset();
+        lb->lb_fd_released = true;
+        releasable_buffers().erase(lb);
+        release_count += 1;
+    }
+
+    log_debug("released %zu idle file descriptors", release_count);
+
+    return release_count;
+}
+
 void
 line_buffer::resize_buffer(size_t new_max)
 {
@@ -644,11 +840,18 @@ line_buffer::load_next_buffer()
 #endif
     else
     {
-        rc = pread(this->lb_cached_fd ? this->lb_cached_fd.value().get()
-                                      : this->lb_fd.get(),
-                   this->lb_alt_buffer.value().end(),
-                   this->lb_alt_buffer.value().available(),
-                   start + this->lb_alt_buffer.value().size());
+        std::lock_guard<std::mutex> fd_lg(this->lb_fd_mutex);
+
+        if (this->lb_cached_fd || this->lb_fd != -1 || this->reacquire_fd()) {
+            rc = pread(this->lb_cached_fd ? this->lb_cached_fd.value().get()
+                                          : this->lb_fd.get(),
+                       this->lb_alt_buffer.value().end(),
+                       this->lb_alt_buffer.value().available(),
+                       start + this->lb_alt_buffer.value().size());
+        } else {
+            rc = -1;
+            errno = EBADF;
+        }
     }
     // XXX For some reason, cygwin is giving us a bogus return value when
     // up to the end of the file.
@@ -737,6 +940,7 @@ line_buffer::fill_range(file_off_t start, ssize_t max_length)
 
     require(start >= 0);
 
+    this->lb_last_read = READ_COUNTER++;
     // log_debug("fill range %d %d", start, max_length);
 #if 0
     log_debug("(%p) fill range %d %d (%d) %d",
@@ -782,11 +986,15 @@ line_buffer::fill_range(file_off_t start, ssize_t max_length)
         this->lb_alt_line_has_ansi.clear();
         this->lb_stats.s_used_preloads += 1;
     }
+
+    // Taken after any preload is collected since the loader also needs it.
+    std::unique_lock<std::mutex> fd_lock(this->lb_fd_mutex);
+
     if (this->in_range(start) && this->in_range(start + max_length - 1)) {
         /* Cache already has the data, nothing to do. */
         retval = true;
         if (!lnav::pid::in_child && this->lb_seekable && this->lb_buffer.full()
-            && !this->lb_loader_file_offset)
+            && !this->lb_loader_file_offset && this->lb_fd != -1)
         {
             // log_debug("loader available start=%d", start);
             auto last_lf_iter = std::find(
@@ -821,7 +1029,7 @@ line_buffer::fill_range(file_off_t start, ssize_t max_length)
                     });
             }
         }
-    } else if (this->lb_fd != -1) {
+    } else if (this->lb_fd != -1 || this->reacquire_fd()) {
         ssize_t rc;
 
         /* Make sure there is enough space, then */
@@ -1044,7 +1252,7 @@ line_buffer::load_next_line(file_range prev_line)
     bool done = false;
     line_info retval;
 
-    require(this->lb_fd != -1);
+    require(this->lb_fd != -1 || this->lb_fd_released);
 
     auto offset = prev_line.next_offset();
     ssize_t request_size = INITIAL_REQUEST_SIZE;
@@ -1266,9 +1474,20 @@ line_buffer::gz_indexed::indexDict::indexDict(const z_stream& s,
     this->out = s.total_out;
     auto last_byte_in = s.next_in[-1];
     this->in_bits = last_byte_in >> (8 - this->bits);
-    // Copy the last 32k uncompressed data (sliding window) to our
+    // Deflate the last 32k uncompressed data (sliding window) into our
     // index
-    memcpy(this->index, s.next_out - GZ_WINSIZE, GZ_WINSIZE);
+    auto dest_len = compressBound(GZ_WINSIZE);
+    this->index.resize(dest_len);
+    auto rc = compress2(this->index.data(),
+                        &dest_len,
+                        s.next_out - GZ_WINSIZE,
+                        GZ_WINSIZE,
+                        Z_BEST_SPEED);
+    if (rc != Z_OK) {
+        throw std::bad_alloc();
+    }
+    this->index.resize(dest_len);
+    this->index.shrink_to_fit();
 }
 
 int
@@ -1288,8 +1507,16 @@ line_buffer::gz_indexed::indexDict::apply(z_streamp s)
     }
     s->total_in = this->in;
     s->total_out = this->out;
-    inflateSetDictionary(s, this->index, GZ_WINSIZE);
-    return ret;
+
+    Bytef window[GZ_WINSIZE];
+    uLongf window_len = sizeof(window);
+    ret = uncompress(
+        window, &window_len, this->index.data(), this->index.size());
+    if (ret != Z_OK) {
+        return ret;
+    }
+    inflateSetDictionary(s, window, window_len);
+    return Z_OK;
 }
 
 bool
@@ -33,8 +33,11 @@
 #define line_buffer_hh
 
 #include <array>
+#include <atomic>
 #include <exception>
+#include <functional>
 #include <future>
+#include <mutex>
 #include <vector>
 
 #include <errno.h>
@@ -103,7 +106,7 @@ public:
      */
     class gz_indexed {
     public:
-        gz_indexed();
+        explicit gz_indexed(size_t max_syncpoints = MAX_SYNCPOINTS);
         gz_indexed(gz_indexed&& other) = default;
         ~gz_indexed() { this->close(); }
 
@@ -127,21 +130,44 @@ public:
          */
         int read(void* buf, size_t offset, size_t size);
 
+        /**
+         * A point in the stream where decompression can be restarted.  The
+         * 32KB window that is needed to restart is kept deflated since it
+         * is rarely used and there can be thousands of syncpoints.
+         */
         struct indexDict {
             off_t in = 0;
             off_t out = 0;
             unsigned char bits = 0;
             unsigned char in_bits = 0;
-            Bytef index[GZ_WINSIZE];
+            std::vector<Bytef> index;
             indexDict(z_stream const& s, const file_size_t size);
 
             int apply(z_streamp s);
         };
 
+        /**
+         * The default maximum number of syncpoints to keep.  Once this is
+         * reached, every other syncpoint is dropped and the spacing between
+         * them is doubled so that the memory used by the index stays
+         * bounded.
+         */
+        static constexpr size_t MAX_SYNCPOINTS = 4096;
+
+        /** @return The number of syncpoints in the index. */
+        size_t syncpoint_count() const { return this->syncpoints.size(); }
+
+        /** @return The number of bytes used to store the syncpoints. */
+        size_t syncpoint_memory() const;
+
     private:
+        void add_syncpoint(size_t size);
+
         z_stream strm; /*< gzip streams structure */
         std::vector<indexDict>
             syncpoints; /*< indexed dictionaries as discovered */
+        off_t syncpoint_spacing; /*< compressed bytes between syncpoints */
+        size_t max_syncpoints; /*< syncpoints to keep before thinning */
         auto_mem<Bytef> inbuf; /*< Compressed data buffer */
         int gz_fd = -1; /*< The file to read data from. */
     };
@@ -159,6 +185,54 @@ public:
     /** @return The file descriptor that data should be pulled from. */
     int get_fd() const { return this->lb_fd; }
 
+    /**
+     * Open a separate descriptor for the file, going through the reopen
+     * function if the buffer's descriptor has been released.
+     *
+     * @return The new descriptor or an error if the file could not be
+     *   opened or was replaced.
+     */
+    Result<auto_fd, std::string> dup_fd();
+
+    using reopen_func = std::function<Result<auto_fd, std::string>()>;
+
+    /**
+     * Allow the file descriptor to be closed while the file is idle.  Only
+     * descriptors for plain, seekable files can be released.
+     *
+     * @param func The function used to reopen the file the next time data
+     *   needs to be read from it.  The function should fail if the file
+     *   has been replaced since it was first opened.
+     */
+    void set_reopen_func(reopen_func func);
+
+    /**
+     * @return True if the descriptor was closed by release_idle_fds() and
+     *   has not been reopened yet.
+     */
+    bool is_fd_released() const { return this->lb_fd_released; }
+
+    /**
+     * Close the descriptors of the least recently read files until no more
+     * than the given number of releasable descriptors are open.  Any
+     * buffered data is kept and the descriptors are reopened on demand.
+     * Buffers that are in the middle of a read are skipped.
+     *
+     * @param max_open The number of descriptors that can stay open.
+     * @return The number of descriptors that were closed.
+     */
+    static size_t release_idle_fds(size_t max_open);
+
+    /**
+     * Close this buffer's descriptor if more than the given number of
+     * releasable descriptors are open.  Unlike release_idle_fds(), this
+     * can be called from any thread that has exclusive use of the buffer,
+     * like one that has just opened the file.
+     *
+     * @return True if the descriptor was closed.
+     */
+    bool release_fd_if_over(size_t max_open);
+
     time_t get_file_time() const { return this->lb_file_time; }
 
     /**
@@ -218,7 +292,13 @@ public:
     /** Release any resources held by this object. */
     void reset()
     {
-        this->lb_fd.reset();
+        this->remove_from_pool();
+        {
+            std::lock_guard<std::mutex> lg(this->lb_fd_mutex);
+
+            this->lb_fd.reset();
+            this->lb_fd_released = false;
+        }
 
         this->lb_file_offset = 0;
         this->lb_file_size = (ssize_t) -1;
@@ -324,6 +404,20 @@ private:
 
     bool load_next_buffer();
 
+    bool is_releasable() const
+    {
+        return this->lb_reopen_func && this->lb_seekable
+            && !this->lb_compressed && !this->lb_cached_fd;
+    }
+
+    /**
+     * Reopen a descriptor that was closed by release_idle_fds().  The
+     * caller must hold lb_fd_mutex.
+     */
+    bool reacquire_fd();
+
+    void remove_from_pool();
+
     using safe_gz_indexed = safe::Safe<gz_indexed>;
 
     shared_buffer lb_share_manager;
@@ -364,6 +458,16 @@ private:
 
     nonstd::optional<auto_fd> lb_cached_fd;
 
+    reopen_func lb_reopen_func;
+    /**
+     * Held while lb_fd is read from, closed, or reopened so that another
+     * thread cannot release the descriptor out from under a read.
+     */
+    std::mutex lb_fd_mutex;
+    std::atomic<bool> lb_fd_released{false};
+    /** The value of a global counter at the time of the last read. */
+    std::atomic<uint64_t> lb_last_read{0};
+
     header_data lb_header;
 };
 
@@ -95,6 +95,7 @@
 #include "dump_internals.hh"
 #include "environ_vtab.hh"
 #include "filter_sub_source.hh"
+#include "field_sketch_vtab.hh"
 #include "fstat_vtab.hh"
 #include "grep_proc.hh"
 #include "hist_source.hh"
@@ -410,6 +411,13 @@ setup_logline_table(exec_context& ec)
         }
     }
 
+    lnav_sql_meta_callbacks.smc_eponymous_tables.clear();
+    for (const auto& iter : *lnav_data.ld_vtab_manager) {
+        if (lnav_data.ld_vtab_manager->is_lazy(iter.first)) {
+            lnav_sql_meta_callbacks.smc_eponymous_tables[iter.first.to_string()]
+                = iter.second->get_table_statement();
+        }
+    }
     walk_sqlite_metadata(lnav_data.ld_db.in(), lnav_sql_meta_callbacks);
 
     for (const auto& iter : *lnav_data.ld_vtab_manager) {
@@ -1503,6 +1511,7 @@ looper()
         auto next_rebuild_time = ui_clock::now();
         auto next_status_update_time = next_rebuild_time;
         auto next_rescan_time = next_rebuild_time;
+        auto next_bookmark_flush_time = next_rebuild_time;
 
         while (lnav_data.ld_looping) {
             auto loop_deadline
@@ -1633,6 +1642,12 @@ looper()
                 }
                 next_status_update_time = ui_clock::now() + 100ms;
             }
+            if (lnav_data.ld_session_loaded
+                && ui_clock::now() >= next_bookmark_flush_time)
+            {
+                flush_bookmarks();
+                next_bookmark_flush_time = ui_clock::now() + 5s;
+            }
             if (filter_source->fss_editing) {
                 filter_source->fss_match_view.set_needs_update();
             }
@@ -2158,6 +2173,7 @@ main(int argc, char* argv[])
         int register_collation_functions(sqlite3 * db);
 
         register_sqlite_funcs(lnav_data.ld_db.in(), sqlite_registration_funcs);
+        index_sqlite_funcs_help(sqlite_registration_funcs);
         register_collation_functions(lnav_data.ld_db.in());
     }
 
@@ -2176,6 +2192,7 @@ main(int argc, char* argv[])
     register_regexp_vtab(lnav_data.ld_db.in());
     register_xpath_vtab(lnav_data.ld_db.in());
     register_fstat_vtab(lnav_data.ld_db.in());
+    register_field_sketch_vtab(lnav_data.ld_db.in());
     lnav::events::register_events_tab(lnav_data.ld_db.in());
 
     auto _vtab_cleanup = finally([] {
@@ -2420,10 +2437,9 @@ SELECT tbl_name FROM sqlite_master WHERE sql LIKE 'CREATE VIRTUAL TABLE%'
 
     if (lnav_data.ld_debug_log_name != DEFAULT_DEBUG_LOG) {
         lnav_log_level = lnav_log_level_t::TRACE;
+        lnav_log_file = make_optional_from_nullable(
+            fopen(lnav_data.ld_debug_log_name.c_str(), "a"));
     }
-
-    lnav_log_file = make_optional_from_nullable(
-        fopen(lnav_data.ld_debug_log_name.c_str(), "a"));
     log_info("lnav started");
 
     {
@@ -2731,13 +2747,14 @@ SELECT tbl_name FROM sqlite_master WHERE sql LIKE 'CREATE VIRTUAL TABLE%'
     lnav_data.ld_vtab_manager->register_vtab(std::make_shared<all_logs_vtab>());
     lnav_data.ld_vtab_manager->register_vtab(
         std::make_shared<log_format_vtab_impl>(
-            *log_format::find_root_format("generic_log")));
+            *log_format::find_root_format("generic_log")),
+        true);
 
     for (auto& iter : log_format::get_root_formats()) {
         auto lvi = iter->get_vtab_impl();
 
         if (lvi != nullptr) {
-            lnav_data.ld_vtab_manager->register_vtab(lvi);
+            lnav_data.ld_vtab_manager->register_vtab(lvi, true);
         }
     }
 
@@ -31,6 +31,7 @@
 
 #include "lnav.events.hh"
 #include "lnav.hh"
+#include "lnav.query_pool.hh"
 #include "service_tags.hh"
 #include "session_data.hh"
 
@@ -141,7 +142,7 @@ public:
                 auto vt = format->get_vtab_impl();
 
                 if (vt != nullptr) {
-                    lnav_data.ld_vtab_manager->register_vtab(vt);
+                    lnav_data.ld_vtab_manager->register_vtab(vt, true);
                 }
             }
 
@@ -192,6 +193,11 @@ rebuild_indexes(nonstd::optional<ui_clock::time_point> deadline)
     bool scroll_downs[LNV__MAX];
     size_t retval = 0;
 
+    // The background queries expect the logs to stay put while they run.
+    for (const auto& err : lnav::query_pool::wait()) {
+        log_error("background query failed -- %s", err.c_str());
+    }
+
     for (int lpc = 0; lpc < LNV__MAX; lpc++) {
         old_bottoms[lpc] = lnav_data.ld_views[lpc].get_top_for_last_row();
         scroll_downs[lpc]
@@ -268,6 +274,9 @@ rebuild_indexes(nonstd::optional<ui_clock::time_point> deadline)
     }
 
     auto result = lss.rebuild_index(deadline);
+    // Now that every file has had a chance to read new data, close the
+    // descriptors of the ones that have been idle the longest.
+    logfile::release_idle_fds();
     if (result != logfile_sub_source::rebuild_result::rr_no_change) {
         size_t new_count = lss.text_line_count();
         bool force
@@ -0,0 +1,221 @@
+/**
+ * Copyright (c) 2023, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <algorithm>
+#include <mutex>
+#include <thread>
+
+#include "lnav.query_pool.hh"
+
+#include "base/lnav_log.hh"
+#include "lnav.hh"
+#include "lnav_util.hh"
+#include "log_vtab_impl.hh"
+#include "sqlite-extension-func.hh"
+
+int register_collation_functions(sqlite3* db);
+
+namespace lnav {
+namespace query_pool {
+
+static std::recursive_mutex SOURCE_MUTEX;
+
+struct running_query {
+    std::unique_ptr<query> rq_query;
+    row_callback_t rq_on_row;
+    std::string rq_error;
+    std::thread rq_thread;
+};
+
+static std::vector<std::unique_ptr<running_query>> RUNNING_QUERIES;
+
+query::~query() = default;
+
+Result<std::unique_ptr<query>, std::string>
+prepare(const std::string& sql)
+{
+    static sqlite_registration_func_t WORKER_FUNCS[] = {
+        common_extension_functions,
+        string_extension_functions,
+        network_extension_functions,
+        fs_extension_functions,
+        json_extension_functions,
+        yaml_extension_functions,
+        time_extension_functions,
+
+        nullptr,
+    };
+
+    std::unique_ptr<query> retval(new query());
+
+    if (sqlite3_open(":memory:", retval->q_db.out()) != SQLITE_OK) {
+        return Err(std::string("unable to create a database connection"));
+    }
+
+    register_sqlite_funcs(retval->q_db.in(), WORKER_FUNCS);
+    register_collation_functions(retval->q_db.in());
+
+    // Queries that are already running can be reading from the log tables
+    // while this one is being planned.
+    log_vtab_data.lvd_source_mutex = &SOURCE_MUTEX;
+    auto _unlock = finally([] { log_vtab_data.lvd_source_mutex = nullptr; });
+
+    retval->q_vtab_manager = std::make_unique<log_vtab_manager>(
+        retval->q_db.in(), lnav_data.ld_views[LNV_LOG], lnav_data.ld_log_source);
+    for (const auto& vtab_pair : *lnav_data.ld_vtab_manager) {
+        auto errmsg
+            = retval->q_vtab_manager->register_vtab(vtab_pair.second, true);
+        if (!errmsg.empty()) {
+            log_error("unable to register %s for query: %s",
+                      vtab_pair.first.get(),
+                      errmsg.c_str());
+        }
+    }
+
+    auto rc = sqlite3_prepare_v2(retval->q_db.in(),
+                                 sql.c_str(),
+                                 sql.size(),
+                                 retval->q_stmt.out(),
+                                 nullptr);
+    if (rc != SQLITE_OK) {
+        return Err(std::string(sqlite3_errmsg(retval->q_db.in())));
+    }
+    if (retval->q_stmt.in() == nullptr) {
+        return Err(std::string("no statement given"));
+    }
+    if (!sqlite3_stmt_readonly(retval->q_stmt.in())) {
+        return Err(std::string("only read-only statements can be run"));
+    }
+
+    return Ok(std::move(retval));
+}
+
+static void
+run_query(running_query* rq)
+{
+    auto* stmt = rq->rq_query->get_stmt();
+    auto done = false;
+
+    log_vtab_data.lvd_source_mutex = &SOURCE_MUTEX;
+    while (!done) {
+        auto rc = sqlite3_step(stmt);
+
+        switch (rc) {
+            case SQLITE_ROW:
+                rq->rq_on_row(stmt);
+                break;
+            case SQLITE_DONE:
+                done = true;
+                break;
+            default:
+                rq->rq_error = sqlite3_errmsg(sqlite3_db_handle(stmt));
+                done = true;
+                break;
+        }
+    }
+    log_vtab_data.lvd_source_mutex = nullptr;
+}
+
+static void
+join_query(running_query& rq, std::vector<std::string>& errors)
+{
+    if (rq.rq_thread.joinable()) {
+        rq.rq_thread.join();
+    }
+    if (!rq.rq_error.empty()) {
+        log_error("query failed: %s -- %s",
+                  sqlite3_sql(rq.rq_query->get_stmt()),
+                  rq.rq_error.c_str());
+        errors.emplace_back(rq.rq_error);
+    }
+}
+
+void
+start(std::unique_ptr<query> q, row_callback_t on_row)
+{
+    static const size_t MAX_RUNNING
+        = std::max(1U, std::thread::hardware_concurrency());
+
+    auto rq = std::make_unique<running_query>();
+
+    rq->rq_query = std::move(q);
+    rq->rq_on_row = std::move(on_row);
+    if (!sqlite3_threadsafe()) {
+        run_query(rq.get());
+        RUNNING_QUERIES.emplace_back(std::move(rq));
+        return;
+    }
+
+    size_t active = std::count_if(
+        RUNNING_QUERIES.begin(), RUNNING_QUERIES.end(), [](const auto& elem) {
+            return elem->rq_thread.joinable();
+        });
+    if (active >= MAX_RUNNING) {
+        for (auto& elem : RUNNING_QUERIES) {
+            if (elem->rq_thread.joinable()) {
+                elem->rq_thread.join();
+                break;
+            }
+        }
+    }
+
+    log_info("starting query %d: %s",
+             (int) RUNNING_QUERIES.size(),
+             sqlite3_sql(rq->rq_query->get_stmt()));
+    auto* rq_ptr = rq.get();
+    rq->rq_thread = std::thread([rq_ptr]() { run_query(rq_ptr); });
+    RUNNING_QUERIES.emplace_back(std::move(rq));
+}
+
+bool
+busy()
+{
+    return !RUNNING_QUERIES.empty();
+}
+
+std::vector<std::string>
+wait()
+{
+    std::vector<std::string> retval;
+
+    if (RUNNING_QUERIES.empty()) {
+        return retval;
+    }
+
+    log_info("waiting for %d queries", (int) RUNNING_QUERIES.size());
+    for (auto& rq : RUNNING_QUERIES) {
+        join_query(*rq, retval);
+    }
+    RUNNING_QUERIES.clear();
+
+    return retval;
+}
+
+}  // namespace query_pool
+}  // namespace lnav
@@ -0,0 +1,102 @@
+/**
+ * Copyright (c) 2023, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef lnav_query_pool_hh
+#define lnav_query_pool_hh
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <sqlite3.h>
+
+#include "base/auto_mem.hh"
+#include "base/result.h"
+#include "sqlitepp.hh"
+
+class log_vtab_manager;
+
+namespace lnav {
+namespace query_pool {
+
+/**
+ * A read-only statement prepared on its own connection.  The connection has
+ * the lnav extension functions and the log tables registered, but not the
+ * tables that are tied to the UI or that were created in the main database.
+ */
+class query {
+public:
+    ~query();
+
+    sqlite3_stmt* get_stmt() const { return this->q_stmt.in(); }
+
+private:
+    friend Result<std::unique_ptr<query>, std::string> prepare(
+        const std::string& sql);
+
+    query() = default;
+
+    auto_sqlite3 q_db;
+    std::unique_ptr<log_vtab_manager> q_vtab_manager;
+    auto_mem<sqlite3_stmt> q_stmt{sqlite3_finalize};
+};
+
+using row_callback_t = std::function<void(sqlite3_stmt*)>;
+
+/**
+ * Prepare a statement on a new connection.  Statements that would modify a
+ * database are rejected.
+ */
+Result<std::unique_ptr<query>, std::string> prepare(const std::string& sql);
+
+/**
+ * Start stepping through the query's results on a background thread.  The
+ * callback is called from that thread for each row.  The log files are not
+ * rescanned or reindexed until wait() is called, so every query sees the
+ * same snapshot of the logs.
+ */
+void start(std::unique_ptr<query> q, row_callback_t on_row);
+
+/**
+ * @return True if any queries have been started and not yet waited on.
+ */
+bool busy();
+
+/**
+ * Wait for the started queries to finish.
+ *
+ * @return The error messages from any queries that failed.
+ */
+std::vector<std::string> wait();
+
+}  // namespace query_pool
+}  // namespace lnav
+
+#endif
@@ -58,6 +58,7 @@
 #include "field_overlay_source.hh"
 #include "fmt/printf.h"
 #include "lnav.indexing.hh"
+#include "lnav.query_pool.hh"
 #include "lnav_commands.hh"
 #include "lnav_config.hh"
 #include "lnav_util.hh"
@@ -1103,8 +1104,6 @@ com_save_to(exec_context& ec,
     int line_count = 0;
 
     if (args[0] == "write-csv-to") {
-        std::vector<std::vector<const char*>>::iterator row_iter;
-        std::vector<const char*>::iterator iter;
         std::vector<db_label_source::header_meta>::iterator hdr_iter;
         bool first = true;
 
@@ -1120,23 +1119,20 @@ com_save_to(exec_context& ec,
         }
         fprintf(outfile, "\n");
 
-        for (row_iter = dls.dls_rows.begin(); row_iter != dls.dls_rows.end();
-             ++row_iter)
-        {
-            if (ec.ec_dry_run && distance(dls.dls_rows.begin(), row_iter) > 10)
-            {
+        for (size_t row = 0; row < dls.dls_rows.size(); row++) {
+            if (ec.ec_dry_run && row > 10) {
                 break;
             }
 
             first = true;
-            for (iter = row_iter->begin(); iter != row_iter->end(); ++iter) {
+            for (const auto* cell : dls.dls_rows[row]) {
                 if (!first) {
                     fprintf(outfile, ",");
                 }
                 csv_write_string(
                     outfile,
-                    anonymize ? ta.next(string_fragment::from_c_str(*iter))
-                              : *iter);
+                    anonymize ? ta.next(string_fragment::from_c_str(cell))
+                              : cell);
                 first = false;
             }
             fprintf(outfile, "\n");
@@ -1315,17 +1311,12 @@ com_save_to(exec_context& ec,
         }
     } else if (args[0] == "write-raw-to") {
         if (tc == &lnav_data.ld_views[LNV_DB]) {
-            for (auto row_iter = dls.dls_rows.begin();
-                 row_iter != dls.dls_rows.end();
-                 ++row_iter)
-            {
-                if (ec.ec_dry_run
-                    && distance(dls.dls_rows.begin(), row_iter) > 10)
-                {
+            for (size_t row = 0; row < dls.dls_rows.size(); row++) {
+                if (ec.ec_dry_run && row > 10) {
                     break;
                 }
 
-                for (auto& iter : *row_iter) {
+                for (const auto* iter : dls.dls_rows[row]) {
                     if (anonymize) {
                         fputs(
                             ta.next(string_fragment::from_c_str(iter)).c_str(),
@@ -1475,6 +1466,93 @@ com_save_to(exec_context& ec,
     return Ok(retval);
 }
 
+static Result<std::string, lnav::console::user_message>
+com_write_query_csv_to(exec_context& ec,
+                       std::string cmdline,
+                       std::vector<std::string>& args)
+{
+    if (args.empty()) {
+        args.emplace_back("filename");
+        return Ok(std::string());
+    }
+
+    if (args.size() < 3) {
+        return ec.make_error("expecting a file name and a SQL statement");
+    }
+
+    if (lnav_data.ld_flags & LNF_SECURE_MODE) {
+        return ec.make_error("{} -- unavailable in secure mode", args[0]);
+    }
+
+    std::vector<std::string> split_args;
+    shlex lexer(args[1]);
+
+    if (!lexer.split(split_args, ec.create_resolver())
+        || split_args.size() != 1)
+    {
+        return ec.make_error("unable to parse file name -- {}", args[1]);
+    }
+
+    auto sql = trim(remaining_args(cmdline, args, 2));
+    auto prep_res = lnav::query_pool::prepare(sql);
+    if (prep_res.isErr()) {
+        return ec.make_error("unable to prepare query -- {}",
+                             prep_res.unwrapErr());
+    }
+
+    if (ec.ec_dry_run) {
+        return Ok(std::string());
+    }
+
+    auto_mem<FILE> outfile(fclose);
+
+    if ((outfile = fopen(split_args[0].c_str(), "w")) == nullptr) {
+        return ec.make_error("unable to open file -- {}", split_args[0]);
+    }
+
+    auto q = prep_res.unwrap();
+    auto column_count = sqlite3_column_count(q->get_stmt());
+
+    for (int lpc = 0; lpc < column_count; lpc++) {
+        if (lpc > 0) {
+            fprintf(outfile, ",");
+        }
+        csv_write_string(outfile, sqlite3_column_name(q->get_stmt(), lpc));
+    }
+    fprintf(outfile, "\n");
+
+    auto shared_out = std::shared_ptr<FILE>(outfile.release(), fclose);
+    lnav::query_pool::start(
+        std::move(q), [shared_out, column_count](sqlite3_stmt* stmt) {
+            for (int lpc = 0; lpc < column_count; lpc++) {
+                const auto* value
+                    = (const char*) sqlite3_column_text(stmt, lpc);
+
+                if (lpc > 0) {
+                    fprintf(shared_out.get(), ",");
+                }
+                csv_write_string(shared_out.get(),
+                                 value != nullptr ? value
+                                                  : db_label_source::NULL_STR);
+            }
+            fprintf(shared_out.get(), "\n");
+        });
+
+    if (!(lnav_data.ld_flags & LNF_HEADLESS) && lnav_data.ld_cmd_init_done
+        && ec.ec_path_stack.size() <= 1)
+    {
+        // The UI reads from the logs too, so an interactive command cannot
+        // leave the query running.
+        auto errors = lnav::query_pool::wait();
+
+        if (!errors.empty()) {
+            return ec.make_error("query failed -- {}", errors.front());
+        }
+    }
+
+    return Ok(std::string());
+}
+
 static Result<std::string, lnav::console::user_message>
 com_pipe_to(exec_context& ec,
             std::string cmdline,
@@ -1918,6 +1996,140 @@ com_filter(exec_context& ec,
     return Ok(retval);
 }
 
+static Result<std::string, lnav::console::user_message>
+com_filter_set(exec_context& ec,
+               std::string cmdline,
+               std::vector<std::string>& args)
+{
+    std::string retval;
+
+    if (args.empty()) {
+        args.emplace_back("filename");
+
+        return Ok(std::string());
+    }
+
+    auto* tc = *lnav_data.ld_view_stack.top();
+    auto* tss = tc->get_sub_source();
+
+    if (!tss->tss_supports_filtering) {
+        return ec.make_error("{} view does not support filtering",
+                             lnav_view_strings[tc - lnav_data.ld_views]);
+    }
+    if (args.size() < 2) {
+        return ec.make_error(
+            "expecting a file name or an SQL query prefixed with ';'");
+    }
+
+    auto& fs = tss->get_filters();
+    auto source = trim(remaining_args(cmdline, args));
+    if (fs.get_filter(source) != nullptr) {
+        return com_enable_filter(ec, cmdline, args);
+    }
+
+    if (fs.full()) {
+        return ec.make_error("filter limit reached");
+    }
+
+    lnav::aho_corasick matcher;
+
+    if (startswith(source, ";")) {
+        auto sql = source.substr(1);
+        auto_mem<sqlite3_stmt> stmt(sqlite3_finalize);
+
+        if (sqlite3_prepare_v2(lnav_data.ld_db.in(),
+                               sql.c_str(),
+                               sql.size(),
+                               stmt.out(),
+                               nullptr)
+            != SQLITE_OK)
+        {
+            return ec.make_error("unable to prepare query -- {}",
+                                 sqlite3_errmsg(lnav_data.ld_db.in()));
+        }
+        if (stmt.in() == nullptr || !sqlite3_stmt_readonly(stmt.in())) {
+            return ec.make_error("expecting a read-only query");
+        }
+
+        auto done = false;
+        while (!done) {
+            switch (sqlite3_step(stmt.in())) {
+                case SQLITE_ROW: {
+                    const auto* value
+                        = (const char*) sqlite3_column_text(stmt.in(), 0);
+
+                    if (value != nullptr) {
+                        matcher.add(string_fragment::from_c_str(value));
+                    }
+                    break;
+                }
+                case SQLITE_DONE:
+                    done = true;
+                    break;
+                default:
+                    return ec.make_error("unable to execute query -- {}",
+                                         sqlite3_errmsg(lnav_data.ld_db.in()));
+            }
+        }
+    } else {
+        std::vector<std::string> split_args;
+        shlex lexer(source);
+
+        if (!lexer.split(split_args, ec.create_resolver())
+            || split_args.size() != 1)
+        {
+            return ec.make_error("unable to parse file name -- {}", source);
+        }
+
+        auto read_res = lnav::filesystem::read_file(split_args[0]);
+        if (read_res.isErr()) {
+            return ec.make_error("unable to read file -- {} -- {}",
+                                 split_args[0],
+                                 read_res.unwrapErr());
+        }
+
+        auto content = read_res.unwrap();
+        for (const auto& line : string_fragment::from_str(content).split_lines())
+        {
+            matcher.add(line.trim());
+        }
+    }
+
+    if (matcher.empty()) {
+        return ec.make_error("no strings to match were found in -- {}",
+                             source);
+    }
+
+    auto literal_count = matcher.size();
+    if (ec.ec_dry_run) {
+        lnav_data.ld_preview_status_source.get_description().set_value(
+            "The filter will match %zu strings", literal_count);
+        return Ok(std::string());
+    }
+
+    auto lt = (args[0] == "filter-out-set") ? text_filter::EXCLUDE
+                                            : text_filter::INCLUDE;
+    auto filter_index = fs.next_index();
+    if (!filter_index) {
+        return ec.make_error("too many filters");
+    }
+    auto lsf = std::make_shared<literal_set_filter>(
+        lt, source, *filter_index, std::move(matcher));
+
+    log_debug("%s [%d] %s -- %zu strings",
+              args[0].c_str(),
+              lsf->get_index(),
+              source.c_str(),
+              literal_count);
+    fs.add_filter(lsf);
+    tss->text_filters_changed();
+
+    retval = fmt::format(
+        FMT_STRING("info: filter now active with {} strings"), literal_count);
+
+    return Ok(retval);
+}
+
 static Result<std::string, lnav::console::user_message>
 com_delete_filter(exec_context& ec,
                   std::string cmdline,
@@ -4070,6 +4282,31 @@ com_show_unmarked(exec_context& ec,
     return Ok(retval);
 }
 
+static Result<std::string, lnav::console::user_message>
+com_toggle_repeats(exec_context& ec,
+                   std::string cmdline,
+                   std::vector<std::string>& args)
+{
+    std::string retval;
+
+    if (args.empty() || lnav_data.ld_view_stack.empty()) {
+    } else if (*lnav_data.ld_view_stack.top() != &lnav_data.ld_views[LNV_LOG])
+    {
+        return ec.make_error(
+            ":toggle-repeats is only supported for the LOG view");
+    } else if (!ec.ec_dry_run) {
+        auto& tc = lnav_data.ld_views[LNV_LOG];
+
+        if (!lnav_data.ld_log_source.toggle_repeats(tc.get_selection())) {
+            return ec.make_error(
+                "the selected line is not part of a run of repeated messages");
+        }
+        rebuild_indexes_repeatedly();
+    }
+
+    return Ok(retval);
+}
+
 static Result<std::string, lnav::console::user_message>
 com_rebuild(exec_context& ec,
             std::string cmdline,
@@ -5108,6 +5345,15 @@ readline_context::command_t STD_COMMANDS[] = {
          .with_summary("Show lines that have not been bookmarked")
          .with_opposites({"show-unmarked-lines"})
          .with_tags({"filtering", "bookmarks"})},
+    {"toggle-repeats",
+     com_toggle_repeats,
+
+     help_text(":toggle-repeats")
+         .with_summary("Expand the run of repeated messages at the focused "
+                       "line or collapse it again.  Runs are only collapsed "
+                       "when the /tuning/logfile/collapse-repeats option is "
+                       "enabled")
+         .with_tags({"display"})},
     {"highlight",
      com_highlight,
 
@@ -5155,6 +5401,34 @@ readline_context::command_t STD_COMMANDS[] = {
          .with_example({"To filter out log messages that contain the string "
                         "'last message repeated'",
                         "last message repeated"})},
+    {"filter-in-set",
+     com_filter_set,
+
+     help_text(":filter-in-set")
+         .with_summary("Only show lines that contain one of the strings in "
+                       "the given file or the results of the given query")
+         .with_parameter(help_text(
+             "source",
+             "The path to a file with one string per line, or an SQL query "
+             "prefixed with a semicolon whose first column has the strings"))
+         .with_tags({"filtering"})
+         .with_example({"To only show lines that have one of the request IDs "
+                        "in the file /tmp/ids.txt",
+                        "/tmp/ids.txt"})},
+    {"filter-out-set",
+     com_filter_set,
+
+     help_text(":filter-out-set")
+         .with_summary("Remove lines that contain one of the strings in the "
+                       "given file or the results of the given query")
+         .with_parameter(help_text(
+             "source",
+             "The path to a file with one string per line, or an SQL query "
+             "prefixed with a semicolon whose first column has the strings"))
+         .with_tags({"filtering"})
+         .with_example({"To remove lines that have one of the addresses in "
+                        "the blocked table",
+                        ";SELECT addr FROM blocked"})},
     {"delete-filter",
      com_delete_filter,
 
@@ -5233,6 +5507,19 @@ readline_context::command_t STD_COMMANDS[] = {
          .with_tags({"io", "scripting", "sql"})
          .with_example({"To write SQL results as CSV to /tmp/table.csv",
                         "/tmp/table.csv"})},
+    {"write-query-csv-to",
+     com_write_query_csv_to,
+
+     help_text(":write-query-csv-to")
+         .with_summary("Run a read-only SQL query in the background and "
+                       "write the results to the given file in CSV format")
+         .with_parameter(help_text("path", "The path to the file to write"))
+         .with_parameter(help_text("statement", "The SQL statement to run"))
+         .with_tags({"io", "scripting", "sql"})
+         .with_example({"To count the errors in the background and write "
+                        "them to /tmp/errors.csv",
+                        "/tmp/errors.csv SELECT count(*) FROM all_logs "
+                        "WHERE log_level = 'error'"})},
     {"write-json-to",
      com_save_to,
 
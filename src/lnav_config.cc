@@ -58,6 +58,7 @@
 #include "bin2c.hh"
 #include "config.h"
 #include "default-config.h"
+#include "lnav_util.hh"
 #include "styling.hh"
 #include "view_curses.hh"
 #include "yajlpp/yajlpp.hh"
@@ -99,6 +100,12 @@ static auto lsc = injector::bind<logfile_sub_source_ns::config>::to_instance(
 static auto tssc = injector::bind<top_status_source_cfg>::to_instance(
     +[]() { return &lnav_config.lc_top_status_cfg; });
 
+static auto dlc = injector::bind<lnav::delimited_log::config>::to_instance(
+    +[]() { return &lnav_config.lc_delimited_log; });
+
+static auto dbc = injector::bind<db_sub_source_ns::config>::to_instance(
+    +[]() { return &lnav_config.lc_db_view; });
+
 bool
 check_experimental(const char* feature_name)
 {
@@ -1067,6 +1074,18 @@ static const struct json_path_container file_vtab_handlers = {
                    &file_vtab::config::fvc_max_content_size),
 };
 
+static const struct json_path_container db_view_handlers = {
+    yajlpp::property_handler("max-memory-size")
+        .with_synopsis("<bytes>")
+        .with_description("The amount of memory a query result can use "
+                          "before its rows are moved out to a temporary "
+                          "file.  Only the rows being viewed or exported are "
+                          "read back into memory")
+        .with_min_value(0)
+        .for_field(&_lnav_config::lc_db_view,
+                   &db_sub_source_ns::config::dc_max_memory_size),
+};
+
 static const struct json_path_container logfile_handlers = {
     yajlpp::property_handler("max-unrecognized-lines")
         .with_synopsis("<lines>")
@@ -1075,6 +1094,70 @@ static const struct json_path_container logfile_handlers = {
         .with_min_value(1)
         .for_field(&_lnav_config::lc_logfile,
                    &lnav::logfile::config::lc_max_unrecognized_lines),
+    yajlpp::property_handler("tail-first-min-size")
+        .with_synopsis("<bytes>")
+        .with_description("The minimum size of a file before the end of the "
+                          "file is indexed and displayed first, a value of "
+                          "zero disables tail-first indexing")
+        .with_min_value(0)
+        .for_field(&_lnav_config::lc_logfile,
+                   &lnav::logfile::config::lc_tail_first_min_size),
+    yajlpp::property_handler("tail-first-size")
+        .with_synopsis("<bytes>")
+        .with_description("The number of bytes at the end of a large file to "
+                          "index before indexing the rest of the file")
+        .with_min_value(1)
+        .for_field(&_lnav_config::lc_logfile,
+                   &lnav::logfile::config::lc_tail_first_size),
+    yajlpp::property_handler("max-retained-lines")
+        .with_synopsis("<lines>")
+        .with_description("The maximum number of lines to keep in the index "
+                          "for a log file, older lines are dropped as new "
+                          "ones are read.  A value of zero means there is no "
+                          "limit")
+        .with_min_value(0)
+        .for_field(&_lnav_config::lc_logfile,
+                   &lnav::logfile::config::lc_max_retained_lines),
+    yajlpp::property_handler("max-retained-bytes")
+        .with_synopsis("<bytes>")
+        .with_description("The maximum number of bytes at the end of a log "
+                          "file to keep in the index, older lines are "
+                          "dropped as new ones are read.  A value of zero "
+                          "means there is no limit")
+        .with_min_value(0)
+        .for_field(&_lnav_config::lc_logfile,
+                   &lnav::logfile::config::lc_max_retained_bytes),
+    yajlpp::property_handler("max-retained-age")
+        .with_synopsis("<duration>")
+        .with_description("The maximum age of messages to keep in the index "
+                          "for a log file, relative to the newest message in "
+                          "the file, expressed as a duration (e.g. '1d' for "
+                          "one day)")
+        .with_example("1d")
+        .with_example("12h")
+        .for_field(&_lnav_config::lc_logfile,
+                   &lnav::logfile::config::lc_max_retained_age),
+    yajlpp::property_handler("max-open-files")
+        .with_synopsis("<count>")
+        .with_description("The maximum number of log files to keep open.  "
+                          "The least recently read files are closed when "
+                          "the limit is exceeded and reopened when they "
+                          "need to be read again.  A value of zero means "
+                          "half of the process's file descriptor limit")
+        .with_min_value(0)
+        .for_field(&_lnav_config::lc_logfile,
+                   &lnav::logfile::config::lc_max_open_files),
+    yajlpp::property_handler("collapse-repeats")
+        .with_synopsis("bool")
+        .with_description("Collapse runs of identical single-line messages "
+                          "in a file into a single row in the log view.  The "
+                          "row shows how many times the message repeated "
+                          "and over what period and can be expanded with "
+                          "the :toggle-repeats command.  The SQL log tables "
+                          "still return a row for every message, but the "
+                          "messages in a collapsed row share its log_line")
+        .for_field(&_lnav_config::lc_logfile,
+                   &lnav::logfile::config::lc_collapse_repeats),
 };
 
 static const struct json_path_container ssh_config_handlers = {
@@ -1235,10 +1318,46 @@ static const struct json_path_container log_source_watch_handlers = {
         .with_children(log_source_watch_expr_handlers),
 };
 
+static const struct json_path_container delimited_log_handlers = {
+    yajlpp::property_handler("delimiters")
+        .with_synopsis("<chars>")
+        .with_description("The field delimiters to try when detecting the "
+                          "header of a delimited file")
+        .with_example(",\t")
+        .for_field(&_lnav_config::lc_delimited_log,
+                   &lnav::delimited_log::config::dc_delimiters),
+    yajlpp::property_handler("quote")
+        .with_synopsis("<char>")
+        .with_description("The character used to quote fields that contain "
+                          "delimiters, an empty string disables quoting")
+        .with_example("\"")
+        .for_field(&_lnav_config::lc_delimited_log,
+                   &lnav::delimited_log::config::dc_quote),
+    yajlpp::property_handler("timestamp-column")
+        .with_synopsis("<name>")
+        .with_description("The name of the column that contains the message "
+                          "timestamp.  If empty, the first column with a "
+                          "timestamp in the first record is used")
+        .with_example("time")
+        .for_field(&_lnav_config::lc_delimited_log,
+                   &lnav::delimited_log::config::dc_timestamp_column),
+    yajlpp::property_handler("level-column")
+        .with_synopsis("<name>")
+        .with_description("The name of the column that contains the message "
+                          "level.  If empty, a column named 'level' or "
+                          "'severity' is used")
+        .with_example("status")
+        .for_field(&_lnav_config::lc_delimited_log,
+                   &lnav::delimited_log::config::dc_level_column),
+};
+
 static const struct json_path_container log_source_handlers = {
     yajlpp::property_handler("watch-expressions")
         .with_description("Log message watch expressions")
         .with_children(log_source_watch_handlers),
+    yajlpp::property_handler("delimited")
+        .with_description("Settings for delimited (e.g. CSV or TSV) files")
+        .with_children(delimited_log_handlers),
 };
 
 static const struct json_path_container tuning_handlers = {
@@ -1248,6 +1367,9 @@ static const struct json_path_container tuning_handlers = {
     yajlpp::property_handler("file-vtab")
         .with_description("Settings related to the lnav_file virtual-table")
         .with_children(file_vtab_handlers),
+    yajlpp::property_handler("db-view")
+        .with_description("Settings related to the SQL results view")
+        .with_children(db_view_handlers),
     yajlpp::property_handler("logfile")
         .with_description("Settings related to log files")
         .with_children(logfile_handlers),
@@ -1475,31 +1597,77 @@ load_default_configs(struct _lnav_config& config_obj,
     return retval;
 }
 
+/**
+ * @return The configuration that results from loading only the builtin
+ * files.  The files are parsed the first time this is called and the
+ * result is copied into the configurations that need it afterward.
+ */
+static const _lnav_config&
+builtin_config(std::vector<lnav::console::user_message>& errors)
+{
+    static nonstd::optional<_lnav_config> retval;
+
+    if (!retval) {
+        log_info("loading builtin configuration");
+        retval = _lnav_config{};
+        load_default_configs(retval.value(), "*", errors);
+    }
+
+    return retval.value();
+}
+
 void
 load_config(const std::vector<ghc::filesystem::path>& extra_paths,
             std::vector<lnav::console::user_message>& errors)
 {
     auto user_config = lnav::paths::dotlnav() / "config.json";
+    auto sample_dir = lnav::paths::dotlnav() / "configs" / "default";
+    auto samples_hash_path = sample_dir / ".samples-hash";
+    hasher samples_hasher;
 
     for (auto& bsf : lnav_config_json) {
-        auto sample_path = lnav::paths::dotlnav() / "configs" / "default"
-            / fmt::format(FMT_STRING("{}.sample"), bsf.get_name());
-
-        auto write_res = lnav::filesystem::write_file(sample_path,
-                                                      bsf.to_string_fragment());
-        if (write_res.isErr()) {
-            fprintf(stderr,
-                    "error:unable to write default config file: %s -- %s\n",
-                    sample_path.c_str(),
-                    write_res.unwrapErr().c_str());
+        samples_hasher.update(bsf.get_name(), strlen(bsf.get_name()));
+        samples_hasher.update(bsf.to_string_fragment());
+    }
+
+    // The hash of the builtin files is kept next to the samples so they
+    // only need to be written out again when the builtin files change.
+    auto samples_hash = samples_hasher.to_string();
+    auto hash_res = lnav::filesystem::read_file(samples_hash_path);
+    if (hash_res.isErr() || hash_res.unwrap() != samples_hash) {
+        auto samples_written = true;
+
+        for (auto& bsf : lnav_config_json) {
+            auto sample_path = sample_dir
+                / fmt::format(FMT_STRING("{}.sample"), bsf.get_name());
+
+            auto write_res = lnav::filesystem::write_file(
+                sample_path, bsf.to_string_fragment());
+            if (write_res.isErr()) {
+                fprintf(stderr,
+                        "error:unable to write default config file: %s -- "
+                        "%s\n",
+                        sample_path.c_str(),
+                        write_res.unwrapErr().c_str());
+                samples_written = false;
+            }
+        }
+        if (samples_written) {
+            auto write_res = lnav::filesystem::write_file(samples_hash_path,
+                                                          samples_hash);
+            if (write_res.isErr()) {
+                log_error("unable to write %s -- %s",
+                          samples_hash_path.c_str(),
+                          write_res.unwrapErr().c_str());
+            }
         }
     }
 
     {
-        log_info("loading builtin configuration into default");
-        load_default_configs(lnav_default_config, "*", errors);
-        log_info("loading builtin configuration into base");
-        load_default_configs(lnav_config, "*", errors);
+        const auto& builtin = builtin_config(errors);
+
+        lnav_default_config = builtin;
+        lnav_config = builtin;
 
         log_info("loading user configuration files");
         for (const auto& extra_path : extra_paths) {
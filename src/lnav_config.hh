@@ -43,6 +43,8 @@
 #include "base/file_range.hh"
 #include "base/lnav.console.hh"
 #include "base/result.h"
+#include "db_sub_source.cfg.hh"
+#include "delimited_log.cfg.hh"
 #include "file_vtab.cfg.hh"
 #include "ghc/filesystem.hpp"
 #include "lnav_config_fwd.hh"
@@ -114,6 +116,8 @@ struct _lnav_config {
     tailer::config lc_tailer;
     sysclip::config lc_sysclip;
     logfile_sub_source_ns::config lc_log_source;
+    lnav::delimited_log::config lc_delimited_log;
+    db_sub_source_ns::config lc_db_view;
 };
 
 extern struct _lnav_config lnav_config;
@@ -104,3 +104,19 @@ log_accel::get_direction() const
 
     return retval;
 }
+
+log_accel::direction_t
+log_accel::window::get_direction() const
+{
+    log_accel la;
+
+    for (int lpc = 0; lpc < this->w_size; lpc++) {
+        auto index = (this->w_next - 1 - lpc + POINT_COUNT) % POINT_COUNT;
+
+        if (!la.add_point(this->w_points[index])) {
+            break;
+        }
+    }
+
+    return la.get_direction();
+}
@@ -96,6 +96,33 @@ private:
     int64_t la_max_velocity{INT64_MIN};
     int64_t la_velocity[HISTORY_SIZE];
     int la_velocity_size{0};
+
+public:
+    /**
+     * A sliding window over the most recent points in a series that is
+     * visited from oldest to most recent.  The direction computed for the
+     * window is the same as feeding the points to a log_accel in reverse.
+     */
+    class window {
+    public:
+        void add_point(int64_t point)
+        {
+            this->w_points[this->w_next] = point;
+            this->w_next = (this->w_next + 1) % POINT_COUNT;
+            if (this->w_size < POINT_COUNT) {
+                this->w_size += 1;
+            }
+        }
+
+        direction_t get_direction() const;
+
+    private:
+        static const int POINT_COUNT = HISTORY_SIZE + 1;
+
+        int64_t w_points[POINT_COUNT];
+        int w_next{0};
+        int w_size{0};
+    };
 };
 
 #endif
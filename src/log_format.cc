@@ -64,6 +64,30 @@ external_log_format::mod_map_t external_log_format::MODULE_FORMATS;
 std::vector<std::shared_ptr<external_log_format>>
     external_log_format::GRAPH_ORDERED_FORMATS;
 
+bool
+external_log_format::pattern::match(string_fragment line,
+                                      lnav::pcre2pp::match_data& md) const
+{
+    const auto& co = *this->p_pcre.pp_value;
+
+    if (this->p_native) {
+        switch (this->p_native->match(co, line, md)) {
+            case lnav::native_format::match_result::match:
+                return true;
+            case lnav::native_format::match_result::no_match:
+                return false;
+            case lnav::native_format::match_result::unknown:
+                break;
+        }
+    }
+
+    return co.capture_from(line)
+        .into(md)
+        .matches(PCRE2_NO_UTF_CHECK)
+        .ignore_error()
+        .has_value();
+}
+
 struct line_range
 logline_value::origin_in_full_msg(const char* msg, ssize_t len) const
 {
@@ -717,6 +741,50 @@ external_log_format::get_snippets() const
     return retval;
 }
 
+/**
+ * Convert a numeric capture to a double, applying any unit scaling.
+ */
+static nonstd::optional<double>
+capture_to_number(const external_log_format::indexed_value_def& ivd,
+                  const lnav::pcre2pp::match_data& md)
+{
+    const auto& vd = *ivd.ivd_value_def;
+    auto num_cap = md[ivd.ivd_index];
+
+    if (!num_cap || !num_cap->is_valid()) {
+        return nonstd::nullopt;
+    }
+
+    const struct scaling_factor* scaling = nullptr;
+
+    if (ivd.ivd_unit_field_index >= 0) {
+        auto unit_cap = md[ivd.ivd_unit_field_index];
+
+        if (unit_cap && unit_cap->is_valid()) {
+            intern_string_t unit_val = intern_string::lookup(unit_cap.value());
+
+            auto unit_iter = vd.vd_unit_scaling.find(unit_val);
+            if (unit_iter != vd.vd_unit_scaling.end()) {
+                const auto& sf = unit_iter->second;
+
+                scaling = &sf;
+            }
+        }
+    }
+
+    auto scan_res = scn::scan_value<double>(num_cap->to_string_view());
+    if (!scan_res) {
+        return nonstd::nullopt;
+    }
+
+    auto dvalue = scan_res.value();
+    if (scaling != nullptr) {
+        scaling->scale(dvalue);
+    }
+
+    return dvalue;
+}
+
 log_format::scan_result_t
 external_log_format::scan(logfile& lf,
                           std::vector<logline>& dst,
@@ -832,21 +900,24 @@ external_log_format::scan(logfile& lf,
     int pat_index = orig_lock;
     auto line_sf = sbr.to_string_fragment();
 
-    while (::next_format(this->elf_pattern_order, curr_fmt, pat_index)) {
+    // Continuation lines usually cannot match any of the patterns, so
+    // check the prefilter before trying all of the regexes.
+    auto could_match = this->elf_prefilter.could_match(line_sf);
+
+    while (could_match
+           && ::next_format(this->elf_pattern_order, curr_fmt, pat_index))
+    {
         static thread_local auto md = lnav::pcre2pp::match_data::unitialized();
 
         auto* fpat = this->elf_pattern_order[curr_fmt].get();
-        auto* pat = fpat->p_pcre.pp_value.get();
 
         if (fpat->p_module_format) {
             continue;
         }
 
-        auto match_res = pat->capture_from(line_sf)
-                             .into(md)
-                             .matches(PCRE2_NO_UTF_CHECK)
-                             .ignore_error();
-        if (!match_res) {
+        if (!fpat->p_prefilter.could_match(line_sf)
+            || !fpat->match(line_sf, md))
+        {
             if (!this->lf_pattern_locks.empty() && pat_index != -1) {
                 curr_fmt = -1;
                 pat_index = -1;
@@ -856,6 +927,8 @@ external_log_format::scan(logfile& lf,
 
         auto ts = md[fpat->p_timestamp_field_index];
         auto time_cap = md[fpat->p_time_field_index];
+        auto ts_start = ts->sf_begin;
+        auto ts_end = ts->sf_end;
         auto level_cap = md[fpat->p_level_field_index];
         auto mod_cap = md[fpat->p_module_field_index];
         auto opid_cap = md[fpat->p_opid_field_index];
@@ -948,12 +1021,7 @@ external_log_format::scan(logfile& lf,
 
                     int mod_pat_index = mod_elf->last_pattern_index();
                     auto& mod_pat = *mod_elf->elf_pattern_order[mod_pat_index];
-                    auto match_res = mod_pat.p_pcre.pp_value
-                                         ->capture_from(body_cap.value())
-                                         .into(mod_md)
-                                         .matches(PCRE2_NO_UTF_CHECK)
-                                         .ignore_error();
-                    if (match_res) {
+                    if (mod_pat.match(body_cap.value(), mod_md)) {
                         auto mod_level_cap
                             = mod_md[mod_pat.p_level_field_index];
 
@@ -968,39 +1036,46 @@ external_log_format::scan(logfile& lf,
         for (auto value_index : fpat->p_numeric_value_indexes) {
             const indexed_value_def& ivd = fpat->p_value_by_index[value_index];
             const value_def& vd = *ivd.ivd_value_def;
-            auto num_cap = md[ivd.ivd_index];
-
-            if (num_cap && num_cap->is_valid()) {
-                const struct scaling_factor* scaling = nullptr;
+            auto num_opt = capture_to_number(ivd, md);
 
-                if (ivd.ivd_unit_field_index >= 0) {
-                    auto unit_cap = md[ivd.ivd_unit_field_index];
+            if (num_opt) {
+                this->lf_value_stats[vd.vd_values_index].add_value(
+                    num_opt.value());
+            }
+        }
 
-                    if (unit_cap && unit_cap->is_valid()) {
-                        intern_string_t unit_val
-                            = intern_string::lookup(unit_cap.value());
+        if (!fpat->p_sketch_value_indexes.empty()
+            && li.li_file_range.fr_offset >= sbc.sbc_sketch_offset)
+        {
+            auto block_time
+                = log_tv.tv_sec - (log_tv.tv_sec % FIELD_SKETCH_BLOCK_SECS);
 
-                        auto unit_iter = vd.vd_unit_scaling.find(unit_val);
-                        if (unit_iter != vd.vd_unit_scaling.end()) {
-                            const auto& sf = unit_iter->second;
+            for (auto value_index : fpat->p_sketch_value_indexes) {
+                const indexed_value_def& ivd
+                    = fpat->p_value_by_index[value_index];
+                const value_def& vd = *ivd.ivd_value_def;
+                auto cap = md[ivd.ivd_index];
 
-                            scaling = &sf;
-                        }
-                    }
+                if (!cap || !cap->is_valid()) {
+                    continue;
                 }
 
-                auto scan_res
-                    = scn::scan_value<double>(num_cap->to_string_view());
-                if (scan_res) {
-                    auto dvalue = scan_res.value();
-                    if (scaling != nullptr) {
-                        scaling->scale(dvalue);
-                    }
-                    this->lf_value_stats[vd.vd_values_index].add_value(dvalue);
+                nonstd::optional<double> num_opt;
+                switch (vd.vd_meta.lvm_kind) {
+                    case value_kind_t::VALUE_INTEGER:
+                    case value_kind_t::VALUE_FLOAT:
+                        num_opt = capture_to_number(ivd, md);
+                        break;
+                    default:
+                        break;
                 }
+                sbc.sbc_sketches[vd.vd_meta.lvm_name][block_time].add(
+                    cap.value(), num_opt);
             }
         }
 
+        sbc.sbc_timestamp_start = ts_start;
+        sbc.sbc_timestamp_end = ts_end;
         dst.emplace_back(
             li.li_file_range.fr_offset, log_tv, level, mod_index, opid);
 
@@ -1112,12 +1187,7 @@ external_log_format::annotate(uint64_t line_number,
     auto& pat = *this->elf_pattern_order[pat_index];
 
     sa.reserve(pat.p_pcre.pp_value->get_capture_count());
-    auto match_res
-        = pat.p_pcre.pp_value->capture_from(line.to_string_fragment())
-              .into(md)
-              .matches(PCRE2_NO_UTF_CHECK)
-              .ignore_error();
-    if (!match_res) {
+    if (!pat.match(line.to_string_fragment(), md)) {
         // A continued line still needs a body.
         lr.lr_start = 0;
         lr.lr_end = line.length();
@@ -1890,6 +1960,9 @@ external_log_format::build(std::vector<lnav::console::user_message>& errors)
                         break;
                 }
             }
+            if (vd->vd_sketch) {
+                pat.p_sketch_value_indexes.push_back(lpc);
+            }
         }
 
         if (!this->elf_level_field.empty() && pat.p_level_field_index == -1) {
@@ -1910,9 +1983,44 @@ external_log_format::build(std::vector<lnav::console::user_message>& errors)
                         this->elf_body_field.get());
         }
 
+        pat.p_prefilter.pf_first_bytes
+            = pat.p_pcre.pp_value->get_anchored_first_bytes();
+        pat.p_prefilter.pf_min_length = pat.p_pcre.pp_value->get_min_length();
+        pat.p_native
+            = lnav::native_format::find_pattern_matcher(*pat.p_pcre.pp_value);
+        if (pat.p_native) {
+            log_info("%s: using native parser for pattern",
+                     pat.p_config_path.c_str());
+        }
+
         this->elf_pattern_order.push_back(iter->second);
     }
 
+    {
+        auto first_pat = true;
+
+        this->elf_prefilter = prefilter{};
+        for (const auto& pat : this->elf_pattern_order) {
+            if (pat->p_module_format) {
+                continue;
+            }
+            if (first_pat) {
+                this->elf_prefilter = pat->p_prefilter;
+                first_pat = false;
+            } else {
+                this->elf_prefilter.merge(pat->p_prefilter);
+            }
+        }
+        if (this->elf_prefilter.pf_first_bytes.all()) {
+            log_debug("%s: no line prefilter available",
+                      this->elf_name.get());
+        } else {
+            log_debug("%s: line prefilter accepts %zu first bytes",
+                      this->elf_name.get(),
+                      this->elf_prefilter.pf_first_bytes.count());
+        }
+    }
+
     if (this->elf_type != elf_type_t::ELF_TYPE_TEXT) {
         if (!this->elf_patterns.empty()) {
             errors.emplace_back(
@@ -1950,6 +2058,23 @@ external_log_format::build(std::vector<lnav::console::user_message>& errors)
 
     stable_sort(this->elf_level_pairs.begin(), this->elf_level_pairs.end());
 
+    {
+        std::map<log_level_t, std::string> level_regexes;
+
+        for (const auto& pair : this->elf_level_patterns) {
+            if (pair.second.lp_pcre.pp_value) {
+                level_regexes[pair.first]
+                    = pair.second.lp_pcre.pp_value->get_pattern();
+            }
+        }
+        this->elf_native_level
+            = lnav::native_format::find_level_detector(level_regexes);
+        if (this->elf_native_level != nullptr) {
+            log_info("%s: using native level detector",
+                     this->elf_name.get());
+        }
+    }
+
     for (auto& vd : this->elf_value_def_order) {
         std::vector<std::string>::iterator act_iter;
 
@@ -2600,7 +2725,7 @@ external_log_format::register_vtabs(
         if (elf_search_table.second.std_level != LEVEL_UNKNOWN) {
             lst->lst_log_level = elf_search_table.second.std_level;
         }
-        auto errmsg = vtab_manager->register_vtab(lst);
+        auto errmsg = vtab_manager->register_vtab(lst, true);
         if (!errmsg.empty()) {
 #if 0
             errors.push_back("error:" + this->elf_name.to_string() + ":"
@@ -2681,7 +2806,7 @@ public:
             return true;
         }
 
-        content_line_t cl(lss.at(lc.lc_curr_line));
+        content_line_t cl(lc.content_line(lss));
         auto* lf = lss.find_file_ptr(cl);
         auto lf_iter = lf->begin() + cl;
         uint8_t mod_id = lf_iter->get_module_id();
@@ -2882,7 +3007,9 @@ external_log_format::convert_level(string_fragment sf,
             }
         }
 
-        if (this->elf_level_patterns.empty()) {
+        if (this->elf_native_level != nullptr) {
+            retval = this->elf_native_level(sf);
+        } else if (this->elf_level_patterns.empty()) {
             retval = string2level(sf.data(), sf.length());
         } else {
             for (const auto& elf_level_pattern : this->elf_level_patterns) {
@@ -3013,8 +3140,7 @@ log_format::find_root_format(const char* name)
     return nullptr;
 }
 
-log_format::pattern_for_lines::pattern_for_lines(uint32_t pfl_line,
-                                                 uint32_t pfl_pat_index)
+pattern_for_lines::pattern_for_lines(uint32_t pfl_line, uint32_t pfl_pat_index)
     : pfl_line(pfl_line), pfl_pat_index(pfl_pat_index)
 {
 }
@@ -355,6 +355,12 @@ public:
         SCAN_MATCH,
         SCAN_NO_MATCH,
         SCAN_INCOMPLETE,
+        /**
+         * The line does not match yet, but it could belong to a file in
+         * this format once more lines are seen, so the formats after this
+         * one should not claim it.
+         */
+        SCAN_NEED_MORE,
     };
 
     /**
@@ -469,12 +475,7 @@ public:
         return {};
     }
 
-    struct pattern_for_lines {
-        pattern_for_lines(uint32_t pfl_line, uint32_t pfl_pat_index);
-
-        uint32_t pfl_line;
-        int pfl_pat_index;
-    };
+    using pattern_for_lines = ::pattern_for_lines;
 
     int last_pattern_index() const
     {
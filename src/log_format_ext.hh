@@ -32,9 +32,11 @@
 #ifndef lnav_log_format_ext_hh
 #define lnav_log_format_ext_hh
 
+#include <bitset>
 #include <unordered_map>
 
 #include "log_format.hh"
+#include "log_format_native.hh"
 #include "log_search_table_fwd.hh"
 #include "yajlpp/yajlpp.hh"
 
@@ -69,6 +71,7 @@ public:
         logline_value_meta vd_meta;
         std::string vd_collate;
         bool vd_foreign_key{false};
+        bool vd_sketch{false};
         intern_string_t vd_unit_field;
         std::map<const intern_string_t, scaling_factor> vd_unit_scaling;
         ssize_t vd_values_index{-1};
@@ -98,6 +101,36 @@ public:
         }
     };
 
+    /**
+     * A necessary condition for a line to match a pattern that can be
+     * checked without running the regex.  Used to quickly reject
+     * continuation lines of multi-line messages.
+     */
+    struct prefilter {
+        /** The bytes that a line must start with. */
+        std::bitset<256> pf_first_bytes{std::bitset<256>{}.set()};
+        /** The minimum length of a line. */
+        size_t pf_min_length{0};
+
+        void merge(const prefilter& other)
+        {
+            this->pf_min_length
+                = std::min(this->pf_min_length, other.pf_min_length);
+            this->pf_first_bytes |= other.pf_first_bytes;
+        }
+
+        bool could_match(string_fragment line) const
+        {
+            if (line.length() < (int) this->pf_min_length) {
+                return false;
+            }
+            if (line.empty()) {
+                return true;
+            }
+            return this->pf_first_bytes[(unsigned char) line.front()];
+        }
+    };
+
     struct pattern {
         intern_string_t p_name;
         std::string p_config_path;
@@ -106,6 +139,7 @@ public:
             p_pcre;
         std::vector<indexed_value_def> p_value_by_index;
         std::vector<int> p_numeric_value_indexes;
+        std::vector<int> p_sketch_value_indexes;
         int p_timestamp_field_index{-1};
         int p_time_field_index{-1};
         int p_level_field_index{-1};
@@ -115,6 +149,15 @@ public:
         int p_timestamp_end{-1};
         bool p_module_format{false};
         std::set<size_t> p_matched_samples;
+        prefilter p_prefilter;
+        /** A hand-written parser that is equivalent to p_pcre, if any. */
+        std::shared_ptr<lnav::native_format::pattern_matcher> p_native;
+
+        /**
+         * Match the line against this pattern, using the native parser if
+         * there is one.
+         */
+        bool match(string_fragment line, lnav::pcre2pp::match_data& md) const;
     };
 
     struct level_pattern {
@@ -346,9 +389,13 @@ public:
     intern_string_t elf_module_id_field;
     intern_string_t elf_opid_field;
     std::map<log_level_t, level_pattern> elf_level_patterns;
+    /** A replacement for elf_level_patterns, if there is one. */
+    lnav::native_format::level_detector elf_native_level{nullptr};
     std::vector<std::pair<int64_t, log_level_t>> elf_level_pairs;
     bool elf_container{false};
     bool elf_has_module_format{false};
+    /** The union of the prefilters for the message patterns. */
+    prefilter elf_prefilter;
     bool elf_builtin_format{false};
 
     using search_table_pcre2pp
@@ -38,6 +38,7 @@
 
 #include "ArenaAlloc/arenaalloc.h"
 #include "base/file_range.hh"
+#include "base/sketch.hh"
 #include "base/string_attr_type.hh"
 #include "byte_array.hh"
 #include "log_level.hh"
@@ -58,14 +59,49 @@ using log_opid_map = robin_hood::unordered_map<string_fragment,
                                                frag_hasher,
                                                std::equal_to<string_fragment>>;
 
+/**
+ * The sketches for fields that have the "sketch" property set, kept per
+ * field name and then per time block.
+ */
+using field_sketch_blocks = std::map<time_t, lnav::sketch::field_summary>;
+using field_sketch_map = std::map<intern_string_t, field_sketch_blocks>;
+
+/** The number of seconds covered by a single block of field sketches. */
+static constexpr time_t FIELD_SKETCH_BLOCK_SECS = 60 * 60;
+
 struct scan_batch_context {
     ArenaAlloc::Alloc<char>& sbc_allocator;
     log_opid_map sbc_opids;
+    field_sketch_map sbc_sketches;
+    /**
+     * Lines before this offset were already added to the sketches and are
+     * only being scanned again because the last line might have been
+     * partial.
+     */
+    file_off_t sbc_sketch_offset{0};
+    /**
+     * The range of the timestamp in the last line that was scanned, so it
+     * can be left out when comparing messages.  The start is -1 when the
+     * format did not report it.
+     */
+    int sbc_timestamp_start{-1};
+    int sbc_timestamp_end{-1};
     std::string sbc_cached_level_strings[4];
     log_level_t sbc_cached_level_values[4];
     size_t sbc_cached_level_count{0};
 };
 
+/**
+ * The index of the pattern that matched a run of lines, starting at the
+ * given line number.
+ */
+struct pattern_for_lines {
+    pattern_for_lines(uint32_t pfl_line, uint32_t pfl_pat_index);
+
+    uint32_t pfl_line;
+    int pfl_pat_index;
+};
+
 /**
  * Metadata for a single line in a log file.
  */
@@ -38,8 +38,11 @@
 
 #include "base/injector.bind.hh"
 #include "base/opt_util.hh"
+#include "base/string_util.hh"
 #include "config.h"
+#include "delimited_log.cfg.hh"
 #include "formats/logfmt/logfmt.parser.hh"
+#include "ghc/filesystem.hpp"
 #include "log_vtab_impl.hh"
 #include "sql_util.hh"
 #include "yajlpp/yajlpp.hh"
@@ -126,6 +129,8 @@ class generic_log_format : public log_format {
                 this->check_for_new_year(dst, log_time, log_tv);
             }
 
+            sbc.sbc_timestamp_start = ts.sf_begin;
+            sbc.sbc_timestamp_end = ts.sf_end;
             dst.emplace_back(li.li_file_range.fr_offset, log_tv, level_val);
             return SCAN_MATCH;
         }
@@ -1768,8 +1773,651 @@ public:
     }
 };
 
+static string_fragment
+strip_eol(string_fragment sf)
+{
+    while (!sf.empty()
+           && (sf.sf_string[sf.sf_end - 1] == '\r'
+               || sf.sf_string[sf.sf_end - 1] == '\n'))
+    {
+        sf.sf_end -= 1;
+    }
+
+    return sf;
+}
+
+/**
+ * Splits a line of delimited values into fields.  A field that starts with
+ * the quote character extends to the matching quote, so it can contain
+ * delimiters, and a doubled quote is an escaped quote.  Each line is split
+ * on its own, so a quoted field cannot span lines.  The scans for
+ * delimiters and quotes are done with memchr() so that long fields are
+ * skipped a word at a time instead of a byte at a time.
+ */
+struct delimited_string {
+    struct field {
+        /** The field contents without any surrounding quotes. */
+        string_fragment f_value;
+        /** True if the value contains doubled quotes that are escapes. */
+        bool f_escaped{false};
+
+        std::string unescaped(char quote) const
+        {
+            std::string retval;
+
+            retval.reserve(this->f_value.length());
+            for (int lpc = 0; lpc < this->f_value.length(); lpc++) {
+                retval.push_back(this->f_value[lpc]);
+                if (this->f_value[lpc] == quote) {
+                    lpc += 1;
+                }
+            }
+
+            return retval;
+        }
+    };
+
+    string_fragment ds_str;
+    char ds_delim;
+    char ds_quote;
+
+    int find(int start, char ch) const
+    {
+        const auto* hit = (const char*) memchr(
+            &this->ds_str.sf_string[start], ch, this->ds_str.sf_end - start);
+
+        return hit == nullptr ? -1 : hit - this->ds_str.sf_string;
+    }
+
+    /**
+     * Split out the field that starts at the given offset.
+     *
+     * @param pos The offset of the start of the field, updated to the start
+     *   of the next field.  The offset is past the end of the string when
+     *   there are no more fields.
+     * @param fd_out The field.
+     * @return False if there are no more fields.
+     */
+    bool next(int& pos, field& fd_out) const
+    {
+        auto end = this->ds_str.sf_end;
+
+        if (pos > end) {
+            return false;
+        }
+
+        auto value_start = pos;
+        auto value_end = end;
+        auto rest = pos;
+
+        fd_out.f_escaped = false;
+        if (this->ds_quote != '\0' && pos < end
+            && this->ds_str.sf_string[pos] == this->ds_quote)
+        {
+            value_start = pos + 1;
+            rest = end;
+            for (auto scan = value_start; scan < end;) {
+                auto quote = this->find(scan, this->ds_quote);
+
+                if (quote == -1) {
+                    break;
+                }
+                if (quote + 1 < end
+                    && this->ds_str.sf_string[quote + 1] == this->ds_quote)
+                {
+                    fd_out.f_escaped = true;
+                    scan = quote + 2;
+                    continue;
+                }
+                value_end = quote;
+                rest = quote + 1;
+                break;
+            }
+        }
+
+        auto delim = rest < end ? this->find(rest, this->ds_delim) : -1;
+        if (value_start == pos) {
+            value_end = delim == -1 ? end : delim;
+        }
+        fd_out.f_value = string_fragment::from_byte_range(
+            this->ds_str.sf_string, value_start, value_end);
+        pos = delim == -1 ? end + 1 : delim + 1;
+
+        return true;
+    }
+
+    size_t count() const
+    {
+        auto pos = this->ds_str.sf_begin;
+        field fd;
+        size_t retval = 0;
+
+        while (this->next(pos, fd)) {
+            retval += 1;
+        }
+
+        return retval;
+    }
+};
+
+/**
+ * Format for delimiter-separated files (CSV, TSV, ...) where the first line
+ * is a header.  Detection is only done after the formats with patterns have
+ * had a chance at the file, see load_formats().
+ */
+class dsv_log_format : public log_format {
+public:
+    /** The fewest columns that a delimited file can have. */
+    static constexpr size_t MIN_COLUMNS = 3;
+    /**
+     * The number of records after the header that have to agree with it
+     * before a file is treated as delimited.
+     */
+    static constexpr size_t MIN_RECORDS = 2;
+
+    struct field_def {
+        logline_value_meta fd_meta;
+
+        field_def(const intern_string_t name, int col, log_format* format)
+            : fd_meta(name, value_kind_t::VALUE_TEXT, col, format)
+        {
+        }
+    };
+
+    dsv_log_format()
+    {
+        this->lf_is_self_describing = true;
+        this->lf_time_ordered = false;
+    }
+
+    const intern_string_t get_name() const override
+    {
+        static const intern_string_t name(intern_string::lookup("delimited"));
+
+        return this->dlf_format_name.empty() ? name : this->dlf_format_name;
+    }
+
+    void clear() override
+    {
+        this->log_format::clear();
+        this->dlf_format_name.clear();
+        this->dlf_field_defs.clear();
+        this->dlf_timestamp_index = -1;
+        this->dlf_level_index = -1;
+    }
+
+    delimited_string split(string_fragment sf) const
+    {
+        return delimited_string{sf, this->dlf_delim, this->dlf_quote};
+    }
+
+    /**
+     * Get the timestamp and level from a record.
+     *
+     * @return True if the timestamp column held a timestamp.
+     */
+    bool parse_record(string_fragment sf,
+                      struct timeval& tv_out,
+                      log_level_t& level_out)
+    {
+        auto ds = this->split(sf);
+        auto pos = ds.ds_str.sf_begin;
+        delimited_string::field fd;
+        struct exttm tm;
+        bool found_ts = false;
+
+        level_out = LEVEL_INFO;
+        for (int index = 0; ds.next(pos, fd); index++) {
+            if (index == this->dlf_timestamp_index) {
+                const auto* last = this->lf_date_time.scan(fd.f_value.data(),
+                                                           fd.f_value.length(),
+                                                           nullptr,
+                                                           &tm,
+                                                           tv_out);
+                if (last != nullptr) {
+                    this->lf_timestamp_flags = tm.et_flags;
+                    found_ts = true;
+                }
+            } else if (index == this->dlf_level_index) {
+                level_out
+                    = string2level(fd.f_value.data(), fd.f_value.length());
+                if (level_out == LEVEL_UNKNOWN) {
+                    level_out = LEVEL_INFO;
+                }
+            }
+        }
+
+        return found_ts;
+    }
+
+    scan_result_t scan_int(std::vector<logline>& dst,
+                           const line_info& li,
+                           shared_buffer_ref& sbr)
+    {
+        struct timeval tv;
+        log_level_t level;
+
+        if (!this->parse_record(
+                strip_eol(sbr.to_string_fragment()), tv, level))
+        {
+            return SCAN_NO_MATCH;
+        }
+
+        dst.emplace_back(li.li_file_range.fr_offset, tv, level);
+        return SCAN_MATCH;
+    }
+
+    /**
+     * Check if a column holds the timestamp.  The whole value has to be a
+     * timestamp and the header cannot be one, otherwise the first line is
+     * not really a header.  Plain numbers are skipped since they are more
+     * likely to be counts or IDs than epoch times.
+     */
+    static bool is_timestamp_column(const std::string& name,
+                                    string_fragment value)
+    {
+        if (value.empty()
+            || std::all_of(value.begin(), value.end(), [](char ch) {
+                   return isdigit(ch) || ch == '.';
+               }))
+        {
+            return false;
+        }
+
+        date_time_scanner dts;
+        struct timeval tv;
+        struct exttm tm;
+        const auto* last
+            = dts.scan(value.data(), value.length(), nullptr, &tm, tv);
+        if (last == nullptr || last != value.data() + value.length()) {
+            return false;
+        }
+
+        return dts.scan(name.c_str(), name.length(), nullptr, &tm, tv)
+            == nullptr;
+    }
+
+    /**
+     * Check if a value looks like a column name, which rules out most
+     * sentences and data that happen to have a delimiter in them.
+     */
+    static bool is_header_name(const std::string& name)
+    {
+        static const char* const PUNCT = " _-./()[]";
+
+        if (name.empty() || name.length() > 64
+            || !(isalpha(name[0]) || name[0] == '_' || (name[0] & 0x80)))
+        {
+            return false;
+        }
+
+        return std::all_of(name.begin(), name.end(), [](char ch) {
+            return isalnum(ch) || (ch & 0x80)
+                || (ch != '\0' && strchr(PUNCT, ch) != nullptr);
+        });
+    }
+
+    scan_result_t scan(logfile& lf,
+                       std::vector<logline>& dst,
+                       const line_info& li,
+                       shared_buffer_ref& sbr,
+                       scan_batch_context& sbc) override
+    {
+        static const char* const LEVEL_NAMES[] = {
+            "level",
+            "log_level",
+            "loglevel",
+            "severity",
+        };
+
+        if (!this->dlf_format_name.empty()) {
+            return this->scan_int(dst, li, sbr);
+        }
+
+        // The header has to be the first line and it has to be followed by
+        // MIN_RECORDS records with the same number of fields.
+        if (dst.empty() || dst.size() > MIN_RECORDS || sbr.empty()) {
+            return SCAN_NO_MATCH;
+        }
+
+        std::vector<shared_buffer_ref> prev_sbrs;
+        for (auto iter = dst.begin(); iter != dst.end(); ++iter) {
+            auto read_result = lf.read_line(iter);
+            if (read_result.isErr()) {
+                return SCAN_NO_MATCH;
+            }
+            prev_sbrs.emplace_back(read_result.unwrap());
+        }
+
+        std::vector<string_fragment> lines;
+        for (auto& prev_sbr : prev_sbrs) {
+            lines.emplace_back(strip_eol(prev_sbr.to_string_fragment()));
+        }
+        lines.emplace_back(strip_eol(sbr.to_string_fragment()));
+
+        auto header_sf = lines.front();
+        if (header_sf.empty() || header_sf[0] == '#') {
+            return SCAN_NO_MATCH;
+        }
+
+        const auto& cfg = injector::get<const lnav::delimited_log::config&>();
+        char quote = cfg.dc_quote.empty() ? '\0' : cfg.dc_quote[0];
+        size_t best_count = MIN_COLUMNS - 1;
+        char best_delim = '\0';
+
+        for (auto delim : cfg.dc_delimiters) {
+            auto header_count
+                = delimited_string{header_sf, delim, quote}.count();
+
+            if (header_count > best_count
+                && std::all_of(
+                    lines.begin() + 1,
+                    lines.end(),
+                    [delim, quote, header_count](const auto& line_sf) {
+                        return delimited_string{line_sf, delim, quote}.count()
+                            == header_count;
+                    }))
+            {
+                best_count = header_count;
+                best_delim = delim;
+            }
+        }
+        if (best_delim == '\0') {
+            return SCAN_NO_MATCH;
+        }
+
+        this->clear();
+        this->dlf_delim = best_delim;
+        this->dlf_quote = quote;
+
+        std::vector<std::string> names;
+        {
+            auto ds = this->split(header_sf);
+            auto pos = ds.ds_str.sf_begin;
+            delimited_string::field fd;
+
+            while (ds.next(pos, fd)) {
+                auto name = fd.f_escaped ? fd.unescaped(quote)
+                                         : fd.f_value.trim().to_string();
+
+                if (!is_header_name(name)
+                    || std::any_of(names.begin(),
+                                   names.end(),
+                                   [&name](const auto& elem) {
+                                       return strcasecmp(elem.c_str(),
+                                                         name.c_str())
+                                           == 0;
+                                   }))
+                {
+                    this->clear();
+                    return SCAN_NO_MATCH;
+                }
+                names.emplace_back(std::move(name));
+            }
+        }
+
+        {
+            auto ds = this->split(lines[1]);
+            auto pos = ds.ds_str.sf_begin;
+            delimited_string::field fd;
+
+            for (size_t index = 0; ds.next(pos, fd) && index < names.size();
+                 index++)
+            {
+                const auto& name = names[index];
+
+                if (cfg.dc_timestamp_column.empty()) {
+                    if (this->dlf_timestamp_index == -1
+                        && is_timestamp_column(name, fd.f_value.trim()))
+                    {
+                        this->dlf_timestamp_index = index;
+                    }
+                } else if (strcasecmp(name.c_str(),
+                                      cfg.dc_timestamp_column.c_str())
+                           == 0)
+                {
+                    this->dlf_timestamp_index = index;
+                }
+
+                if (cfg.dc_level_column.empty()) {
+                    for (const auto* level_name : LEVEL_NAMES) {
+                        if (strcasecmp(name.c_str(), level_name) == 0) {
+                            this->dlf_level_index = index;
+                        }
+                    }
+                } else if (strcasecmp(name.c_str(),
+                                      cfg.dc_level_column.c_str())
+                           == 0)
+                {
+                    this->dlf_level_index = index;
+                }
+            }
+        }
+        if (this->dlf_timestamp_index == -1) {
+            this->clear();
+            return SCAN_NO_MATCH;
+        }
+
+        std::vector<std::pair<struct timeval, log_level_t>> records;
+        for (size_t lpc = 1; lpc < lines.size(); lpc++) {
+            struct timeval tv;
+            log_level_t level;
+
+            if (!this->parse_record(lines[lpc], tv, level)) {
+                this->clear();
+                return SCAN_NO_MATCH;
+            }
+            records.emplace_back(tv, level);
+        }
+
+        if (dst.size() < MIN_RECORDS) {
+            // Keep the formats after this one from claiming the record
+            // until there are enough of them to be sure.
+            this->clear();
+            return SCAN_NEED_MORE;
+        }
+
+        for (const auto& name : names) {
+            auto ident = sql_safe_ident(name);
+
+            // Avoid collisions with the columns that every log table has
+            // and with SQL keywords.
+            if (startswith(ident, "log_")
+                || std::binary_search(std::begin(sql_keywords),
+                                      std::end(sql_keywords),
+                                      toupper(ident)))
+            {
+                ident.insert(0, "col_");
+            }
+            this->dlf_field_defs.emplace_back(
+                intern_string::lookup(ident), this->dlf_field_defs.size(), this);
+        }
+
+        this->dlf_format_name = get_format_name(
+            lf.get_filename(), best_delim, header_sf.to_string());
+        log_info("%s: detected delimited format %s with %zu columns",
+                 lf.get_filename().c_str(),
+                 this->dlf_format_name.get(),
+                 this->dlf_field_defs.size());
+
+        // The records before this line were indexed as plain text while
+        // waiting for enough of them, so fill in their times and levels.
+        for (size_t lpc = 1; lpc < dst.size(); lpc++) {
+            dst[lpc].set_time(records[lpc - 1].first);
+            dst[lpc].set_level(records[lpc - 1].second);
+        }
+        dst.front().set_ignore(true);
+        dst.emplace_back(li.li_file_range.fr_offset,
+                         records.back().first,
+                         records.back().second);
+
+        return SCAN_MATCH;
+    }
+
+    void annotate(uint64_t line_number,
+                  string_attrs_t& sa,
+                  logline_value_vector& values,
+                  bool annotate_module) const override
+    {
+        auto& sbr = values.lvv_sbr;
+        auto ds = this->split(strip_eol(sbr.to_string_fragment()));
+        auto pos = ds.ds_str.sf_begin;
+        delimited_string::field fd;
+
+        for (size_t index = 0; ds.next(pos, fd); index++) {
+            if (index >= this->dlf_field_defs.size()) {
+                sa.emplace_back(line_range{fd.f_value.sf_begin, -1},
+                                SA_INVALID.value("extra fields detected"));
+                return;
+            }
+
+            const auto& meta = this->dlf_field_defs[index].fd_meta;
+            auto lr = line_range(fd.f_value.sf_begin, fd.f_value.sf_end);
+
+            if ((int) index == this->dlf_timestamp_index) {
+                sa.emplace_back(lr, logline::L_TIMESTAMP.value());
+            }
+            if (fd.f_escaped) {
+                values.lvv_values.emplace_back(meta,
+                                               fd.unescaped(this->dlf_quote));
+                values.lvv_values.back().lv_origin = lr;
+            } else {
+                values.lvv_values.emplace_back(meta, sbr, lr);
+            }
+        }
+    }
+
+    bool hide_field(const intern_string_t field_name, bool val) override
+    {
+        auto fd_iter
+            = std::find_if(this->dlf_field_defs.begin(),
+                           this->dlf_field_defs.end(),
+                           [field_name](const field_def& elem) {
+                               return elem.fd_meta.lvm_name == field_name;
+                           });
+        if (fd_iter == this->dlf_field_defs.end()) {
+            return false;
+        }
+
+        fd_iter->fd_meta.lvm_user_hidden = val;
+        return true;
+    }
+
+    std::shared_ptr<log_format> specialized(int fmt_lock = -1) override
+    {
+        auto retval = std::make_shared<dsv_log_format>(*this);
+
+        retval->lf_specialized = true;
+        return retval;
+    }
+
+    class dsv_log_table : public log_format_vtab_impl {
+    public:
+        explicit dsv_log_table(const dsv_log_format& format)
+            : log_format_vtab_impl(format), dlt_format(format)
+        {
+        }
+
+        void get_columns(std::vector<vtab_column>& cols) const override
+        {
+            for (const auto& fd : this->dlt_format.dlf_field_defs) {
+                auto type_pair = log_vtab_impl::logline_value_to_sqlite_type(
+                    fd.fd_meta.lvm_kind);
+
+                cols.emplace_back(fd.fd_meta.lvm_name.to_string(),
+                                  type_pair.first,
+                                  "",
+                                  false,
+                                  "",
+                                  type_pair.second);
+            }
+        }
+
+        const dsv_log_format& dlt_format;
+    };
+
+    /**
+     * Get the name of the format for a file, which is also the name of its
+     * SQL table.  Files with the same header share a table, a file with a
+     * different header gets a new name even if the file names match.
+     */
+    static intern_string_t get_format_name(const std::string& filename,
+                                           char delim,
+                                           const std::string& header)
+    {
+        static std::map<std::string, intern_string_t> names;
+
+        auto key = std::string(1, delim) + header;
+        auto iter = names.find(key);
+        if (iter != names.end()) {
+            return iter->second;
+        }
+
+        auto prefix = fmt::format(
+            FMT_STRING("{}_{}"),
+            delim == '\t' ? "tsv" : "csv",
+            sql_safe_ident(ghc::filesystem::path(filename).stem().string()));
+        auto retval = intern_string::lookup(prefix + "_log");
+        for (int suffix = 2;
+             std::any_of(names.begin(),
+                         names.end(),
+                         [&retval](const auto& elem) {
+                             return elem.second == retval;
+                         });
+             suffix++)
+        {
+            retval = intern_string::lookup(
+                fmt::format(FMT_STRING("{}_{}_log"), prefix, suffix));
+        }
+        names[key] = retval;
+
+        return retval;
+    }
+
+    static std::map<intern_string_t, std::shared_ptr<dsv_log_table>>&
+    get_tables()
+    {
+        static std::map<intern_string_t, std::shared_ptr<dsv_log_table>>
+            retval;
+
+        return retval;
+    }
+
+    std::shared_ptr<log_vtab_impl> get_vtab_impl() const override
+    {
+        if (this->dlf_format_name.empty()) {
+            return nullptr;
+        }
+
+        std::shared_ptr<dsv_log_table> retval = nullptr;
+
+        auto& tables = get_tables();
+        auto iter = tables.find(this->dlf_format_name);
+        if (iter == tables.end()) {
+            retval = std::make_shared<dsv_log_table>(*this);
+            tables[this->dlf_format_name] = retval;
+        }
+
+        return retval;
+    }
+
+    void get_subline(const logline& ll,
+                     shared_buffer_ref& sbr,
+                     bool full_message) override
+    {
+    }
+
+    intern_string_t dlf_format_name;
+    char dlf_delim{','};
+    char dlf_quote{'"'};
+    int dlf_timestamp_index{-1};
+    int dlf_level_index{-1};
+    std::vector<field_def> dlf_field_defs;
+};
+
 static auto format_binder = injector::bind_multiple<log_format>()
                                 .add<logfmt_format>()
                                 .add<bro_log_format>()
                                 .add<w3c_log_format>()
+                                .add<dsv_log_format>()
                                 .add<generic_log_format>();
@@ -29,6 +29,7 @@
  * @file log_format_loader.cc
  */
 
+#include <algorithm>
 #include <map>
 #include <string>
 
@@ -585,6 +586,14 @@ static const struct json_path_container value_def_handlers = {
                           "treated as a foreign key for row in another table")
         .for_field(&external_log_format::value_def::vd_foreign_key),
 
+    yajlpp::property_handler("sketch")
+        .with_synopsis("<bool>")
+        .with_description(
+            "Indicates whether or not summaries of this field's values "
+            "should be kept while indexing.  The summaries can be queried "
+            "with the sketch_top_values() and sketch_stats() SQL functions")
+        .for_field(&external_log_format::value_def::vd_sketch),
+
     yajlpp::property_handler("hidden")
         .with_synopsis("<bool>")
         .with_description(
@@ -1312,10 +1321,14 @@ load_formats(const std::vector<ghc::filesystem::path>& extra_paths,
         log_info("  %s", graph_ordered_format->get_name().get());
     }
 
+    // The formats that guess at the structure of a file go last, so the
+    // formats with patterns get the first chance at it.
     auto& roots = log_format::get_root_formats();
-    auto iter = std::find_if(roots.begin(), roots.end(), [](const auto& elem) {
-        return elem->get_name() == "generic_log";
-    });
+    auto iter = std::stable_partition(
+        roots.begin(), roots.end(), [](const auto& elem) {
+            return elem->get_name() != "delimited"
+                && elem->get_name() != "generic_log";
+        });
     roots.insert(
         iter, graph_ordered_formats.begin(), graph_ordered_formats.end());
 }
@@ -0,0 +1,809 @@
+/**
+ * Copyright (c) 2022, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <string.h>
+
+#include "log_format_native.hh"
+
+#include "config.h"
+
+namespace lnav {
+namespace native_format {
+
+const char* const SYSLOG_STD_REGEX
+    = R"re(^(?<timestamp>(?:\S{3,8}\s+\d{1,2} \d{2}:\d{2}:\d{2}|\d{4}-\d{2}-\d{2}T\d{2}:\d{2}:\d{2}(?:\.\d{3,6})?(?:Z|(?:\+|-)\d{2}:\d{2})))(?: (?<log_hostname>[a-zA-Z0-9:][^ ]+[a-zA-Z0-9]))?(?: \[CLOUDINIT\])?(?:(?: syslogd [\d\.]+|(?: (?<log_syslog_tag>(?<log_procname>(?:[^\[: ]+|[^ :]+))(?:\[(?<log_pid>\d+)\](?: \([^\)]+\))?)?))):\s*(?<body>.*)$|:?(?:(?: ---)? last message repeated \d+ times?(?: ---)?)))re";
+
+const char* const SYSLOG_RFC5424_REGEX
+    = R"re(^<(?<log_pri>\d+)>(?<syslog_version>\d+) (?<timestamp>\d{4}-\d{2}-\d{2}T\d{2}:\d{2}:\d{2}(?:\.\d{6})?(?:[^ ]+)?) (?<log_hostname>[^ ]+|-) (?<log_syslog_tag>(?<log_procname>[^ ]+|-) (?<log_pid>[^ ]+|-) (?<log_msgid>[^ ]+|-)) (?<log_struct>\[(?:[^\]"]|"(?:\.|[^"])+")*\]|-|)\s+(?<body>.*))re";
+
+const char* const SYSLOG_ERROR_REGEX
+    = R"re((?:(?:(?<![a-zA-Z]))(?:(?i)error(?:s)?)(?:(?![a-zA-Z]))|failed|failure))re";
+
+const char* const SYSLOG_WARNING_REGEX
+    = R"re((?:(?:(?i)warn)|not responding|init: cannot execute))re";
+
+namespace {
+
+/**
+ * A cursor over the line being parsed.  Positions are byte offsets and
+ * reads past the end of the line return END, so that an embedded NUL is
+ * still treated as an ordinary byte.
+ */
+struct cursor {
+    static constexpr int END = -1;
+
+    const char* c_str;
+    int c_len;
+
+    bool in_range(int pos) const { return 0 <= pos && pos < this->c_len; }
+
+    int at(int pos) const
+    {
+        if (!this->in_range(pos)) {
+            return END;
+        }
+
+        return (unsigned char) this->c_str[pos];
+    }
+
+    bool is_digit(int pos) const
+    {
+        if (!this->in_range(pos)) {
+            return false;
+        }
+
+        auto ch = this->c_str[pos];
+
+        return '0' <= ch && ch <= '9';
+    }
+
+    bool is_alnum(int pos) const
+    {
+        if (!this->in_range(pos)) {
+            return false;
+        }
+
+        auto ch = this->c_str[pos];
+
+        return ('0' <= ch && ch <= '9') || ('a' <= ch && ch <= 'z')
+            || ('A' <= ch && ch <= 'Z');
+    }
+
+    bool is_space(int pos) const
+    {
+        if (!this->in_range(pos)) {
+            return false;
+        }
+
+        switch (this->c_str[pos]) {
+            case ' ':
+            case '\t':
+            case '\n':
+            case '\v':
+            case '\f':
+            case '\r':
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    bool is_high(int pos) const
+    {
+        return this->in_range(pos) && (this->c_str[pos] & 0x80);
+    }
+
+    bool digits(int pos, int count) const
+    {
+        for (int lpc = 0; lpc < count; lpc++) {
+            if (!this->is_digit(pos + lpc)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    int skip_digits(int pos) const
+    {
+        while (this->is_digit(pos)) {
+            pos += 1;
+        }
+        return pos;
+    }
+
+    int skip_space(int pos) const
+    {
+        while (this->is_space(pos)) {
+            pos += 1;
+        }
+        return pos;
+    }
+
+    /**
+     * @return The position of the first occurrence of the given byte
+     *   between pos and end, or end if there is none.
+     */
+    int find(int pos, char ch, int end = -1) const
+    {
+        if (end == -1) {
+            end = this->c_len;
+        }
+        if (pos >= end) {
+            return end;
+        }
+
+        const auto* hit = memchr(&this->c_str[pos], ch, end - pos);
+
+        return hit == nullptr ? end : (const char*) hit - this->c_str;
+    }
+
+    bool literal(int pos, const char* str, size_t len) const
+    {
+        return pos + (int) len <= this->c_len
+            && memcmp(&this->c_str[pos], str, len) == 0;
+    }
+
+    template<std::size_t N>
+    bool literal(int pos, const char (&str)[N]) const
+    {
+        return this->literal(pos, str, N - 1);
+    }
+
+    /** Match "dd:dd:dd" */
+    bool time_of_day(int pos) const
+    {
+        return this->digits(pos, 2) && this->at(pos + 2) == ':'
+            && this->digits(pos + 3, 2) && this->at(pos + 5) == ':'
+            && this->digits(pos + 6, 2);
+    }
+
+    /** Match "dddd-dd-ddTdd:dd:dd" */
+    bool iso_date_time(int pos) const
+    {
+        return this->digits(pos, 4) && this->at(pos + 4) == '-'
+            && this->digits(pos + 5, 2) && this->at(pos + 7) == '-'
+            && this->digits(pos + 8, 2) && this->at(pos + 10) == 'T'
+            && this->time_of_day(pos + 11);
+    }
+};
+
+class syslog_std_matcher : public pattern_matcher {
+public:
+    explicit syslog_std_matcher(const pcre2pp::code& co)
+        : ssm_timestamp(co.name_index("timestamp")),
+          ssm_hostname(co.name_index("log_hostname")),
+          ssm_tag(co.name_index("log_syslog_tag")),
+          ssm_procname(co.name_index("log_procname")),
+          ssm_pid(co.name_index("log_pid")),
+          ssm_body(co.name_index("body"))
+    {
+    }
+
+    match_result match(const pcre2pp::code& co,
+                       string_fragment line,
+                       pcre2pp::match_data& md) const override
+    {
+        cursor cur{line.data(), line.length()};
+        int ts_end;
+
+        // (?:\S{3,8}\s+\d{1,2} \d{2}:\d{2}:\d{2}|<iso8601>)
+        auto month_end = 0;
+        auto month_high = false;
+        // A run longer than 32 bytes is more than eight characters, even
+        // if they are all four-byte UTF-8 sequences.
+        while (month_end <= 32 && month_end < cur.c_len
+               && !cur.is_space(month_end))
+        {
+            month_high = month_high || cur.is_high(month_end);
+            month_end += 1;
+        }
+        if (month_high && month_end <= 32) {
+            // \S counts characters and not bytes.
+            return match_result::unknown;
+        }
+        if (3 <= month_end && month_end <= 8 && cur.is_space(month_end)) {
+            auto day_start = cur.skip_space(month_end);
+
+            if (cur.is_high(day_start)) {
+                return match_result::unknown;
+            }
+
+            auto day_end = day_start;
+            if (cur.is_digit(day_end)) {
+                day_end += cur.is_digit(day_end + 1) ? 2 : 1;
+            }
+            if (day_end == day_start || cur.at(day_end) != ' '
+                || !cur.time_of_day(day_end + 1))
+            {
+                return match_result::no_match;
+            }
+            ts_end = day_end + 9;
+        } else if (cur.iso_date_time(0)) {
+            ts_end = 19;
+            if (cur.at(ts_end) == '.') {
+                auto frac_end = cur.skip_digits(ts_end + 1);
+                auto frac_len = frac_end - (ts_end + 1);
+
+                if (frac_len < 3 || frac_len > 6) {
+                    return match_result::no_match;
+                }
+                ts_end = frac_end;
+            }
+            switch (cur.at(ts_end)) {
+                case 'Z':
+                    ts_end += 1;
+                    break;
+                case '+':
+                case '-':
+                    if (!cur.digits(ts_end + 1, 2)
+                        || cur.at(ts_end + 3) != ':'
+                        || !cur.digits(ts_end + 4, 2))
+                    {
+                        return match_result::no_match;
+                    }
+                    ts_end += 6;
+                    break;
+                default:
+                    return match_result::no_match;
+            }
+        } else {
+            return match_result::no_match;
+        }
+
+        // (?: (?<log_hostname>[a-zA-Z0-9:][^ ]+[a-zA-Z0-9]))?
+        if (cur.at(ts_end) == ' '
+            && (cur.is_alnum(ts_end + 1) || cur.at(ts_end + 1) == ':'))
+        {
+            auto host_start = ts_end + 1;
+            auto run_end = cur.find(host_start, ' ');
+
+            for (auto host_end = run_end; host_end >= host_start + 3;
+                 host_end--)
+            {
+                if (!cur.is_alnum(host_end - 1)) {
+                    continue;
+                }
+
+                auto res = this->match_after_host(
+                    co, line, cur, ts_end, host_start, host_end, md);
+                if (res != match_result::no_match) {
+                    return res;
+                }
+            }
+        }
+
+        return this->match_after_host(co, line, cur, ts_end, -1, ts_end, md);
+    }
+
+private:
+    match_result match_after_host(const pcre2pp::code& co,
+                                  string_fragment line,
+                                  const cursor& cur,
+                                  int ts_end,
+                                  int host_start,
+                                  int host_end,
+                                  pcre2pp::match_data& md) const
+    {
+        // (?: \[CLOUDINIT\])?
+        if (cur.literal(host_end, " [CLOUDINIT]")) {
+            auto res = this->match_after_cloudinit(
+                co, line, cur, ts_end, host_start, host_end, host_end + 12, md);
+            if (res != match_result::no_match) {
+                return res;
+            }
+        }
+
+        return this->match_after_cloudinit(
+            co, line, cur, ts_end, host_start, host_end, host_end, md);
+    }
+
+    match_result match_after_cloudinit(const pcre2pp::code& co,
+                                       string_fragment line,
+                                       const cursor& cur,
+                                       int ts_end,
+                                       int host_start,
+                                       int host_end,
+                                       int pos,
+                                       pcre2pp::match_data& md) const
+    {
+        // (?: syslogd [\d\.]+ ...):\s*(?<body>.*)$
+        if (cur.literal(pos, " syslogd ")) {
+            auto ver_end = pos + 9;
+
+            while (cur.is_digit(ver_end) || cur.at(ver_end) == '.') {
+                ver_end += 1;
+            }
+            if (ver_end > pos + 9 && cur.at(ver_end) == ':') {
+                return this->finish_message(co,
+                                            line,
+                                            cur,
+                                            ts_end,
+                                            host_start,
+                                            host_end,
+                                            -1,
+                                            -1,
+                                            -1,
+                                            -1,
+                                            ver_end,
+                                            md);
+            }
+        }
+
+        // (?: (?<log_syslog_tag>...)):\s*(?<body>.*)$
+        if (cur.at(pos) == ' ') {
+            auto tag_start = pos + 1;
+            // The procname is (?:[^\[: ]+|[^ :]+), so the first alternative
+            // is tried with every length before the second one.
+            auto alt2_end
+                = cur.find(tag_start, ':', cur.find(tag_start, ' '));
+            auto alt1_end = cur.find(tag_start, '[', alt2_end);
+            int candidates[2][2] = {
+                {alt1_end, tag_start},
+                {alt2_end, tag_start},
+            };
+
+            for (const auto& cand : candidates) {
+                for (auto proc_end = cand[0]; proc_end > cand[1]; proc_end--) {
+                    auto res = this->match_after_procname(co,
+                                                          line,
+                                                          cur,
+                                                          ts_end,
+                                                          host_start,
+                                                          host_end,
+                                                          tag_start,
+                                                          proc_end,
+                                                          md);
+                    if (res != match_result::no_match) {
+                        return res;
+                    }
+                }
+            }
+        }
+
+        // :?(?:(?: ---)? last message repeated \d+ times?(?: ---)?)
+        for (auto colon = 1; colon >= 0; colon--) {
+            auto rep_start = pos;
+
+            if (colon) {
+                if (cur.at(rep_start) != ':') {
+                    continue;
+                }
+                rep_start += 1;
+            }
+            for (auto dashes = 1; dashes >= 0; dashes--) {
+                auto rep_pos = rep_start;
+
+                if (dashes) {
+                    if (!cur.literal(rep_pos, " ---")) {
+                        continue;
+                    }
+                    rep_pos += 4;
+                }
+                if (!cur.literal(rep_pos, " last message repeated ")) {
+                    continue;
+                }
+                rep_pos += 23;
+
+                auto count_end = cur.skip_digits(rep_pos);
+                if (count_end == rep_pos || !cur.literal(count_end, " time")) {
+                    continue;
+                }
+                rep_pos = count_end + 5;
+                if (cur.at(rep_pos) == 's') {
+                    rep_pos += 1;
+                }
+                if (cur.literal(rep_pos, " ---")) {
+                    rep_pos += 4;
+                }
+
+                md.reset_for(co, line);
+                md.set_capture(0, line.sub_range(0, rep_pos));
+                md.set_capture(this->ssm_timestamp, line.sub_range(0, ts_end));
+                if (host_start != -1) {
+                    md.set_capture(this->ssm_hostname,
+                                   line.sub_range(host_start, host_end));
+                }
+                return match_result::match;
+            }
+        }
+
+        return match_result::no_match;
+    }
+
+    match_result match_after_procname(const pcre2pp::code& co,
+                                      string_fragment line,
+                                      const cursor& cur,
+                                      int ts_end,
+                                      int host_start,
+                                      int host_end,
+                                      int tag_start,
+                                      int proc_end,
+                                      pcre2pp::match_data& md) const
+    {
+        // (?:\[(?<log_pid>\d+)\](?: \([^\)]+\))?)?
+        if (cur.at(proc_end) == '[') {
+            auto pid_end = cur.skip_digits(proc_end + 1);
+
+            if (pid_end > proc_end + 1 && cur.at(pid_end) == ']') {
+                auto tag_end = pid_end + 1;
+
+                if (cur.at(tag_end) == ' ' && cur.at(tag_end + 1) == '(') {
+                    auto paren_end = cur.find(tag_end + 2, ')');
+
+                    if (paren_end > tag_end + 2 && cur.at(paren_end) == ')'
+                        && cur.at(paren_end + 1) == ':')
+                    {
+                        return this->finish_message(co,
+                                                    line,
+                                                    cur,
+                                                    ts_end,
+                                                    host_start,
+                                                    host_end,
+                                                    tag_start,
+                                                    proc_end,
+                                                    proc_end + 1,
+                                                    pid_end,
+                                                    paren_end + 1,
+                                                    md);
+                    }
+                }
+                if (cur.at(tag_end) == ':') {
+                    return this->finish_message(co,
+                                                line,
+                                                cur,
+                                                ts_end,
+                                                host_start,
+                                                host_end,
+                                                tag_start,
+                                                proc_end,
+                                                proc_end + 1,
+                                                pid_end,
+                                                tag_end,
+                                                md);
+                }
+            }
+        }
+        if (cur.at(proc_end) == ':') {
+            return this->finish_message(co,
+                                        line,
+                                        cur,
+                                        ts_end,
+                                        host_start,
+                                        host_end,
+                                        tag_start,
+                                        proc_end,
+                                        -1,
+                                        -1,
+                                        proc_end,
+                                        md);
+        }
+
+        return match_result::no_match;
+    }
+
+    /**
+     * Match the ":\s*(?<body>.*)$" that ends a message and fill in the
+     * captures.
+     */
+    match_result finish_message(const pcre2pp::code& co,
+                                string_fragment line,
+                                const cursor& cur,
+                                int ts_end,
+                                int host_start,
+                                int host_end,
+                                int tag_start,
+                                int proc_end,
+                                int pid_start,
+                                int pid_end,
+                                int colon,
+                                pcre2pp::match_data& md) const
+    {
+        auto body_start = cur.skip_space(colon + 1);
+
+        if (cur.is_high(body_start)) {
+            return match_result::unknown;
+        }
+
+        md.reset_for(co, line);
+        md.set_capture(0, line);
+        md.set_capture(this->ssm_timestamp, line.sub_range(0, ts_end));
+        if (host_start != -1) {
+            md.set_capture(this->ssm_hostname,
+                           line.sub_range(host_start, host_end));
+        }
+        if (tag_start != -1) {
+            md.set_capture(this->ssm_tag, line.sub_range(tag_start, colon));
+            md.set_capture(this->ssm_procname,
+                           line.sub_range(tag_start, proc_end));
+        }
+        if (pid_start != -1) {
+            md.set_capture(this->ssm_pid, line.sub_range(pid_start, pid_end));
+        }
+        md.set_capture(this->ssm_body,
+                       line.sub_range(body_start, line.length()));
+
+        return match_result::match;
+    }
+
+    int ssm_timestamp;
+    int ssm_hostname;
+    int ssm_tag;
+    int ssm_procname;
+    int ssm_pid;
+    int ssm_body;
+};
+
+class syslog_rfc5424_matcher : public pattern_matcher {
+public:
+    explicit syslog_rfc5424_matcher(const pcre2pp::code& co)
+        : srm_pri(co.name_index("log_pri")),
+          srm_version(co.name_index("syslog_version")),
+          srm_timestamp(co.name_index("timestamp")),
+          srm_hostname(co.name_index("log_hostname")),
+          srm_tag(co.name_index("log_syslog_tag")),
+          srm_procname(co.name_index("log_procname")),
+          srm_pid(co.name_index("log_pid")),
+          srm_msgid(co.name_index("log_msgid")),
+          srm_struct(co.name_index("log_struct")),
+          srm_body(co.name_index("body"))
+    {
+    }
+
+    match_result match(const pcre2pp::code& co,
+                       string_fragment line,
+                       pcre2pp::match_data& md) const override
+    {
+        cursor cur{line.data(), line.length()};
+
+        if (cur.at(0) != '<') {
+            return match_result::no_match;
+        }
+
+        auto pri_end = cur.skip_digits(1);
+        if (pri_end == 1 || cur.at(pri_end) != '>') {
+            return match_result::no_match;
+        }
+
+        auto ver_start = pri_end + 1;
+        auto ver_end = cur.skip_digits(ver_start);
+        if (ver_end == ver_start || cur.at(ver_end) != ' ') {
+            return match_result::no_match;
+        }
+
+        auto ts_start = ver_end + 1;
+        if (!cur.iso_date_time(ts_start)) {
+            return match_result::no_match;
+        }
+
+        // The fractional seconds and zone are all non-space characters, so
+        // the timestamp runs to the next space.
+        auto ts_end = cur.find(ts_start + 19, ' ');
+
+        // The hostname, procname, pid, and msgid are all "[^ ]+|-".
+        int field_starts[4];
+        int field_ends[4];
+        auto pos = ts_end;
+        for (int lpc = 0; lpc < 4; lpc++) {
+            if (cur.at(pos) != ' ') {
+                return match_result::no_match;
+            }
+            field_starts[lpc] = pos + 1;
+            field_ends[lpc] = cur.find(pos + 1, ' ');
+            if (field_ends[lpc] == field_starts[lpc]) {
+                return match_result::no_match;
+            }
+            pos = field_ends[lpc];
+        }
+        if (cur.at(pos) != ' ') {
+            return match_result::no_match;
+        }
+
+        // (?<log_struct>\[(?:[^\]"]|"(?:\.|[^"])+")*\]|-|)
+        auto struct_start = pos + 1;
+        auto struct_end = struct_start;
+        switch (cur.at(struct_start)) {
+            case '[': {
+                auto item = struct_start + 1;
+
+                while (cur.in_range(item) && cur.at(item) != ']') {
+                    if (cur.at(item) == '"') {
+                        auto quote_end = cur.find(item + 1, '"');
+
+                        if (quote_end == item + 1 || quote_end >= cur.c_len) {
+                            return match_result::no_match;
+                        }
+                        item = quote_end + 1;
+                    } else {
+                        item += 1;
+                    }
+                }
+                if (cur.at(item) != ']') {
+                    return match_result::no_match;
+                }
+                struct_end = item + 1;
+                break;
+            }
+            case '-':
+                struct_end = struct_start + 1;
+                break;
+        }
+
+        // \s+(?<body>.*)
+        if (!cur.is_space(struct_end)) {
+            return match_result::no_match;
+        }
+        auto body_start = cur.skip_space(struct_end);
+        if (cur.is_high(body_start)) {
+            return match_result::unknown;
+        }
+
+        md.reset_for(co, line);
+        md.set_capture(0, line);
+        md.set_capture(this->srm_pri, line.sub_range(1, pri_end));
+        md.set_capture(this->srm_version, line.sub_range(ver_start, ver_end));
+        md.set_capture(this->srm_timestamp, line.sub_range(ts_start, ts_end));
+        md.set_capture(this->srm_hostname,
+                       line.sub_range(field_starts[0], field_ends[0]));
+        md.set_capture(this->srm_tag,
+                       line.sub_range(field_starts[1], field_ends[3]));
+        md.set_capture(this->srm_procname,
+                       line.sub_range(field_starts[1], field_ends[1]));
+        md.set_capture(this->srm_pid,
+                       line.sub_range(field_starts[2], field_ends[2]));
+        md.set_capture(this->srm_msgid,
+                       line.sub_range(field_starts[3], field_ends[3]));
+        md.set_capture(this->srm_struct,
+                       line.sub_range(struct_start, struct_end));
+        md.set_capture(this->srm_body,
+                       line.sub_range(body_start, line.length()));
+
+        return match_result::match;
+    }
+
+private:
+    int srm_pri;
+    int srm_version;
+    int srm_timestamp;
+    int srm_hostname;
+    int srm_tag;
+    int srm_procname;
+    int srm_pid;
+    int srm_msgid;
+    int srm_struct;
+    int srm_body;
+};
+
+bool
+is_ascii_alpha(char ch)
+{
+    return ('a' <= ch && ch <= 'z') || ('A' <= ch && ch <= 'Z');
+}
+
+/**
+ * Equivalent to checking SYSLOG_WARNING_REGEX and then SYSLOG_ERROR_REGEX,
+ * but in a single pass over the string.
+ */
+log_level_t
+detect_syslog_level(string_fragment sf)
+{
+    auto error_found = false;
+    const auto* str = sf.data();
+    auto len = sf.length();
+
+    for (int lpc = 0; lpc < len; lpc++) {
+        switch (str[lpc]) {
+            case 'w':
+            case 'W':
+                if (lpc + 4 <= len && strncasecmp(&str[lpc], "warn", 4) == 0)
+                {
+                    return LEVEL_WARNING;
+                }
+                break;
+            case 'n':
+                if (lpc + 14 <= len
+                    && memcmp(&str[lpc], "not responding", 14) == 0)
+                {
+                    return LEVEL_WARNING;
+                }
+                break;
+            case 'i':
+                if (lpc + 20 <= len
+                    && memcmp(&str[lpc], "init: cannot execute", 20) == 0)
+                {
+                    return LEVEL_WARNING;
+                }
+                break;
+            case 'e':
+            case 'E':
+                if (!error_found && lpc + 5 <= len
+                    && strncasecmp(&str[lpc], "error", 5) == 0
+                    && (lpc == 0 || !is_ascii_alpha(str[lpc - 1])))
+                {
+                    auto end = lpc + 5;
+
+                    if (end < len && (str[end] == 's' || str[end] == 'S')) {
+                        end += 1;
+                    }
+                    if (end >= len || !is_ascii_alpha(str[end])) {
+                        error_found = true;
+                    }
+                }
+                break;
+            case 'f':
+                if (!error_found && lpc + 6 <= len
+                    && (memcmp(&str[lpc], "failed", 6) == 0
+                        || (lpc + 7 <= len
+                            && memcmp(&str[lpc], "failure", 7) == 0)))
+                {
+                    error_found = true;
+                }
+                break;
+        }
+    }
+
+    return error_found ? LEVEL_ERROR : LEVEL_INFO;
+}
+
+}  // namespace
+
+std::shared_ptr<pattern_matcher>
+find_pattern_matcher(const pcre2pp::code& co)
+{
+    const auto& pattern = co.get_pattern();
+
+    if (pattern == SYSLOG_STD_REGEX) {
+        return std::make_shared<syslog_std_matcher>(co);
+    }
+    if (pattern == SYSLOG_RFC5424_REGEX) {
+        return std::make_shared<syslog_rfc5424_matcher>(co);
+    }
+
+    return nullptr;
+}
+
+level_detector
+find_level_detector(const std::map<log_level_t, std::string>& patterns)
+{
+    if (patterns.size() == 2) {
+        auto error_iter = patterns.find(LEVEL_ERROR);
+        auto warning_iter = patterns.find(LEVEL_WARNING);
+
+        if (error_iter != patterns.end() && warning_iter != patterns.end()
+            && error_iter->second == SYSLOG_ERROR_REGEX
+            && warning_iter->second == SYSLOG_WARNING_REGEX)
+        {
+            return detect_syslog_level;
+        }
+    }
+
+    return nullptr;
+}
+
+}  // namespace native_format
+}  // namespace lnav
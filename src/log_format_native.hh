@@ -0,0 +1,106 @@
+/**
+ * Copyright (c) 2022, Timothy Stack
+ *
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * * Redistributions of source code must retain the above copyright notice, this
+ * list of conditions and the following disclaimer.
+ * * Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ * * Neither the name of Timothy Stack nor the names of its contributors
+ * may be used to endorse or promote products derived from this software
+ * without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE REGENTS AND CONTRIBUTORS ''AS IS'' AND ANY
+ * EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE REGENTS OR CONTRIBUTORS BE LIABLE FOR ANY
+ * DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+ * (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ * LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+ * ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+ * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * @file log_format_native.hh
+ *
+ * Hand-written parsers that are equivalent to the regexes used by some of
+ * the built-in log formats.  A parser is only used when the format's regex
+ * is exactly the one the parser was written for, so user-modified formats
+ * keep using the regex.
+ */
+
+#ifndef lnav_log_format_native_hh
+#define lnav_log_format_native_hh
+
+#include <map>
+#include <memory>
+#include <string>
+
+#include "base/intern_string.hh"
+#include "base/log_level_enum.hh"
+#include "pcrepp/pcre2pp.hh"
+
+namespace lnav {
+namespace native_format {
+
+enum class match_result {
+    match,
+    no_match,
+    /** The parser cannot decide, so the regex needs to be run instead. */
+    unknown,
+};
+
+class pattern_matcher {
+public:
+    virtual ~pattern_matcher() = default;
+
+    /**
+     * Parse the line and fill in the same captures that the regex would.
+     *
+     * @param co The code this parser is equivalent to.
+     * @param line The line to parse.
+     * @param md The match data to fill in.
+     */
+    virtual match_result match(const pcre2pp::code& co,
+                               string_fragment line,
+                               pcre2pp::match_data& md) const
+        = 0;
+};
+
+/**
+ * A replacement for the level patterns of a format.
+ *
+ * @return The level of the first pattern that would match, in the order of
+ *   the level values, or LEVEL_INFO if none match.
+ */
+using level_detector = log_level_t (*)(string_fragment sf);
+
+/**
+ * @return The parser that is equivalent to the given code or nullptr if
+ *   there is none.
+ */
+std::shared_ptr<pattern_matcher> find_pattern_matcher(
+    const pcre2pp::code& co);
+
+/**
+ * @param patterns The regexes for each level.
+ * @return A function that is equivalent to matching the given patterns or
+ *   nullptr if there is none.
+ */
+level_detector find_level_detector(
+    const std::map<log_level_t, std::string>& patterns);
+
+extern const char* const SYSLOG_STD_REGEX;
+extern const char* const SYSLOG_RFC5424_REGEX;
+extern const char* const SYSLOG_ERROR_REGEX;
+extern const char* const SYSLOG_WARNING_REGEX;
+
+}  // namespace native_format
+}  // namespace lnav
+
+#endif
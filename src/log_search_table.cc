@@ -229,7 +229,7 @@ void
 log_search_table::filter(log_cursor& lc, logfile_sub_source& lss)
 {
     if (this->lst_format != nullptr) {
-        lc.lc_format_name = this->lst_format->get_name();
+        lc.lc_format_names = {this->lst_format->get_name()};
     }
     if (!this->lst_log_path_glob.empty()) {
         lc.lc_log_path.emplace_back(SQLITE_INDEX_CONSTRAINT_GLOB,
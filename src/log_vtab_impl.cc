@@ -44,14 +44,34 @@
 
 // #define DEBUG_INDEXING 1
 
+/**
+ * Flag OR'd into the idxNum passed to vt_filter() when the planner consumed
+ * a descending ORDER BY on log_line/log_time.  The remaining bits are the
+ * number of constraints.
+ */
+static constexpr int VT_IDX_DESCENDING = 1 << 16;
+static constexpr int VT_IDX_COUNT_MASK = VT_IDX_DESCENDING - 1;
+
+/**
+ * Operator stored in the constraint copy passed to vt_filter() for an IN
+ * constraint whose whole list of values is handed over in a single call.
+ */
+static constexpr unsigned char VT_OP_IN = 0xff;
+
 using namespace lnav::roles::literals;
 
 static auto intern_lifetime = intern_string::get_table_lifetime();
 
-static struct log_cursor log_cursor_latest;
+static thread_local struct log_cursor log_cursor_latest;
 
 thread_local _log_vtab_data log_vtab_data;
 
+static std::unique_lock<std::recursive_mutex>
+lock_source()
+{
+    return log_vtab_data.lock_source();
+}
+
 static const char* LOG_COLUMNS = R"(  (
   log_line        INTEGER,            -- The line number for the log message
   log_part        TEXT     COLLATE naturalnocase,  -- The partition the message is in
@@ -222,7 +242,7 @@ log_vtab_impl::extract(logfile* lf,
 bool
 log_vtab_impl::is_valid(log_cursor& lc, logfile_sub_source& lss)
 {
-    content_line_t cl(lss.at(lc.lc_curr_line));
+    content_line_t cl(lc.content_line(lss));
     auto* lf = lss.find_file_ptr(cl);
     auto lf_iter = lf->begin() + cl;
 
@@ -230,12 +250,19 @@ log_vtab_impl::is_valid(log_cursor& lc, logfile_sub_source& lss)
         return false;
     }
 
-    if (!lc.lc_format_name.empty()
-        && lc.lc_format_name != lf->get_format_name())
+    if (!lc.lc_format_names.empty()
+        && std::find(lc.lc_format_names.begin(),
+                     lc.lc_format_names.end(),
+                     lf->get_format_name())
+            == lc.lc_format_names.end())
     {
         return false;
     }
 
+    if (lc.lc_files && lc.lc_files->count(lf) == 0) {
+        return false;
+    }
+
     if (!lc.lc_pattern_name.empty()
         && lc.lc_pattern_name != lf->get_format_ptr()->get_pattern_name(cl))
     {
@@ -248,6 +275,10 @@ log_vtab_impl::is_valid(log_cursor& lc, logfile_sub_source& lss)
         return false;
     }
 
+    if (lc.lc_levels && !lc.lc_levels->test(lf_iter->get_msg_level())) {
+        return false;
+    }
+
     if (!lc.lc_log_path.empty()) {
         if (lf == lc.lc_last_log_path_match) {
         } else if (lf == lc.lc_last_log_path_mismatch) {
@@ -278,7 +309,7 @@ log_vtab_impl::is_valid(log_cursor& lc, logfile_sub_source& lss)
         }
     }
 
-    if (lc.lc_opid && lf_iter->get_opid() != lc.lc_opid.value().value) {
+    if (lc.lc_opids && !lc.lc_opids->test(lf_iter->get_opid())) {
         return false;
     }
 
@@ -296,18 +327,22 @@ struct log_vtab {
 struct vtab_cursor {
     void cache_msg(logfile* lf, logfile::const_iterator ll)
     {
-        if (this->log_msg_line == this->log_cursor.lc_curr_line) {
+        if (this->log_msg_line == this->log_cursor.lc_curr_line
+            && this->log_msg_repeat == this->log_cursor.lc_repeat)
+        {
             return;
         }
         auto& sbr = this->line_values.lvv_sbr;
         lf->read_full_message(ll, sbr);
         sbr.erase_ansi();
         this->log_msg_line = this->log_cursor.lc_curr_line;
+        this->log_msg_repeat = this->log_cursor.lc_repeat;
     }
 
     sqlite3_vtab_cursor base;
     struct log_cursor log_cursor;
     vis_line_t log_msg_line{-1_vl};
+    uint32_t log_msg_repeat{0};
     logline_value_vector line_values;
 };
 
@@ -328,8 +363,14 @@ vt_create(sqlite3* db,
 
     p_vt->db = db;
 
+    /*
+     * Tables created with "CREATE VIRTUAL TABLE" pass the table name as an
+     * argument, eponymous tables are named after the module.
+     */
+    const auto* table_name = argc > 3 ? argv[3] : argv[0];
+
     /* Declare the vtable's structure */
-    p_vt->vi = vm->lookup_impl(intern_string::lookup(argv[3]));
+    p_vt->vi = vm->lookup_impl(intern_string::lookup(table_name));
     if (p_vt->vi == nullptr) {
         return SQLITE_ERROR;
     }
@@ -341,7 +382,7 @@ vt_create(sqlite3* db,
     auto loose_p_vt = p_vt.release();
     *pp_vt = &loose_p_vt->base;
 
-    log_debug("creating log format table: %s = %p", argv[3], p_vt.get());
+    log_debug("creating log format table: %s = %p", table_name, p_vt.get());
 
     return rc;
 }
@@ -385,6 +426,7 @@ static int
 vt_open(sqlite3_vtab* p_svt, sqlite3_vtab_cursor** pp_cursor)
 {
     log_vtab* p_vt = (log_vtab*) p_svt;
+    auto source_lock = lock_source();
 
     p_vt->base.zErrMsg = nullptr;
 
@@ -393,7 +435,7 @@ vt_open(sqlite3_vtab* p_svt, sqlite3_vtab_cursor** pp_cursor)
     *pp_cursor = (sqlite3_vtab_cursor*) p_cur;
 
     p_cur->base.pVtab = p_svt;
-    p_cur->log_cursor.lc_opid = nonstd::nullopt;
+    p_cur->log_cursor.lc_opids = nonstd::nullopt;
     p_cur->log_cursor.lc_curr_line = 0_vl;
     p_cur->log_cursor.lc_end_line = vis_line_t(p_vt->lss->text_line_count());
     p_cur->log_cursor.lc_sub_index = 0;
@@ -447,7 +489,7 @@ populate_indexed_columns(vtab_cursor* vc, log_vtab* vt)
         }
 
         if (lf == nullptr) {
-            content_line_t cl(vt->lss->at(vc->log_cursor.lc_curr_line));
+            content_line_t cl(vc->log_cursor.content_line(*vt->lss));
             uint64_t line_number;
             auto ld = vt->lss->find_data(cl, line_number);
             lf = (*ld)->get_file_ptr();
@@ -492,15 +534,36 @@ vt_next(sqlite3_vtab_cursor* cur)
     auto* vc = (vtab_cursor*) cur;
     auto* vt = (log_vtab*) cur->pVtab;
     auto done = false;
+    auto source_lock = lock_source();
 
     vc->line_values.clear();
+    if (vc->log_cursor.lc_rows_remaining) {
+        if (vc->log_cursor.lc_rows_remaining.value() <= 0) {
+            vc->log_cursor.lc_indexed_lines.clear();
+            vc->log_cursor.set_eof();
+            return SQLITE_OK;
+        }
+        vc->log_cursor.lc_rows_remaining.value() -= 1;
+    }
+
+    if (vc->log_cursor.next_repeat()) {
+        return SQLITE_OK;
+    }
+
+    const auto step
+        = vc->log_cursor.lc_direction == log_cursor::direction_t::backward
+        ? -1_vl
+        : 1_vl;
+
     if (!vc->log_cursor.lc_indexed_lines.empty()) {
         vc->log_cursor.lc_curr_line = vc->log_cursor.lc_indexed_lines.back();
         vc->log_cursor.lc_indexed_lines.pop_back();
     } else {
-        vc->log_cursor.lc_curr_line += 1_vl;
+        vc->log_cursor.lc_curr_line += step;
     }
     vc->log_cursor.lc_sub_index = 0;
+    vc->log_cursor.lc_repeat = 0;
+    vc->log_cursor.lc_repeat_count = 1;
     do {
         log_cursor_latest = vc->log_cursor;
         if (((log_cursor_latest.lc_curr_line % 1024) == 0)
@@ -510,17 +573,20 @@ vt_next(sqlite3_vtab_cursor* cur)
             break;
         }
 
+        vc->log_cursor.seek_listed_line();
         while (vc->log_cursor.lc_curr_line != -1_vl && !vc->log_cursor.is_eof()
                && !vt->vi->is_valid(vc->log_cursor, *vt->lss))
         {
-            vc->log_cursor.lc_curr_line += 1_vl;
+            vc->log_cursor.lc_curr_line += step;
             vc->log_cursor.lc_sub_index = 0;
+            vc->log_cursor.seek_listed_line();
         }
         if (vc->log_cursor.is_eof()) {
             done = true;
         } else {
             done = vt->vi->next(vc->log_cursor, *vt->lss);
             if (done) {
+                vc->log_cursor.start_row(*vt->lss);
                 populate_indexed_columns(vc, vt);
             } else {
                 if (!vc->log_cursor.lc_indexed_lines.empty()) {
@@ -528,7 +594,7 @@ vt_next(sqlite3_vtab_cursor* cur)
                         = vc->log_cursor.lc_indexed_lines.back();
                     vc->log_cursor.lc_indexed_lines.pop_back();
                 } else {
-                    vc->log_cursor.lc_curr_line += 1_vl;
+                    vc->log_cursor.lc_curr_line += step;
                 }
                 vc->log_cursor.lc_sub_index = 0;
             }
@@ -544,6 +610,7 @@ vt_next_no_rowid(sqlite3_vtab_cursor* cur)
     auto* vc = (vtab_cursor*) cur;
     auto* vt = (log_vtab*) cur->pVtab;
     auto done = false;
+    auto source_lock = lock_source();
 
     vc->line_values.lvv_values.clear();
     do {
@@ -599,6 +666,7 @@ vt_column(sqlite3_vtab_cursor* cur, sqlite3_context* ctx, int col)
 {
     auto* vc = (vtab_cursor*) cur;
     auto* vt = (log_vtab*) cur->pVtab;
+    auto source_lock = lock_source();
 
 #ifdef DEBUG_INDEXING
     log_debug("vt_column(%s, %d:%d)",
@@ -607,7 +675,7 @@ vt_column(sqlite3_vtab_cursor* cur, sqlite3_context* ctx, int col)
               col);
 #endif
 
-    content_line_t cl(vt->lss->at(vc->log_cursor.lc_curr_line));
+    content_line_t cl(vc->log_cursor.content_line(*vt->lss));
     uint64_t line_number;
     auto ld = vt->lss->find_data(cl, line_number);
     auto* lf = (*ld)->get_file_ptr();
@@ -701,11 +769,20 @@ vt_column(sqlite3_vtab_cursor* cur, sqlite3_context* ctx, int col)
         }
 
         case VT_COL_IDLE_MSECS:
-            if (vc->log_cursor.lc_curr_line == 0) {
+            if (vc->log_cursor.lc_curr_line == 0
+                && vc->log_cursor.lc_repeat == 0)
+            {
                 sqlite3_result_int64(ctx, 0);
             } else {
+                auto prev_vl = vis_line_t(vc->log_cursor.lc_curr_line - 1);
+                // The previous message is the last one in the previous row
+                // when that row has collapsed repeats.
                 content_line_t prev_cl(
-                    vt->lss->at(vis_line_t(vc->log_cursor.lc_curr_line - 1)));
+                    vc->log_cursor.lc_repeat > 0
+                        ? cl - content_line_t(1)
+                        : vt->lss->at(prev_vl)
+                            + content_line_t(vt->lss->repeat_count(prev_vl)
+                                             - 1));
                 auto prev_lf = vt->lss->find(prev_cl);
                 auto prev_ll = prev_lf->begin() + prev_cl;
                 uint64_t prev_time, curr_line_time;
@@ -728,13 +805,20 @@ vt_column(sqlite3_vtab_cursor* cur, sqlite3_context* ctx, int col)
         }
 
         case VT_COL_MARK: {
-            sqlite3_result_int(ctx, ll->is_marked());
+            // Marks are set on the row, which is the first message in a
+            // row of collapsed repeats.
+            const auto* row_ll = vc->log_cursor.lc_repeat > 0
+                ? vt->lss->find_line(vt->lss->at(vc->log_cursor.lc_curr_line))
+                : &(*ll);
+
+            sqlite3_result_int(ctx, row_ll->is_marked());
             break;
         }
 
         case VT_COL_LOG_COMMENT: {
-            auto line_meta_opt
-                = vt->lss->find_bookmark_metadata(vc->log_cursor.lc_curr_line);
+            auto line_meta_opt = vc->log_cursor.lc_repeat > 0
+                ? nonstd::nullopt
+                : vt->lss->find_bookmark_metadata(vc->log_cursor.lc_curr_line);
             if (!line_meta_opt || line_meta_opt.value()->bm_comment.empty()) {
                 sqlite3_result_null(ctx);
             } else {
@@ -748,8 +832,9 @@ vt_column(sqlite3_vtab_cursor* cur, sqlite3_context* ctx, int col)
         }
 
         case VT_COL_LOG_TAGS: {
-            auto line_meta_opt
-                = vt->lss->find_bookmark_metadata(vc->log_cursor.lc_curr_line);
+            auto line_meta_opt = vc->log_cursor.lc_repeat > 0
+                ? nonstd::nullopt
+                : vt->lss->find_bookmark_metadata(vc->log_cursor.lc_curr_line);
             if (!line_meta_opt || line_meta_opt.value()->bm_tags.empty()) {
                 sqlite3_result_null(ctx);
             } else {
@@ -1142,12 +1227,78 @@ vt_rowid(sqlite3_vtab_cursor* cur, sqlite_int64* p_rowid)
 {
     vtab_cursor* p_cur = (vtab_cursor*) cur;
 
-    *p_rowid = (((uint64_t) p_cur->log_cursor.lc_curr_line) << 8)
+    *p_rowid = (((uint64_t) p_cur->log_cursor.lc_repeat) << 40)
+        | (((uint64_t) p_cur->log_cursor.lc_curr_line) << 8)
         | (p_cur->log_cursor.lc_sub_index & 0xff);
 
     return SQLITE_OK;
 }
 
+content_line_t
+log_cursor::content_line(logfile_sub_source& lss) const
+{
+    return lss.at(this->lc_curr_line) + content_line_t(this->lc_repeat);
+}
+
+bool
+log_cursor::next_repeat()
+{
+    if (this->lc_direction == direction_t::backward) {
+        if (this->lc_repeat > 0) {
+            this->lc_repeat -= 1;
+            return true;
+        }
+    } else if (this->lc_repeat + 1 < this->lc_repeat_count) {
+        this->lc_repeat += 1;
+        return true;
+    }
+
+    return false;
+}
+
+void
+log_cursor::start_row(logfile_sub_source& lss)
+{
+    if (this->is_eof()) {
+        this->lc_repeat = 0;
+        this->lc_repeat_count = 1;
+        return;
+    }
+
+    this->lc_repeat_count = lss.repeat_count(this->lc_curr_line);
+    this->lc_repeat = this->lc_direction == direction_t::backward
+        ? this->lc_repeat_count - 1
+        : 0;
+}
+
+void
+log_cursor::seek_listed_line()
+{
+    if (this->lc_listed_lines.empty()) {
+        return;
+    }
+
+    if (this->lc_direction == direction_t::backward) {
+        auto iter = std::upper_bound(this->lc_listed_lines.begin(),
+                                     this->lc_listed_lines.end(),
+                                     this->lc_curr_line);
+        if (iter == this->lc_listed_lines.begin()) {
+            this->lc_curr_line = this->lc_begin_line - 1_vl;
+        } else {
+            this->lc_curr_line = *std::prev(iter);
+        }
+    } else {
+        auto iter = std::lower_bound(this->lc_listed_lines.begin(),
+                                     this->lc_listed_lines.end(),
+                                     this->lc_curr_line);
+        if (iter == this->lc_listed_lines.end()) {
+            this->lc_curr_line = std::max(this->lc_curr_line, this->lc_end_line);
+        } else {
+            this->lc_curr_line = *iter;
+        }
+    }
+}
+
 void
 log_cursor::update(unsigned char op, vis_line_t vl, constraint_t cons)
 {
@@ -1267,6 +1418,56 @@ struct time_range {
     }
 };
 
+/**
+ * Copies of the values of an IN constraint that SQLite is passing all at
+ * once.  SQLite reuses the same value object while iterating over the list,
+ * so each one has to be duplicated.
+ */
+class in_list_values {
+public:
+    explicit in_list_values(sqlite3_value* list)
+    {
+#if SQLITE_VERSION_NUMBER >= 3038000
+        sqlite3_value* val = nullptr;
+
+        for (auto rc = sqlite3_vtab_in_first(list, &val);
+             rc == SQLITE_OK && val != nullptr;
+             rc = sqlite3_vtab_in_next(list, &val))
+        {
+            auto* dup = sqlite3_value_dup(val);
+            if (dup != nullptr) {
+                this->ilv_values.push_back(dup);
+            }
+        }
+#endif
+    }
+
+    in_list_values(const in_list_values&) = delete;
+    in_list_values& operator=(const in_list_values&) = delete;
+
+    ~in_list_values()
+    {
+        for (auto* val : this->ilv_values) {
+            sqlite3_value_free(val);
+        }
+    }
+
+    bool empty() const { return this->ilv_values.empty(); }
+
+    std::vector<sqlite3_value*>::const_iterator begin() const
+    {
+        return this->ilv_values.begin();
+    }
+
+    std::vector<sqlite3_value*>::const_iterator end() const
+    {
+        return this->ilv_values.end();
+    }
+
+private:
+    std::vector<sqlite3_value*> ilv_values;
+};
+
 static int
 vt_filter(sqlite3_vtab_cursor* p_vtc,
           int idxNum,
@@ -1277,7 +1478,10 @@ vt_filter(sqlite3_vtab_cursor* p_vtc,
     auto* p_cur = (vtab_cursor*) p_vtc;
     auto* vt = (log_vtab*) p_vtc->pVtab;
     sqlite3_index_info::sqlite3_index_constraint* index = nullptr;
+    const auto descending = (idxNum & VT_IDX_DESCENDING) != 0;
+    auto source_lock = lock_source();
 
+    idxNum &= VT_IDX_COUNT_MASK;
     if (idxStr) {
         auto desc_len = strlen(idxStr);
         auto index_len = idxNum * sizeof(*index);
@@ -1296,10 +1500,13 @@ vt_filter(sqlite3_vtab_cursor* p_vtc,
 #ifdef DEBUG_INDEXING
     log_debug("vt_filter(%s, %d)", vt->vi->get_name().get(), idxNum);
 #endif
-    p_cur->log_cursor.lc_format_name.clear();
+    p_cur->log_cursor.lc_format_names.clear();
     p_cur->log_cursor.lc_pattern_name.clear();
-    p_cur->log_cursor.lc_opid = nonstd::nullopt;
+    p_cur->log_cursor.lc_opids = nonstd::nullopt;
     p_cur->log_cursor.lc_level_constraint = nonstd::nullopt;
+    p_cur->log_cursor.lc_levels = nonstd::nullopt;
+    p_cur->log_cursor.lc_files = nonstd::nullopt;
+    p_cur->log_cursor.lc_listed_lines.clear();
     p_cur->log_cursor.lc_log_path.clear();
     p_cur->log_cursor.lc_indexed_columns.clear();
     p_cur->log_cursor.lc_last_log_path_match = nullptr;
@@ -1309,17 +1516,280 @@ vt_filter(sqlite3_vtab_cursor* p_vtc,
     p_cur->log_cursor.lc_last_unique_path_mismatch = nullptr;
     p_cur->log_cursor.lc_curr_line = 0_vl;
     p_cur->log_cursor.lc_end_line = vis_line_t(vt->lss->text_line_count());
+    p_cur->log_cursor.lc_begin_line = 0_vl;
+    p_cur->log_cursor.lc_direction = log_cursor::direction_t::forward;
+    p_cur->log_cursor.lc_rows_remaining = nonstd::nullopt;
+    p_cur->log_cursor.lc_repeat = 0;
+    p_cur->log_cursor.lc_repeat_count = 1;
 
     nonstd::optional<time_range> log_time_range;
-    nonstd::optional<log_cursor::opid_hash> opid_val;
+    nonstd::optional<int64_t> row_limit;
+    int64_t row_offset = 0;
+    // The LIMIT can only be enforced by the cursor if every row it returns
+    // is going to be accepted by SQLite, so track whether all of the
+    // constraints were applied exactly.
+    auto exact = true;
+    // Set when an IN constraint had no values, so no rows can match.
+    auto empty_in = false;
+    nonstd::optional<std::bitset<1U << 6U>> opids;
     std::vector<log_cursor::string_constraint> log_path_constraints;
     std::vector<log_cursor::string_constraint> log_unique_path_constraints;
 
     for (int lpc = 0; lpc < idxNum; lpc++) {
         auto col = index[lpc].iColumn;
         auto op = index[lpc].op;
+
+        if (op == VT_OP_IN) {
+            // SQLite still checks each row against the list, these are
+            // only used to narrow down the rows that are visited.
+            exact = false;
+            in_list_values in_values(argv[lpc]);
+            if (in_values.empty()) {
+                empty_in = true;
+                continue;
+            }
+
+            switch (col) {
+                case VT_COL_LINE_NUMBER: {
+                    auto& lines = p_cur->log_cursor.lc_listed_lines;
+                    auto line_count = vis_line_t(vt->lss->text_line_count());
+                    auto all_ints = true;
+
+                    for (auto* val : in_values) {
+                        if (sqlite3_value_type(val) != SQLITE_INTEGER) {
+                            all_ints = false;
+                            break;
+                        }
+                        auto vl = vis_line_t(sqlite3_value_int64(val));
+                        if (vl >= 0_vl && vl < line_count) {
+                            lines.push_back(vl);
+                        }
+                    }
+                    if (!all_ints) {
+                        lines.clear();
+                        break;
+                    }
+                    if (lines.empty()) {
+                        empty_in = true;
+                        break;
+                    }
+                    std::sort(lines.begin(), lines.end());
+                    lines.erase(std::unique(lines.begin(), lines.end()),
+                                lines.end());
+                    p_cur->log_cursor.update(SQLITE_INDEX_CONSTRAINT_GE,
+                                             lines.front(),
+                                             log_cursor::constraint_t::unique);
+                    p_cur->log_cursor.update(SQLITE_INDEX_CONSTRAINT_LE,
+                                             lines.back(),
+                                             log_cursor::constraint_t::unique);
+                    break;
+                }
+                case VT_COL_LEVEL: {
+                    std::bitset<LEVEL__MAX> levels;
+
+                    for (auto* val : in_values) {
+                        if (sqlite3_value_type(val) != SQLITE3_TEXT) {
+                            continue;
+                        }
+                        const auto* level_str
+                            = (const char*) sqlite3_value_text(val);
+                        levels.set(string2level(level_str,
+                                                sqlite3_value_bytes(val)));
+                    }
+                    p_cur->log_cursor.lc_levels = levels;
+                    break;
+                }
+                case VT_COL_LOG_TIME: {
+                    time_range in_range;
+                    auto all_times = true;
+
+                    for (auto* val : in_values) {
+                        const auto* datestr
+                            = (const char*) sqlite3_value_text(val);
+                        auto datelen = sqlite3_value_bytes(val);
+                        date_time_scanner dts;
+                        struct timeval tv;
+                        struct exttm mytm;
+
+                        if (sqlite3_value_type(val) != SQLITE3_TEXT
+                            || dts.scan(datestr, datelen, nullptr, &mytm, tv)
+                                != (datestr + datelen))
+                        {
+                            all_times = false;
+                            break;
+                        }
+                        in_range.add(tv);
+                    }
+                    if (!all_times) {
+                        log_warning(
+                            "  log_time IN list has a value that is not a "
+                            "valid datetime, index will not be applied");
+                        break;
+                    }
+                    if (!log_time_range) {
+                        log_time_range = time_range{};
+                    }
+                    log_time_range->add(in_range.tr_begin.value());
+                    log_time_range->add(in_range.tr_end.value());
+                    break;
+                }
+                default: {
+                    if (col <= (VT_COL_MAX + vt->vi->vi_column_count - 1)) {
+                        break;
+                    }
+
+                    auto footer_column = static_cast<log_footer_columns>(
+                        col - (VT_COL_MAX + vt->vi->vi_column_count - 1) - 1);
+                    switch (footer_column) {
+                        case log_footer_columns::format: {
+                            for (auto* val : in_values) {
+                                if (sqlite3_value_type(val) != SQLITE3_TEXT) {
+                                    continue;
+                                }
+                                p_cur->log_cursor.lc_format_names.emplace_back(
+                                    intern_string::lookup(
+                                        (const char*) sqlite3_value_text(val)));
+                            }
+                            if (p_cur->log_cursor.lc_format_names.empty()) {
+                                empty_in = true;
+                            }
+                            break;
+                        }
+                        case log_footer_columns::opid: {
+                            std::vector<string_fragment> opid_list;
+
+                            if (!opids) {
+                                opids = std::bitset<1U << 6U>{};
+                            }
+                            for (auto* val : in_values) {
+                                if (sqlite3_value_type(val) != SQLITE3_TEXT) {
+                                    continue;
+                                }
+                                auto opid = string_fragment::from_bytes(
+                                    sqlite3_value_text(val),
+                                    sqlite3_value_bytes(val));
+                                opids->set(log_cursor::opid_hash{
+                                    static_cast<unsigned int>(hash_str(
+                                        opid.data(), opid.length()))}
+                                               .value);
+                                opid_list.emplace_back(opid);
+                            }
+
+                            if (!log_time_range) {
+                                log_time_range = time_range{};
+                            }
+                            for (const auto& file_data : *vt->lss) {
+                                if (file_data->get_file_ptr() == nullptr) {
+                                    continue;
+                                }
+                                safe::ReadAccess<logfile::safe_opid_map>
+                                    r_opid_map(
+                                        file_data->get_file_ptr()->get_opids());
+                                for (const auto& opid : opid_list) {
+                                    const auto& iter = r_opid_map->find(opid);
+                                    if (iter == r_opid_map->end()) {
+                                        continue;
+                                    }
+                                    log_time_range->add(
+                                        iter->second.otr_begin);
+                                    log_time_range->add(iter->second.otr_end);
+                                }
+                            }
+                            break;
+                        }
+                        case log_footer_columns::path:
+                        case log_footer_columns::unique_path: {
+                            std::set<const logfile*> files;
+
+                            if (!log_time_range) {
+                                log_time_range = time_range{};
+                            }
+                            for (const auto& file_data : *vt->lss) {
+                                auto* lf = file_data->get_file_ptr();
+                                if (lf == nullptr) {
+                                    continue;
+                                }
+                                const auto& path
+                                    = footer_column == log_footer_columns::path
+                                    ? lf->get_filename()
+                                    : lf->get_unique_path();
+                                for (auto* val : in_values) {
+                                    if (sqlite3_value_type(val) != SQLITE3_TEXT)
+                                    {
+                                        continue;
+                                    }
+                                    if (path
+                                        == (const char*) sqlite3_value_text(
+                                            val))
+                                    {
+                                        files.insert(lf);
+                                        log_time_range->add(
+                                            lf->front().get_timeval());
+                                        log_time_range->add(
+                                            lf->back().get_timeval());
+                                        break;
+                                    }
+                                }
+                            }
+
+                            auto& lc_files = p_cur->log_cursor.lc_files;
+                            if (lc_files) {
+                                std::set<const logfile*> both;
+
+                                std::set_intersection(
+                                    lc_files->begin(),
+                                    lc_files->end(),
+                                    files.begin(),
+                                    files.end(),
+                                    std::inserter(both, both.begin()));
+                                files = std::move(both);
+                            }
+                            lc_files = std::move(files);
+                            break;
+                        }
+                        default:
+                            break;
+                    }
+                    break;
+                }
+            }
+            continue;
+        }
+
+#ifdef SQLITE_INDEX_CONSTRAINT_LIMIT
+        if (op == SQLITE_INDEX_CONSTRAINT_LIMIT) {
+            if (sqlite3_value_type(argv[lpc]) == SQLITE_INTEGER) {
+                row_limit = sqlite3_value_int64(argv[lpc]);
+            }
+            continue;
+        }
+        if (op == SQLITE_INDEX_CONSTRAINT_OFFSET) {
+            // SQLite skips the offset rows itself, so they still need to
+            // be returned by the cursor.
+            if (sqlite3_value_type(argv[lpc]) == SQLITE_INTEGER) {
+                row_offset = sqlite3_value_int64(argv[lpc]);
+            }
+            continue;
+        }
+#endif
+
         switch (col) {
             case VT_COL_LINE_NUMBER: {
+                if (sqlite3_value_type(argv[lpc]) != SQLITE_INTEGER) {
+                    exact = false;
+                }
+                switch (op) {
+                    case SQLITE_INDEX_CONSTRAINT_EQ:
+                    case SQLITE_INDEX_CONSTRAINT_GT:
+                    case SQLITE_INDEX_CONSTRAINT_GE:
+                    case SQLITE_INDEX_CONSTRAINT_LT:
+                    case SQLITE_INDEX_CONSTRAINT_LE:
+                        break;
+                    default:
+                        exact = false;
+                        break;
+                }
+
                 auto vl = vis_line_t(sqlite3_value_int64(argv[lpc]));
 
                 p_cur->log_cursor.update(
@@ -1328,6 +1798,7 @@ vt_filter(sqlite3_vtab_cursor* p_vtc,
             }
             case VT_COL_LEVEL: {
                 if (sqlite3_value_type(argv[lpc]) != SQLITE3_TEXT) {
+                    exact = false;
                     continue;
                 }
 
@@ -1343,6 +1814,9 @@ vt_filter(sqlite3_vtab_cursor* p_vtc,
             }
 
             case VT_COL_LOG_TIME:
+                // The time range is mapped to a range of lines, which is not
+                // precise enough to skip SQLite's check.
+                exact = false;
                 if (sqlite3_value_type(argv[lpc]) == SQLITE3_TEXT) {
                     const auto* datestr
                         = (const char*) sqlite3_value_text(argv[lpc]);
@@ -1398,6 +1872,7 @@ vt_filter(sqlite3_vtab_cursor* p_vtc,
 
                     switch (footer_column) {
                         case log_footer_columns::time_msecs: {
+                            exact = false;
                             auto msecs = sqlite3_value_int64(argv[lpc]);
                             struct timeval tv;
 
@@ -1433,8 +1908,10 @@ vt_filter(sqlite3_vtab_cursor* p_vtc,
                                 = (const char*) sqlite3_value_text(argv[lpc]);
 
                             if (format_name_str != nullptr) {
-                                p_cur->log_cursor.lc_format_name
-                                    = intern_string::lookup(format_name_str);
+                                p_cur->log_cursor.lc_format_names.emplace_back(
+                                    intern_string::lookup(format_name_str));
+                            } else {
+                                exact = false;
                             }
                             break;
                         }
@@ -1445,10 +1922,13 @@ vt_filter(sqlite3_vtab_cursor* p_vtc,
                             if (pattern_name_str != nullptr) {
                                 p_cur->log_cursor.lc_pattern_name
                                     = intern_string::lookup(pattern_name_str);
+                            } else {
+                                exact = false;
                             }
                             break;
                         }
                         case log_footer_columns::opid: {
+                            exact = false;
                             if (sqlite3_value_type(argv[lpc]) != SQLITE3_TEXT) {
                                 continue;
                             }
@@ -1472,12 +1952,17 @@ vt_filter(sqlite3_vtab_cursor* p_vtc,
                                 log_time_range->add(iter->second.otr_end);
                             }
 
-                            opid_val = log_cursor::opid_hash{
+                            if (!opids) {
+                                opids = std::bitset<1U << 6U>{};
+                            }
+                            opids->set(log_cursor::opid_hash{
                                 static_cast<unsigned int>(
-                                    hash_str(opid.data(), opid.length()))};
+                                    hash_str(opid.data(), opid.length()))}
+                                           .value);
                             break;
                         }
                         case log_footer_columns::path: {
+                            exact = false;
                             if (sqlite3_value_type(argv[lpc]) != SQLITE3_TEXT) {
                                 continue;
                             }
@@ -1511,6 +1996,7 @@ vt_filter(sqlite3_vtab_cursor* p_vtc,
                             break;
                         }
                         case log_footer_columns::unique_path: {
+                            exact = false;
                             if (sqlite3_value_type(argv[lpc]) != SQLITE3_TEXT) {
                                 continue;
                             }
@@ -1549,12 +2035,14 @@ vt_filter(sqlite3_vtab_cursor* p_vtc,
                         case log_footer_columns::body:
                         case log_footer_columns::raw_text:
                         case log_footer_columns::line_hash:
+                            exact = false;
                             break;
                     }
                 } else {
                     const auto* value
                         = (const char*) sqlite3_value_text(argv[lpc]);
 
+                    exact = false;
                     if (value != nullptr) {
                         auto value_len
                             = (size_t) sqlite3_value_bytes(argv[lpc]);
@@ -1578,6 +2066,11 @@ vt_filter(sqlite3_vtab_cursor* p_vtc,
         }
     }
 
+    if (descending) {
+        // The column indexes are only built up while stepping forward.
+        p_cur->log_cursor.lc_indexed_columns.clear();
+    }
+
     if (!p_cur->log_cursor.lc_indexed_columns.empty()) {
         nonstd::optional<vis_line_t> max_indexed_line;
 
@@ -1635,7 +2128,7 @@ vt_filter(sqlite3_vtab_cursor* p_vtc,
             log_debug("max indexed out of sync, clearing other indexes");
             p_cur->log_cursor.lc_level_constraint = nonstd::nullopt;
             p_cur->log_cursor.lc_curr_line = 0_vl;
-            opid_val = nonstd::nullopt;
+            opids = nonstd::nullopt;
             log_time_range = nonstd::nullopt;
             p_cur->log_cursor.lc_indexed_lines.clear();
             log_path_constraints.clear();
@@ -1655,12 +2148,32 @@ vt_filter(sqlite3_vtab_cursor* p_vtc,
         p_cur->log_cursor.lc_curr_line = p_cur->log_cursor.lc_end_line;
     } else {
         if (log_time_range->tr_begin) {
-            auto vl_opt
-                = vt->lss->row_for_time(log_time_range->tr_begin.value());
-            if (!vl_opt) {
+            const auto& tr_begin = log_time_range->tr_begin.value();
+            auto line_count = vis_line_t(vt->lss->text_line_count());
+            auto vl = vt->lss->row_for_time(tr_begin).value_or(line_count);
+
+            // Rows of collapsed repeats are found by the time of their
+            // first message, so the later messages in the previous row
+            // can still be in the range.
+            if (vl > 0_vl) {
+                auto prev_vl = vl - 1_vl;
+                auto count = vt->lss->repeat_count(prev_vl);
+
+                if (count > 1) {
+                    auto last_cl
+                        = vt->lss->at(prev_vl) + content_line_t(count - 1);
+
+                    if (!(vt->lss->find_line(last_cl)->get_timeval()
+                          < tr_begin))
+                    {
+                        vl = prev_vl;
+                    }
+                }
+            }
+            if (vl >= line_count) {
                 p_cur->log_cursor.lc_curr_line = p_cur->log_cursor.lc_end_line;
             } else {
-                p_cur->log_cursor.lc_curr_line = vl_opt.value();
+                p_cur->log_cursor.lc_curr_line = vl;
             }
         }
         if (log_time_range->tr_end) {
@@ -1684,14 +2197,32 @@ vt_filter(sqlite3_vtab_cursor* p_vtc,
         }
     }
 
-    p_cur->log_cursor.lc_opid = opid_val;
+    if (empty_in) {
+        p_cur->log_cursor.lc_curr_line = p_cur->log_cursor.lc_end_line;
+        p_cur->log_cursor.lc_indexed_lines.clear();
+    }
+
+    p_cur->log_cursor.lc_opids = opids;
     p_cur->log_cursor.lc_log_path = std::move(log_path_constraints);
     p_cur->log_cursor.lc_unique_path = std::move(log_unique_path_constraints);
 
-    if (p_cur->log_cursor.lc_indexed_lines.empty()) {
+    if (descending) {
+        auto line_count = vis_line_t(vt->lss->text_line_count());
+
+        if (p_cur->log_cursor.lc_end_line > line_count) {
+            p_cur->log_cursor.lc_end_line = line_count;
+        }
+        p_cur->log_cursor.lc_direction = log_cursor::direction_t::backward;
+        p_cur->log_cursor.lc_begin_line = p_cur->log_cursor.lc_curr_line;
+        // vt_next() steps before reading, so start just past the end.
+        p_cur->log_cursor.lc_curr_line = p_cur->log_cursor.lc_end_line;
+    } else if (p_cur->log_cursor.lc_indexed_lines.empty()) {
         p_cur->log_cursor.lc_indexed_lines.push_back(
             p_cur->log_cursor.lc_curr_line);
     }
+    if (exact && row_limit && row_limit.value() >= 0) {
+        p_cur->log_cursor.lc_rows_remaining = row_limit.value() + row_offset;
+    }
     vt->vi->filter(p_cur->log_cursor, *vt->lss);
 
     auto rc = vt->base.pModule->xNext(p_vtc);
@@ -1705,13 +2236,51 @@ vt_filter(sqlite3_vtab_cursor* p_vtc,
     return rc;
 }
 
+/**
+ * Ask SQLite to pass the values of an IN constraint all at once instead of
+ * calling vt_filter() once for each value.
+ *
+ * @return VT_OP_IN if the constraint is an IN that will be handled in one
+ * pass, otherwise the constraint's operator.
+ */
+static unsigned char
+constraint_op(sqlite3_index_info* p_info, int lpc)
+{
+#if SQLITE_VERSION_NUMBER >= 3038000
+    if (sqlite3_vtab_in(p_info, lpc, -1)) {
+        sqlite3_vtab_in(p_info, lpc, 1);
+        return VT_OP_IN;
+    }
+#endif
+
+    return p_info->aConstraint[lpc].op;
+}
+
+static std::string
+index_term(const char* column, unsigned char op)
+{
+    if (op == VT_OP_IN) {
+        return fmt::format(FMT_STRING("{} IN (?)"), column);
+    }
+
+    return fmt::format(
+        FMT_STRING("{} {} ?"), column, sql_constraint_op_name(op));
+}
+
 static int
 vt_best_index(sqlite3_vtab* tab, sqlite3_index_info* p_info)
 {
     std::vector<sqlite3_index_info::sqlite3_index_constraint> indexes;
     std::vector<std::string> index_desc;
+    std::vector<int> limit_constraints;
     int argvInUse = 0;
     auto* vt = (log_vtab*) tab;
+    auto source_lock = lock_source();
+    // Tables with primary keys can return several rows per line and are
+    // always scanned forward.
+    auto steppable = vt->base.pModule->xNext == vt_next;
+    auto order_consumed = false;
+    auto order_desc = false;
 
     log_info("vt_best_index(%s, nConstraint=%d)",
              vt->vi->get_name().get(),
@@ -1719,14 +2288,37 @@ vt_best_index(sqlite3_vtab* tab, sqlite3_index_info* p_info)
     if (!vt->vi->vi_supports_indexes) {
         return SQLITE_OK;
     }
+
+    if (steppable && p_info->nOrderBy > 0) {
+        order_consumed = true;
+        order_desc = p_info->aOrderBy[0].desc;
+        for (int lpc = 0; lpc < p_info->nOrderBy; lpc++) {
+            const auto& ob = p_info->aOrderBy[lpc];
+
+            // The index is sorted by time, so log_line and log_time always
+            // have the same order.
+            if ((ob.iColumn != VT_COL_LINE_NUMBER
+                 && ob.iColumn != VT_COL_LOG_TIME)
+                || ob.desc != order_desc)
+            {
+                order_consumed = false;
+                break;
+            }
+        }
+    }
+
     for (int lpc = 0; lpc < p_info->nConstraint; lpc++) {
         const auto& constraint = p_info->aConstraint[lpc];
-        if (!constraint.usable || constraint.op == SQLITE_INDEX_CONSTRAINT_MATCH
 #ifdef SQLITE_INDEX_CONSTRAINT_OFFSET
-            || constraint.op == SQLITE_INDEX_CONSTRAINT_OFFSET
-            || constraint.op == SQLITE_INDEX_CONSTRAINT_LIMIT
+        if (constraint.usable
+            && (constraint.op == SQLITE_INDEX_CONSTRAINT_OFFSET
+                || constraint.op == SQLITE_INDEX_CONSTRAINT_LIMIT))
+        {
+            limit_constraints.push_back(lpc);
+            continue;
+        }
 #endif
-        )
+        if (!constraint.usable || constraint.op == SQLITE_INDEX_CONSTRAINT_MATCH)
         {
             log_debug("  column %d: is not usable (usable=%d, op: %s)",
                       lpc,
@@ -1743,16 +2335,22 @@ vt_best_index(sqlite3_vtab* tab, sqlite3_index_info* p_info)
                 argvInUse += 1;
                 indexes.push_back(constraint);
                 p_info->aConstraintUsage[lpc].argvIndex = argvInUse;
-                index_desc.emplace_back(fmt::format(
-                    FMT_STRING("log_line {} ?"), sql_constraint_op_name(op)));
+                // The cursor can only skip between the listed lines when it
+                // is stepping through the log view.
+                if (steppable) {
+                    indexes.back().op = constraint_op(p_info, lpc);
+                }
+                index_desc.emplace_back(
+                    index_term("log_line", indexes.back().op));
                 break;
             }
             case VT_COL_LOG_TIME: {
                 argvInUse += 1;
                 indexes.push_back(p_info->aConstraint[lpc]);
                 p_info->aConstraintUsage[lpc].argvIndex = argvInUse;
-                index_desc.emplace_back(fmt::format(
-                    FMT_STRING("log_time {} ?"), sql_constraint_op_name(op)));
+                indexes.back().op = constraint_op(p_info, lpc);
+                index_desc.emplace_back(
+                    index_term("log_time", indexes.back().op));
                 break;
             }
             case VT_COL_LEVEL: {
@@ -1760,9 +2358,9 @@ vt_best_index(sqlite3_vtab* tab, sqlite3_index_info* p_info)
                     argvInUse += 1;
                     indexes.push_back(constraint);
                     p_info->aConstraintUsage[lpc].argvIndex = argvInUse;
+                    indexes.back().op = constraint_op(p_info, lpc);
                     index_desc.emplace_back(
-                        fmt::format(FMT_STRING("log_level {} ?"),
-                                    sql_constraint_op_name(op)));
+                        index_term("log_level", indexes.back().op));
                 }
                 break;
             }
@@ -1787,7 +2385,9 @@ vt_best_index(sqlite3_vtab* tab, sqlite3_index_info* p_info)
                                 indexes.push_back(constraint);
                                 p_info->aConstraintUsage[lpc].argvIndex
                                     = argvInUse;
-                                index_desc.emplace_back("log_format = ?");
+                                indexes.back().op = constraint_op(p_info, lpc);
+                                index_desc.emplace_back(index_term(
+                                    "log_format", indexes.back().op));
                             }
                             break;
                         }
@@ -1807,7 +2407,9 @@ vt_best_index(sqlite3_vtab* tab, sqlite3_index_info* p_info)
                                 indexes.push_back(constraint);
                                 p_info->aConstraintUsage[lpc].argvIndex
                                     = argvInUse;
-                                index_desc.emplace_back("log_opid = ?");
+                                indexes.back().op = constraint_op(p_info, lpc);
+                                index_desc.emplace_back(index_term(
+                                    "log_opid", indexes.back().op));
                             }
                             break;
                         }
@@ -1815,18 +2417,18 @@ vt_best_index(sqlite3_vtab* tab, sqlite3_index_info* p_info)
                             argvInUse += 1;
                             indexes.push_back(constraint);
                             p_info->aConstraintUsage[lpc].argvIndex = argvInUse;
-                            index_desc.emplace_back(
-                                fmt::format(FMT_STRING("log_path {} ?"),
-                                            sql_constraint_op_name(op)));
+                            indexes.back().op = constraint_op(p_info, lpc);
+                            index_desc.emplace_back(index_term(
+                                "log_path", indexes.back().op));
                             break;
                         }
                         case log_footer_columns::unique_path: {
                             argvInUse += 1;
                             indexes.push_back(constraint);
                             p_info->aConstraintUsage[lpc].argvIndex = argvInUse;
-                            index_desc.emplace_back(
-                                fmt::format(FMT_STRING("log_unique_path {} ?"),
-                                            sql_constraint_op_name(op)));
+                            indexes.back().op = constraint_op(p_info, lpc);
+                            index_desc.emplace_back(index_term(
+                                "log_unique_path", indexes.back().op));
                             break;
                         }
                         case log_footer_columns::text:
@@ -1849,10 +2451,36 @@ vt_best_index(sqlite3_vtab* tab, sqlite3_index_info* p_info)
         }
     }
 
-    if (argvInUse) {
-        auto full_desc = fmt::format(FMT_STRING("SEARCH {} USING {}"),
-                                     vt->vi->get_name().get(),
-                                     fmt::join(index_desc, " AND "));
+    // SQLite only passes LIMIT/OFFSET when all of the other constraints
+    // are handled here, so the cursor can stop early as long as it is
+    // returning rows in the requested order.
+    auto search_argc = argvInUse;
+    if (steppable && (p_info->nOrderBy == 0 || order_consumed)) {
+        for (auto lpc : limit_constraints) {
+            const auto& constraint = p_info->aConstraint[lpc];
+
+            argvInUse += 1;
+            indexes.push_back(constraint);
+            p_info->aConstraintUsage[lpc].argvIndex = argvInUse;
+            index_desc.emplace_back(
+                constraint.op == SQLITE_INDEX_CONSTRAINT_LIMIT ? "LIMIT ?"
+                                                               : "OFFSET ?");
+        }
+    }
+
+    if (order_consumed) {
+        p_info->orderByConsumed = 1;
+    }
+
+    if (argvInUse || (order_consumed && order_desc)) {
+        auto full_desc = argvInUse
+            ? fmt::format(FMT_STRING("SEARCH {} USING {}"),
+                          vt->vi->get_name().get(),
+                          fmt::join(index_desc, " AND "))
+            : fmt::format(FMT_STRING("SCAN {}"), vt->vi->get_name().get());
+        if (order_consumed && order_desc) {
+            full_desc.append(" DESC");
+        }
         log_info("found index: %s", full_desc.c_str());
 
         sqlite3_index_info::sqlite3_index_constraint* index_copy;
@@ -1875,11 +2503,16 @@ vt_best_index(sqlite3_vtab* tab, sqlite3_index_info* p_info)
         index_copy
             = reinterpret_cast<sqlite3_index_info::sqlite3_index_constraint*>(
                 index_storage);
-        memcpy(index_copy, &indexes[0], index_len);
+        if (index_len > 0) {
+            memcpy(index_copy, &indexes[0], index_len);
+        }
         p_info->idxNum = argvInUse;
+        if (order_consumed && order_desc) {
+            p_info->idxNum |= VT_IDX_DESCENDING;
+        }
         p_info->idxStr = static_cast<char*>(storage);
         p_info->needToFreeIdxStr = 1;
-        p_info->estimatedCost = 10.0;
+        p_info->estimatedCost = search_argc ? 10.0 : 1000000000.0;
     } else {
         static char fullscan_str[] = "fullscan";
 
@@ -1910,7 +2543,9 @@ vt_update(sqlite3_vtab* tab,
     if (argc > 1 && sqlite3_value_type(argv[0]) != SQLITE_NULL
         && sqlite3_value_int64(argv[0]) == sqlite3_value_int64(argv[1]))
     {
-        int64_t rowid = sqlite3_value_int64(argv[0]) >> 8;
+        // The rowid also holds the sub-line index and the index of the
+        // message in a row of collapsed repeats, only the line is needed.
+        int64_t rowid = (sqlite3_value_int64(argv[0]) >> 8) & 0xffffffff;
         int val = sqlite3_value_int(argv[2 + VT_COL_MARK]);
         vis_line_t vrowid(rowid);
 
@@ -2057,6 +2692,24 @@ static sqlite3_module no_rowid_vtab_module = {
     nullptr, /* xFindFunction - function overloading */
 };
 
+/**
+ * @return A copy of the given module without an xCreate method so that it
+ * can only be used as an eponymous virtual table.
+ */
+static sqlite3_module
+eponymous_module(const sqlite3_module& mod)
+{
+    auto retval = mod;
+
+    retval.xCreate = nullptr;
+    return retval;
+}
+
+static sqlite3_module eponymous_vtab_module
+    = eponymous_module(generic_vtab_module);
+static sqlite3_module eponymous_no_rowid_vtab_module
+    = eponymous_module(no_rowid_vtab_module);
+
 static int
 progress_callback(void* ptr)
 {
@@ -2094,7 +2747,7 @@ log_vtab_manager::~log_vtab_manager()
 }
 
 std::string
-log_vtab_manager::register_vtab(std::shared_ptr<log_vtab_impl> vi)
+log_vtab_manager::register_vtab(std::shared_ptr<log_vtab_impl> vi, bool lazy)
 {
     std::string retval;
 
@@ -2104,10 +2757,26 @@ log_vtab_manager::register_vtab(std::shared_ptr<log_vtab_impl> vi)
         auto_mem<char, sqlite3_free> sql;
         int rc;
 
-        this->vm_impls[vi->get_name()] = vi;
-
         vi->get_primary_keys(primary_keys);
 
+        if (lazy) {
+            rc = sqlite3_create_module(this->vm_db,
+                                       vi->get_name().get(),
+                                       primary_keys.empty()
+                                           ? &eponymous_vtab_module
+                                           : &eponymous_no_rowid_vtab_module,
+                                       this);
+            if (rc != SQLITE_OK) {
+                retval = sqlite3_errmsg(this->vm_db);
+            } else {
+                this->vm_impls[vi->get_name()] = vi;
+                this->vm_lazy_tables.insert(vi->get_name());
+            }
+            return retval;
+        }
+
+        this->vm_impls[vi->get_name()] = vi;
+
         sql = sqlite3_mprintf(
             "CREATE VIRTUAL TABLE %s "
             "USING %s(%s)",
@@ -2132,6 +2801,10 @@ log_vtab_manager::unregister_vtab(intern_string_t name)
 
     if (this->vm_impls.find(name) == this->vm_impls.end()) {
         retval = fmt::format(FMT_STRING("unknown table -- {}"), name);
+    } else if (this->vm_lazy_tables.erase(name) > 0) {
+        sqlite3_create_module(this->vm_db, name.get(), nullptr, nullptr);
+
+        this->vm_impls.erase(name);
     } else {
         auto_mem<char, sqlite3_free> sql;
         __attribute((unused)) int rc;
@@ -2152,7 +2825,7 @@ log_format_vtab_impl::next(log_cursor& lc, logfile_sub_source& lss)
         return true;
     }
 
-    auto cl = content_line_t(lss.at(lc.lc_curr_line));
+    auto cl = lc.content_line(lss);
     auto* lf = lss.find_file_ptr(cl);
     auto lf_iter = lf->begin() + cl;
     uint8_t mod_id = lf_iter->get_module_id();
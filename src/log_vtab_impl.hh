@@ -30,7 +30,10 @@
 #ifndef vtab_impl_hh
 #define vtab_impl_hh
 
+#include <bitset>
 #include <map>
+#include <mutex>
+#include <set>
 #include <string>
 #include <vector>
 
@@ -133,16 +136,36 @@ struct log_cursor {
         string_constraint cc_constraint;
     };
 
+    enum class direction_t {
+        forward,
+        backward,
+    };
+
     vis_line_t lc_curr_line;
     int lc_sub_index;
+    /** The message being returned from a row of collapsed repeats. */
+    uint32_t lc_repeat{0};
+    /** The number of messages in the current row. */
+    uint32_t lc_repeat_count{1};
     vis_line_t lc_end_line;
+    /** The first line in the range when stepping backward. */
+    vis_line_t lc_begin_line{0};
+    direction_t lc_direction{direction_t::forward};
+    /** The number of rows left to return when a LIMIT was pushed down. */
+    nonstd::optional<int64_t> lc_rows_remaining;
 
     using level_constraint = integral_constraint<log_level_t>;
 
     nonstd::optional<level_constraint> lc_level_constraint;
-    intern_string_t lc_format_name;
+    /** The levels from an IN constraint on log_level. */
+    nonstd::optional<std::bitset<LEVEL__MAX>> lc_levels;
+    /** The allowed formats, any one of them can match. */
+    std::vector<intern_string_t> lc_format_names;
     intern_string_t lc_pattern_name;
-    nonstd::optional<opid_hash> lc_opid;
+    /** The hashes of the allowed opids, any one of them can match. */
+    nonstd::optional<std::bitset<1U << 6U>> lc_opids;
+    /** The files selected by IN constraints on log_path/log_unique_path. */
+    nonstd::optional<std::set<const logfile*>> lc_files;
     std::vector<string_constraint> lc_log_path;
     logfile* lc_last_log_path_match{nullptr};
     logfile* lc_last_log_path_mismatch{nullptr};
@@ -152,6 +175,8 @@ struct log_cursor {
 
     std::vector<column_constraint> lc_indexed_columns;
     std::vector<vis_line_t> lc_indexed_lines;
+    /** The lines from an IN constraint on log_line, sorted ascending. */
+    std::vector<vis_line_t> lc_listed_lines;
 
     enum class constraint_t {
         none,
@@ -162,8 +187,39 @@ struct log_cursor {
 
     void set_eof() { this->lc_curr_line = this->lc_end_line = 0_vl; }
 
+    /**
+     * Move the cursor to the nearest line in lc_listed_lines, in the current
+     * direction, if the current line is not one of them.
+     */
+    void seek_listed_line();
+
+    /**
+     * @return The content line for the message the cursor is on, taking
+     * into account rows that collapsed repeated messages.
+     */
+    content_line_t content_line(logfile_sub_source& lss) const;
+
+    /**
+     * Step to the next message in the current row of collapsed repeats.
+     *
+     * @return True if the cursor moved within the row.
+     */
+    bool next_repeat();
+
+    /**
+     * Reset the repeat state after the cursor moved to a new row.
+     *
+     * @param lss The source of the rows.
+     */
+    void start_row(logfile_sub_source& lss);
+
     bool is_eof() const
     {
+        if (this->lc_direction == direction_t::backward) {
+            return this->lc_curr_line < this->lc_begin_line
+                || this->lc_curr_line >= this->lc_end_line;
+        }
+
         return this->lc_indexed_lines.empty()
             && this->lc_curr_line >= this->lc_end_line;
     }
@@ -274,6 +330,20 @@ struct _log_vtab_data {
     sql_progress_finished_callback_t lvd_finished;
     source_location lvd_location;
     attr_line_t lvd_content;
+    /**
+     * When set, the log tables hold this lock while reading from the log
+     * files so that statements running on other connections are serialized.
+     */
+    std::recursive_mutex* lvd_source_mutex{nullptr};
+
+    std::unique_lock<std::recursive_mutex> lock_source() const
+    {
+        if (this->lvd_source_mutex == nullptr) {
+            return {};
+        }
+
+        return std::unique_lock<std::recursive_mutex>(*this->lvd_source_mutex);
+    }
 };
 
 extern thread_local _log_vtab_data log_vtab_data;
@@ -317,9 +387,25 @@ public:
 
     logfile_sub_source* get_source() { return &this->vm_source; }
 
-    std::string register_vtab(std::shared_ptr<log_vtab_impl> vi);
+    /**
+     * Register a table with SQLite.
+     *
+     * @param vi The table implementation.
+     * @param lazy If true, the table is registered as an eponymous module
+     *   instead of with "CREATE VIRTUAL TABLE".  SQLite will only connect
+     *   to the table when a statement first refers to it and the schema is
+     *   not changed, so prepared statements are not invalidated.
+     * @return An error message or an empty string on success.
+     */
+    std::string register_vtab(std::shared_ptr<log_vtab_impl> vi,
+                              bool lazy = false);
     std::string unregister_vtab(intern_string_t name);
 
+    bool is_lazy(intern_string_t name) const
+    {
+        return this->vm_lazy_tables.count(name) > 0;
+    }
+
     std::shared_ptr<log_vtab_impl> lookup_impl(intern_string_t name) const
     {
         auto iter = this->vm_impls.find(name);
@@ -339,6 +425,7 @@ private:
     textview_curses& vm_textview;
     logfile_sub_source& vm_source;
     std::map<intern_string_t, std::shared_ptr<log_vtab_impl>> vm_impls;
+    std::set<intern_string_t> vm_lazy_tables;
 };
 
 #endif
@@ -57,6 +57,28 @@ static auto intern_lifetime = intern_string::get_table_lifetime();
 
 static const size_t INDEX_RESERVE_INCREMENT = 1024;
 
+/**
+ * @return The number of log files that can have an open descriptor at the
+ *   same time.
+ */
+static size_t
+max_open_files()
+{
+    const auto& cfg = injector::get<const lnav::logfile::config&>();
+
+    if (cfg.lc_max_open_files > 0) {
+        return cfg.lc_max_open_files;
+    }
+
+    // Leave room for the descriptors used by sockets, pipes, and
+    // databases.
+    struct rlimit rl;
+    if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur != RLIM_INFINITY) {
+        return std::max<size_t>(rl.rlim_cur / 2, 16);
+    }
+    return 4096;
+}
+
 static const typed_json_path_container<line_buffer::header_data>
     file_header_handlers = {
         yajlpp::property_handler("name").for_field(
@@ -75,6 +97,7 @@ logfile::open(std::string filename, logfile_open_options& loo)
     auto lf = std::shared_ptr<logfile>(new logfile(std::move(filename), loo));
 
     memset(&lf->lf_stat, 0, sizeof(lf->lf_stat));
+    nonstd::optional<std::string> reopen_path;
     if (lf->lf_options.loo_fd == -1) {
         char resolved_path[PATH_MAX];
 
@@ -114,6 +137,7 @@ logfile::open(std::string filename, logfile_open_options& loo)
 
         lf->lf_actual_path = lf->lf_filename;
         lf->lf_valid_filename = true;
+        reopen_path = resolved_path;
     } else {
         log_perror(fstat(lf->lf_options.loo_fd, &lf->lf_stat));
         lf->lf_named_file = false;
@@ -127,6 +151,38 @@ logfile::open(std::string filename, logfile_open_options& loo)
 
     lf->lf_content_id = hasher().update(lf->lf_filename).to_string();
     lf->lf_line_buffer.set_fd(lf->lf_options.loo_fd);
+    if (reopen_path) {
+        // The descriptor can be closed while the file is idle, so make sure
+        // it is still the same file when it is reopened.
+        lf->lf_line_buffer.set_reopen_func(
+            [path = reopen_path.value(),
+             dev = lf->lf_stat.st_dev,
+             ino = lf->lf_stat.st_ino]() -> Result<auto_fd, std::string> {
+                auto fd = TRY(lnav::filesystem::open_file(path, O_RDONLY));
+                struct stat st;
+
+                if (fstat(fd, &st) == -1) {
+                    return Err(fmt::format(FMT_STRING("fstat({}) failed with: {}"),
+                                           path,
+                                           strerror(errno)));
+                }
+                if (st.st_dev != dev || st.st_ino != ino) {
+                    return Err(fmt::format(
+                        FMT_STRING("{} was replaced while it was closed"),
+                        path));
+                }
+                fd.close_on_exec();
+
+                return Ok(std::move(fd));
+            });
+        // Many files can be opened at once during a rescan, so don't hold
+        // on to the descriptor if there are too many open already.  It
+        // will be reopened when the file is indexed.
+        if (lf->lf_line_buffer.release_fd_if_over(max_open_files())) {
+            log_debug("%s: too many open files, closing until indexed",
+                      lf->lf_filename.c_str());
+        }
+    }
     lf->lf_index.reserve(INDEX_RESERVE_INCREMENT);
 
     lf->lf_indexing = lf->lf_options.loo_is_visible;
@@ -217,6 +273,8 @@ logfile::process_prefix(shared_buffer_ref& sbr,
     time_t prescan_time = 0;
     bool retval = false;
 
+    sbc.sbc_timestamp_start = -1;
+    sbc.sbc_timestamp_end = -1;
     if (this->lf_format.get() != nullptr) {
         if (!this->lf_index.empty()) {
             prescan_time = this->lf_index[prescan_size - 1].get_time();
@@ -267,6 +325,9 @@ logfile::process_prefix(shared_buffer_ref& sbr,
             (*iter)->clear();
             this->set_format_base_time(iter->get());
             found = (*iter)->scan(*this, this->lf_index, li, sbr, sbc);
+            if (found == log_format::SCAN_NEED_MORE) {
+                break;
+            }
             if (found == log_format::SCAN_MATCH) {
 #if 0
                 require(this->lf_index.size() == 1 ||
@@ -311,6 +372,13 @@ logfile::process_prefix(shared_buffer_ref& sbr,
                 auto& last_line = this->lf_index[this->lf_index.size() - 1];
 
                 for (size_t lpc = 0; lpc < this->lf_index.size() - 1; lpc++) {
+                    if (lpc < prescan_size
+                        && this->lf_index[lpc].get_msg_level() != LEVEL_UNKNOWN)
+                    {
+                        // The format already placed this line while it
+                        // was looking back over the earlier lines.
+                        continue;
+                    }
                     if (this->lf_format->lf_multiline) {
                         this->lf_index[lpc].set_time(last_line.get_time());
                         this->lf_index[lpc].set_millis(last_line.get_millis());
@@ -359,7 +427,8 @@ logfile::process_prefix(shared_buffer_ref& sbr,
             }
             break;
         }
-        case log_format::SCAN_NO_MATCH: {
+        case log_format::SCAN_NO_MATCH:
+        case log_format::SCAN_NEED_MORE: {
             log_level_t last_level = LEVEL_UNKNOWN;
             time_t last_time = this->lf_index_time;
             short last_millis = 0;
@@ -398,6 +467,12 @@ logfile::process_prefix(shared_buffer_ref& sbr,
     return retval;
 }
 
+void
+logfile::release_idle_fds()
+{
+    line_buffer::release_idle_fds(max_open_files());
+}
+
 logfile::rebuild_result_t
 logfile::rebuild_index(nonstd::optional<ui_clock::time_point> deadline)
 {
@@ -410,11 +485,29 @@ logfile::rebuild_index(nonstd::optional<ui_clock::time_point> deadline)
     }
 
     auto retval = rebuild_result_t::NO_NEW_LINES;
+    bool started_tail_first = false;
     struct stat st;
 
     this->lf_activity.la_polls += 1;
 
-    if (fstat(this->lf_line_buffer.get_fd(), &st) == -1) {
+    if (this->lf_line_buffer.is_fd_released()) {
+        // The descriptor was closed while the file was idle, so check the
+        // path instead.  The descriptor is reopened if there is new data.
+        auto stat_res
+            = lnav::filesystem::stat_file(this->lf_actual_path.value());
+        if (stat_res.isErr()) {
+            return rebuild_result_t::INVALID;
+        }
+        st = stat_res.unwrap();
+        if (st.st_dev != this->lf_stat.st_dev
+            || st.st_ino != this->lf_stat.st_ino)
+        {
+            log_info("replaced file detected, closing -- %s",
+                     this->lf_filename.c_str());
+            this->close();
+            return rebuild_result_t::NO_NEW_LINES;
+        }
+    } else if (fstat(this->lf_line_buffer.get_fd(), &st) == -1) {
         if (errno == EINTR) {
             return rebuild_result_t::NO_NEW_LINES;
         }
@@ -476,6 +569,15 @@ logfile::rebuild_index(nonstd::optional<ui_clock::time_point> deadline)
             }
             this->lf_index.pop_back();
             rollback_size += 1;
+            if (this->has_repeats()) {
+                // Remember if the line was collapsed so that a change can be
+                // reported after it is read again.
+                auto reread_line = (uint32_t) this->lf_index.size();
+
+                this->lf_reread_repeat = std::make_pair(
+                    reread_line, this->is_collapsed(reread_line));
+                this->trim_repeat_runs();
+            }
 
             if (!this->lf_index.empty()) {
                 auto last_line = this->lf_index.end();
@@ -498,9 +600,14 @@ logfile::rebuild_index(nonstd::optional<ui_clock::time_point> deadline)
                     this->close();
                     return rebuild_result_t::INVALID;
                 }
+            } else if (this->lf_head_index) {
+                this->lf_line_buffer.flush_at(off);
             } else {
                 this->lf_line_buffer.flush_at(0);
             }
+        } else if (this->lf_head_index) {
+            off = this->lf_head_index->his_end_offset;
+            this->lf_line_buffer.flush_at(off);
         } else {
             this->lf_line_buffer.flush_at(0);
             off = 0;
@@ -534,6 +641,7 @@ logfile::rebuild_index(nonstd::optional<ui_clock::time_point> deadline)
         }
         scan_batch_context sbc{this->lf_allocator};
         sbc.sbc_opids.reserve(32);
+        sbc.sbc_sketch_offset = this->lf_sketch_offset;
         auto prev_range = file_range{off};
         while (limit > 0) {
             auto load_result = this->lf_line_buffer.load_next_line(prev_range);
@@ -593,8 +701,7 @@ logfile::rebuild_index(nonstd::optional<ui_clock::time_point> deadline)
                 this->lf_text_format = text_format_t::TF_BINARY;
             }
 
-            auto read_result
-                = this->lf_line_buffer.read_range(li.li_file_range);
+            auto read_result = this->read_index_line(li);
             if (read_result.isErr()) {
                 log_error("%s:read failure -- %s",
                           this->lf_filename.c_str(),
@@ -604,17 +711,6 @@ logfile::rebuild_index(nonstd::optional<ui_clock::time_point> deadline)
             }
 
             auto sbr = read_result.unwrap();
-            sbr.rtrim(is_line_ending);
-
-            if (li.li_valid_utf && li.li_has_ansi) {
-                auto tmp_line = sbr.to_string_fragment().to_string();
-
-                scrub_ansi_string(tmp_line, nullptr);
-                memcpy(sbr.get_writable_data(),
-                       tmp_line.c_str(),
-                       tmp_line.length());
-                sbr.narrow(0, tmp_line.length());
-            }
 
             this->lf_longest_line
                 = std::max(this->lf_longest_line, sbr.length());
@@ -628,6 +724,12 @@ logfile::rebuild_index(nonstd::optional<ui_clock::time_point> deadline)
             // Update this early so that line_length() works
             this->lf_index_size = li.li_file_range.next_offset();
 
+            if (this->lf_format) {
+                // The filters skip lines that repeat the previous message,
+                // so this needs to be done before they are notified.
+                this->track_repeats(sbr, sbc);
+            }
+
             if (this->lf_logline_observer != nullptr) {
                 this->lf_logline_observer->logline_new_lines(
                     *this, this->begin() + old_size, this->end(), sbr);
@@ -662,39 +764,7 @@ logfile::rebuild_index(nonstd::optional<ui_clock::time_point> deadline)
             }
 #endif
             if (this->lf_format) {
-                if (!this->lf_applicable_taggers.empty()) {
-                    auto sf = sbr.to_string_fragment();
-
-                    for (const auto& td : this->lf_applicable_taggers) {
-                        auto curr_ll = this->end() - 1;
-
-                        if (td->ftd_level != LEVEL_UNKNOWN
-                            && td->ftd_level != curr_ll->get_msg_level())
-                        {
-                            continue;
-                        }
-
-                        if (td->ftd_pattern.pp_value
-                                ->find_in(sf, PCRE2_NO_UTF_CHECK)
-                                .ignore_error()
-                                .has_value())
-                        {
-                            curr_ll->set_mark(true);
-                            while (curr_ll->is_continued()) {
-                                --curr_ll;
-                            }
-                            auto line_number = static_cast<uint32_t>(
-                                std::distance(this->begin(), curr_ll));
-
-                            this->lf_bookmark_metadata[line_number].add_tag(
-                                td->ftd_name);
-                        }
-                    }
-                }
-
-                if (!this->back().is_continued()) {
-                    lnav::log::watch::eval_with(*this, this->end() - 1);
-                }
+                this->apply_line_tags(sbr);
             }
 
             if (li.li_partial) {
@@ -753,27 +823,15 @@ logfile::rebuild_index(nonstd::optional<ui_clock::time_point> deadline)
         this->lf_index_size = prev_range.next_offset();
         this->lf_stat = st;
 
-        {
-            safe::WriteAccess<logfile::safe_opid_map> writable_opid_map(
-                this->lf_opids);
-
-            for (const auto& opid_pair : sbc.sbc_opids) {
-                auto opid_iter = writable_opid_map->find(opid_pair.first);
+        this->merge_opids(sbc);
+        this->merge_field_sketches(sbc);
+        this->lf_sketch_offset = this->lf_index_size;
 
-                if (opid_iter == writable_opid_map->end()) {
-                    writable_opid_map->emplace(opid_pair);
-                } else {
-                    if (opid_pair.second.otr_begin
-                        < opid_iter->second.otr_begin)
-                    {
-                        opid_iter->second.otr_begin
-                            = opid_pair.second.otr_begin;
-                    }
-                    if (opid_iter->second.otr_end < opid_pair.second.otr_end) {
-                        opid_iter->second.otr_end = opid_pair.second.otr_end;
-                    }
-                }
-            }
+        if (!has_format && this->lf_format != nullptr && deadline
+            && this->start_tail_first(st))
+        {
+            started_tail_first = true;
+            sort_needed = true;
         }
 
         if (sort_needed) {
@@ -786,11 +844,31 @@ logfile::rebuild_index(nonstd::optional<ui_clock::time_point> deadline)
         this->lf_sort_needed = false;
     }
 
+    if (this->lf_head_index && !started_tail_first
+        && !this->lf_line_buffer.is_data_available(this->lf_index_size,
+                                                   st.st_size)
+        && (!deadline || ui_clock::now() < deadline.value()))
+    {
+        // The tail has caught up, work on filling in the head.
+        auto head_res = this->index_head(deadline);
+
+        if (head_res == rebuild_result_t::INVALID) {
+            return head_res;
+        }
+        if (head_res == rebuild_result_t::NEW_ORDER) {
+            retval = head_res;
+        }
+    }
+
     this->lf_index_time = this->lf_line_buffer.get_file_time();
     if (!this->lf_index_time) {
         this->lf_index_time = st.st_mtime;
     }
 
+    if (retval == rebuild_result_t::NEW_LINES && this->apply_retention()) {
+        retval = rebuild_result_t::NEW_ORDER;
+    }
+
     if (this->lf_out_of_time_order_count) {
         log_info("Detected %d out-of-time-order lines in file: %s",
                  this->lf_out_of_time_order_count,
@@ -801,6 +879,731 @@ logfile::rebuild_index(nonstd::optional<ui_clock::time_point> deadline)
     return retval;
 }
 
+Result<shared_buffer_ref, std::string>
+logfile::read_index_line(const line_info& li)
+{
+    auto retval = TRY(this->lf_line_buffer.read_range(li.li_file_range));
+
+    retval.rtrim(is_line_ending);
+    if (li.li_valid_utf && li.li_has_ansi) {
+        auto tmp_line = retval.to_string_fragment().to_string();
+
+        scrub_ansi_string(tmp_line, nullptr);
+        memcpy(retval.get_writable_data(), tmp_line.c_str(), tmp_line.length());
+        retval.narrow(0, tmp_line.length());
+    }
+
+    return Ok(std::move(retval));
+}
+
+void
+logfile::apply_line_tags(const shared_buffer_ref& sbr)
+{
+    if (!this->lf_applicable_taggers.empty()) {
+        auto sf = sbr.to_string_fragment();
+
+        for (const auto& td : this->lf_applicable_taggers) {
+            auto curr_ll = this->end() - 1;
+
+            if (td->ftd_level != LEVEL_UNKNOWN
+                && td->ftd_level != curr_ll->get_msg_level())
+            {
+                continue;
+            }
+
+            if (td->ftd_pattern.pp_value->find_in(sf, PCRE2_NO_UTF_CHECK)
+                    .ignore_error()
+                    .has_value())
+            {
+                curr_ll->set_mark(true);
+                while (curr_ll->is_continued()) {
+                    --curr_ll;
+                }
+                auto line_number = static_cast<uint32_t>(
+                    std::distance(this->begin(), curr_ll));
+
+                this->lf_bookmark_metadata[line_number].add_tag(td->ftd_name);
+            }
+        }
+    }
+
+    if (!this->back().is_continued()) {
+        lnav::log::watch::eval_with(*this, this->end() - 1);
+    }
+}
+
+nonstd::optional<logfile::repeat_key>
+logfile::get_repeat_key(const_iterator ll)
+{
+    if (!ll->is_message() || ll->is_marked()) {
+        return nonstd::nullopt;
+    }
+
+    logline_value_vector values;
+    string_attrs_t sa;
+    auto line_number = std::distance(this->cbegin(), ll);
+
+    this->read_full_message(ll, values.lvv_sbr);
+    values.lvv_sbr.erase_ansi();
+    this->lf_format->annotate(line_number, sa, values, false);
+
+    auto time_attr = find_string_attr(sa, &logline::L_TIMESTAMP);
+    auto text = values.lvv_sbr.to_string_fragment();
+    hasher h;
+    if (time_attr != sa.end() && time_attr->sa_range.lr_start >= 0
+        && time_attr->sa_range.lr_start <= text.length())
+    {
+        auto ts_end = time_attr->sa_range.lr_end == -1
+            ? text.length()
+            : std::min(text.length(), time_attr->sa_range.lr_end);
+
+        h.update(text.data(), time_attr->sa_range.lr_start);
+        h.update(text.data() + ts_end, text.length() - ts_end);
+    } else {
+        h.update(text);
+    }
+
+    return repeat_key{
+        ll->get_msg_level(),
+        ll->get_opid(),
+        this->lf_format->get_pattern_name(line_number),
+        h.to_array(),
+    };
+}
+
+nonstd::optional<logfile::repeat_key>
+logfile::get_repeat_key(const_iterator ll,
+                        const shared_buffer_ref& sbr,
+                        const scan_batch_context& sbc)
+{
+    auto sf = sbr.to_string_fragment();
+
+    if (sbc.sbc_timestamp_start < 0
+        || sbc.sbc_timestamp_end < sbc.sbc_timestamp_start
+        || sbc.sbc_timestamp_end > sf.length())
+    {
+        // The format did not say where the timestamp is, so the line has
+        // to be annotated to find it.
+        return this->get_repeat_key(ll);
+    }
+
+    if (!ll->is_message() || ll->is_marked()) {
+        return nonstd::nullopt;
+    }
+
+    auto line_number = std::distance(this->cbegin(), ll);
+    hasher h;
+
+    h.update(sf.data(), sbc.sbc_timestamp_start);
+    h.update(sf.data() + sbc.sbc_timestamp_end,
+             sf.length() - sbc.sbc_timestamp_end);
+
+    return repeat_key{
+        ll->get_msg_level(),
+        ll->get_opid(),
+        this->lf_format->get_pattern_name(line_number),
+        h.to_array(),
+    };
+}
+
+void
+logfile::track_repeats(const shared_buffer_ref& sbr,
+                       const scan_batch_context& sbc)
+{
+    const auto& cfg = injector::get<const lnav::logfile::config&>();
+
+    if (!cfg.lc_collapse_repeats) {
+        return;
+    }
+
+    auto line_number = (uint32_t) (this->lf_index.size() - 1);
+
+    this->add_to_repeat_run(line_number, sbr, sbc);
+    if (this->lf_reread_repeat && this->lf_reread_repeat->first == line_number)
+    {
+        if (this->lf_reread_repeat->second != this->is_collapsed(line_number)) {
+            this->note_repeat_change(line_number);
+        }
+        this->lf_reread_repeat = nonstd::nullopt;
+    }
+}
+
+void
+logfile::add_to_repeat_run(uint32_t line_number,
+                           const shared_buffer_ref& sbr,
+                           const scan_batch_context& sbc)
+{
+    static const uint32_t MAX_REPEATS_PER_RUN = 1U << 20;
+
+    auto ll = this->cbegin() + line_number;
+
+    if (ll->is_continued()) {
+        // Only single-line messages are collapsed, so undo the repeat if
+        // the message turned out to have more lines.
+        if (this->is_repeat(line_number - 1)) {
+            auto was_collapsed = this->is_collapsed(line_number - 1);
+            auto& last_run = this->lf_repeat_runs.back();
+
+            last_run.rr_count -= 1;
+            if (last_run.rr_count < 2) {
+                this->lf_repeat_runs.pop_back();
+            }
+            if (was_collapsed) {
+                this->note_repeat_change(line_number - 1);
+            }
+        }
+        this->lf_last_repeat_key = nonstd::nullopt;
+        return;
+    }
+
+    if (line_number == 0) {
+        this->lf_last_repeat_key = nonstd::nullopt;
+        return;
+    }
+
+    auto prev_line = line_number - 1;
+    if (!this->lf_last_repeat_key
+        || this->lf_last_repeat_key->first != prev_line)
+    {
+        // The index was rolled back or shifted since the last key was
+        // computed, so recompute it for the previous line.
+        this->lf_last_repeat_key = nonstd::nullopt;
+        if (!ll[-1].is_continued()) {
+            auto prev_key = this->get_repeat_key(ll - 1);
+            if (prev_key) {
+                this->lf_last_repeat_key
+                    = std::make_pair(prev_line, std::move(prev_key.value()));
+            }
+        }
+    }
+
+    auto key = this->get_repeat_key(ll, sbr, sbc);
+    if (!key) {
+        this->lf_last_repeat_key = nonstd::nullopt;
+        return;
+    }
+    if (this->lf_last_repeat_key
+        && this->lf_last_repeat_key->second == key.value())
+    {
+        if (!this->lf_repeat_runs.empty()
+            && this->lf_repeat_runs.back().end_line() == line_number)
+        {
+            auto& last_run = this->lf_repeat_runs.back();
+
+            if (last_run.rr_count < MAX_REPEATS_PER_RUN) {
+                last_run.rr_count += 1;
+            }
+        } else {
+            this->lf_repeat_runs.emplace_back(repeat_run{prev_line, 2});
+        }
+    }
+    this->lf_last_repeat_key
+        = std::make_pair(line_number, std::move(key.value()));
+}
+
+const logfile::repeat_run*
+logfile::find_repeat_run(uint32_t line_number) const
+{
+    if (this->lf_repeat_runs.empty()) {
+        return nullptr;
+    }
+
+    auto iter = std::upper_bound(
+        this->lf_repeat_runs.begin(),
+        this->lf_repeat_runs.end(),
+        line_number,
+        [](uint32_t line, const repeat_run& run) { return line < run.rr_line; });
+    if (iter == this->lf_repeat_runs.begin()) {
+        return nullptr;
+    }
+    --iter;
+    if (line_number >= iter->end_line()) {
+        return nullptr;
+    }
+
+    return &(*iter);
+}
+
+bool
+logfile::toggle_repeat_run(uint32_t line_number)
+{
+    auto* run = const_cast<repeat_run*>(this->find_repeat_run(line_number));
+
+    if (run == nullptr) {
+        return false;
+    }
+
+    run->rr_expanded = !run->rr_expanded;
+    return true;
+}
+
+void
+logfile::trim_repeat_runs()
+{
+    auto size = (uint32_t) this->lf_index.size();
+
+    while (!this->lf_repeat_runs.empty()
+           && this->lf_repeat_runs.back().rr_line + 1 >= size)
+    {
+        this->lf_repeat_runs.pop_back();
+    }
+    if (!this->lf_repeat_runs.empty()
+        && this->lf_repeat_runs.back().end_line() > size)
+    {
+        auto& last_run = this->lf_repeat_runs.back();
+
+        last_run.rr_count = size - last_run.rr_line;
+    }
+}
+
+void
+logfile::note_repeat_change(uint32_t line_number)
+{
+    if (!this->lf_repeat_change || line_number < this->lf_repeat_change.value())
+    {
+        this->lf_repeat_change = line_number;
+    }
+}
+
+void
+logfile::merge_opids(const scan_batch_context& sbc)
+{
+    safe::WriteAccess<logfile::safe_opid_map> writable_opid_map(
+        this->lf_opids);
+
+    for (const auto& opid_pair : sbc.sbc_opids) {
+        auto opid_iter = writable_opid_map->find(opid_pair.first);
+
+        if (opid_iter == writable_opid_map->end()) {
+            writable_opid_map->emplace(opid_pair);
+        } else {
+            if (opid_pair.second.otr_begin < opid_iter->second.otr_begin) {
+                opid_iter->second.otr_begin = opid_pair.second.otr_begin;
+            }
+            if (opid_iter->second.otr_end < opid_pair.second.otr_end) {
+                opid_iter->second.otr_end = opid_pair.second.otr_end;
+            }
+        }
+    }
+}
+
+void
+logfile::merge_field_sketches(const scan_batch_context& sbc)
+{
+    for (const auto& sketch_pair : sbc.sbc_sketches) {
+        auto& blocks = this->lf_field_sketches[sketch_pair.first];
+
+        for (const auto& block_pair : sketch_pair.second) {
+            blocks[block_pair.first].merge(block_pair.second);
+        }
+    }
+}
+
+bool
+logfile::start_tail_first(const struct stat& st)
+{
+    static const size_t MAX_PROBE_LINES = 1000;
+
+    const auto& cfg = injector::get<const lnav::logfile::config&>();
+
+    if (cfg.lc_tail_first_min_size == 0 || !this->lf_named_file
+        || this->lf_line_buffer.is_compressed()
+        || (file_size_t) st.st_size < cfg.lc_tail_first_min_size
+        || (file_size_t) st.st_size <= cfg.lc_tail_first_size)
+    {
+        return false;
+    }
+
+    auto tail_guess = st.st_size - (file_off_t) cfg.lc_tail_first_size;
+    if (tail_guess <= this->lf_index_size) {
+        return false;
+    }
+
+    /*
+     * The guessed offset is most likely in the middle of a line, so skip
+     * to the next line and then look for a line that the format recognizes
+     * as the start of a message.  The probing is done with a scratch index
+     * so the real one is not disturbed.
+     */
+    auto saved_locks = this->lf_format->lf_pattern_locks;
+    ArenaAlloc::Alloc<char> probe_allocator{4 * 1024};
+    scan_batch_context probe_sbc{probe_allocator};
+    std::vector<logline> probe_index;
+    nonstd::optional<file_off_t> tail_start;
+    auto prev_range = file_range{tail_guess - 1};
+
+    this->lf_line_buffer.flush_at(0);
+    for (size_t probe_count = 0; probe_count <= MAX_PROBE_LINES;
+         probe_count++)
+    {
+        auto load_result = this->lf_line_buffer.load_next_line(prev_range);
+        if (load_result.isErr()) {
+            break;
+        }
+
+        auto li = load_result.unwrap();
+        if (li.li_file_range.empty() || li.li_partial) {
+            break;
+        }
+        prev_range = li.li_file_range;
+        if (probe_count == 0) {
+            continue;
+        }
+
+        auto read_result = this->read_index_line(li);
+        if (read_result.isErr()) {
+            break;
+        }
+
+        auto sbr = read_result.unwrap();
+        probe_index.clear();
+        probe_index.emplace_back(0, 0, 0, LEVEL_UNKNOWN);
+        auto scan_res = this->lf_format->scan(
+            *this, probe_index, li, sbr, probe_sbc);
+        if (scan_res == log_format::SCAN_MATCH && probe_index.size() > 1
+            && probe_index[1].is_message()
+            && probe_index[1].get_msg_level() != LEVEL_INVALID)
+        {
+            tail_start = li.li_file_range.fr_offset;
+            break;
+        }
+    }
+    this->lf_format->lf_pattern_locks = saved_locks;
+
+    if (!tail_start) {
+        log_info("%s: unable to find a message near the end of the file, "
+                 "not indexing tail-first",
+                 this->lf_filename.c_str());
+        return false;
+    }
+
+    log_info("%s: indexing tail-first starting at offset %lld, head is %lld "
+             "bytes",
+             this->lf_filename.c_str(),
+             (long long) tail_start.value(),
+             (long long) (tail_start.value() - this->lf_index_size));
+
+    head_index_state his;
+
+    his.his_next_offset = this->lf_index_size;
+    his.his_end_offset = tail_start.value();
+    if (this->lf_logline_observer != nullptr) {
+        this->lf_logline_observer->logline_restart(*this,
+                                                   this->lf_index.size());
+    }
+    his.his_index = std::move(this->lf_index);
+    his.his_bookmark_metadata = std::move(this->lf_bookmark_metadata);
+    his.his_pattern_locks = std::move(this->lf_format->lf_pattern_locks);
+    his.his_repeat_runs = std::move(this->lf_repeat_runs);
+    this->lf_index.clear();
+    this->lf_index.reserve(INDEX_RESERVE_INCREMENT);
+    this->lf_bookmark_metadata.clear();
+    this->lf_format->lf_pattern_locks.clear();
+    this->lf_repeat_runs.clear();
+    this->lf_last_repeat_key = nonstd::nullopt;
+    this->lf_reread_repeat = nonstd::nullopt;
+    this->lf_index_size = tail_start.value();
+    this->lf_partial_line = false;
+    this->lf_next_line_cache = nonstd::nullopt;
+    this->lf_head_index = std::move(his);
+
+    return true;
+}
+
+logfile::rebuild_result_t
+logfile::index_head(nonstd::optional<ui_clock::time_point> deadline)
+{
+    static const size_t DEADLINE_CHECK_INTERVAL = 1000;
+
+    auto& his = this->lf_head_index.value();
+    auto tail_index_size = this->lf_index_size;
+    auto tail_partial_line = this->lf_partial_line;
+    auto retval = rebuild_result_t::NO_NEW_LINES;
+    bool done = false;
+    size_t line_count = 0;
+
+    /*
+     * Swap in the head state so that the format scanners, tag definitions,
+     * and watch expressions work with the head as if it was the whole
+     * index.
+     */
+    std::swap(this->lf_index, his.his_index);
+    std::swap(this->lf_bookmark_metadata, his.his_bookmark_metadata);
+    std::swap(this->lf_format->lf_pattern_locks, his.his_pattern_locks);
+    std::swap(this->lf_repeat_runs, his.his_repeat_runs);
+    this->lf_last_repeat_key = nonstd::nullopt;
+    this->lf_reread_repeat = nonstd::nullopt;
+    this->lf_index_size = his.his_next_offset;
+    this->lf_partial_line = false;
+    this->lf_next_line_cache = nonstd::nullopt;
+
+    scan_batch_context sbc{this->lf_allocator};
+    sbc.sbc_opids.reserve(32);
+    auto prev_range = file_range{his.his_next_offset};
+    while (true) {
+        auto load_result = this->lf_line_buffer.load_next_line(prev_range);
+
+        if (load_result.isErr()) {
+            log_error("%s: load next head line failure -- %s",
+                      this->lf_filename.c_str(),
+                      load_result.unwrapErr().c_str());
+            retval = rebuild_result_t::INVALID;
+            break;
+        }
+
+        auto li = load_result.unwrap();
+
+        if (li.li_file_range.empty()
+            || li.li_file_range.fr_offset >= his.his_end_offset)
+        {
+            done = true;
+            break;
+        }
+        prev_range = li.li_file_range;
+
+        auto read_result = this->read_index_line(li);
+        if (read_result.isErr()) {
+            log_error("%s: head read failure -- %s",
+                      this->lf_filename.c_str(),
+                      read_result.unwrapErr().c_str());
+            retval = rebuild_result_t::INVALID;
+            break;
+        }
+
+        auto sbr = read_result.unwrap();
+
+        this->lf_longest_line = std::max(this->lf_longest_line, sbr.length());
+        this->process_prefix(sbr, li, sbc);
+        this->lf_index_size = li.li_file_range.next_offset();
+        if (!this->lf_index.empty()) {
+            this->apply_line_tags(sbr);
+            this->track_repeats(sbr, sbc);
+        }
+
+        line_count += 1;
+        if (deadline && (line_count % DEADLINE_CHECK_INTERVAL) == 0
+            && ui_clock::now() > deadline.value())
+        {
+            break;
+        }
+    }
+
+    his.his_next_offset = prev_range.next_offset();
+    this->merge_opids(sbc);
+    this->merge_field_sketches(sbc);
+
+    std::swap(this->lf_index, his.his_index);
+    std::swap(this->lf_bookmark_metadata, his.his_bookmark_metadata);
+    std::swap(this->lf_format->lf_pattern_locks, his.his_pattern_locks);
+    std::swap(this->lf_repeat_runs, his.his_repeat_runs);
+    this->lf_last_repeat_key = nonstd::nullopt;
+    this->lf_reread_repeat = nonstd::nullopt;
+    this->lf_index_size = tail_index_size;
+    this->lf_partial_line = tail_partial_line;
+    this->lf_next_line_cache = nonstd::nullopt;
+
+    if (retval == rebuild_result_t::INVALID) {
+        this->close();
+    } else if (done) {
+        this->splice_head();
+        retval = rebuild_result_t::NEW_ORDER;
+    }
+
+    return retval;
+}
+
+void
+logfile::splice_head()
+{
+    auto his = std::move(this->lf_head_index.value());
+    auto head_size = his.his_index.size();
+
+    this->lf_head_index = nonstd::nullopt;
+
+    log_info("%s: splicing %zu head lines in front of %zu tail lines",
+             this->lf_filename.c_str(),
+             head_size,
+             this->lf_index.size());
+
+    his.his_index.reserve(head_size + this->lf_index.size());
+    his.his_index.insert(
+        his.his_index.end(), this->lf_index.begin(), this->lf_index.end());
+    this->lf_index = std::move(his.his_index);
+
+    for (auto& bm_pair : this->lf_bookmark_metadata) {
+        his.his_bookmark_metadata[bm_pair.first + head_size]
+            = std::move(bm_pair.second);
+    }
+    this->lf_bookmark_metadata = std::move(his.his_bookmark_metadata);
+
+    for (auto& run : this->lf_repeat_runs) {
+        run.rr_line += head_size;
+    }
+    this->lf_repeat_runs.insert(this->lf_repeat_runs.begin(),
+                                his.his_repeat_runs.begin(),
+                                his.his_repeat_runs.end());
+
+    auto& tail_locks = this->lf_format->lf_pattern_locks;
+    for (auto& pfl : tail_locks) {
+        pfl.pfl_line += head_size;
+    }
+    tail_locks.insert(tail_locks.begin(),
+                      his.his_pattern_locks.begin(),
+                      his.his_pattern_locks.end());
+
+    this->lf_spliced_line_count += head_size;
+}
+
+bool
+logfile::apply_retention()
+{
+    static const size_t MIN_DROP_COUNT = 1024;
+
+    const auto& cfg = injector::get<const lnav::logfile::config&>();
+
+    if (this->lf_format == nullptr || this->lf_head_index
+        || this->lf_index.empty())
+    {
+        return false;
+    }
+
+    size_t drop_count = 0;
+
+    if (cfg.lc_max_retained_lines > 0
+        && this->lf_index.size() > cfg.lc_max_retained_lines)
+    {
+        drop_count = this->lf_index.size() - cfg.lc_max_retained_lines;
+    }
+    if (cfg.lc_max_retained_bytes > 0
+        && (file_size_t) (this->lf_index_size
+                          - this->lf_index.front().get_offset())
+            > cfg.lc_max_retained_bytes)
+    {
+        auto min_offset
+            = this->lf_index_size - (file_off_t) cfg.lc_max_retained_bytes;
+        auto off_iter = std::lower_bound(
+            this->lf_index.begin(),
+            this->lf_index.end(),
+            min_offset,
+            [](const logline& ll, file_off_t off) {
+                return ll.get_offset() < off;
+            });
+
+        drop_count = std::max(
+            drop_count,
+            (size_t) std::distance(this->lf_index.begin(), off_iter));
+    }
+    if (cfg.lc_max_retained_age.count() > 0) {
+        struct timeval min_tv = this->lf_index.back().get_timeval();
+
+        min_tv.tv_sec -= cfg.lc_max_retained_age.count();
+        auto time_iter = std::lower_bound(
+            this->lf_index.begin(), this->lf_index.end(), min_tv);
+
+        drop_count = std::max(
+            drop_count,
+            (size_t) std::distance(this->lf_index.begin(), time_iter));
+    }
+
+    /*
+     * Lines are dropped in batches so that the cost of shifting the index
+     * and rebuilding the merged index is spread out over many new lines.
+     */
+    if (drop_count < std::max(MIN_DROP_COUNT, this->lf_index.size() / 16)) {
+        return false;
+    }
+
+    // Only drop whole messages so there are no orphaned continuation lines.
+    while (drop_count < this->lf_index.size()
+           && !this->lf_index[drop_count].is_message())
+    {
+        drop_count += 1;
+    }
+    if (drop_count >= this->lf_index.size()) {
+        return false;
+    }
+
+    auto first_tv = this->lf_index[drop_count].get_timeval();
+
+    log_info("%s: dropping %zu lines to stay within the retention limits",
+             this->lf_filename.c_str(),
+             drop_count);
+
+    this->lf_index.erase(this->lf_index.begin(),
+                         this->lf_index.begin() + drop_count);
+
+    robin_hood::unordered_map<uint32_t, bookmark_metadata> new_bm;
+    for (auto& bm_pair : this->lf_bookmark_metadata) {
+        if (bm_pair.first >= drop_count) {
+            new_bm[bm_pair.first - drop_count] = std::move(bm_pair.second);
+        }
+    }
+    this->lf_bookmark_metadata = std::move(new_bm);
+
+    // The first remaining line starts what is left of a run that was
+    // partially dropped.
+    auto run_iter = this->lf_repeat_runs.begin();
+    for (auto& run : this->lf_repeat_runs) {
+        if (run.end_line() <= drop_count + 1) {
+            continue;
+        }
+        if (run.rr_line < drop_count) {
+            run.rr_count = run.end_line() - drop_count;
+            run.rr_line = drop_count;
+        }
+        run.rr_line -= drop_count;
+        *run_iter = run;
+        ++run_iter;
+    }
+    this->lf_repeat_runs.erase(run_iter, this->lf_repeat_runs.end());
+    this->lf_last_repeat_key = nonstd::nullopt;
+    this->lf_reread_repeat = nonstd::nullopt;
+
+    auto& locks = this->lf_format->lf_pattern_locks;
+    auto lock_iter = std::find_if(
+        locks.begin(), locks.end(), [drop_count](const auto& pfl) {
+            return pfl.pfl_line > drop_count;
+        });
+    if (lock_iter != locks.begin()) {
+        // Keep the lock that covers the new first line.
+        --lock_iter;
+    }
+    locks.erase(locks.begin(), lock_iter);
+    for (auto& pfl : locks) {
+        pfl.pfl_line = pfl.pfl_line > drop_count ? pfl.pfl_line - drop_count
+                                                 : 0;
+    }
+
+    {
+        safe::WriteAccess<logfile::safe_opid_map> writable_opid_map(
+            this->lf_opids);
+
+        for (auto opid_iter = writable_opid_map->begin();
+             opid_iter != writable_opid_map->end();)
+        {
+            if (opid_iter->second.otr_end < first_tv) {
+                opid_iter = writable_opid_map->erase(opid_iter);
+            } else {
+                ++opid_iter;
+            }
+        }
+    }
+
+    // Blocks that only cover dropped lines are not needed anymore.
+    for (auto& sketch_pair : this->lf_field_sketches) {
+        auto& blocks = sketch_pair.second;
+
+        blocks.erase(
+            blocks.begin(),
+            blocks.upper_bound(first_tv.tv_sec - FIELD_SKETCH_BLOCK_SECS));
+    }
+
+    this->lf_next_line_cache = nonstd::nullopt;
+    this->lf_dropped_line_count += drop_count;
+
+    return true;
+}
+
 Result<shared_buffer_ref, std::string>
 logfile::read_line(logfile::iterator ll)
 {
@@ -1015,13 +1818,21 @@ logfile::adjust_content_time(int line, const timeval& tv, bool abs_offset)
     } else {
         timeradd(&old_time, &tv, &this->lf_time_offset);
     }
-    for (auto& iter : *this) {
+    auto adjust_line = [this, &old_time](logline& ll) {
         struct timeval curr, diff, new_time;
 
-        curr = iter.get_timeval();
+        curr = ll.get_timeval();
         timersub(&curr, &old_time, &diff);
         timeradd(&diff, &this->lf_time_offset, &new_time);
-        iter.set_time(new_time);
+        ll.set_time(new_time);
+    };
+    for (auto& iter : *this) {
+        adjust_line(iter);
+    }
+    if (this->lf_head_index) {
+        for (auto& iter : this->lf_head_index->his_index) {
+            adjust_line(iter);
+        }
     }
     this->lf_sort_needed = true;
 }
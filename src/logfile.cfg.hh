@@ -32,11 +32,20 @@
 #ifndef lnav_logfile_cfg_hh
 #define lnav_logfile_cfg_hh
 
+#include <chrono>
+
 namespace lnav {
 namespace logfile {
 
 struct config {
     uint64_t lc_max_unrecognized_lines{1000};
+    uint64_t lc_tail_first_min_size{256 * 1024 * 1024};
+    uint64_t lc_tail_first_size{16 * 1024 * 1024};
+    uint64_t lc_max_retained_lines{0};
+    uint64_t lc_max_retained_bytes{0};
+    std::chrono::seconds lc_max_retained_age{0};
+    uint64_t lc_max_open_files{0};
+    bool lc_collapse_repeats{false};
 };
 
 }  // namespace logfile
@@ -33,6 +33,7 @@
 #ifndef logfile_hh
 #define logfile_hh
 
+#include <algorithm>
 #include <set>
 #include <string>
 #include <utility>
@@ -134,6 +135,23 @@ public:
 
     int get_fd() const { return this->lf_line_buffer.get_fd(); }
 
+    /**
+     * @return A separate descriptor for reading the file.  If the file's
+     *   descriptor was released while idle, the file is reopened and checked
+     *   to make sure it has not been replaced.
+     */
+    Result<auto_fd, std::string> dup_fd()
+    {
+        return this->lf_line_buffer.dup_fd();
+    }
+
+    /**
+     * Close the descriptors of the least recently read files if more are
+     * open than allowed by the configuration.  This should be called once
+     * per poll cycle, after the files have been indexed.
+     */
+    static void release_idle_fds();
+
     /** @param filename The new filename for this log file. */
     void set_filename(const std::string& filename);
 
@@ -337,6 +355,128 @@ public:
 
     bool is_indexing() const { return this->lf_indexing; }
 
+    /**
+     * @return True if the end of the file was indexed first and the
+     * beginning of the file is still being indexed.
+     */
+    bool is_indexing_head() const { return this->lf_head_index.has_value(); }
+
+    /**
+     * @return The number of lines that were inserted in front of the
+     * existing lines by the last call to rebuild_index().  The line numbers
+     * of the lines that were already in the index are shifted by this
+     * amount.
+     */
+    size_t consume_spliced_line_count()
+    {
+        auto retval = this->lf_spliced_line_count;
+
+        this->lf_spliced_line_count = 0;
+        return retval;
+    }
+
+    /**
+     * @return The number of lines that were dropped from the front of the
+     * index by the last call to rebuild_index() to stay within the
+     * configured retention limits.  The line numbers of the remaining lines
+     * have been shifted down by this amount.
+     */
+    size_t consume_dropped_line_count()
+    {
+        auto retval = this->lf_dropped_line_count;
+
+        this->lf_dropped_line_count = 0;
+        return retval;
+    }
+
+    /**
+     * A run of consecutive, identical single-line messages.  Runs are only
+     * tracked when the /tuning/logfile/collapse-repeats option is enabled.
+     * Unless the run is expanded, only the first line in the run gets a row
+     * in the log view.
+     */
+    struct repeat_run {
+        /** The line number of the first message in the run. */
+        uint32_t rr_line;
+        /** The number of messages in the run, always at least two. */
+        uint32_t rr_count;
+        /** True if the messages in the run should be shown separately. */
+        bool rr_expanded{false};
+
+        uint32_t end_line() const { return this->rr_line + this->rr_count; }
+    };
+
+    bool has_repeats() const { return !this->lf_repeat_runs.empty(); }
+
+    /**
+     * @param line_number The line to look up.
+     * @return The run that contains the given line or nullptr if the line
+     * is not part of a run.
+     */
+    const repeat_run* find_repeat_run(uint32_t line_number) const;
+
+    /**
+     * @param line_number The line to check.
+     * @return True if the line is a message that is identical to the
+     * message on the line before it.
+     */
+    bool is_repeat(uint32_t line_number) const
+    {
+        const auto* run = this->find_repeat_run(line_number);
+
+        return run != nullptr && run->rr_line != line_number;
+    }
+
+    /**
+     * @param line_number The line to check.
+     * @return True if the line is a repeat that is folded into the row for
+     * the first message in its run.
+     */
+    bool is_collapsed(uint32_t line_number) const
+    {
+        const auto* run = this->find_repeat_run(line_number);
+
+        return run != nullptr && !run->rr_expanded
+            && run->rr_line != line_number;
+    }
+
+    /**
+     * @param line_number The line at the start of a row.
+     * @return The number of messages that are shown by the row.
+     */
+    uint32_t repeat_count(uint32_t line_number) const
+    {
+        const auto* run = this->find_repeat_run(line_number);
+
+        if (run == nullptr || run->rr_expanded || run->rr_line != line_number)
+        {
+            return 1;
+        }
+        return run->rr_count;
+    }
+
+    /**
+     * Switch the run containing the given line between being shown as a
+     * single row and a row per message.
+     *
+     * @return True if the line is part of a run.
+     */
+    bool toggle_repeat_run(uint32_t line_number);
+
+    /**
+     * @return The lowest line whose membership in a run changed after the
+     * line was first indexed, which happens when the last line in the file
+     * had to be read again or turned out to be part of a multi-line
+     * message.
+     */
+    nonstd::optional<uint32_t> consume_repeat_change()
+    {
+        auto retval = this->lf_repeat_change;
+
+        this->lf_repeat_change = nonstd::nullopt;
+        return retval;
+    }
+
     /** Check the invariants for this object. */
     bool invariant()
     {
@@ -362,6 +502,11 @@ public:
 
     safe_opid_map& get_opids() { return this->lf_opids; }
 
+    const field_sketch_map& get_field_sketches() const
+    {
+        return this->lf_field_sketches;
+    }
+
     void quiesce() { this->lf_line_buffer.quiesce(); }
 
     void enable_cache() { this->lf_line_buffer.enable_cache(); }
@@ -399,8 +544,85 @@ protected:
     void set_format_base_time(log_format* lf);
 
 private:
+    /**
+     * The state for indexing the head of a large file after the tail of the
+     * file has been indexed.
+     */
+    struct head_index_state {
+        std::vector<logline> his_index;
+        robin_hood::unordered_map<uint32_t, bookmark_metadata>
+            his_bookmark_metadata;
+        std::vector<pattern_for_lines> his_pattern_locks;
+        std::vector<repeat_run> his_repeat_runs;
+        /** The offset where indexing of the head should resume. */
+        file_off_t his_next_offset{0};
+        /** The offset of the first message in the tail. */
+        file_off_t his_end_offset{0};
+    };
+
     logfile(std::string filename, logfile_open_options& loo);
 
+    Result<shared_buffer_ref, std::string> read_index_line(
+        const line_info& li);
+
+    void apply_line_tags(const shared_buffer_ref& sbr);
+
+    /**
+     * The parts of a message that must match for it to be considered a
+     * repeat of the previous message.  The hash covers the whole message
+     * without the timestamp.
+     */
+    struct repeat_key {
+        log_level_t rk_level;
+        uint8_t rk_opid;
+        intern_string_t rk_pattern;
+        byte_array<2, uint64_t> rk_hash;
+
+        bool operator==(const repeat_key& other) const
+        {
+            return this->rk_level == other.rk_level
+                && this->rk_opid == other.rk_opid
+                && this->rk_pattern == other.rk_pattern
+                && this->rk_hash == other.rk_hash;
+        }
+    };
+
+    nonstd::optional<repeat_key> get_repeat_key(const_iterator ll);
+
+    /**
+     * Get the key for the line that was just scanned using the timestamp
+     * range reported by the format, which avoids having to annotate it.
+     */
+    nonstd::optional<repeat_key> get_repeat_key(
+        const_iterator ll,
+        const shared_buffer_ref& sbr,
+        const scan_batch_context& sbc);
+
+    void track_repeats(const shared_buffer_ref& sbr,
+                       const scan_batch_context& sbc);
+
+    void add_to_repeat_run(uint32_t line_number,
+                           const shared_buffer_ref& sbr,
+                           const scan_batch_context& sbc);
+
+    /** Drop the parts of runs that cover lines past the end of the index. */
+    void trim_repeat_runs();
+
+    void note_repeat_change(uint32_t line_number);
+
+    void merge_opids(const scan_batch_context& sbc);
+
+    void merge_field_sketches(const scan_batch_context& sbc);
+
+    bool start_tail_first(const struct stat& st);
+
+    rebuild_result_t index_head(
+        nonstd::optional<ui_clock::time_point> deadline);
+
+    void splice_head();
+
+    bool apply_retention();
+
     std::string lf_filename;
     logfile_open_options lf_options;
     logfile_activity lf_activity;
@@ -430,6 +652,8 @@ private:
     uint32_t lf_out_of_time_order_count{0};
     safe_notes lf_notes;
     safe_opid_map lf_opids;
+    field_sketch_map lf_field_sketches;
+    file_off_t lf_sketch_offset{0};
     size_t lf_watch_count{0};
     ArenaAlloc::Alloc<char> lf_allocator{64 * 1024};
     nonstd::optional<time_t> lf_cached_base_time;
@@ -441,6 +665,19 @@ private:
 
     std::vector<std::shared_ptr<format_tag_def>> lf_applicable_taggers;
     std::map<std::string, metadata> lf_embedded_metadata;
+    nonstd::optional<head_index_state> lf_head_index;
+    size_t lf_spliced_line_count{0};
+    size_t lf_dropped_line_count{0};
+    /** The runs of repeated messages, sorted by their first line. */
+    std::vector<repeat_run> lf_repeat_runs;
+    /** The key for the last message and the line it is on. */
+    nonstd::optional<std::pair<uint32_t, repeat_key>> lf_last_repeat_key;
+    /**
+     * The last line that was dropped so it could be read again and whether
+     * it was a repeat at the time.
+     */
+    nonstd::optional<std::pair<uint32_t, bool>> lf_reread_repeat;
+    nonstd::optional<uint32_t> lf_repeat_change;
 };
 
 class logline_observer {
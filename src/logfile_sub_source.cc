@@ -56,6 +56,7 @@
 const bookmark_type_t logfile_sub_source::BM_ERRORS("error");
 const bookmark_type_t logfile_sub_source::BM_WARNINGS("warning");
 const bookmark_type_t logfile_sub_source::BM_FILES("file");
+const bookmark_type_t logfile_sub_source::BM_SLOWDOWNS("slowdown");
 
 static int
 pretty_sql_callback(exec_context& ec, sqlite3_stmt* stmt)
@@ -343,6 +344,19 @@ logfile_sub_source::text_value_for_line(textview_curses& tc,
         auto relstr = humanize::time::duration::from_tv(diff_tv).to_string();
         value_out = fmt::format(FMT_STRING("{: >12}|{}"), relstr, value_out);
     }
+
+    auto count = this->repeat_count(vis_line_t(row));
+    if (count > 1) {
+        auto last_line = this->find_line(this->at(vis_line_t(row))
+                                         + content_line_t(count - 1));
+        auto span_tv
+            = last_line->get_timeval() - this->lss_token_line->get_timeval();
+
+        value_out.append(fmt::format(
+            FMT_STRING(" [repeated {} times over {}]"),
+            count,
+            humanize::time::duration::from_tv(span_tv).to_string()));
+    }
     this->lss_in_value_for_line = false;
 }
 
@@ -630,6 +644,20 @@ logfile_sub_source::rebuild_index(
     auto retval = rebuild_result::rr_no_change;
     nonstd::optional<struct timeval> lowest_tv = nonstd::nullopt;
     vis_line_t search_start = 0_vl;
+    nonstd::optional<content_line_t> top_content_line;
+    bool restore_top = false;
+    bool reordered = false;
+    bool reindexed = false;
+    // Files whose lines need to be removed from the index and files whose
+    // sorted run of lines needs to be merged into the index.
+    std::vector<bool> removed_files(this->lss_files.size());
+    std::vector<bool> merged_files(this->lss_files.size());
+
+    if (!this->lss_filtered_index.empty()
+        && this->tss_view->get_top() < vis_line_t(this->text_line_count()))
+    {
+        top_content_line = this->at(this->tss_view->get_top());
+    }
 
     this->lss_force_rebuild = false;
     if (force) {
@@ -668,10 +696,9 @@ logfile_sub_source::rebuild_index(
 
         if (lf == nullptr) {
             if (ld.ld_lines_indexed > 0) {
-                log_debug("%d: file closed, doing full rebuild",
+                log_debug("%d: file closed, removing from index",
                           ld.ld_file_index);
-                force = true;
-                retval = rebuild_result::rr_full_rebuild;
+                removed_files[file_index] = true;
             }
         } else {
             if (time_left && deadline && ui_clock::now() > deadline.value()) {
@@ -681,7 +708,35 @@ logfile_sub_source::rebuild_index(
             }
 
             if (!this->tss_view->is_paused() && time_left) {
-                switch (lf->rebuild_index(deadline)) {
+                auto rebuild_res = lf->rebuild_index(deadline);
+
+                if (rebuild_res == logfile::rebuild_result_t::NO_NEW_LINES
+                    && ld.ld_lines_indexed < lf->size())
+                {
+                    // The file was indexed before it was added to this
+                    // source, so its lines were never reported as new.
+                    rebuild_res = logfile::rebuild_result_t::NEW_LINES;
+                }
+
+                auto repeat_change = lf->consume_repeat_change();
+                if (repeat_change && repeat_change.value() < ld.ld_lines_indexed
+                    && rebuild_res == logfile::rebuild_result_t::NEW_LINES
+                    && retval <= rebuild_result::rr_partial_rebuild)
+                {
+                    // A line that was already indexed was folded into or
+                    // taken out of a run of repeats, so reindex from there.
+                    auto change_tv
+                        = (*lf)[repeat_change.value()].get_timeval();
+
+                    log_debug("%s:%u: repeat changed, partial rebuild",
+                              lf->get_filename().c_str(),
+                              repeat_change.value());
+                    retval = rebuild_result::rr_partial_rebuild;
+                    if (!lowest_tv || change_tv < lowest_tv.value()) {
+                        lowest_tv = change_tv;
+                    }
+                }
+                switch (rebuild_res) {
                     case logfile::rebuild_result_t::NO_NEW_LINES:
                         // No changes
                         break;
@@ -701,9 +756,17 @@ logfile_sub_source::rebuild_index(
 
                             // If there are new lines that are older than what
                             // we have in the index, we need to resort.
-                            if (last_indexed_line == nullptr
-                                || new_file_line
+                            if (ld.ld_lines_indexed == 0
+                                && last_indexed_line != nullptr
+                                && new_file_line
                                     < last_indexed_line->get_timeval())
+                            {
+                                log_debug("%s: merging new file into index",
+                                          lf->get_filename().c_str());
+                                merged_files[file_index] = true;
+                            } else if (last_indexed_line == nullptr
+                                       || new_file_line
+                                           < last_indexed_line->get_timeval())
                             {
                                 log_debug(
                                     "%s:%ld: found older lines, full "
@@ -732,13 +795,33 @@ logfile_sub_source::rebuild_index(
                         }
                         break;
                     case logfile::rebuild_result_t::INVALID:
-                    case logfile::rebuild_result_t::NEW_ORDER:
-                        log_debug("%s: log file has a new order, full rebuild",
+                        log_debug("%s: log file is invalid, full rebuild",
                                   lf->get_filename().c_str());
                         retval = rebuild_result::rr_full_rebuild;
                         force = true;
                         full_sort = true;
                         break;
+                    case logfile::rebuild_result_t::NEW_ORDER: {
+                        log_debug("%s: log file has a new order, re-merging",
+                                  lf->get_filename().c_str());
+                        reordered = true;
+                        removed_files[file_index] = true;
+                        merged_files[file_index] = true;
+
+                        auto spliced_count = lf->consume_spliced_line_count();
+                        if (spliced_count > 0) {
+                            this->shift_file_lines(
+                                ld, spliced_count, top_content_line);
+                            restore_top = true;
+                        }
+                        auto dropped_count = lf->consume_dropped_line_count();
+                        if (dropped_count > 0) {
+                            this->drop_file_lines(
+                                ld, dropped_count, top_content_line);
+                            restore_top = true;
+                        }
+                        break;
+                    }
                 }
             }
             file_count += 1;
@@ -750,13 +833,45 @@ logfile_sub_source::rebuild_index(
         return rebuild_result::rr_appended_lines;
     }
 
-    if (this->lss_index.reserve(total_lines)) {
-        force = true;
-        retval = rebuild_result::rr_full_rebuild;
-    }
+    this->lss_index.reserve(total_lines);
 
     auto& vis_bm = this->tss_view->get_bookmarks();
 
+    auto has_removed = std::find(removed_files.begin(), removed_files.end(), true)
+        != removed_files.end();
+    auto has_merged = std::find(merged_files.begin(), merged_files.end(), true)
+        != merged_files.end();
+    if (this->lss_index.empty() || (force && (has_removed || has_merged))) {
+        if (has_removed || has_merged) {
+            log_debug("unable to update index incrementally, full rebuild");
+            force = true;
+            retval = rebuild_result::rr_full_rebuild;
+        }
+        if (reordered) {
+            full_sort = true;
+        }
+    } else if (has_removed || has_merged) {
+        // Update the existing index in place instead of starting over, so
+        // that files coming and going do not require a full sort.
+        if (has_removed) {
+            this->remove_files_from_index(removed_files);
+        }
+        for (auto& ld : this->lss_files) {
+            if (!merged_files[ld->ld_file_index]) {
+                continue;
+            }
+            this->merge_file_into_index(*ld);
+        }
+        this->reindex_merged_lines(merged_files);
+        this->lss_longest_line = 0;
+        this->lss_basename_width = 0;
+        this->lss_filename_width = 0;
+        reindexed = true;
+    }
+
+    // True if the lines for all of the existing rows were just passed to
+    // the index delegate.
+    auto recounted_rows = false;
     if (force) {
         for (iter = this->lss_files.begin(); iter != this->lss_files.end();
              iter++)
@@ -825,22 +940,27 @@ logfile_sub_source::rebuild_index(
 
         if (this->lss_index_delegate) {
             this->lss_index_delegate->index_start(*this);
-            for (const auto row_in_full_index : this->lss_filtered_index) {
-                auto cl = this->lss_index[row_in_full_index];
+            for (auto row = 0_vl;
+                 row < vis_line_t(this->lss_filtered_index.size());
+                 row += 1_vl)
+            {
+                auto cl = this->at(row);
                 uint64_t line_number;
                 auto ld_iter = this->find_data(cl, line_number);
                 auto& ld = *ld_iter;
                 auto line_iter = ld->get_file_ptr()->begin() + line_number;
 
-                this->lss_index_delegate->index_line(
-                    *this, ld->get_file_ptr(), line_iter);
+                this->index_row_lines(ld->get_file_ptr(), line_iter);
             }
+            recounted_rows = true;
         }
     }
 
-    if (retval != rebuild_result::rr_no_change || force) {
+    if (retval != rebuild_result::rr_no_change || force || reindexed) {
         size_t index_size = 0, start_size = this->lss_index.size();
         logline_cmp line_cmper(*this);
+        // Repeats that were added to rows that were indexed earlier.
+        std::vector<std::pair<logfile_data*, uint32_t>> late_repeats;
 
         for (auto& ld : this->lss_files) {
             auto* lf = ld->get_file_ptr();
@@ -867,7 +987,9 @@ logfile_sub_source::rebuild_index(
                 for (size_t line_index = 0; line_index < lf->size();
                      line_index++)
                 {
-                    if ((*lf)[line_index].is_ignored()) {
+                    if ((*lf)[line_index].is_ignored()
+                        || (lf->has_repeats() && lf->is_collapsed(line_index)))
+                    {
                         continue;
                     }
 
@@ -919,9 +1041,19 @@ logfile_sub_source::rebuild_index(
                     break;
                 }
 
-                if (!lf_iter->is_ignored()) {
+                auto* lf = ld->get_file_ptr();
+                int line_index = lf_iter - lf->begin();
+
+                if (lf->has_repeats() && lf->is_collapsed(line_index)) {
+                    // The line is shown by the row for the first message in
+                    // the run, so it does not get its own entry.
+                    const auto* run = lf->find_repeat_run(line_index);
+
+                    if (run->rr_line < ld->ld_lines_indexed) {
+                        late_repeats.emplace_back(ld, line_index);
+                    }
+                } else if (!lf_iter->is_ignored()) {
                     int file_index = ld->ld_file_index;
-                    int line_index = lf_iter - ld->get_file_ptr()->begin();
 
                     content_line_t con_line(file_index * MAX_LINES_PER_FILE
                                             + line_index);
@@ -1016,8 +1148,23 @@ logfile_sub_source::rebuild_index(
                 }
                 this->lss_filtered_index.push_back(index_index);
                 if (this->lss_index_delegate != nullptr) {
+                    this->index_row_lines(lf, lf->begin() + line_number);
+                }
+            }
+        }
+
+        if (this->lss_index_delegate != nullptr && !recounted_rows) {
+            for (const auto& late_pair : late_repeats) {
+                auto* ld = late_pair.first;
+                auto* lf = ld->get_file_ptr();
+                const auto* run = lf->find_repeat_run(late_pair.second);
+                content_line_t first_cl(ld->ld_file_index * MAX_LINES_PER_FILE
+                                        + run->rr_line);
+                auto row_opt = this->find_from_content(first_cl);
+
+                if (row_opt && this->at(row_opt.value()) == first_cl) {
                     this->lss_index_delegate->index_line(
-                        *this, lf, lf->begin() + line_number);
+                        *this, lf, lf->begin() + late_pair.second);
                 }
             }
         }
@@ -1027,6 +1174,16 @@ logfile_sub_source::rebuild_index(
         }
     }
 
+    if (restore_top && top_content_line) {
+        // Keep the view on the same line after the index was shuffled.
+        this->find_from_content(top_content_line.value()) |
+            [this](auto new_top) { this->tss_view->set_top(new_top); };
+    }
+
+    if (reindexed) {
+        retval = rebuild_result::rr_full_rebuild;
+    }
+
     switch (retval) {
         case rebuild_result::rr_no_change:
             break;
@@ -1052,11 +1209,13 @@ void
 logfile_sub_source::text_update_marks(vis_bookmarks& bm)
 {
     std::shared_ptr<logfile> last_file;
+    log_accel::window accel;
     vis_line_t vl;
 
     bm[&BM_WARNINGS].clear();
     bm[&BM_ERRORS].clear();
     bm[&BM_FILES].clear();
+    bm[&BM_SLOWDOWNS].clear();
 
     for (auto& lss_user_mark : this->lss_user_marks) {
         bm[lss_user_mark.first].clear();
@@ -1088,6 +1247,11 @@ logfile_sub_source::text_update_marks(vis_bookmarks& bm)
 
         auto line_iter = lf->begin() + cl;
         if (line_iter->is_message()) {
+            accel.add_point(line_iter->get_time_in_millis());
+            if (accel.get_direction() == log_accel::A_DECEL) {
+                bm[&BM_SLOWDOWNS].insert_once(vl);
+            }
+
             switch (line_iter->get_msg_level()) {
                 case LEVEL_WARNING:
                     bm[&BM_WARNINGS].insert_once(vl);
@@ -1132,7 +1296,17 @@ logfile_sub_source::get_line_accel_direction(vis_line_t vl)
 }
 
 void
-logfile_sub_source::text_filters_changed()
+logfile_sub_source::text_clear_deleted_filter_state()
+{
+    for (auto& ld : *this) {
+        if (ld->get_file_ptr() != nullptr) {
+            ld->ld_filter_state.clear_deleted_filter_state();
+        }
+    }
+}
+
+void
+logfile_sub_source::text_refilter()
 {
     this->lss_index_generation += 1;
 
@@ -1198,7 +1372,7 @@ logfile_sub_source::text_filters_changed()
             }
             this->lss_filtered_index.push_back(index_index);
             if (this->lss_index_delegate != nullptr) {
-                this->lss_index_delegate->index_line(*this, lf, line_iter);
+                this->index_row_lines(lf, line_iter);
             }
         }
     }
@@ -1269,9 +1443,13 @@ logfile_sub_source::insert_file(const std::shared_ptr<logfile>& lf)
         ld->set_visibility(lf->get_open_options().loo_is_visible);
         this->lss_files.push_back(std::move(ld));
     } else {
+        if ((*existing)->ld_lines_indexed > 0) {
+            // The lines from the previous file in this slot have not been
+            // removed from the index yet.
+            this->lss_force_rebuild = true;
+        }
         (*existing)->set_file(lf);
     }
-    this->lss_force_rebuild = true;
 
     return true;
 }
@@ -1370,8 +1548,7 @@ logfile_sub_source::set_sql_marker(std::string stmt_str, sqlite3_stmt* stmt)
             }
         }
         if (this->lss_index_delegate) {
-            this->lss_index_delegate->index_line(
-                *this, (*ld)->get_file_ptr(), ll);
+            this->index_row_lines((*ld)->get_file_ptr(), ll);
         }
     }
     if (this->lss_index_delegate) {
@@ -1744,11 +1921,301 @@ logfile_sub_source::remove_file(std::shared_ptr<logfile> lf)
                 bv.erase(file_range.first, file_range.second);
             }
         }
+    }
+}
+
+void
+logfile_sub_source::remove_files_from_index(
+    const std::vector<bool>& removed_files)
+{
+    auto filt_iter = this->lss_filtered_index.begin();
+    auto filt_out = filt_iter;
+    size_t write_index = 0;
+
+    for (size_t read_index = 0; read_index < this->lss_index.size();
+         read_index++)
+    {
+        content_line_t cl = this->lss_index[read_index];
+        auto is_filtered = filt_iter != this->lss_filtered_index.end()
+            && *filt_iter == read_index;
+
+        if (is_filtered) {
+            ++filt_iter;
+        }
+        if (removed_files[(uint64_t) cl / MAX_LINES_PER_FILE]) {
+            continue;
+        }
+        if (is_filtered) {
+            *filt_out = write_index;
+            ++filt_out;
+        }
+        this->lss_index[write_index] = this->lss_index[read_index];
+        write_index += 1;
+    }
+
+    log_debug("removed %zu lines from the index",
+              this->lss_index.size() - write_index);
+    this->lss_index.shrink_to(write_index);
+    this->lss_filtered_index.erase(filt_out, this->lss_filtered_index.end());
 
-        this->lss_force_rebuild = true;
+    for (auto& ld : this->lss_files) {
+        if (removed_files[ld->ld_file_index]) {
+            ld->ld_lines_indexed = 0;
+        }
     }
 }
 
+void
+logfile_sub_source::merge_file_into_index(logfile_data& ld)
+{
+    auto* lf = ld.get_file_ptr();
+    size_t run_size = 0;
+
+    for (size_t line_index = 0; line_index < lf->size(); line_index++) {
+        if (!(*lf)[line_index].is_ignored()
+            && !(lf->has_repeats() && lf->is_collapsed(line_index)))
+        {
+            run_size += 1;
+        }
+    }
+
+    auto old_size = this->lss_index.size();
+
+    log_debug("%d: merging %zu lines into index of %zu lines",
+              ld.ld_file_index,
+              run_size,
+              old_size);
+    this->lss_index.reserve(old_size + run_size);
+    this->lss_index.ba_size = old_size + run_size;
+
+    // Merge from the back so that it can be done in place.
+    auto file_base = content_line_t(ld.ld_file_index * MAX_LINES_PER_FILE);
+    auto old_index = (ssize_t) old_size - 1;
+    auto line_index = (ssize_t) lf->size() - 1;
+    auto out_index = (ssize_t) this->lss_index.size() - 1;
+
+    while (line_index >= 0) {
+        auto& ll = (*lf)[line_index];
+
+        if (ll.is_ignored()
+            || (lf->has_repeats() && lf->is_collapsed(line_index)))
+        {
+            line_index -= 1;
+            continue;
+        }
+
+        if (old_index >= 0) {
+            auto* old_ll = this->find_line(this->lss_index[old_index]);
+
+            if (ll < *old_ll) {
+                this->lss_index[out_index] = this->lss_index[old_index];
+                out_index -= 1;
+                old_index -= 1;
+                continue;
+            }
+        }
+
+        this->lss_index[out_index] = file_base + content_line_t(line_index);
+        out_index -= 1;
+        line_index -= 1;
+    }
+
+    ld.ld_lines_indexed = lf->size();
+}
+
+void
+logfile_sub_source::reindex_merged_lines(const std::vector<bool>& merged_files)
+{
+    auto& vis_bm = this->tss_view->get_bookmarks();
+    auto& expr_marks_bv = vis_bm[&textview_curses::BM_USER_EXPR];
+    uint32_t filter_in_mask, filter_out_mask;
+    std::vector<uint32_t> new_filtered_index;
+    auto filt_iter = this->lss_filtered_index.cbegin();
+    size_t old_index = 0;
+
+    this->get_filters().get_enabled_mask(filter_in_mask, filter_out_mask);
+    new_filtered_index.reserve(this->lss_index.size());
+    expr_marks_bv.clear();
+    if (this->lss_index_delegate != nullptr) {
+        this->lss_index_delegate->index_start(*this);
+    }
+
+    for (size_t index_index = 0; index_index < this->lss_index.size();
+         index_index++)
+    {
+        content_line_t cl = (content_line_t) this->lss_index[index_index];
+        uint64_t line_number;
+        auto ld = this->find_data(cl, line_number);
+        auto* lf = (*ld)->get_file_ptr();
+        auto line_iter = lf->begin() + line_number;
+
+        if (!merged_files[(*ld)->ld_file_index]) {
+            // The filter state for lines that were already in the index is
+            // unchanged, so just carry it over.
+            auto is_filtered = filt_iter != this->lss_filtered_index.cend()
+                && *filt_iter == old_index;
+
+            old_index += 1;
+            if (!is_filtered) {
+                continue;
+            }
+            ++filt_iter;
+        } else {
+            if (line_iter->is_marked()) {
+                auto start_iter = line_iter;
+                while (start_iter->is_continued()) {
+                    --start_iter;
+                }
+                content_line_t start_con_line(
+                    (*ld)->ld_file_index * MAX_LINES_PER_FILE
+                    + (start_iter - lf->begin()));
+
+                this->lss_user_marks[&textview_curses::BM_META].insert_once(
+                    start_con_line);
+                line_iter->set_mark(false);
+            }
+
+            if (!(*ld)->is_visible()) {
+                continue;
+            }
+            if (this->tss_apply_filters
+                && ((*ld)->ld_filter_state.excluded(
+                        filter_in_mask, filter_out_mask, line_number)
+                    || !this->check_extra_filters(ld, line_iter)))
+            {
+                continue;
+            }
+
+            auto eval_res = this->eval_sql_filter(
+                this->lss_marker_stmt.in(), ld, line_iter);
+            line_iter->set_expr_mark(eval_res.isOk() && eval_res.unwrap());
+        }
+
+        if (line_iter->is_expr_marked()) {
+            expr_marks_bv.insert_once(vis_line_t(new_filtered_index.size()));
+        }
+        new_filtered_index.push_back(index_index);
+        if (this->lss_index_delegate != nullptr) {
+            this->index_row_lines(lf, line_iter);
+        }
+    }
+
+    this->lss_filtered_index = std::move(new_filtered_index);
+}
+
+void
+logfile_sub_source::index_row_lines(logfile* lf, logfile::iterator ll)
+{
+    auto count = lf->has_repeats()
+        ? lf->repeat_count(std::distance(lf->begin(), ll))
+        : 1;
+
+    for (uint32_t lpc = 0; lpc < count; lpc++) {
+        this->lss_index_delegate->index_line(*this, lf, ll + lpc);
+    }
+}
+
+bool
+logfile_sub_source::toggle_repeats(vis_line_t vl)
+{
+    content_line_t line = this->at(vl);
+    auto* lf = this->find_file_ptr(line);
+
+    if (lf == nullptr || !lf->toggle_repeat_run(line)) {
+        return false;
+    }
+
+    this->lss_force_rebuild = true;
+    return true;
+}
+
+void
+logfile_sub_source::shift_file_lines(logfile_data& ld,
+                                     size_t count,
+                                     nonstd::optional<content_line_t>& cl)
+{
+    auto file_start = content_line_t(ld.ld_file_index * MAX_LINES_PER_FILE);
+    auto file_end
+        = content_line_t((ld.ld_file_index + 1) * MAX_LINES_PER_FILE - 1);
+
+    log_debug("%d: shifting file lines by %zu", ld.ld_file_index, count);
+    for (auto& mark_pair : this->lss_user_marks) {
+        auto& bv = mark_pair.second;
+        auto file_range = bv.equal_range(file_start, file_end);
+
+        for (auto iter = file_range.first; iter != file_range.second; ++iter) {
+            *iter += content_line_t(count);
+        }
+    }
+    if (cl && file_start <= cl.value() && cl.value() <= file_end) {
+        cl.value() += content_line_t(count);
+    }
+
+    auto* lf = ld.get_file_ptr();
+    for (auto lf_iter = lf->begin(); lf_iter != lf->begin() + count; ++lf_iter)
+    {
+        if (!lf_iter->is_marked()) {
+            continue;
+        }
+
+        auto start_iter = lf_iter;
+        while (start_iter->is_continued()) {
+            --start_iter;
+        }
+        content_line_t start_con_line(
+            file_start + std::distance(lf->begin(), start_iter));
+
+        this->lss_user_marks[&textview_curses::BM_META].insert_once(
+            start_con_line);
+        lf_iter->set_mark(false);
+    }
+
+    // The filter state is indexed by line number, so it has to be redone.
+    auto& lfs = ld.ld_filter_state.lfo_filter_state;
+    for (int lpc = 0; lpc < logfile_filter_state::MAX_FILTERS; lpc++) {
+        lfs.clear_filter_state(lpc);
+    }
+    lfs.tfs_mask.clear();
+    if (ld.ld_filter_state.lfo_filter_stack.empty()) {
+        lfs.resize(lf->size());
+    } else {
+        lf->reobserve_from(lf->begin());
+    }
+}
+
+void
+logfile_sub_source::drop_file_lines(logfile_data& ld,
+                                    size_t count,
+                                    nonstd::optional<content_line_t>& cl)
+{
+    auto file_start = content_line_t(ld.ld_file_index * MAX_LINES_PER_FILE);
+    auto file_end
+        = content_line_t((ld.ld_file_index + 1) * MAX_LINES_PER_FILE - 1);
+    auto drop_end = content_line_t(file_start + count);
+
+    log_debug("%d: dropping %zu file lines", ld.ld_file_index, count);
+    for (auto& mark_pair : this->lss_user_marks) {
+        auto& bv = mark_pair.second;
+        auto file_range = bv.equal_range(file_start, file_end);
+        auto keep_iter = std::lower_bound(
+            file_range.first, file_range.second, drop_end);
+
+        for (auto iter = keep_iter; iter != file_range.second; ++iter) {
+            *iter -= content_line_t(count);
+        }
+        bv.erase(file_range.first, keep_iter);
+    }
+    if (cl && file_start <= cl.value() && cl.value() <= file_end) {
+        if (cl.value() < drop_end) {
+            cl = file_start;
+        } else {
+            cl.value() -= content_line_t(count);
+        }
+    }
+
+    ld.ld_filter_state.lfo_filter_state.drop_lines(count);
+}
+
 nonstd::optional<vis_line_t>
 logfile_sub_source::find_from_content(content_line_t cl)
 {
@@ -1766,10 +2233,19 @@ logfile_sub_source::find_from_content(content_line_t cl)
 
         auto vis_start = *vis_start_opt;
 
+        if (lf->has_repeats() && lf->is_collapsed(line)) {
+            // The line is shown by the row for the first message in its run.
+            auto first_line = lf->find_repeat_run(line)->rr_line;
+
+            cl = cl - content_line_t(line - first_line);
+            ll_iter = lf->begin() + first_line;
+            vis_start = this->find_from_time(ll_iter->get_timeval())
+                            .value_or(vis_start);
+        }
         while (vis_start < vis_line_t(this->text_line_count())) {
             content_line_t guess_cl = this->at(vis_start);
 
-            if (cl == guess_cl) {
+            if (guess_cl == cl) {
                 return vis_start;
             }
 
@@ -1794,14 +2270,15 @@ logfile_sub_source::reload_index_delegate()
     }
 
     this->lss_index_delegate->index_start(*this);
-    for (unsigned int index : this->lss_filtered_index) {
-        content_line_t cl = (content_line_t) this->lss_index[index];
+    for (auto row = 0_vl; row < vis_line_t(this->lss_filtered_index.size());
+         row += 1_vl)
+    {
+        content_line_t cl = this->at(row);
         uint64_t line_number;
         auto ld = this->find_data(cl, line_number);
         std::shared_ptr<logfile> lf = (*ld)->get_file();
 
-        this->lss_index_delegate->index_line(
-            *this, lf.get(), lf->begin() + line_number);
+        this->index_row_lines(lf.get(), lf->begin() + line_number);
     }
     this->lss_index_delegate->index_complete(*this);
 }
@@ -41,6 +41,7 @@
 
 #include <limits.h>
 
+#include "base/aho_corasick.hh"
 #include "base/lnav.console.hh"
 #include "base/lnav_log.hh"
 #include "base/time_util.hh"
@@ -113,6 +114,40 @@ protected:
     std::shared_ptr<lnav::pcre2pp::code> pf_pcre;
 };
 
+/**
+ * A filter that matches lines containing any one of a set of literal
+ * strings, like request IDs or addresses, that were loaded from a file or
+ * the results of an SQL query.
+ */
+class literal_set_filter : public text_filter {
+public:
+    literal_set_filter(type_t type,
+                       const std::string& id,
+                       size_t index,
+                       lnav::aho_corasick matcher)
+        : text_filter(type, filter_lang_t::SET, id, index),
+          lsf_matcher(std::move(matcher))
+    {
+    }
+
+    bool matches(const logfile& lf,
+                 logfile::const_iterator ll,
+                 shared_buffer_ref& line) override
+    {
+        return this->lsf_matcher.find_in(line.to_string_fragment());
+    }
+
+    std::string to_command() const override
+    {
+        return (this->lf_type == text_filter::INCLUDE ? "filter-in-set "
+                                                      : "filter-out-set ")
+            + this->lf_id;
+    }
+
+protected:
+    lnav::aho_corasick lsf_matcher;
+};
+
 class sql_filter : public text_filter {
 public:
     sql_filter(logfile_sub_source& lss,
@@ -245,8 +280,7 @@ public:
     const static bookmark_type_t BM_ERRORS;
     const static bookmark_type_t BM_WARNINGS;
     const static bookmark_type_t BM_FILES;
-
-    virtual void text_filters_changed();
+    const static bookmark_type_t BM_SLOWDOWNS;
 
     logfile_sub_source();
 
@@ -636,6 +670,32 @@ public:
         return this->lss_index[this->lss_filtered_index[vl]];
     }
 
+    /**
+     * @param vl The row to check.
+     * @return The number of consecutive, identical messages that were
+     * collapsed into the given row.  Rows are only collapsed when the
+     * /tuning/logfile/collapse-repeats option is enabled.
+     */
+    uint32_t repeat_count(vis_line_t vl) const
+    {
+        content_line_t line = this->at(vl);
+        auto* lf = this->lss_files[line / MAX_LINES_PER_FILE]->get_file_ptr();
+
+        if (lf == nullptr || !lf->has_repeats()) {
+            return 1;
+        }
+        return lf->repeat_count(line % MAX_LINES_PER_FILE);
+    }
+
+    /**
+     * Expand the run of repeated messages shown by the given row or, if the
+     * row is part of an expanded run, collapse the run again.
+     *
+     * @param vl The row to toggle.
+     * @return True if the row was part of a run of repeated messages.
+     */
+    bool toggle_repeats(vis_line_t vl);
+
     content_line_t at_base(vis_line_t vl)
     {
         while (this->find_line(this->at(vl))->get_sub_offset() != 0) {
@@ -834,6 +894,11 @@ public:
 
     void quiesce();
 
+protected:
+    void text_refilter() override;
+
+    void text_clear_deleted_filter_state() override;
+
 private:
     static const size_t LINE_SIZE_CACHE_SIZE = 512;
 
@@ -971,6 +1036,62 @@ private:
 
     bool check_extra_filters(iterator ld, logfile::iterator ll);
 
+    /**
+     * Update the marks and filter state for a file after lines were inserted
+     * in front of the lines that were already indexed.
+     *
+     * @param ld The file that had lines inserted.
+     * @param count The number of lines that were inserted.
+     * @param cl A content line to update if it is in the file.
+     */
+    void shift_file_lines(logfile_data& ld,
+                          size_t count,
+                          nonstd::optional<content_line_t>& cl);
+
+    /**
+     * Remove the lines for the given files from the index in a single pass
+     * and update the filtered index to match.
+     *
+     * @param removed_files Flags, by file index, for the files to remove.
+     */
+    void remove_files_from_index(const std::vector<bool>& removed_files);
+
+    /**
+     * Merge all of the lines from a file into the index.  The file's lines
+     * must not already be in the index.
+     *
+     * @param ld The file to merge.
+     */
+    void merge_file_into_index(logfile_data& ld);
+
+    /**
+     * Rebuild the filtered index, expression marks, and index delegate
+     * after files were merged into or removed from the index.  The filter
+     * state is only evaluated for lines from the merged files, the state
+     * for other lines is carried over from the current filtered index.
+     *
+     * @param merged_files Flags, by file index, for the merged files.
+     */
+    void reindex_merged_lines(const std::vector<bool>& merged_files);
+
+    /**
+     * Update the marks and filter state for a file after lines were dropped
+     * from the front of the file's index.
+     *
+     * @param ld The file that had lines dropped.
+     * @param count The number of lines that were dropped.
+     * @param cl A content line to update if it is in the file.
+     */
+    void drop_file_lines(logfile_data& ld,
+                         size_t count,
+                         nonstd::optional<content_line_t>& cl);
+
+    /**
+     * Pass the line for a row, and any repeats collapsed into it, to the
+     * index delegate.
+     */
+    void index_row_lines(logfile* lf, logfile::iterator ll);
+
     size_t lss_basename_width = 0;
     size_t lss_filename_width = 0;
     unsigned long lss_flags{0};
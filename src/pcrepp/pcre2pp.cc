@@ -69,6 +69,21 @@ capture_builder::into(lnav::pcre2pp::match_data& md) &&
     };
 }
 
+void
+match_data::reset_for(const code& co, string_fragment in)
+{
+    if (this->md_ovector_count < co.get_match_data_capacity()) {
+        *this = co.create_match_data();
+    }
+
+    this->md_code = &co;
+    this->md_input = input{in};
+    this->md_capture_end = 0;
+    for (uint32_t lpc = 0; lpc < this->md_ovector_count * 2; lpc++) {
+        this->md_ovector[lpc] = PCRE2_UNSET;
+    }
+}
+
 match_data
 code::create_match_data() const
 {
@@ -144,6 +159,90 @@ code::match_partial(string_fragment in) const
     return 0;
 }
 
+std::bitset<256>
+code::get_anchored_first_bytes() const
+{
+    std::bitset<256> retval;
+    uint32_t all_options = 0;
+    uint32_t arg_options = 0;
+
+    retval.set();
+    pcre2_pattern_info(this->p_code.in(), PCRE2_INFO_ALLOPTIONS, &all_options);
+    if (!(all_options & PCRE2_ANCHORED) || this->p_pattern.empty()
+        || this->p_pattern[0] != '^')
+    {
+        return retval;
+    }
+
+    // PCRE2 only computes the possible starting code units for patterns
+    // that are not anchored.  Since every match of the anchored pattern is
+    // also a match of the pattern without the leading '^', the first bytes
+    // of the latter are a superset of the former.
+    pcre2_pattern_info(this->p_code.in(), PCRE2_INFO_ARGOPTIONS, &arg_options);
+
+    auto unanchored_pat = string_fragment::from_str(this->p_pattern).substr(1);
+    int errcode;
+    PCRE2_SIZE erroffset;
+    auto_mem<pcre2_code> unanchored(pcre2_code_free);
+
+    unanchored = pcre2_compile(unanchored_pat.udata(),
+                               unanchored_pat.length(),
+                               arg_options,
+                               &errcode,
+                               &erroffset,
+                               nullptr);
+    if (unanchored == nullptr) {
+        return retval;
+    }
+
+    uint32_t first_code_type = 0;
+    pcre2_pattern_info(
+        unanchored.in(), PCRE2_INFO_FIRSTCODETYPE, &first_code_type);
+    if (first_code_type == 1) {
+        uint32_t first_code_unit = 0;
+
+        pcre2_pattern_info(
+            unanchored.in(), PCRE2_INFO_FIRSTCODEUNIT, &first_code_unit);
+        if (first_code_unit >= 0x80) {
+            // The case-folded version of a non-ASCII character might not
+            // share the same leading byte, so don't try to narrow it.
+            return retval;
+        }
+        retval.reset();
+        retval.set(first_code_unit);
+        // The first code unit might be case-insensitive.
+        if (isalpha(first_code_unit)) {
+            retval.set(first_code_unit ^ 0x20U);
+        }
+        return retval;
+    }
+
+    const uint8_t* first_bitmap = nullptr;
+    pcre2_pattern_info(unanchored.in(), PCRE2_INFO_FIRSTBITMAP, &first_bitmap);
+    if (first_bitmap == nullptr) {
+        return retval;
+    }
+
+    retval.reset();
+    for (size_t lpc = 0; lpc < retval.size(); lpc++) {
+        if (first_bitmap[lpc / 8] & (1U << (lpc % 8))) {
+            retval.set(lpc);
+        }
+    }
+
+    return retval;
+}
+
+size_t
+code::get_min_length() const
+{
+    uint32_t retval = 0;
+
+    pcre2_pattern_info(this->p_code.in(), PCRE2_INFO_MINLENGTH, &retval);
+
+    return retval;
+}
+
 const char*
 code::get_name_for_capture(size_t index) const
 {
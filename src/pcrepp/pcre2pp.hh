@@ -32,6 +32,7 @@
 
 #define PCRE2_CODE_UNIT_WIDTH 8
 
+#include <bitset>
 #include <memory>
 #include <string>
 #include <vector>
@@ -108,6 +109,34 @@ public:
 
     uint32_t get_capacity() const { return this->md_ovector_count; }
 
+    /**
+     * Clear the captures so they can be filled in by a hand-written parser
+     * that is equivalent to the given code.
+     *
+     * @param co The code whose captures are being filled in.
+     * @param in The string that was parsed.
+     */
+    void reset_for(const code& co, string_fragment in);
+
+    /**
+     * Set a capture to a fragment of the string passed to reset_for().
+     * Captures that are not set are treated as unmatched, like they would
+     * be after running the regex.
+     */
+    void set_capture(size_t index, string_fragment sf)
+    {
+        auto base = this->md_input.i_string.sf_begin;
+
+        this->md_ovector[index * 2] = sf.sf_begin - base;
+        this->md_ovector[(index * 2) + 1] = sf.sf_end - base;
+        if ((int) index >= this->md_capture_end) {
+            this->md_capture_end = index + 1;
+        }
+        if (index == 0) {
+            this->md_input.i_next_offset = sf.sf_end - base;
+        }
+    }
+
 private:
     friend matcher;
     friend code;
@@ -297,6 +326,22 @@ public:
 
     size_t match_partial(string_fragment in) const;
 
+    /**
+     * Compute the set of bytes that a subject must start with in order to
+     * be matched by this pattern.  The set can only be narrowed for
+     * patterns that are anchored with a leading '^'.
+     *
+     * @return The set of possible first bytes.  All bits are set when the
+     *   set could not be determined.
+     */
+    std::bitset<256> get_anchored_first_bytes() const;
+
+    /**
+     * @return The minimum length of a subject that can be matched by this
+     *   pattern, as computed by PCRE2.
+     */
+    size_t get_min_length() const;
+
     std::string replace(string_fragment str, const char* repl) const;
 
     std::shared_ptr<code> to_shared() &&
@@ -91,6 +91,50 @@ TEST_CASE("partial")
     CHECK(matched == 3);
 }
 
+TEST_CASE("anchored_first_bytes")
+{
+    {
+        auto co = lnav::pcre2pp::code::from_const(
+            R"(^(?<timestamp>\d{4}-\d{2}-\d{2}) (?<body>.*)$)");
+        auto first_bytes = co.get_anchored_first_bytes();
+
+        CHECK(first_bytes.count() == 10);
+        CHECK(first_bytes['0']);
+        CHECK(first_bytes['9']);
+        CHECK_FALSE(first_bytes['\t']);
+        CHECK(co.get_min_length() == 11);
+    }
+
+    {
+        auto co = lnav::pcre2pp::code::from_const(R"(^\[(?<level>\w+)\])");
+        auto first_bytes = co.get_anchored_first_bytes();
+
+        CHECK(first_bytes.count() == 1);
+        CHECK(first_bytes['[']);
+    }
+
+    {
+        auto co = lnav::pcre2pp::code::from_const(R"(^(?i)error)");
+        auto first_bytes = co.get_anchored_first_bytes();
+
+        CHECK(first_bytes.count() == 2);
+        CHECK(first_bytes['e']);
+        CHECK(first_bytes['E']);
+    }
+
+    {
+        auto co = lnav::pcre2pp::code::from_const(R"(^a|b)");
+
+        CHECK(co.get_anchored_first_bytes().all());
+    }
+
+    {
+        auto co = lnav::pcre2pp::code::from_const(R"(\d+)");
+
+        CHECK(co.get_anchored_first_bytes().all());
+    }
+}
+
 TEST_CASE("capture_name")
 {
     auto co = lnav::pcre2pp::code::from_const("(?<abc>def)(ghi)");
@@ -30,6 +30,8 @@
  */
 
 #include <algorithm>
+#include <atomic>
+#include <thread>
 #include <utility>
 
 #include "session_data.hh"
@@ -130,29 +132,114 @@ static const char* UPGRADE_STMTS[] = {
 static const size_t MAX_SESSIONS = 8;
 static const size_t MAX_SESSION_FILE_COUNT = 256;
 
-static std::vector<content_line_t> marked_session_lines;
-static std::vector<content_line_t> offset_session_lines;
+namespace {
 
-static bool
-bind_line(sqlite3* db,
-          sqlite3_stmt* stmt,
-          content_line_t cl,
-          time_t session_time)
-{
-    logfile_sub_source& lss = lnav_data.ld_log_source;
-    auto lf = lss.find(cl);
+/**
+ * The primary key of a line in the bookmarks and time_offset tables.
+ */
+struct line_key {
+    struct timeval lk_time;
+    intern_string_t lk_format;
+    std::string lk_hash;
+};
 
-    if (lf == nullptr) {
-        return false;
+struct mark_row {
+    line_key mr_key;
+    nonstd::optional<std::string> mr_part_name;
+    nonstd::optional<std::string> mr_comment;
+    nonstd::optional<std::string> mr_tags;
+
+    bool same_values(const mark_row& other) const
+    {
+        return this->mr_part_name == other.mr_part_name
+            && this->mr_comment == other.mr_comment
+            && this->mr_tags == other.mr_tags;
     }
+};
+
+struct offset_row {
+    line_key or_key;
+    int64_t or_sec;
+    int64_t or_usec;
+};
 
-    sqlite3_clear_bindings(stmt);
+/**
+ * A set of changes to the bookmark database that are written in a single
+ * transaction.  The batch is captured on the main thread so that the
+ * writer never has to touch the log files.
+ */
+struct bookmark_batch {
+    ghc::filesystem::path bb_db_path;
+    int64_t bb_session_time{0};
+    std::set<std::string> bb_netlocs;
+    std::vector<line_key> bb_deleted_marks;
+    std::vector<mark_row> bb_file_rows;
+    std::vector<mark_row> bb_marks;
+    std::vector<line_key> bb_deleted_offsets;
+    std::vector<offset_row> bb_offsets;
+    bool bb_expire{false};
+
+    bool empty() const
+    {
+        return this->bb_netlocs.empty() && this->bb_deleted_marks.empty()
+            && this->bb_file_rows.empty() && this->bb_marks.empty()
+            && this->bb_deleted_offsets.empty() && this->bb_offsets.empty()
+            && !this->bb_expire;
+    }
+};
 
+/**
+ * A bookmark as it was last written to the database for the current
+ * session.  The file pointer is kept to detect content lines that have
+ * been reused by a different file.
+ */
+struct saved_mark {
+    const logfile* sm_file;
+    mark_row sm_row;
+};
+
+/**
+ * Runs bookmark batches on a background thread, one at a time.
+ */
+class bookmark_writer {
+public:
+    ~bookmark_writer() { this->wait(); }
+
+    bool is_busy() const
+    {
+        return this->bw_thread.joinable() && !this->bw_done.load();
+    }
+
+    void wait()
+    {
+        if (this->bw_thread.joinable()) {
+            this->bw_thread.join();
+        }
+    }
+
+    void start(bookmark_batch batch);
+
+private:
+    std::thread bw_thread;
+    std::atomic<bool> bw_done{true};
+};
+
+}  // namespace
+
+static std::map<content_line_t, saved_mark> saved_marks;
+static time_t saved_marks_session_time = -1;
+static std::vector<line_key> loaded_session_marks;
+static std::vector<line_key> loaded_session_offsets;
+static bookmark_writer session_bookmark_writer;
+
+static nonstd::optional<line_key>
+key_for_line(const std::shared_ptr<logfile>& lf, content_line_t cl)
+{
     auto line_iter = lf->begin() + cl;
     auto read_result = lf->read_line(line_iter);
 
     if (read_result.isErr()) {
-        return false;
+        return nonstd::nullopt;
     }
 
     auto line_hash = read_result
@@ -164,12 +251,11 @@ bind_line(sqlite3* db,
                          })
                          .unwrap();
 
-    return bind_values(stmt,
-                       lf->original_line_time(line_iter),
-                       lf->get_format()->get_name(),
-                       line_hash,
-                       session_time)
-        == SQLITE_OK;
+    return line_key{
+        lf->original_line_time(line_iter),
+        lf->get_format()->get_name(),
+        line_hash,
+    };
 }
 
 struct session_file_info {
@@ -379,6 +465,8 @@ load_time_bookmarks()
     bool reload_needed = false;
     auto_mem<char, sqlite3_free> errmsg;
 
+    session_bookmark_writer.wait();
+
     log_info("loading bookmark db: %s", db_path.c_str());
 
     if (sqlite3_open(db_path.c_str(), db.out()) != SQLITE_OK) {
@@ -593,7 +681,11 @@ load_time_bookmarks()
                                 meta = true;
                             }
                             if (!meta) {
-                                marked_session_lines.push_back(line_cl);
+                                loaded_session_marks.emplace_back(line_key{
+                                    log_tv,
+                                    lf->get_format()->get_name(),
+                                    log_hash,
+                                });
                                 lss.set_user_mark(&textview_curses::BM_USER,
                                                   line_cl);
                             }
@@ -719,11 +811,13 @@ load_time_bookmarks()
                         if (lf->get_content_id() == log_hash) {
                             int file_line
                                 = std::distance(lf->begin(), line_iter);
-                            content_line_t line_cl
-                                = content_line_t(base_content_line + file_line);
                             struct timeval offset;
 
-                            offset_session_lines.push_back(line_cl);
+                            loaded_session_offsets.emplace_back(line_key{
+                                log_tv,
+                                lf->get_format()->get_name(),
+                                log_hash,
+                            });
                             offset.tv_sec = sqlite3_column_int64(stmt.in(), 4);
                             offset.tv_usec = sqlite3_column_int64(stmt.in(), 5);
                             lf->adjust_content_time(file_line, offset);
@@ -904,6 +998,8 @@ static const struct json_path_container view_info_handlers = {
 void
 load_session()
 {
+    text_sub_source::filter_batch fb;
+
     load_time_bookmarks();
     scan_sessions() | [](const auto pair) {
         yajl_handle handle;
@@ -966,6 +1062,7 @@ load_session()
         }
     };
 
+    text_sub_source::filter_batch::flush();
     lnav::events::publish(lnav_data.ld_db.in(),
                           lnav::events::session::loaded{});
 }
@@ -978,108 +1075,164 @@ yajl_writer(void* context, const char* str, size_t len)
     fwrite(str, len, 1, file);
 }
 
-static void
-save_user_bookmarks(sqlite3* db,
-                    sqlite3_stmt* stmt,
-                    bookmark_vector<content_line_t>& user_marks)
+static nonstd::optional<mark_row>
+mark_values_for_line(content_line_t cl)
 {
-    logfile_sub_source& lss = lnav_data.ld_log_source;
-    bookmark_vector<content_line_t>::iterator iter;
+    auto& lss = lnav_data.ld_log_source;
+    auto line_meta_opt = lss.find_bookmark_metadata(cl);
+    mark_row retval;
 
-    for (iter = user_marks.begin(); iter != user_marks.end(); ++iter) {
-        content_line_t cl = *iter;
-        auto line_meta_opt = lss.find_bookmark_metadata(cl);
-        if (!bind_line(db, stmt, cl, lnav_data.ld_session_time)) {
-            continue;
-        }
+    if (!line_meta_opt) {
+        retval.mr_part_name = std::string();
+        return retval;
+    }
 
-        if (!line_meta_opt) {
-            if (sqlite3_bind_text(stmt, 5, "", 0, SQLITE_TRANSIENT)
-                != SQLITE_OK)
-            {
-                log_error("could not bind log hash -- %s", sqlite3_errmsg(db));
-                return;
-            }
-        } else {
-            bookmark_metadata& line_meta = *(line_meta_opt.value());
-            if (line_meta.empty()) {
-                continue;
-            }
+    const auto& line_meta = *(line_meta_opt.value());
+    if (line_meta.empty()) {
+        return nonstd::nullopt;
+    }
 
-            if (sqlite3_bind_text(stmt,
-                                  5,
-                                  line_meta.bm_name.c_str(),
-                                  line_meta.bm_name.length(),
-                                  SQLITE_TRANSIENT)
-                != SQLITE_OK)
-            {
-                log_error("could not bind part name -- %s", sqlite3_errmsg(db));
-                return;
-            }
+    retval.mr_part_name = line_meta.bm_name;
+    retval.mr_comment = line_meta.bm_comment;
+    retval.mr_tags = std::string();
+    if (!line_meta.bm_tags.empty()) {
+        yajlpp_gen gen;
 
-            if (sqlite3_bind_text(stmt,
-                                  6,
-                                  line_meta.bm_comment.c_str(),
-                                  line_meta.bm_comment.length(),
-                                  SQLITE_TRANSIENT)
-                != SQLITE_OK)
-            {
-                log_error("could not bind comment -- %s", sqlite3_errmsg(db));
-                return;
+        yajl_gen_config(gen, yajl_gen_beautify, false);
+
+        {
+            yajlpp_array arr(gen);
+
+            for (const auto& str : line_meta.bm_tags) {
+                arr.gen(str);
             }
+        }
 
-            std::string tags;
+        retval.mr_tags = gen.to_string_fragment().to_string();
+    }
 
-            if (!line_meta.bm_tags.empty()) {
-                yajlpp_gen gen;
+    return retval;
+}
 
-                yajl_gen_config(gen, yajl_gen_beautify, false);
+/**
+ * Compare the current user and meta bookmarks against the ones that were
+ * last written for this session and add the difference to the batch.
+ * Lines that have not changed keep their previously computed key, so only
+ * new marks need to be read back from the file and hashed.
+ */
+static void
+capture_mark_changes(bookmark_batch& batch)
+{
+    auto& lss = lnav_data.ld_log_source;
+    auto& bm = lss.get_user_bookmarks();
+    const auto& user_marks = bm[&textview_curses::BM_USER];
+    const auto& meta_marks = bm[&textview_curses::BM_META];
+    std::vector<content_line_t> marks;
+
+    if (saved_marks_session_time != lnav_data.ld_session_time) {
+        saved_marks.clear();
+        saved_marks_session_time = lnav_data.ld_session_time;
+    }
 
-                {
-                    yajlpp_array arr(gen);
+    batch.bb_deleted_marks = std::move(loaded_session_marks);
+    loaded_session_marks.clear();
+
+    marks.reserve(user_marks.size() + meta_marks.size());
+    std::set_union(user_marks.begin(),
+                   user_marks.end(),
+                   meta_marks.begin(),
+                   meta_marks.end(),
+                   std::back_inserter(marks));
+
+    auto saved_iter = saved_marks.begin();
+    for (const auto& cl : marks) {
+        while (saved_iter != saved_marks.end() && saved_iter->first < cl) {
+            batch.bb_deleted_marks.emplace_back(
+                saved_iter->second.sm_row.mr_key);
+            saved_iter = saved_marks.erase(saved_iter);
+        }
 
-                    for (const auto& str : line_meta.bm_tags) {
-                        arr.gen(str);
-                    }
-                }
+        auto file_line = cl;
+        auto lf = lss.find(file_line);
+        nonstd::optional<mark_row> row_opt;
+        if (lf != nullptr) {
+            row_opt = mark_values_for_line(cl);
+        }
+        auto prev_iter = saved_marks.end();
 
-                tags = gen.to_string_fragment().to_string();
-            }
+        if (saved_iter != saved_marks.end() && saved_iter->first == cl) {
+            prev_iter = saved_iter;
+            ++saved_iter;
+        }
 
-            if (sqlite3_bind_text(
-                    stmt, 7, tags.c_str(), tags.length(), SQLITE_TRANSIENT)
-                != SQLITE_OK)
-            {
-                log_error("could not bind tags -- %s", sqlite3_errmsg(db));
-                return;
+        if (prev_iter != saved_marks.end()) {
+            auto& prev = prev_iter->second;
+
+            if (row_opt && prev.sm_file == lf.get()) {
+                if (prev.sm_row.same_values(row_opt.value())) {
+                    continue;
+                }
+                row_opt->mr_key = prev.sm_row.mr_key;
+                prev.sm_row = row_opt.value();
+                batch.bb_marks.emplace_back(row_opt.value());
+                continue;
             }
+
+            batch.bb_deleted_marks.emplace_back(prev.sm_row.mr_key);
+            saved_marks.erase(prev_iter);
         }
 
-        if (sqlite3_step(stmt) != SQLITE_DONE) {
-            log_error("could not execute bookmark insert statement -- %s",
-                      sqlite3_errmsg(db));
-            return;
+        if (!row_opt) {
+            continue;
+        }
+
+        auto key_opt = key_for_line(lf, file_line);
+        if (!key_opt) {
+            continue;
         }
 
-        marked_session_lines.push_back(cl);
+        row_opt->mr_key = std::move(key_opt.value());
+        saved_marks.emplace_hint(
+            saved_iter, cl, saved_mark{lf.get(), row_opt.value()});
+        batch.bb_marks.emplace_back(std::move(row_opt.value()));
+    }
+
+    for (; saved_iter != saved_marks.end();
+         saved_iter = saved_marks.erase(saved_iter))
+    {
+        batch.bb_deleted_marks.emplace_back(saved_iter->second.sm_row.mr_key);
+    }
+}
 
-        sqlite3_reset(stmt);
+static bool
+step_statement(sqlite3* db, sqlite3_stmt* stmt)
+{
+    if (sqlite3_step(stmt) != SQLITE_DONE) {
+        log_error("could not execute bookmark statement -- %s",
+                  sqlite3_errmsg(db));
+        return false;
     }
+
+    sqlite3_reset(stmt);
+    return true;
 }
 
 static void
-save_time_bookmarks()
+write_bookmark_batch(const bookmark_batch& batch)
 {
     auto_sqlite3 db;
-    auto db_path = lnav::paths::dotlnav() / LOG_METADATA_NAME;
     auto_mem<char, sqlite3_free> errmsg;
     auto_mem<sqlite3_stmt> stmt(sqlite3_finalize);
 
-    if (sqlite3_open(db_path.c_str(), db.out()) != SQLITE_OK) {
-        log_error("unable to open bookmark DB -- %s", db_path.c_str());
+    if (sqlite3_open(batch.bb_db_path.c_str(), db.out()) != SQLITE_OK) {
+        log_error("unable to open bookmark DB -- %s",
+                  batch.bb_db_path.c_str());
         return;
     }
 
+    // The main thread can have the DB open for a moment while loading.
+    sqlite3_busy_timeout(db.in(), 1000);
+
     if (sqlite3_exec(db.in(), META_TABLE_DEF, nullptr, nullptr, errmsg.out())
         != SQLITE_OK)
     {
@@ -1095,41 +1248,25 @@ save_time_bookmarks()
         return;
     }
 
+    if (sqlite3_prepare_v2(db.in(),
+                           "REPLACE INTO recent_netlocs (netloc) VALUES (?)",
+                           -1,
+                           stmt.out(),
+                           nullptr)
+        != SQLITE_OK)
     {
-        static const char* UPDATE_NETLOCS_STMT
-            = R"(REPLACE INTO recent_netlocs (netloc) VALUES (?))";
-
-        std::set<std::string> netlocs;
-
-        isc::to<tailer::looper&, services::remote_tailer_t>().send_and_wait(
-            [&netlocs](auto& tlooper) { netlocs = tlooper.active_netlocs(); });
+        log_error("could not prepare recent_netlocs statement -- %s",
+                  sqlite3_errmsg(db));
+        return;
+    }
 
-        if (sqlite3_prepare_v2(
-                db.in(), UPDATE_NETLOCS_STMT, -1, stmt.out(), nullptr)
-            != SQLITE_OK)
-        {
-            log_error("could not prepare recent_netlocs statement -- %s",
-                      sqlite3_errmsg(db));
+    for (const auto& netloc : batch.bb_netlocs) {
+        bind_to_sqlite(stmt.in(), 1, netloc);
+        if (!step_statement(db.in(), stmt.in())) {
             return;
         }
-
-        for (const auto& netloc : netlocs) {
-            bind_to_sqlite(stmt.in(), 1, netloc);
-
-            if (sqlite3_step(stmt.in()) != SQLITE_DONE) {
-                log_error("could not execute bookmark insert statement -- %s",
-                          sqlite3_errmsg(db));
-                return;
-            }
-
-            sqlite3_reset(stmt.in());
-        }
-        session_data.sd_recent_netlocs.insert(netlocs.begin(), netlocs.end());
     }
 
-    logfile_sub_source& lss = lnav_data.ld_log_source;
-    bookmarks<content_line_t>::type& bm = lss.get_user_bookmarks();
-
     if (sqlite3_prepare_v2(db.in(),
                            "DELETE FROM bookmarks WHERE "
                            " log_time = ? and log_format = ? and log_hash = ? "
@@ -1144,26 +1281,17 @@ save_time_bookmarks()
         return;
     }
 
-    for (auto& marked_session_line : marked_session_lines) {
-        if (!bind_line(db.in(),
-                       stmt.in(),
-                       marked_session_line,
-                       lnav_data.ld_session_time))
-        {
-            continue;
-        }
-
-        if (sqlite3_step(stmt.in()) != SQLITE_DONE) {
-            log_error("could not execute bookmark insert statement -- %s",
-                      sqlite3_errmsg(db));
+    for (const auto& key : batch.bb_deleted_marks) {
+        bind_values(stmt.in(),
+                    key.lk_time,
+                    key.lk_format,
+                    key.lk_hash,
+                    batch.bb_session_time);
+        if (!step_statement(db.in(), stmt.in())) {
             return;
         }
-
-        sqlite3_reset(stmt.in());
     }
 
-    marked_session_lines.clear();
-
     if (sqlite3_prepare_v2(db.in(),
                            "REPLACE INTO bookmarks"
                            " (log_time, log_format, log_hash, session_time, "
@@ -1179,58 +1307,29 @@ save_time_bookmarks()
         return;
     }
 
-    {
-        logfile_sub_source::iterator file_iter;
-
-        for (file_iter = lnav_data.ld_log_source.begin();
-             file_iter != lnav_data.ld_log_source.end();
-             ++file_iter)
-        {
-            auto lf = (*file_iter)->get_file();
-
-            if (lf == nullptr) {
-                continue;
-            }
-
-            content_line_t base_content_line;
-            base_content_line = lss.get_file_base_content_line(file_iter);
-            base_content_line
-                = content_line_t(base_content_line + lf->size() - 1);
-
-            if (!bind_line(db.in(),
-                           stmt.in(),
-                           base_content_line,
-                           lnav_data.ld_session_time))
-            {
-                continue;
-            }
-
-            if (sqlite3_bind_null(stmt.in(), 5) != SQLITE_OK) {
-                log_error("could not bind log hash -- %s",
-                          sqlite3_errmsg(db.in()));
-                return;
-            }
-
-            if (sqlite3_step(stmt.in()) != SQLITE_DONE) {
-                log_error("could not execute bookmark insert statement -- %s",
-                          sqlite3_errmsg(db));
+    for (const auto* rows : {&batch.bb_file_rows, &batch.bb_marks}) {
+        for (const auto& row : *rows) {
+            bind_values(stmt.in(),
+                        row.mr_key.lk_time,
+                        row.mr_key.lk_format,
+                        row.mr_key.lk_hash,
+                        batch.bb_session_time,
+                        row.mr_part_name,
+                        row.mr_comment,
+                        row.mr_tags);
+            if (!step_statement(db.in(), stmt.in())) {
                 return;
             }
-
-            sqlite3_reset(stmt.in());
         }
     }
 
-    save_user_bookmarks(db.in(), stmt.in(), bm[&textview_curses::BM_USER]);
-    save_user_bookmarks(db.in(), stmt.in(), bm[&textview_curses::BM_META]);
-
     if (sqlite3_prepare_v2(db.in(),
                            "DELETE FROM time_offset WHERE "
                            " log_time = ? and log_format = ? and log_hash = ? "
                            " and session_time = ?",
                            -1,
                            stmt.out(),
-                           NULL)
+                           nullptr)
         != SQLITE_OK)
     {
         log_error("could not prepare time_offset delete statement -- %s",
@@ -1238,26 +1337,17 @@ save_time_bookmarks()
         return;
     }
 
-    for (auto& offset_session_line : offset_session_lines) {
-        if (!bind_line(db.in(),
-                       stmt.in(),
-                       offset_session_line,
-                       lnav_data.ld_session_time))
-        {
-            continue;
-        }
-
-        if (sqlite3_step(stmt.in()) != SQLITE_DONE) {
-            log_error("could not execute bookmark insert statement -- %s",
-                      sqlite3_errmsg(db));
+    for (const auto& key : batch.bb_deleted_offsets) {
+        bind_values(stmt.in(),
+                    key.lk_time,
+                    key.lk_format,
+                    key.lk_hash,
+                    batch.bb_session_time);
+        if (!step_statement(db.in(), stmt.in())) {
             return;
         }
-
-        sqlite3_reset(stmt.in());
     }
 
-    offset_session_lines.clear();
-
     if (sqlite3_prepare_v2(db.in(),
                            "REPLACE INTO time_offset"
                            " (log_time, log_format, log_hash, session_time, "
@@ -1265,7 +1355,7 @@ save_time_bookmarks()
                            " VALUES (?, ?, ?, ?, ?, ?)",
                            -1,
                            stmt.out(),
-                           NULL)
+                           nullptr)
         != SQLITE_OK)
     {
         log_error("could not prepare time_offset replace statement -- %s",
@@ -1273,110 +1363,156 @@ save_time_bookmarks()
         return;
     }
 
+    for (const auto& row : batch.bb_offsets) {
+        bind_values(stmt.in(),
+                    row.or_key.lk_time,
+                    row.or_key.lk_format,
+                    row.or_key.lk_hash,
+                    batch.bb_session_time,
+                    row.or_sec,
+                    row.or_usec);
+        if (!step_statement(db.in(), stmt.in())) {
+            return;
+        }
+    }
+
+    if (sqlite3_exec(db.in(), "COMMIT", nullptr, nullptr, errmsg.out())
+        != SQLITE_OK)
     {
-        logfile_sub_source::iterator file_iter;
+        log_error("unable to commit transaction -- %s", errmsg.in());
+        return;
+    }
 
-        for (file_iter = lnav_data.ld_log_source.begin();
-             file_iter != lnav_data.ld_log_source.end();
-             ++file_iter)
-        {
-            auto lf = (*file_iter)->get_file();
-            content_line_t base_content_line;
+    if (!batch.bb_expire) {
+        return;
+    }
 
-            if (lf == nullptr) {
-                continue;
-            }
+    if (sqlite3_exec(db.in(), BOOKMARK_LRU_STMT, nullptr, nullptr, errmsg.out())
+        != SQLITE_OK)
+    {
+        log_error("unable to delete old bookmarks -- %s", errmsg.in());
+        return;
+    }
 
-            base_content_line = lss.get_file_base_content_line(file_iter);
+    if (sqlite3_exec(db.in(), NETLOC_LRU_STMT, nullptr, nullptr, errmsg.out())
+        != SQLITE_OK)
+    {
+        log_error("unable to delete old netlocs -- %s", errmsg.in());
+        return;
+    }
+}
 
-            if (!bind_values(stmt,
-                             lf->original_line_time(lf->begin()),
-                             lf->get_format()->get_name(),
-                             lf->get_content_id(),
-                             lnav_data.ld_session_time))
-            {
-                continue;
-            }
+void
+bookmark_writer::start(bookmark_batch batch)
+{
+    this->wait();
+    this->bw_done = false;
+    this->bw_thread = std::thread([this, batch = std::move(batch)]() {
+        log_set_thread_prefix("bookmark-writer");
+        write_bookmark_batch(batch);
+        this->bw_done = true;
+    });
+}
 
-            if (sqlite3_bind_null(stmt.in(), 5) != SQLITE_OK) {
-                log_error("could not bind log hash -- %s",
-                          sqlite3_errmsg(db.in()));
-                return;
-            }
+static bookmark_batch
+new_bookmark_batch()
+{
+    bookmark_batch retval;
 
-            if (sqlite3_bind_null(stmt.in(), 6) != SQLITE_OK) {
-                log_error("could not bind log hash -- %s",
-                          sqlite3_errmsg(db.in()));
-                return;
-            }
+    retval.bb_db_path = lnav::paths::dotlnav() / LOG_METADATA_NAME;
+    retval.bb_session_time = lnav_data.ld_session_time;
 
-            if (sqlite3_step(stmt.in()) != SQLITE_DONE) {
-                log_error("could not execute bookmark insert statement -- %s",
-                          sqlite3_errmsg(db));
-                return;
-            }
+    return retval;
+}
 
-            sqlite3_reset(stmt.in());
-        }
+void
+flush_bookmarks()
+{
+    if (lnav_data.ld_flags & LNF_SECURE_MODE || session_bookmark_writer.is_busy()) {
+        return;
     }
 
-    for (auto& ls : lss) {
-        if (ls->get_file() == nullptr) {
-            continue;
-        }
+    auto batch = new_bookmark_batch();
 
-        auto lf = ls->get_file();
+    capture_mark_changes(batch);
+    if (batch.empty()) {
+        return;
+    }
 
-        if (!lf->is_time_adjusted()) {
+    session_bookmark_writer.start(std::move(batch));
+}
+
+static void
+save_time_bookmarks()
+{
+    auto& lss = lnav_data.ld_log_source;
+
+    session_bookmark_writer.wait();
+
+    auto batch = new_bookmark_batch();
+
+    batch.bb_expire = true;
+    isc::to<tailer::looper&, services::remote_tailer_t>().send_and_wait(
+        [&batch](auto& tlooper) { batch.bb_netlocs = tlooper.active_netlocs(); });
+    session_data.sd_recent_netlocs.insert(batch.bb_netlocs.begin(),
+                                          batch.bb_netlocs.end());
+
+    capture_mark_changes(batch);
+
+    for (auto file_iter = lss.begin(); file_iter != lss.end(); ++file_iter) {
+        auto lf = (*file_iter)->get_file();
+
+        if (lf == nullptr || lf->size() == 0) {
             continue;
         }
 
-        auto line_iter = lf->begin() + lf->get_time_offset_line();
-        struct timeval offset = lf->get_time_offset();
-
-        auto read_result = lf->read_line(line_iter);
+        auto last_line = content_line_t(lf->size() - 1);
+        auto last_cl = content_line_t(
+            lss.get_file_base_content_line(file_iter) + last_line);
 
-        if (read_result.isErr()) {
-            return;
+        // A mark on the last line already records the file.
+        if (saved_marks.count(last_cl) > 0) {
+            continue;
         }
 
-        bind_values(stmt.in(),
-                    lf->original_line_time(line_iter),
-                    lf->get_format()->get_name(),
-                    lf->get_content_id(),
-                    lnav_data.ld_session_time,
-                    offset.tv_sec,
-                    offset.tv_usec);
-
-        if (sqlite3_step(stmt.in()) != SQLITE_DONE) {
-            log_error("could not execute bookmark insert statement -- %s",
-                      sqlite3_errmsg(db));
-            return;
+        auto key_opt = key_for_line(lf, last_line);
+        if (!key_opt) {
+            continue;
         }
 
-        sqlite3_reset(stmt.in());
+        batch.bb_file_rows.emplace_back(mark_row{std::move(key_opt.value())});
     }
 
-    if (sqlite3_exec(db.in(), "COMMIT", nullptr, nullptr, errmsg.out())
-        != SQLITE_OK)
-    {
-        log_error("unable to begin transaction -- %s", errmsg.in());
-        return;
-    }
+    batch.bb_deleted_offsets = std::move(loaded_session_offsets);
+    loaded_session_offsets.clear();
 
-    if (sqlite3_exec(db.in(), BOOKMARK_LRU_STMT, nullptr, nullptr, errmsg.out())
-        != SQLITE_OK)
-    {
-        log_error("unable to delete old bookmarks -- %s", errmsg.in());
-        return;
-    }
+    for (auto& ls : lss) {
+        auto lf = ls->get_file();
 
-    if (sqlite3_exec(db.in(), NETLOC_LRU_STMT, nullptr, nullptr, errmsg.out())
-        != SQLITE_OK)
-    {
-        log_error("unable to delete old netlocs -- %s", errmsg.in());
-        return;
+        if (lf == nullptr || lf->size() == 0) {
+            continue;
+        }
+
+        if (!lf->is_time_adjusted()) {
+            continue;
+        }
+
+        auto line_iter = lf->begin() + lf->get_time_offset_line();
+        auto offset = lf->get_time_offset();
+
+        batch.bb_offsets.emplace_back(offset_row{
+            line_key{
+                lf->original_line_time(line_iter),
+                lf->get_format()->get_name(),
+                lf->get_content_id(),
+            },
+            offset.tv_sec,
+            offset.tv_usec,
+        });
     }
+
+    session_bookmark_writer.start(std::move(batch));
+    session_bookmark_writer.wait();
 }
 
 static void
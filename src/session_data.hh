@@ -63,6 +63,11 @@ void init_session();
 void load_session();
 void load_time_bookmarks();
 void save_session();
+/**
+ * Write any changes to the user's bookmarks to the session database in the
+ * background.  Nothing is done if a previous write is still in progress.
+ */
+void flush_bookmarks();
 void reset_session();
 
 namespace lnav {
@@ -365,6 +365,22 @@ walk_sqlite_metadata(sqlite3* db, struct sqlite_metadata_callbacks& smc)
             return retval;
         }
 
+        if (iter->first == "main") {
+            for (const auto& epo_pair : smc.smc_eponymous_tables) {
+                const char* colnames[] = {"name", "sql"};
+                const char* colvalues[] = {
+                    epo_pair.first.c_str(),
+                    epo_pair.second.c_str(),
+                };
+
+                retval = handle_table_list(
+                    &tld, 2, (char**) colvalues, (char**) colnames);
+                if (retval != SQLITE_OK) {
+                    return retval;
+                }
+            }
+        }
+
         for (auto table_iter = iter->second.begin();
              table_iter != iter->second.end();
              ++table_iter)
@@ -74,6 +74,11 @@ struct sqlite_metadata_callbacks {
     sqlite_exec_callback smc_foreign_key_list;
     void* smc_userdata{nullptr};
     db_table_map_t smc_db_list{};
+    /**
+     * Eponymous virtual tables in the "main" database, which are not listed
+     * in sqlite_master, mapped to their DDL.
+     */
+    std::map<std::string, std::string> smc_eponymous_tables{};
 };
 
 int walk_sqlite_metadata(sqlite3* db, struct sqlite_metadata_callbacks& smc);
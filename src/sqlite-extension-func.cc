@@ -93,13 +93,6 @@ register_sqlite_funcs(sqlite3* db, sqlite_registration_func_t* reg_funcs)
                                     basic_funcs[i].xFunc,
                                     nullptr,
                                     nullptr);
-
-            if (fd.fd_help.ht_context != help_context_t::HC_NONE) {
-                help_text& ht = fd.fd_help;
-
-                sqlite_function_help.insert(std::make_pair(ht.ht_name, &ht));
-                ht.index_tags();
-            }
         }
 
         for (i = 0; agg_funcs && agg_funcs[i].zName; i++) {
@@ -110,14 +103,40 @@ register_sqlite_funcs(sqlite3* db, sqlite_registration_func_t* reg_funcs)
                                     agg_funcs[i].zName,
                                     agg_funcs[i].nArg,
                                     SQLITE_UTF8,
-                                    (void*) &agg_funcs[i],
+                                    (void*) &fda,
                                     nullptr,
                                     agg_funcs[i].xStep,
                                     agg_funcs[i].xFinalize);
+        }
+    }
+
+    return 0;
+}
+
+void
+index_sqlite_funcs_help(sqlite_registration_func_t* reg_funcs)
+{
+    require(reg_funcs != nullptr);
 
-            if (fda.fda_help.ht_context != help_context_t::HC_NONE) {
-                help_text& ht = fda.fda_help;
+    for (int lpc = 0; reg_funcs[lpc]; lpc++) {
+        struct FuncDef* basic_funcs = nullptr;
+        struct FuncDefAgg* agg_funcs = nullptr;
+
+        reg_funcs[lpc](&basic_funcs, &agg_funcs);
 
+        for (int i = 0; basic_funcs && basic_funcs[i].zName; i++) {
+            help_text& ht = basic_funcs[i].fd_help;
+
+            if (ht.ht_context != help_context_t::HC_NONE) {
+                sqlite_function_help.insert(std::make_pair(ht.ht_name, &ht));
+                ht.index_tags();
+            }
+        }
+
+        for (int i = 0; agg_funcs && agg_funcs[i].zName; i++) {
+            help_text& ht = agg_funcs[i].fda_help;
+
+            if (ht.ht_context != help_context_t::HC_NONE) {
                 sqlite_function_help.insert(std::make_pair(ht.ht_name, &ht));
                 ht.index_tags();
             }
@@ -1162,6 +1181,4 @@ register_sqlite_funcs(sqlite3* db, sqlite_registration_func_t* reg_funcs)
                 make_pair(toupper(param.ht_flag_name), &ht));
         }
     }
-
-    return 0;
 }
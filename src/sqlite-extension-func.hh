@@ -95,6 +95,13 @@ extern sqlite_registration_func_t sqlite_registration_funcs[];
 
 int register_sqlite_funcs(sqlite3* db, sqlite_registration_func_t* reg_funcs);
 
+/**
+ * Add the help text for the given functions and the SQLite builtins to
+ * sqlite_function_help.  The help is shared by all connections, so this
+ * should only be called once.
+ */
+void index_sqlite_funcs_help(sqlite_registration_func_t* reg_funcs);
+
 extern "C"
 {
 int sqlite3_db_dump(
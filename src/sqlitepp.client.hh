@@ -35,6 +35,7 @@
 #include "base/auto_mem.hh"
 #include "base/intern_string.hh"
 #include "base/lnav_log.hh"
+#include "optional.hpp"
 #include "sql_util.hh"
 #include "vtab_module.hh"
 
@@ -74,6 +75,17 @@ bind_to_sqlite(sqlite3_stmt* stmt, int index, int64_t i)
     return sqlite3_bind_int64(stmt, index, i);
 }
 
+template<typename T>
+int
+bind_to_sqlite(sqlite3_stmt* stmt, int index, const nonstd::optional<T>& val)
+{
+    if (!val) {
+        return sqlite3_bind_null(stmt, index);
+    }
+
+    return bind_to_sqlite(stmt, index, val.value());
+}
+
 template<typename... Args, std::size_t... Idx>
 int
 bind_values_helper(sqlite3_stmt* stmt,
@@ -36,10 +36,18 @@
 #include "bound_tags.hh"
 #include "config.h"
 #include "lnav.events.hh"
+#include "lnav_util.hh"
 #include "md2attr_line.hh"
 #include "sqlitepp.hh"
 
 using namespace lnav::roles::literals;
+using namespace std::chrono_literals;
+
+/**
+ * The amount of Markdown source to render on the UI thread when a document
+ * is first opened, the rest is rendered in the background.
+ */
+static constexpr size_t PREFIX_RENDER_SIZE = 16 * 1024;
 
 size_t
 textfile_sub_source::text_line_count()
@@ -208,7 +216,22 @@ textfile_sub_source::push_back(const std::shared_ptr<logfile>& lf)
 }
 
 void
-textfile_sub_source::text_filters_changed()
+textfile_sub_source::text_clear_deleted_filter_state()
+{
+    for (const auto& lf : this->tss_files) {
+        auto* lfo = (line_filter_observer*) lf->get_logline_observer();
+
+        lfo->clear_deleted_filter_state();
+    }
+    for (const auto& lf : this->tss_hidden_files) {
+        auto* lfo = (line_filter_observer*) lf->get_logline_observer();
+
+        lfo->clear_deleted_filter_state();
+    }
+}
+
+void
+textfile_sub_source::text_refilter()
 {
     for (auto iter = this->tss_files.begin(); iter != this->tss_files.end();) {
         ++iter;
@@ -450,13 +473,246 @@ textfile_sub_source::text_crumbs_for_line(
     }
 }
 
+/**
+ * Split Markdown source at the top-level ATX headings so that each section
+ * can be rendered on its own.  The whole document is returned as a single
+ * section if it contains link reference definitions since those can be
+ * used from any other section.
+ */
+static std::vector<string_fragment>
+split_markdown_sections(string_fragment content)
+{
+    static const auto REF_DEF_RE = lnav::pcre2pp::code::from_const(
+        R"(^ {0,3}\[[^\]]+\]:)", PCRE2_MULTILINE);
+    static const std::pair<const char*, const char*> HTML_BLOCKS[] = {
+        {"<!--", "-->"},
+        {"<pre", "</pre>"},
+        {"<script", "</script>"},
+        {"<style", "</style>"},
+        {"<textarea", "</textarea>"},
+    };
+
+    std::vector<string_fragment> retval;
+
+    if (REF_DEF_RE.find_in(content).ignore_error()) {
+        retval.emplace_back(content);
+        return retval;
+    }
+
+    auto contains = [](string_fragment sf, const char* needle) {
+        auto needle_end = needle + strlen(needle);
+
+        return std::search(sf.begin(), sf.end(), needle, needle_end)
+            != sf.end();
+    };
+    const char* fence = nullptr;
+    const char* html_end = nullptr;
+    bool prev_blank = true;
+    bool section_has_text = false;
+    int section_start = 0;
+    int line_start = 0;
+
+    while (line_start < content.length()) {
+        auto eol_opt = content.substr(line_start).find('\n');
+        auto line_end = eol_opt ? line_start + (int) eol_opt.value() + 1
+                                : content.length();
+        auto line = content.sub_range(line_start, line_end);
+        auto trimmed = line.trim();
+        auto indented = line.sub_range(0, std::min(3, line.length()))
+                            .trim()
+                            .empty();
+
+        if (fence != nullptr) {
+            if (trimmed.startswith(fence)) {
+                fence = nullptr;
+            }
+        } else if (html_end != nullptr) {
+            if (contains(line, html_end)) {
+                html_end = nullptr;
+            }
+        } else if (indented
+                   && (trimmed.startswith("```") || trimmed.startswith("~~~")))
+        {
+            fence = trimmed[0] == '`' ? "```" : "~~~";
+        } else if (trimmed.startswith("<")) {
+            for (const auto& html_block : HTML_BLOCKS) {
+                if (trimmed.startswith(html_block.first)
+                    && !contains(trimmed, html_block.second))
+                {
+                    html_end = html_block.second;
+                    break;
+                }
+            }
+        } else if (prev_blank && section_has_text && line.startswith("#")) {
+            auto level = 0;
+
+            while (level < line.length() && line[level] == '#') {
+                level += 1;
+            }
+            if (level <= 6
+                && (level == line.length() || isspace(line[level])))
+            {
+                retval.emplace_back(
+                    content.sub_range(section_start, line_start));
+                section_start = line_start;
+            }
+        }
+
+        prev_blank = trimmed.empty();
+        if (!prev_blank) {
+            section_has_text = true;
+        }
+        line_start = line_end;
+    }
+
+    if (section_start < content.length() || retval.empty()) {
+        retval.emplace_back(content.substr(section_start));
+    }
+
+    return retval;
+}
+
+textfile_sub_source::markdown_render
+textfile_sub_source::render_markdown(
+    const std::string& filename,
+    nonstd::optional<ghc::filesystem::path> source_path,
+    const std::string& content,
+    std::shared_ptr<const section_cache> prev_sections,
+    nonstd::optional<size_t> max_source_size)
+{
+    static const auto FRONT_MATTER_RE = lnav::pcre2pp::code::from_const(
+        R"((?:^---\n(.*?)\n---\n|^\+\+\+\n(.*?)\n\+\+\+\n))", PCRE2_DOTALL);
+    static thread_local auto md = FRONT_MATTER_RE.create_match_data();
+
+    markdown_render retval;
+    auto content_sf = string_fragment::from_str(content);
+
+    auto cap_res = FRONT_MATTER_RE.capture_from(content_sf)
+                       .into(md)
+                       .matches()
+                       .ignore_error();
+    if (cap_res) {
+        if (md[1]) {
+            retval.mr_frontmatter_format = text_format_t::TF_YAML;
+            retval.mr_frontmatter = md[1]->to_string();
+        } else if (md[2]) {
+            retval.mr_frontmatter_format = text_format_t::TF_TOML;
+            retval.mr_frontmatter = md[2]->to_string();
+        }
+        content_sf = cap_res->f_remaining;
+    } else if (content_sf.startswith("{")) {
+        yajlpp_parse_context ypc(intern_string::lookup(filename));
+        auto_mem<yajl_handle_t> handle(yajl_free);
+
+        handle = yajl_alloc(&ypc.ypc_callbacks, nullptr, &ypc);
+        yajl_config(handle.in(), yajl_allow_trailing_garbage, 1);
+        ypc.with_ignore_unused(true)
+            .with_handle(handle.in())
+            .with_error_reporter([&filename](const auto& ypc, const auto& um) {
+                log_error("%s: failed to parse JSON front matter -- %s",
+                          filename.c_str(),
+                          um.um_reason.al_string.c_str());
+            });
+        if (ypc.parse_doc(content_sf)) {
+            auto consumed = ypc.ypc_total_consumed;
+            if (consumed < content_sf.length() && content_sf[consumed] == '\n')
+            {
+                retval.mr_frontmatter_format = text_format_t::TF_JSON;
+                retval.mr_frontmatter
+                    = string_fragment::from_str_range(content, 0, consumed)
+                          .to_string();
+                content_sf = content_sf.substr(consumed);
+            }
+        }
+    }
+
+    auto sections = std::make_shared<section_cache>();
+    attr_line_t rendered;
+    size_t source_size = 0;
+
+    retval.mr_ok = true;
+    retval.mr_complete = true;
+    retval.mr_text_source = std::make_unique<plain_text_source>();
+    for (const auto& section : split_markdown_sections(content_sf)) {
+        if (max_source_size && source_size >= max_source_size.value()) {
+            retval.mr_complete = false;
+            break;
+        }
+        source_size += section.length();
+
+        auto key = hasher().update(section).to_string();
+        if (prev_sections) {
+            auto prev_iter = prev_sections->find(key);
+            if (prev_iter != prev_sections->end()) {
+                rendered.append(prev_iter->second);
+                sections->emplace(key, prev_iter->second);
+                continue;
+            }
+        }
+
+        md2attr_line mdal;
+
+        mdal.with_source_path(source_path);
+        auto parse_res = md4cpp::parse(section, mdal);
+        if (parse_res.isErr()) {
+            auto view_content = lnav::console::user_message::error(
+                                    "unable to parse markdown file")
+                                    .with_reason(parse_res.unwrapErr())
+                                    .to_attr_line();
+            view_content.append("\n").append(
+                attr_line_t::from_ansi_str(content.c_str()));
+
+            retval.mr_text_source->replace_with(view_content);
+            retval.mr_ok = false;
+            return retval;
+        }
+
+        auto section_al = parse_res.unwrap();
+        rendered.append(section_al);
+        sections->emplace(key, std::move(section_al));
+    }
+
+    retval.mr_text_source->replace_with(rendered);
+    retval.mr_sections = std::move(sections);
+
+    return retval;
+}
+
+void
+textfile_sub_source::install_markdown(const std::shared_ptr<logfile>& lf,
+                                      rendered_file& rf,
+                                      markdown_render mr)
+{
+    static auto& lnav_db = injector::get<auto_sqlite3&>();
+
+    rf.rf_text_source = std::move(mr.mr_text_source);
+    rf.rf_text_source->register_view(this->tss_view);
+    rf.rf_sections = std::move(mr.mr_sections);
+    if (!mr.mr_ok) {
+        return;
+    }
+
+    if (!mr.mr_frontmatter.empty()) {
+        auto& lf_meta = lf->get_embedded_metadata();
+
+        lf_meta["net.daringfireball.markdown.frontmatter"]
+            = {mr.mr_frontmatter_format, std::move(mr.mr_frontmatter)};
+    }
+
+    if (mr.mr_complete) {
+        lnav::events::publish(lnav_db,
+                              lnav::events::file::format_detected{
+                                  lf->get_filename(),
+                                  fmt::to_string(lf->get_text_format()),
+                              });
+    }
+}
+
 bool
 textfile_sub_source::rescan_files(
     textfile_sub_source::scan_callback& callback,
     nonstd::optional<ui_clock::time_point> deadline)
 {
-    static auto& lnav_db = injector::get<auto_sqlite3&>();
-
     file_iterator iter;
     bool retval = false;
 
@@ -505,117 +761,76 @@ textfile_sub_source::rescan_files(
                 auto rend_iter
                     = this->tss_rendered_files.find(lf->get_filename());
                 if (rend_iter != this->tss_rendered_files.end()) {
-                    if (rend_iter->second.rf_file_size == st.st_size
-                        && rend_iter->second.rf_mtime == st.st_mtime)
+                    auto& rf = rend_iter->second;
+
+                    if (rf.rf_pending.valid()) {
+                        if (deadline
+                            && rf.rf_pending.wait_for(0s)
+                                != std::future_status::ready)
+                        {
+                            ++iter;
+                            continue;
+                        }
+                        this->install_markdown(lf, rf, rf.rf_pending.get());
+                        retval = true;
+                    }
+                    if (rf.rf_file_size == st.st_size
+                        && rf.rf_mtime == st.st_mtime)
                     {
                         ++iter;
                         continue;
                     }
                     log_info("markdown file has been updated, re-rendering: %s",
                              lf->get_filename().c_str());
-                    this->tss_rendered_files.erase(rend_iter);
                 }
 
                 auto read_res = lf->read_file();
-                if (read_res.isOk()) {
-                    static const auto FRONT_MATTER_RE
-                        = lnav::pcre2pp::code::from_const(
-                            R"((?:^---\n(.*)\n---\n|^\+\+\+\n(.*)\n\+\+\+\n))",
-                            PCRE2_MULTILINE | PCRE2_DOTALL);
-                    static thread_local auto md
-                        = FRONT_MATTER_RE.create_match_data();
-
-                    auto content = read_res.unwrap();
-                    auto content_sf = string_fragment::from_str(content);
-                    std::string frontmatter;
-                    text_format_t frontmatter_format{text_format_t::TF_UNKNOWN};
-
-                    auto cap_res = FRONT_MATTER_RE.capture_from(content_sf)
-                                       .into(md)
-                                       .matches()
-                                       .ignore_error();
-                    if (cap_res) {
-                        if (md[1]) {
-                            frontmatter_format = text_format_t::TF_YAML;
-                            frontmatter = md[1]->to_string();
-                        } else if (md[2]) {
-                            frontmatter_format = text_format_t::TF_TOML;
-                            frontmatter = md[2]->to_string();
-                        }
-                        content_sf = cap_res->f_remaining;
-                    } else if (content_sf.startswith("{")) {
-                        yajlpp_parse_context ypc(
-                            intern_string::lookup(lf->get_filename()));
-                        auto_mem<yajl_handle_t> handle(yajl_free);
-
-                        handle = yajl_alloc(&ypc.ypc_callbacks, nullptr, &ypc);
-                        yajl_config(
-                            handle.in(), yajl_allow_trailing_garbage, 1);
-                        ypc.with_ignore_unused(true)
-                            .with_handle(handle.in())
-                            .with_error_reporter(
-                                [&lf](const auto& ypc, const auto& um) {
-                                    log_error(
-                                        "%s: failed to parse JSON front matter "
-                                        "-- %s",
-                                        lf->get_filename().c_str(),
-                                        um.um_reason.al_string.c_str());
-                                });
-                        if (ypc.parse_doc(content_sf)) {
-                            auto consumed = ypc.ypc_total_consumed;
-                            if (consumed < content_sf.length()
-                                && content_sf[consumed] == '\n')
-                            {
-                                frontmatter_format = text_format_t::TF_JSON;
-                                frontmatter = string_fragment::from_str_range(
-                                                  content, 0, consumed)
-                                                  .to_string();
-                                content_sf = content_sf.substr(consumed);
-                            }
-                        }
-                    }
-
-                    md2attr_line mdal;
-
-                    mdal.with_source_path(lf->get_actual_path());
-                    auto parse_res = md4cpp::parse(content_sf, mdal);
-
-                    auto& rf = this->tss_rendered_files[lf->get_filename()];
-                    rf.rf_mtime = st.st_mtime;
-                    rf.rf_file_size = st.st_size;
-                    rf.rf_text_source = std::make_unique<plain_text_source>();
-                    rf.rf_text_source->register_view(this->tss_view);
-                    if (parse_res.isOk()) {
-                        auto& lf_meta = lf->get_embedded_metadata();
-
-                        rf.rf_text_source->replace_with(parse_res.unwrap());
-
-                        if (!frontmatter.empty()) {
-                            lf_meta["net.daringfireball.markdown.frontmatter"]
-                                = {frontmatter_format, frontmatter};
-                        }
-
-                        lnav::events::publish(
-                            lnav_db,
-                            lnav::events::file::format_detected{
-                                lf->get_filename(),
-                                fmt::to_string(lf->get_text_format()),
-                            });
-                    } else {
-                        auto view_content
-                            = lnav::console::user_message::error(
-                                  "unable to parse markdown file")
-                                  .with_reason(parse_res.unwrapErr())
-                                  .to_attr_line();
-                        view_content.append("\n").append(
-                            attr_line_t::from_ansi_str(content.c_str()));
-
-                        rf.rf_text_source->replace_with(view_content);
-                    }
-                } else {
+                if (read_res.isErr()) {
                     log_error("unable to read markdown file: %s -- %s",
                               lf->get_filename().c_str(),
                               read_res.unwrapErr().c_str());
+                    ++iter;
+                    continue;
+                }
+
+                auto content = read_res.unwrap();
+                auto& rf = this->tss_rendered_files[lf->get_filename()];
+                rf.rf_mtime = st.st_mtime;
+                rf.rf_file_size = st.st_size;
+                if (rf.rf_text_source == nullptr && deadline) {
+                    // Show the start of the document right away and
+                    // render the rest in the background.
+                    auto prefix = render_markdown(lf->get_filename(),
+                                                  lf->get_actual_path(),
+                                                  content,
+                                                  nullptr,
+                                                  PREFIX_RENDER_SIZE);
+                    auto complete = prefix.mr_complete;
+
+                    this->install_markdown(lf, rf, std::move(prefix));
+                    retval = true;
+                    if (complete) {
+                        ++iter;
+                        continue;
+                    }
+                }
+
+                rf.rf_pending = std::async(
+                    std::launch::async,
+                    [filename = lf->get_filename(),
+                     source_path = lf->get_actual_path(),
+                     content = std::move(content),
+                     prev_sections = rf.rf_sections]() {
+                        log_set_thread_prefix("markdown");
+                        return render_markdown(filename,
+                                               source_path,
+                                               content,
+                                               prev_sections,
+                                               nonstd::nullopt);
+                    });
+                if (!deadline) {
+                    this->install_markdown(lf, rf, rf.rf_pending.get());
+                    retval = true;
                 }
                 ++iter;
                 continue;
@@ -734,28 +949,17 @@ textfile_sub_source::row_for_anchor(const std::string& id)
         return nonstd::nullopt;
     }
 
-    const auto& meta = iter->second.ms_metadata;
-    nonstd::optional<vis_line_t> retval;
-
-    lnav::document::hier_node::depth_first(
-        meta.m_sections_root.get(),
-        [lf, &id, &retval](const lnav::document::hier_node* node) {
-            for (const auto& child_pair : node->hn_named_children) {
-                auto child_anchor
-                    = text_anchors::to_anchor_string(child_pair.first);
+    auto off_opt = iter->second.ms_metadata.m_anchors.offset_for(id);
+    if (!off_opt) {
+        return nonstd::nullopt;
+    }
 
-                if (child_anchor == id) {
-                    auto ll_opt
-                        = lf->line_for_offset(child_pair.second->hn_start);
-                    if (ll_opt != lf->end()) {
-                        retval = vis_line_t(
-                            std::distance(lf->cbegin(), ll_opt.value()));
-                    }
-                }
-            }
-        });
+    auto ll_opt = lf->line_for_offset(off_opt.value());
+    if (!ll_opt || ll_opt.value() == lf->end()) {
+        return nonstd::nullopt;
+    }
 
-    return retval;
+    return vis_line_t(std::distance(lf->cbegin(), ll_opt.value()));
 }
 
 std::unordered_set<std::string>
@@ -778,22 +982,7 @@ textfile_sub_source::get_anchors()
         return retval;
     }
 
-    const auto& meta = iter->second.ms_metadata;
-
-    lnav::document::hier_node::depth_first(
-        meta.m_sections_root.get(),
-        [&retval](const lnav::document::hier_node* node) {
-            if (retval.size() > 100) {
-                return;
-            }
-
-            for (const auto& child_pair : node->hn_named_children) {
-                retval.emplace(
-                    text_anchors::to_anchor_string(child_pair.first));
-            }
-        });
-
-    return retval;
+    return iter->second.ms_metadata.m_anchors.get_anchors();
 }
 
 nonstd::optional<std::string>
@@ -825,19 +1014,8 @@ textfile_sub_source::anchor_for_row(vis_line_t vl)
     auto end_offset = (ll_next_iter == lf->end())
         ? lf->get_index_size() - 1
         : ll_next_iter->get_offset() - 1;
-    iter->second.ms_metadata.m_sections_tree.visit_overlapping(
-        ll_iter->get_offset(),
-        end_offset,
-        [&retval](const lnav::document::section_interval_t& iv) {
-            retval = iv.value.match(
-                [](const std::string& str) {
-                    return nonstd::make_optional(
-                        text_anchors::to_anchor_string(str));
-                },
-                [](size_t) { return nonstd::nullopt; });
-        });
-
-    return retval;
+    return iter->second.ms_metadata.m_anchors.anchor_for(ll_iter->get_offset(),
+                                                         end_offset);
 }
 
 bool
@@ -31,6 +31,7 @@
 #define textfile_sub_source_hh
 
 #include <deque>
+#include <future>
 #include <unordered_map>
 
 #include "filter_observer.hh"
@@ -120,8 +121,6 @@ public:
                       nonstd::optional<ui_clock::time_point> deadline
                       = nonstd::nullopt);
 
-    void text_filters_changed() override;
-
     int get_filtered_count() const override;
 
     int get_filtered_count_for(size_t filter_index) const override;
@@ -144,6 +143,11 @@ public:
 
     void quiesce() override;
 
+protected:
+    void text_refilter() override;
+
+    void text_clear_deleted_filter_state() override;
+
 private:
     void detach_observer(std::shared_ptr<logfile> lf)
     {
@@ -152,12 +156,48 @@ private:
         delete lfo;
     }
 
+    /**
+     * The rendered form of the sections of a Markdown document, keyed by a
+     * hash of each section's source.
+     */
+    using section_cache = std::unordered_map<std::string, attr_line_t>;
+
+    struct markdown_render {
+        std::unique_ptr<plain_text_source> mr_text_source;
+        std::shared_ptr<const section_cache> mr_sections;
+        text_format_t mr_frontmatter_format{text_format_t::TF_UNKNOWN};
+        std::string mr_frontmatter;
+        bool mr_ok{false};
+        bool mr_complete{false};
+    };
+
+    /**
+     * Render a Markdown document, reusing the sections from a previous
+     * render whose source has not changed.  This is called from a worker
+     * thread, so it must not touch the file or the view.
+     *
+     * @param max_source_size If given, stop after rendering at least this
+     *   many bytes of source.
+     */
+    static markdown_render render_markdown(
+        const std::string& filename,
+        nonstd::optional<ghc::filesystem::path> source_path,
+        const std::string& content,
+        std::shared_ptr<const section_cache> prev_sections,
+        nonstd::optional<size_t> max_source_size);
+
     struct rendered_file {
         time_t rf_mtime;
         file_ssize_t rf_file_size;
         std::unique_ptr<plain_text_source> rf_text_source;
+        std::shared_ptr<const section_cache> rf_sections;
+        std::future<markdown_render> rf_pending;
     };
 
+    void install_markdown(const std::shared_ptr<logfile>& lf,
+                          rendered_file& rf,
+                          markdown_render mr);
+
     struct metadata_state {
         time_t ms_mtime;
         file_ssize_t ms_file_size;
@@ -92,6 +92,27 @@ text_filter::add_line(logfile_filter_state& lfs,
     lfs.tfs_lines_for_message[this->lf_index] += 1;
 }
 
+bool
+text_filter::add_repeated_line(logfile_filter_state& lfs,
+                               logfile::const_iterator ll)
+{
+    auto line_number
+        = (size_t) std::distance(lfs.tfs_logfile->cbegin(), ll);
+
+    if (lfs.tfs_lines_for_message[this->lf_index] != 1
+        || lfs.tfs_filter_count[this->lf_index] + 1 != line_number)
+    {
+        return false;
+    }
+
+    this->end_of_message(lfs);
+    lfs.tfs_message_matched[this->lf_index]
+        = lfs.tfs_last_message_matched[this->lf_index];
+    lfs.tfs_lines_for_message[this->lf_index] += 1;
+
+    return true;
+}
+
 void
 text_filter::end_of_message(logfile_filter_state& lfs)
 {
@@ -1029,6 +1050,75 @@ vis_location_history::loc_history_forward(vis_line_t current_top)
     return this->current_position();
 }
 
+static int FILTER_BATCH_DEPTH = 0;
+
+static std::vector<text_sub_source*>&
+pending_refilters()
+{
+    static std::vector<text_sub_source*> retval;
+
+    return retval;
+}
+
+void
+text_sub_source::filter_batch::begin()
+{
+    FILTER_BATCH_DEPTH += 1;
+}
+
+void
+text_sub_source::filter_batch::end()
+{
+    require(FILTER_BATCH_DEPTH > 0);
+
+    FILTER_BATCH_DEPTH -= 1;
+    if (FILTER_BATCH_DEPTH == 0) {
+        flush();
+    }
+}
+
+void
+text_sub_source::filter_batch::flush()
+{
+    auto& pending = pending_refilters();
+
+    while (!pending.empty()) {
+        auto* tss = pending.front();
+
+        pending.erase(pending.begin());
+        tss->tss_refilter_pending = false;
+        tss->text_refilter();
+    }
+}
+
+text_sub_source::~text_sub_source()
+{
+    if (this->tss_refilter_pending) {
+        auto& pending = pending_refilters();
+
+        pending.erase(std::remove(pending.begin(), pending.end(), this),
+                      pending.end());
+    }
+}
+
+void
+text_sub_source::text_filters_changed()
+{
+    if (FILTER_BATCH_DEPTH == 0) {
+        this->text_refilter();
+        return;
+    }
+
+    // The index of a deleted filter can be given to a new filter before
+    // the refilter happens, so the old state has to be dropped now.
+    this->text_clear_deleted_filter_state();
+    if (!this->tss_refilter_pending) {
+        log_debug("deferring refilter until the end of the batch");
+        this->tss_refilter_pending = true;
+        pending_refilters().emplace_back(this);
+    }
+}
+
 void
 text_sub_source::toggle_apply_filters()
 {
@@ -1113,6 +1203,28 @@ logfile_filter_state::resize(size_t newsize)
     }
 }
 
+void
+logfile_filter_state::drop_lines(size_t count)
+{
+    count = std::min(count, this->tfs_mask.size());
+    for (size_t lpc = 0; lpc < count; lpc++) {
+        auto line_mask = this->tfs_mask[lpc];
+
+        for (int filter_index = 0; line_mask != 0; filter_index++) {
+            if (line_mask & 1U) {
+                this->tfs_filter_hits[filter_index] -= 1;
+            }
+            line_mask >>= 1U;
+        }
+    }
+    for (int filter_index = 0; filter_index < MAX_FILTERS; filter_index++) {
+        this->tfs_filter_count[filter_index]
+            -= std::min(count, this->tfs_filter_count[filter_index]);
+    }
+    this->tfs_mask.erase(this->tfs_mask.begin(),
+                         this->tfs_mask.begin() + count);
+}
+
 nonstd::optional<size_t>
 logfile_filter_state::content_line_to_vis_line(uint32_t line)
 {
@@ -64,6 +64,14 @@ public:
 
     void resize(size_t newsize);
 
+    /**
+     * Drop the state for lines at the front of the file after they were
+     * removed from the file's index.
+     *
+     * @param count The number of lines that were removed.
+     */
+    void drop_lines(size_t count);
+
     nonstd::optional<size_t> content_line_to_vis_line(uint32_t line);
 
     const static int MAX_FILTERS = 32;
@@ -83,6 +91,7 @@ enum class filter_lang_t : int {
     NONE,
     REGEX,
     SQL,
+    SET,
 };
 
 class text_filter {
@@ -121,6 +130,16 @@ public:
                   logfile_const_iterator ll,
                   shared_buffer_ref& line);
 
+    /**
+     * Add a line that repeats the previous message by reusing the result
+     * for that message instead of matching the line again.
+     *
+     * @return False if the previous message was not added to this filter,
+     *   in which case add_line() has to be used.
+     */
+    bool add_repeated_line(logfile_filter_state& lfs,
+                           logfile_const_iterator ll);
+
     void end_of_message(logfile_filter_state& lfs);
 
     virtual bool matches(const logfile& lf,
@@ -276,7 +295,33 @@ protected:
  */
 class text_sub_source {
 public:
-    virtual ~text_sub_source() = default;
+    /**
+     * Groups a series of filter changes so that they are applied with a
+     * single pass over the content when the outermost batch ends, instead
+     * of one pass per text_filters_changed() call.
+     */
+    class filter_batch {
+    public:
+        filter_batch() { begin(); }
+
+        ~filter_batch() { end(); }
+
+        filter_batch(const filter_batch&) = delete;
+        filter_batch& operator=(const filter_batch&) = delete;
+
+        static void begin();
+
+        static void end();
+
+        /**
+         * Apply the changes collected so far without ending the batch.
+         * This needs to be called before anything reads the filtered
+         * content.
+         */
+        static void flush();
+    };
+
+    virtual ~text_sub_source();
 
     enum {
         RB_RAW,
@@ -387,7 +432,11 @@ public:
 
     filter_stack& get_filters() { return this->tss_filters; }
 
-    virtual void text_filters_changed() {}
+    /**
+     * Apply changes to the filters.  If a filter_batch is open, the work is
+     * deferred until the batch ends or is flushed.
+     */
+    void text_filters_changed();
 
     virtual int get_filtered_count() const { return 0; }
 
@@ -421,8 +470,22 @@ public:
     bool tss_apply_filters{true};
 
 protected:
+    /**
+     * Re-evaluate the filters against the content of this source.
+     */
+    virtual void text_refilter() {}
+
+    /**
+     * Reset the state kept for filters that have been deleted so that
+     * their indexes can be reused.
+     */
+    virtual void text_clear_deleted_filter_state() {}
+
     textview_curses* tss_view{nullptr};
     filter_stack tss_filters;
+
+private:
+    bool tss_refilter_pending{false};
 };
 
 class vis_location_history : public location_history {
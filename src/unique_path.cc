@@ -27,6 +27,8 @@
  * SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <algorithm>
+
 #include "unique_path.hh"
 
 #include "config.h"
@@ -127,3 +129,113 @@ unique_path_generator::generate()
         loop_count += 1;
     }
 }
+
+void
+unique_path_index::add_source(const std::shared_ptr<unique_path_source>& src)
+{
+    auto name = src->get_path().filename().string();
+    auto& en = this->upi_sources[src.get()];
+
+    en.e_source = src;
+    en.e_name = name;
+    this->upi_groups[name].push_back(src);
+    this->upi_changed_groups.insert(name);
+}
+
+unique_path_index::source_map::iterator
+unique_path_index::remove_source(source_map::iterator iter)
+{
+    auto& en = iter->second;
+    auto group_iter = this->upi_groups.find(en.e_name);
+
+    this->uncount_length(en);
+    if (group_iter != this->upi_groups.end()) {
+        auto& group = group_iter->second;
+
+        group.erase(std::remove(group.begin(), group.end(), en.e_source),
+                    group.end());
+        if (group.empty()) {
+            this->upi_groups.erase(group_iter);
+        }
+    }
+    this->upi_changed_groups.insert(en.e_name);
+
+    return this->upi_sources.erase(iter);
+}
+
+void
+unique_path_index::invalidate(const unique_path_source* src)
+{
+    auto iter = this->upi_sources.find(src);
+
+    if (iter == this->upi_sources.end()) {
+        return;
+    }
+
+    auto src_ptr = iter->second.e_source;
+
+    this->remove_source(iter);
+    this->add_source(src_ptr);
+}
+
+void
+unique_path_index::count_length(entry& en)
+{
+    en.e_length = en.e_source->get_unique_path().size();
+    en.e_counted = true;
+    this->upi_lengths.insert(en.e_length);
+}
+
+void
+unique_path_index::uncount_length(entry& en)
+{
+    if (!en.e_counted) {
+        return;
+    }
+
+    this->upi_lengths.erase(this->upi_lengths.find(en.e_length));
+    en.e_counted = false;
+}
+
+void
+unique_path_index::generate()
+{
+    for (const auto& name : this->upi_changed_groups) {
+        auto group_iter = this->upi_groups.find(name);
+
+        if (group_iter == this->upi_groups.end()) {
+            continue;
+        }
+
+        unique_path_generator upg;
+
+        for (const auto& src : group_iter->second) {
+            this->uncount_length(this->upi_sources[src.get()]);
+            upg.add_source(src);
+        }
+        upg.generate();
+        for (const auto& src : group_iter->second) {
+            this->count_length(this->upi_sources[src.get()]);
+        }
+    }
+    this->upi_changed_groups.clear();
+}
+
+size_t
+unique_path_index::get_max_length() const
+{
+    if (this->upi_lengths.empty()) {
+        return 0;
+    }
+
+    return *this->upi_lengths.rbegin();
+}
+
+void
+unique_path_index::clear()
+{
+    this->upi_sources.clear();
+    this->upi_groups.clear();
+    this->upi_changed_groups.clear();
+    this->upi_lengths.clear();
+}
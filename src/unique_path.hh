@@ -34,7 +34,10 @@
 
 #include <map>
 #include <memory>
+#include <set>
 #include <string>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
 #include "ghc/filesystem.hpp"
@@ -85,4 +88,86 @@ public:
     size_t upg_max_len{0};
 };
 
+/**
+ * Keeps the unique paths for a changing set of sources up-to-date.  Only
+ * sources with the same file name can affect each other's unique path, so
+ * the sources are grouped by file name and only the groups that had a
+ * source added, removed, or renamed are regenerated.
+ */
+class unique_path_index {
+public:
+    /**
+     * Update the index to contain exactly the given sources.
+     */
+    template<typename T>
+    void sync(const std::vector<std::shared_ptr<T>>& sources)
+    {
+        for (const auto& src : sources) {
+            if (this->upi_sources.count(src.get()) == 0) {
+                this->add_source(src);
+            }
+        }
+
+        if (this->upi_sources.size() == sources.size()) {
+            return;
+        }
+
+        std::unordered_set<const unique_path_source*> current;
+
+        for (const auto& src : sources) {
+            current.insert(src.get());
+        }
+        for (auto iter = this->upi_sources.begin();
+             iter != this->upi_sources.end();)
+        {
+            if (current.count(iter->first) == 0) {
+                iter = this->remove_source(iter);
+            } else {
+                ++iter;
+            }
+        }
+    }
+
+    /**
+     * Recompute the group for the given source since its path changed.
+     */
+    void invalidate(const unique_path_source* src);
+
+    /**
+     * Regenerate the unique paths for the groups that changed.
+     */
+    void generate();
+
+    /**
+     * @return The length of the longest unique path.
+     */
+    size_t get_max_length() const;
+
+    void clear();
+
+private:
+    struct entry {
+        std::shared_ptr<unique_path_source> e_source;
+        std::string e_name;
+        size_t e_length{0};
+        bool e_counted{false};
+    };
+
+    using source_map = std::unordered_map<const unique_path_source*, entry>;
+
+    void add_source(const std::shared_ptr<unique_path_source>& src);
+
+    source_map::iterator remove_source(source_map::iterator iter);
+
+    void count_length(entry& en);
+
+    void uncount_length(entry& en);
+
+    source_map upi_sources;
+    std::map<std::string, std::vector<std::shared_ptr<unique_path_source>>>
+        upi_groups;
+    std::set<std::string> upi_changed_groups;
+    std::multiset<size_t> upi_lengths;
+};
+
 #endif  // LNAV_UNIQUE_PATH_HH
@@ -91,8 +91,12 @@ struct from_sqlite<filter_lang_t> {
         if (strcasecmp(type_name, "sql") == 0) {
             return filter_lang_t::SQL;
         }
+        if (strcasecmp(type_name, "set") == 0) {
+            return filter_lang_t::SET;
+        }
 
-        throw from_sqlite_conversion_error("value of 'regex' or 'sql'", argi);
+        throw from_sqlite_conversion_error("value of 'regex', 'sql', or 'set'",
+                                           argi);
     }
 };
 
@@ -671,6 +675,9 @@ CREATE TABLE lnav_view_filters (
                     case filter_lang_t::SQL:
                         sqlite3_result_text(ctx, "sql", 3, SQLITE_STATIC);
                         break;
+                    case filter_lang_t::SET:
+                        sqlite3_result_text(ctx, "set", 3, SQLITE_STATIC);
+                        break;
                     default:
                         ensure(0);
                 }
@@ -797,6 +804,10 @@ CREATE TABLE lnav_view_filters (
                 tf = lnav_data.ld_log_source.get_sql_filter().value();
                 break;
             }
+            case filter_lang_t::SET:
+                throw sqlite_func_error(
+                    "Set filters can only be added with :filter-in-set or "
+                    ":filter-out-set");
             default:
                 ensure(0);
         }
@@ -859,7 +870,18 @@ CREATE TABLE lnav_view_filters (
             return SQLITE_ERROR;
         }
 
-        if (lang == filter_lang_t::SQL && tf->get_index() == 0) {
+        if (lang == filter_lang_t::SET || tf->get_lang() == filter_lang_t::SET)
+        {
+            auto pattern = from_sqlite<std::string>()(1, &pattern_val, 0);
+
+            if (lang != tf->get_lang() || pattern != tf->get_id()) {
+                throw sqlite_func_error(
+                    "The source of a set filter cannot be changed");
+            }
+            if (tf->get_type() != type) {
+                tf->set_type(type);
+            }
+        } else if (lang == filter_lang_t::SQL && tf->get_index() == 0) {
             if (view_index != LNV_LOG) {
                 throw sqlite_func_error(
                     "SQL filters are only supported in the log view");
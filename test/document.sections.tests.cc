@@ -168,3 +168,31 @@ TEST_CASE("lnav::document::sections::sql")
             }
         });
 }
+
+TEST_CASE("lnav::document::sections::anchors")
+{
+    attr_line_t INPUT = R"(
+{
+   "msg": "Hello, World!",
+   "obj": {
+      "a": 1,
+      "b": "Two"
+   },
+   "arr": [1, 2, 3]
+}
+)";
+
+    auto meta = lnav::document::discover_structure(INPUT, line_range{0, -1});
+    auto anchors = meta.m_anchors.get_anchors();
+
+    CHECK(!anchors.empty());
+    for (const auto& anchor : anchors) {
+        auto off_opt = meta.m_anchors.offset_for(anchor);
+
+        REQUIRE(off_opt);
+        CHECK(meta.m_anchors.anchor_for(off_opt.value(), off_opt.value())
+              == anchor);
+    }
+    CHECK(!meta.m_anchors.offset_for("#-not-a-section-"));
+    CHECK(!meta.m_anchors.anchor_for(0, 0));
+}
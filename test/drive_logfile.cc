@@ -40,6 +40,7 @@
 #include "base/injector.hh"
 #include "base/opt_util.hh"
 #include "config.h"
+#include "lnav_config.hh"
 #include "log_format.hh"
 #include "log_format_loader.hh"
 #include "logfile.hh"
@@ -66,6 +67,7 @@ main(int argc, char* argv[])
     int c, retval = EXIT_SUCCESS;
     dl_mode_t mode = MODE_NONE;
     string expected_format;
+    nonstd::optional<ui_clock::time_point> deadline;
 
     {
         static auto builtin_formats
@@ -87,11 +89,19 @@ main(int argc, char* argv[])
         load_formats(paths, errors);
     }
 
-    while ((c = getopt(argc, argv, "ef:ltv")) != -1) {
+    while ((c = getopt(argc, argv, "ef:ltT:v")) != -1) {
         switch (c) {
             case 'f':
                 expected_format = optarg;
                 break;
+            case 'T':
+                // Index the given number of bytes at the end of the file
+                // first.  That is only done when there is a deadline and
+                // the head is not indexed once the deadline has passed.
+                lnav_config.lc_logfile.lc_tail_first_min_size = 1;
+                lnav_config.lc_logfile.lc_tail_first_size = atoi(optarg);
+                deadline = ui_clock::now() - std::chrono::seconds(1);
+                break;
             case 'e':
                 mode = MODE_ECHO;
                 break;
@@ -130,11 +140,11 @@ main(int argc, char* argv[])
         stat(argv[0], &st);
         assert(strcmp(argv[0], lf->get_filename().c_str()) == 0);
 
-        lf->rebuild_index();
+        lf->rebuild_index(deadline);
         assert(!lf->is_closed());
-        lf->rebuild_index();
+        lf->rebuild_index(deadline);
         assert(!lf->is_closed());
-        lf->rebuild_index();
+        lf->rebuild_index(deadline);
         assert(!lf->is_closed());
         assert(lf->get_activity().la_polls == 3);
         if (expected_format.empty()) {
@@ -148,6 +158,16 @@ main(int argc, char* argv[])
         if (!lf->is_compressed()) {
             assert(lf->get_modified_time() == st.st_mtime);
         }
+        if (deadline) {
+            auto sbr = lf->read_line(lf->begin()).unwrap();
+
+            printf("tail: %zd lines, first: %.*s\n",
+                   lf->size(),
+                   (int) sbr.length(),
+                   sbr.get_data());
+            lf->rebuild_index();
+            assert(!lf->is_closed());
+        }
 
         switch (mode) {
             case MODE_NONE:
@@ -59,6 +59,7 @@ main(int argc, char* argv[])
             int register_collation_functions(sqlite3 * db);
 
             register_sqlite_funcs(db.in(), sqlite_registration_funcs);
+            index_sqlite_funcs_help(sqlite_registration_funcs);
             register_collation_functions(db.in());
         }
 
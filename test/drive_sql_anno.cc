@@ -55,6 +55,7 @@ main(int argc, char* argv[])
         retval = EXIT_FAILURE;
     } else {
         register_sqlite_funcs(db.in(), sqlite_registration_funcs);
+        index_sqlite_funcs_help(sqlite_registration_funcs);
 
         attr_line_t al(argv[1]);
 
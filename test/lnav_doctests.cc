@@ -30,11 +30,13 @@
 #include "config.h"
 
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include "big_array.hh"
 #include "byte_array.hh"
 #include "data_scanner.hh"
 #include "doctest/doctest.h"
 #include "lnav_config.hh"
 #include "lnav_util.hh"
+#include "log_format_native.hh"
 #include "relative_time.hh"
 #include "unique_path.hh"
 
@@ -88,6 +90,29 @@ TEST_CASE("byte_array")
     CHECK(std::string(outbuf.in(), outbuf.size()) == "6162636431323334");
 }
 
+TEST_CASE("big_array")
+{
+    big_array<uint32_t> ba;
+
+    CHECK(ba.reserve(10));
+    CHECK_FALSE(ba.reserve(5));
+    for (uint32_t lpc = 0; lpc < 10; lpc++) {
+        ba.push_back(lpc);
+    }
+
+    auto old_capacity = ba.ba_capacity;
+    CHECK(ba.reserve(old_capacity + 1));
+    CHECK(ba.ba_capacity > old_capacity);
+    CHECK(ba.size() == 10);
+    for (uint32_t lpc = 0; lpc < 10; lpc++) {
+        CHECK(ba[lpc] == lpc);
+    }
+
+    ba.shrink_to(4);
+    CHECK(ba.size() == 4);
+    CHECK(ba.back() == 3);
+}
+
 TEST_CASE("ptime_fmt")
 {
     const char* date_str = "2018-05-16 18:16:42";
@@ -184,6 +209,47 @@ TEST_CASE("unique_path")
     CHECK(log2->get_unique_path() == "[machine2]/syslog.log");
 }
 
+TEST_CASE("unique_path_index")
+{
+    unique_path_index upi;
+    std::vector<std::shared_ptr<my_path_source>> sources;
+
+    auto bar = make_shared<my_path_source>("/foo/bar");
+    auto baz = make_shared<my_path_source>("/foo/baz");
+    auto bar2 = make_shared<my_path_source>("/foo2/bar");
+
+    sources.emplace_back(bar);
+    sources.emplace_back(baz);
+    upi.sync(sources);
+    upi.generate();
+
+    CHECK(bar->get_unique_path() == "bar");
+    CHECK(baz->get_unique_path() == "baz");
+    CHECK(upi.get_max_length() == 3);
+
+    sources.emplace_back(bar2);
+    upi.sync(sources);
+    upi.generate();
+
+    CHECK(bar->get_unique_path() == "[foo]/bar");
+    CHECK(baz->get_unique_path() == "baz");
+    CHECK(bar2->get_unique_path() == "[foo2]/bar");
+    CHECK(upi.get_max_length() == 10);
+
+    bar2->mps_path = "/foo2/qux";
+    upi.invalidate(bar2.get());
+    upi.generate();
+
+    CHECK(bar->get_unique_path() == "bar");
+    CHECK(bar2->get_unique_path() == "qux");
+
+    sources.erase(sources.begin());
+    upi.sync(sources);
+    upi.generate();
+
+    CHECK(upi.get_max_length() == 3);
+}
+
 TEST_CASE("attr_line to json")
 {
     attr_line_t al;
@@ -229,3 +295,158 @@ TEST_CASE("data_scanner CSI")
     CHECK(tok_res->tr_token == DT_CSI);
     CHECK(tok_res->to_string() == "\x1b[0m");
 }
+
+TEST_CASE("native syslog parsers")
+{
+    static const char* const PIECES[] = {
+        "Jan",     "Sept",    "Mon 2",   "2022-03-04T05:06:07",
+        "1",       "12",      "123",     "01:02:03",
+        "0",       ".123",    ".1234567", "Z",
+        "+01:00",  "-",       " ",       "  ",
+        "\t",      ":",       "::",      "host",
+        "h:1",     "a.b.c",   "[",       "]",
+        "[12]",    "[x]",     "(x)",     " (y)",
+        "proc",    "syslogd", "1.2.3",   " [CLOUDINIT]",
+        "---",     " last message repeated 3 times", "s",
+        "<13>",    "<1>1",    "\"",      "\"a\"",
+        "[id a=\"b]\"]", "body",  "\xc3\xa9", "error", "warn",
+        "Errors",  "failed",
+    };
+    static const char* const SAMPLES[] = {
+        "Nov  3 09:47:02 veridian automount[16442]: attempting to mount entry",
+        "Jun 27 01:47:20 Tims-MacBook-Air.local configd[17]: network changed",
+        "Apr 28 04:02:03 tstack-centos5 syslogd 1.4.1: restart.",
+        "Apr 28 04:02:03 host proc[1] (x.y): hello",
+        "Apr 28 04:02:03 host : last message repeated 2 times ---",
+        "2022-03-04T05:06:07.123+01:00 host [CLOUDINIT] proc: hi",
+        "<165>1 2003-10-11T22:14:15.003Z mymachine.example.com evntslog - "
+        "ID47 [exampleSDID@32473 iut=\"3\" eventSource=\"Application\"] "
+        "An application event log entry...",
+        "<34>1 2003-10-11T22:14:15.003Z mymachine.example.com su - ID47 - "
+        "'su root' failed for lonvick on /dev/pts/8",
+    };
+
+    auto std_co = lnav::pcre2pp::code::from(
+                      string_fragment::from_c_str(
+                          lnav::native_format::SYSLOG_STD_REGEX),
+                      PCRE2_DOTALL)
+                      .unwrap();
+    auto rfc_co = lnav::pcre2pp::code::from(
+                      string_fragment::from_c_str(
+                          lnav::native_format::SYSLOG_RFC5424_REGEX),
+                      PCRE2_DOTALL)
+                      .unwrap();
+    auto err_co = lnav::pcre2pp::code::from(
+                      string_fragment::from_c_str(
+                          lnav::native_format::SYSLOG_ERROR_REGEX))
+                      .unwrap();
+    auto warn_co = lnav::pcre2pp::code::from(
+                       string_fragment::from_c_str(
+                           lnav::native_format::SYSLOG_WARNING_REGEX))
+                       .unwrap();
+    auto detector = lnav::native_format::find_level_detector({
+        {LEVEL_ERROR, err_co.get_pattern()},
+        {LEVEL_WARNING, warn_co.get_pattern()},
+    });
+    REQUIRE((detector != nullptr));
+
+    std::vector<std::string> lines(std::begin(SAMPLES), std::end(SAMPLES));
+    uint32_t seed = 1;
+    auto next_rand = [&seed]() {
+        seed = seed * 1103515245 + 12345;
+        return (seed >> 16) & 0x7fff;
+    };
+    for (int lpc = 0; lpc < 50000; lpc++) {
+        std::string line;
+        auto count = 1 + next_rand() % 12;
+
+        for (uint32_t piece = 0; piece < count; piece++) {
+            line += PIECES[next_rand() % (sizeof(PIECES) / sizeof(PIECES[0]))];
+        }
+        if (lpc % 2 == 0) {
+            const auto* sample
+                = SAMPLES[next_rand() % (sizeof(SAMPLES) / sizeof(SAMPLES[0]))];
+
+            line.insert(0, sample, next_rand() % strlen(sample));
+        }
+        if (lpc % 7 == 0 && !line.empty()) {
+            auto nul_pos = next_rand() % line.size();
+
+            // Only replace ASCII so the line stays valid UTF-8.
+            if (!(line[nul_pos] & 0x80)) {
+                line[nul_pos] = '\0';
+            }
+        }
+        lines.emplace_back(line);
+    }
+    // An embedded NUL is an ordinary byte and not the end of the line.
+    lines.emplace_back(std::string("Apr 28 04:02:03 host proc[1]: a\0b", 33));
+    lines.emplace_back(std::string("Apr 28 04:02:03 ho\0st proc: hi", 30));
+    lines.emplace_back(std::string("A\0r 28 04:02:03 host proc: hi", 29));
+    lines.emplace_back(std::string("Apr 28 04:02:03 host pr\0c: hi", 29));
+    lines.emplace_back(
+        std::string("<1>1 2003-10-11T22:14:15Z h \0 - - - x", 37));
+    lines.emplace_back(
+        std::string("<1>1 2003-10-11T22:14:15Z h p - - [a=\0] x", 41));
+
+    {
+        auto native = lnav::native_format::find_pattern_matcher(std_co);
+        auto md = std_co.create_match_data();
+        auto nul_line = std::string("Apr 28 04:02:03 host proc[1]: a\0b", 33);
+
+        REQUIRE(native->match(std_co, string_fragment::from_str(nul_line), md)
+                == lnav::native_format::match_result::match);
+        CHECK(md["body"]->to_string() == std::string("a\0b", 3));
+    }
+
+    for (const auto* co : {&std_co, &rfc_co}) {
+        auto native = lnav::native_format::find_pattern_matcher(*co);
+        REQUIRE(native != nullptr);
+
+        auto native_md = co->create_match_data();
+        auto regex_md = co->create_match_data();
+        for (const auto& line : lines) {
+            auto sf = string_fragment::from_str(line);
+            auto res = native->match(*co, sf, native_md);
+            if (res == lnav::native_format::match_result::unknown) {
+                continue;
+            }
+
+            auto regex_matched = co->capture_from(sf)
+                                     .into(regex_md)
+                                     .matches()
+                                     .ignore_error()
+                                     .has_value();
+            INFO(line);
+            CHECK(regex_matched
+                  == (res == lnav::native_format::match_result::match));
+            if (!regex_matched) {
+                continue;
+            }
+            for (size_t index = 0; index <= co->get_capture_count(); index++) {
+                auto native_cap = native_md[index];
+                auto regex_cap = regex_md[index];
+
+                INFO(index);
+                CHECK(native_cap.has_value() == regex_cap.has_value());
+                if (native_cap && regex_cap) {
+                    CHECK(native_cap->sf_begin == regex_cap->sf_begin);
+                    CHECK(native_cap->sf_end == regex_cap->sf_end);
+                }
+            }
+        }
+    }
+
+    for (const auto& line : lines) {
+        auto sf = string_fragment::from_str(line);
+        auto expected = LEVEL_INFO;
+
+        if (warn_co.find_in(sf).ignore_error()) {
+            expected = LEVEL_WARNING;
+        } else if (err_co.find_in(sf).ignore_error()) {
+            expected = LEVEL_ERROR;
+        }
+        INFO(line);
+        CHECK(detector(sf) == expected);
+    }
+}
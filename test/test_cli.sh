@@ -29,3 +29,11 @@ printf "a\ba _\ba a\b_" | run_cap_test env TEST_COMMENT="overstrike bold" \
 grep abcd textfile_long_lines.0 | run_cap_test \
     ${lnav_test} -n -d /tmp/lnav.err \
     -c ';SELECT filepath, lines FROM lnav_file'
+
+echo "2021-07-03T21:49:29 Test" > logfile_one_line.0
+
+run_cap_test ${lnav_test} -n logfile_one_line.0
+
+run_cap_test ${lnav_test} -n \
+    -c ";SELECT inner_height FROM lnav_views WHERE name = 'log'" \
+    logfile_one_line.0
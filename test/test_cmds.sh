@@ -93,6 +93,24 @@ run_cap_test ${lnav_test} -n -d /tmp/lnav.err \
     -c ":goto 0" \
     "${test_dir}/logfile_access_log.*"
 
+run_cap_test ${lnav_test} -n -d /tmp/lnav.err \
+    -c ":filter-out vmkboot" \
+    -c ":goto 2" \
+    -c ":close" \
+    -c ":goto 0" \
+    "${test_dir}/logfile_access_log.*"
+
+run_cap_test ${lnav_test} -n -d /tmp/lnav.err \
+    -c ":open ${test_dir}/logfile_access_log.0" \
+    -c ":goto 0" \
+    ${test_dir}/logfile_access_log.1
+
+run_cap_test ${lnav_test} -n -d /tmp/lnav.err \
+    -c ":filter-out vmkboot" \
+    -c ":open ${test_dir}/logfile_access_log.0" \
+    -c ";SELECT log_line, log_path FROM access_log" \
+    ${test_dir}/logfile_access_log.1
+
 run_cap_test ${lnav_test} -n -d /tmp/lnav.err \
     -c ":goto 0" \
     -c ":hide-file" \
@@ -253,6 +271,46 @@ run_cap_test ${lnav_test} -n \
     -c ":filter-out today" \
     ${test_dir}/logfile_multiline.0
 
+printf 'VMKBOOT\ntramp\n' > filter-set.txt
+
+run_test ${lnav_test} -n \
+    -c ":filter-out-set filter-set.txt" \
+    ${test_dir}/logfile_access_log.0
+
+check_output "filter-out-set did not remove the lines in the set?" <<EOF
+192.168.202.254 - - [20/Jul/2009:22:59:29 +0000] "GET /vmw/vSphere/default/vmkernel.gz HTTP/1.0" 200 78929 "-" "gPXE/0.9.7"
+EOF
+
+run_test ${lnav_test} -n \
+    -c ":filter-in-set ;SELECT 'vmkernel' UNION ALL SELECT 'tramp'" \
+    ${test_dir}/logfile_access_log.0
+
+check_output "filter-in-set did not keep the lines from the query?" <<EOF
+192.168.202.254 - - [20/Jul/2009:22:59:26 +0000] "GET /vmw/cgi/tramp HTTP/1.0" 200 134 "-" "gPXE/0.9.7"
+192.168.202.254 - - [20/Jul/2009:22:59:29 +0000] "GET /vmw/vSphere/default/vmkernel.gz HTTP/1.0" 200 78929 "-" "gPXE/0.9.7"
+EOF
+
+run_test ${lnav_test} -n \
+    -c ":filter-out-set filter-set.txt" \
+    -c ":filter-in-set ;SELECT 'vmkernel'" \
+    -c ";SELECT view_name, enabled, type, language, pattern FROM lnav_view_filters" \
+    -c ":write-csv-to -" \
+    ${test_dir}/logfile_access_log.0
+
+check_output "set filters are not in lnav_view_filters?" <<EOF
+view_name,enabled,type,language,pattern
+log,1,out,set,filter-set.txt
+log,1,in,set,;SELECT 'vmkernel'
+EOF
+
+run_cap_test ${lnav_test} -n \
+    -c ":filter-in-set non-existent-set.txt" \
+    ${test_dir}/logfile_access_log.0
+
+run_cap_test ${lnav_test} -n \
+    -c ":filter-in-set ;SELECT 1 WHERE 0" \
+    ${test_dir}/logfile_access_log.0
+
 cp ${test_dir}/logfile_multiline.0 logfile_append.0
 chmod ug+w logfile_append.0
 
@@ -347,6 +405,49 @@ run_cap_test ${lnav_test} -n \
     -c ':write-jsonlines-to -' \
     ${test_dir}/logfile_access_log.0
 
+rm -f query-status.csv query-methods.csv
+run_test ${lnav_test} -n \
+    -c ":write-query-csv-to query-status.csv SELECT sc_status, count(*) AS total FROM access_log GROUP BY sc_status ORDER BY sc_status" \
+    -c ":write-query-csv-to query-methods.csv SELECT log_line, upper(cs_method) AS method FROM access_log ORDER BY log_line" \
+    -c ";SELECT count(*) AS total FROM access_log" \
+    -c ":write-csv-to -" \
+    ${test_dir}/logfile_access_log.0
+
+check_output "the main query did not run after the background queries?" <<EOF
+total
+3
+EOF
+
+run_test cat query-status.csv
+
+check_output "write-query-csv-to did not write the grouped results?" <<EOF
+sc_status,total
+200,2
+404,1
+EOF
+
+run_test cat query-methods.csv
+
+check_output "write-query-csv-to did not write the second query?" <<EOF
+log_line,method
+0,GET
+1,GET
+2,GET
+EOF
+
+run_cap_test ${lnav_test} -n \
+    -c ":write-query-csv-to query-bad.csv DELETE FROM access_log" \
+    ${test_dir}/logfile_access_log.0
+
+run_cap_test ${lnav_test} -n \
+    -c ":write-query-csv-to query-bad.csv SELECT * FROM lnav_views" \
+    ${test_dir}/logfile_access_log.0
+
+run_cap_test ${lnav_test} -n \
+    -c ":write-query-csv-to query-bad.csv SELECT json_extract(cs_uri_stem, '\$') FROM access_log" \
+    -c ";SELECT 1" \
+    ${test_dir}/logfile_access_log.0
+
 # By setting the LNAVSECURE mode before executing the command, we will disable
 # the access to the write-json-to command and the output would just be the
 # actual display of select query rather than json output.
@@ -31,6 +31,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <zlib.h>
 
 #include "base/auto_fd.hh"
 #include "config.h"
@@ -153,5 +154,116 @@ main(int argc, char* argv[])
         assert(lb.is_pipe_closed());
     }
 
+    {
+        char fn_template[] = "test_line_buffer.XXXXXX";
+
+        auto fd = auto_fd(mkstemp(fn_template));
+        string path = fn_template;
+        line_buffer lb;
+        int reopens = 0;
+
+        write(fd, TEST_DATA, strlen(TEST_DATA));
+        lseek(fd, SEEK_SET, 0);
+
+        lb.set_fd(fd);
+        lb.set_reopen_func([&path, &reopens]() -> Result<auto_fd, string> {
+            auto retval = auto_fd(open(path.c_str(), O_RDONLY));
+
+            if (retval == -1) {
+                return Err(string("cannot open"));
+            }
+            reopens += 1;
+            return Ok(std::move(retval));
+        });
+
+        auto li = lb.load_next_line().unwrap();
+        assert(li.li_file_range.fr_size == 14);
+        assert(line_buffer::release_idle_fds(1) == 0);
+        assert(line_buffer::release_idle_fds(0) == 1);
+        assert(lb.is_fd_released());
+        assert(lb.get_fd() == -1);
+
+        // A separate descriptor goes through the reopen function without
+        // giving the buffer its descriptor back.
+        assert(lb.dup_fd().isOk());
+        assert(lb.is_fd_released());
+        assert(reopens == 1);
+
+        lb.flush_at(0);
+        auto li2 = lb.load_next_line(li.li_file_range).unwrap();
+        assert(li2.li_file_range.fr_size == 16);
+        assert(!lb.is_fd_released());
+        assert(reopens == 2);
+
+        assert(line_buffer::release_idle_fds(0) == 1);
+        remove(fn_template);
+        assert(lb.dup_fd().isErr());
+        lb.flush_at(0);
+        auto li3 = lb.load_next_line(li.li_file_range).unwrap();
+        assert(li3.li_file_range.empty());
+        assert(lb.is_fd_released());
+        assert(reopens == 2);
+    }
+
+    {
+        char fn_template[] = "test_line_buffer.XXXXXX";
+
+        auto fd = auto_fd(mkstemp(fn_template));
+        string path = fn_template;
+        string data;
+        uint32_t seed = 1;
+
+        // Random hex lines do not compress well, so the compressed file is
+        // big enough to need several syncpoints.
+        while (data.size() < 12 * 1024 * 1024) {
+            char line[64];
+
+            for (size_t lpc = 0; lpc < sizeof(line) - 1; lpc++) {
+                seed = seed * 1103515245 + 12345;
+                line[lpc] = "0123456789abcdef"[(seed >> 16) & 0xf];
+            }
+            line[sizeof(line) - 1] = '\n';
+            data.append(line, sizeof(line));
+        }
+
+        auto gz = gzdopen(fd.release(), "wb1");
+        assert(gz != nullptr);
+        assert(gzwrite(gz, data.data(), data.size()) == (int) data.size());
+        assert(gzclose(gz) == Z_OK);
+
+        line_buffer::header_data hd;
+        line_buffer::gz_indexed gi(4);
+        auto_mem<char> buf;
+        const size_t buf_size = 64 * 1024;
+        size_t off = 0;
+
+        buf = (char*) malloc(buf_size);
+        gi.open(open(path.c_str(), O_RDONLY), hd);
+        remove(fn_template);
+        while (off < data.size()) {
+            auto rc = gi.read(buf.in(), off, buf_size);
+
+            assert(rc > 0);
+            assert(memcmp(buf.in(), &data[off], rc) == 0);
+            off += rc;
+        }
+
+        // The index was thinned out when it filled up and the windows are
+        // stored compressed.
+        assert(gi.syncpoint_count() > 0);
+        assert(gi.syncpoint_count() <= 4);
+        assert(gi.syncpoint_memory() < gi.syncpoint_count() * GZ_WINSIZE);
+
+        for (int lpc = 0; lpc < 50; lpc++) {
+            seed = seed * 1103515245 + 12345;
+            off = (seed >> 4) % (data.size() - 4096);
+
+            auto rc = gi.read(buf.in(), off, 4096);
+
+            assert(rc == 4096);
+            assert(memcmp(buf.in(), &data[off], rc) == 0);
+        }
+    }
+
     return retval;
 }
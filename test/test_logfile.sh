@@ -77,6 +77,138 @@ check_output "truncated log file not detected" <<EOF
 Nov  3 09:23:38 veridian automount[16442]: attempting to mount entry /auto/opt
 EOF
 
+run_test ./drive_logfile -T 150 -f syslog_log -e ${srcdir}/logfile_syslog.0
+
+check_output "tail of the file is not indexed first?" <<EOF
+tail: 1 lines, first: Nov  3 09:47:02 veridian sudo: timstack : TTY=pts/6 ; PWD=/auto/wstimstack/rpms/lbuild/test ; USER=root ; COMMAND=/usr/bin/tail /var/log/messages
+Nov  3 09:23:38 veridian automount[7998]: lookup(file): lookup for foobar failed
+Nov  3 09:23:38 veridian automount[16442]: attempting to mount entry /auto/opt
+Nov  3 09:23:38 veridian automount[7999]: lookup(file): lookup for opt failed
+Nov  3 09:47:02 veridian sudo: timstack : TTY=pts/6 ; PWD=/auto/wstimstack/rpms/lbuild/test ; USER=root ; COMMAND=/usr/bin/tail /var/log/messages
+EOF
+
+mkdir -p retention-config/configs/retention
+cat > retention-config/configs/retention/config.json <<EOF
+{
+    "tuning": {
+        "logfile": {
+            "max-retained-lines": 1000
+        }
+    }
+}
+EOF
+seq 1 3000 | sed -e 's/^/2013-06-06T19:13:20.123 line /' > logfile_retention.0
+
+run_test ${lnav_test} -n -I retention-config \
+    -c ";SELECT count(*), min(log_line), min(log_body), max(log_body) FROM generic_log" \
+    -c ":write-csv-to -" \
+    logfile_retention.0
+
+check_output "old lines are not dropped past the retention limit?" <<EOF
+count(*),min(log_line),min(log_body),max(log_body)
+1000,0,line 2001,line 3000
+EOF
+
+mkdir -p repeats-config/configs/repeats
+cat > repeats-config/configs/repeats/config.json <<EOF
+{
+    "tuning": {
+        "logfile": {
+            "collapse-repeats": true
+        }
+    }
+}
+EOF
+
+run_test ${lnav_test} -n -I repeats-config \
+    -c ";SELECT inner_height FROM lnav_views WHERE name = 'log'" \
+    -c ":write-csv-to -" \
+    ${test_dir}/logfile_repeats.0
+
+check_output "repeated messages are not collapsed?" <<EOF
+inner_height
+3
+EOF
+
+run_test ${lnav_test} -n -I repeats-config \
+    -c ";SELECT log_line, log_time, log_idle_msecs, log_level FROM generic_log" \
+    -c ":write-csv-to -" \
+    ${test_dir}/logfile_repeats.0
+
+# The messages in a collapsed row share the row's log_line on purpose.
+check_output "collapsed messages are not expanded in the log table?" <<EOF
+log_line,log_time,log_idle_msecs,log_level
+0,2013-06-06 19:13:20.123,0,info
+1,2013-06-06 19:13:21.123,1000,error
+1,2013-06-06 19:13:22.123,1000,error
+1,2013-06-06 19:13:25.123,3000,error
+2,2013-06-06 19:13:26.123,1000,info
+EOF
+
+run_test ${lnav_test} -n -I repeats-config \
+    -c ";SELECT log_line, log_time FROM generic_log WHERE log_time >= '2013-06-06 19:13:22.000'" \
+    -c ":write-csv-to -" \
+    ${test_dir}/logfile_repeats.0
+
+check_output "time constraint skips collapsed messages?" <<EOF
+log_line,log_time
+1,2013-06-06 19:13:22.123
+1,2013-06-06 19:13:25.123
+2,2013-06-06 19:13:26.123
+EOF
+
+run_test ${lnav_test} -n -I repeats-config \
+    -c ":goto 1" \
+    -c ":toggle-repeats" \
+    -c ";SELECT log_line, log_time FROM generic_log" \
+    -c ":write-csv-to -" \
+    ${test_dir}/logfile_repeats.0
+
+check_output "toggle-repeats does not expand the run?" <<EOF
+log_line,log_time
+0,2013-06-06 19:13:20.123
+1,2013-06-06 19:13:21.123
+2,2013-06-06 19:13:22.123
+3,2013-06-06 19:13:25.123
+4,2013-06-06 19:13:26.123
+EOF
+
+run_test ${lnav_test} -n -I repeats-config \
+    -c ":filter-out connection refused" \
+    -c ";SELECT inner_height FROM lnav_views WHERE name = 'log'" \
+    -c ":write-csv-to -" \
+    ${test_dir}/logfile_repeats.0
+
+check_output "the filter is not applied to the whole run?" <<EOF
+inner_height
+2
+EOF
+
+run_test ${lnav_test} -n -I repeats-config \
+    -c ";UPDATE generic_log SET log_mark = 1 WHERE log_time = '2013-06-06 19:13:25.123'" \
+    -c ";SELECT log_line, log_time, log_mark FROM generic_log" \
+    -c ":write-csv-to -" \
+    ${test_dir}/logfile_repeats.0
+
+check_output "marking a collapsed message does not mark its row?" <<EOF
+log_line,log_time,log_mark
+0,2013-06-06 19:13:20.123,0
+1,2013-06-06 19:13:21.123,1
+1,2013-06-06 19:13:22.123,1
+1,2013-06-06 19:13:25.123,1
+2,2013-06-06 19:13:26.123,0
+EOF
+
+run_test ${lnav_test} -n \
+    -c ";SELECT inner_height FROM lnav_views WHERE name = 'log'" \
+    -c ":write-csv-to -" \
+    ${test_dir}/logfile_repeats.0
+
+check_output "repeated messages are collapsed by default?" <<EOF
+inner_height
+5
+EOF
+
 
 if locale -a | grep fr_FR; then
     cp ${srcdir}/logfile_syslog_fr.0 logfile_syslog_fr_test.0
@@ -269,6 +401,25 @@ run_test ./drive_logfile -f w3c_log ${srcdir}/logfile_w3c.0
 
 on_error_fail_with "Didn't infer w3c_log log format?"
 
+run_test ./drive_logfile -f csv_logfile_csv_log ${srcdir}/logfile_csv.0
+
+on_error_fail_with "Didn't infer CSV log format?"
+
+run_test ./drive_logfile -t -f tsv_logfile_tsv_log ${srcdir}/logfile_tsv.0
+
+check_output "TSV timestamp interpreted incorrectly?" <<EOF
+May 19 08:00:01 2021 -- 000
+May 19 08:00:05 2021 -- 000
+EOF
+
+run_test ./drive_logfile -f generic_log ${srcdir}/logfile_csv.1
+
+on_error_fail_with "Plain text log with commas detected as CSV?"
+
+run_test ./drive_logfile -f generic_log ${srcdir}/logfile_csv.2
+
+on_error_fail_with "Log with a header and one record detected as CSV?"
+
 
 run_test ./drive_logfile ${srcdir}/logfile_empty.0
 
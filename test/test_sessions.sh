@@ -117,3 +117,107 @@ run_cap_test ${lnav_test} -n -d /tmp/lnav.err \
     -c ":load-session" \
     -c ":test-comment restore hidden lines" \
     ${test_dir}/logfile_access_log.0
+
+# set filters are not saved in the session
+rm -rf ./sessions
+mkdir -p $HOME
+printf 'VMKBOOT\ntramp\n' > filter-set.txt
+run_test ${lnav_test} -nq \
+    -c ":filter-out-set filter-set.txt" \
+    -c ":filter-in-set ;SELECT 'default'" \
+    -c ":save-session" \
+    ${test_dir}/logfile_access_log.0
+
+run_test ${lnav_test} -n \
+    -c ":load-session" \
+    ${test_dir}/logfile_access_log.0
+
+check_output "set filters were not restored from the session?" <<EOF
+192.168.202.254 - - [20/Jul/2009:22:59:29 +0000] "GET /vmw/vSphere/default/vmkernel.gz HTTP/1.0" 200 78929 "-" "gPXE/0.9.7"
+EOF
+
+run_test ${lnav_test} -n \
+    -c ":load-session" \
+    -c ";SELECT view_name, enabled, type, language, pattern FROM lnav_view_filters" \
+    -c ":write-csv-to -" \
+    ${test_dir}/logfile_access_log.0
+
+check_output "set filters were restored with the wrong settings?" <<EOF
+view_name,enabled,type,language,pattern
+log,1,out,set,filter-set.txt
+log,1,in,set,;SELECT 'default'
+EOF
+
+# removed marks and time offsets are not deleted from the bookmark db
+rm -rf ./sessions
+mkdir -p $HOME
+run_test ${lnav_test} -nq \
+    -c ";UPDATE access_log SET log_mark = 1" \
+    -c ":save-session" \
+    -c ";UPDATE access_log SET log_mark = 0 WHERE log_line = 1" \
+    -c ":goto 1" \
+    -c ":adjust-log-time 2010-01-01T00:00:00" \
+    -c ":save-session" \
+    ${test_dir}/logfile_access_log.0
+
+run_test ${lnav_test} -n \
+    -c ";ATTACH DATABASE 'sessions/.lnav/log_metadata.db' AS meta" \
+    -c ";SELECT log_time, log_format FROM meta.bookmarks ORDER BY log_time" \
+    -c ":write-csv-to -" \
+    -c ";SELECT log_time, log_format, offset_sec FROM meta.time_offset" \
+    -c ":write-csv-to -"
+
+check_output "the unmarked line was not deleted from the bookmark db?" <<EOF
+log_time,log_format
+2009-07-20T22:59:26.000,access_log
+2009-07-20T22:59:29.000,access_log
+log_time,log_format,offset_sec
+2009-07-20T22:59:29.000,access_log,14173231
+EOF
+
+run_test ${lnav_test} -n \
+    -c ":load-session" \
+    -c ";SELECT log_line, log_time, log_mark FROM access_log" \
+    -c ":write-csv-to -" \
+    ${test_dir}/logfile_access_log.0
+
+check_output "marks and time offset were not restored?" <<EOF
+log_line,log_time,log_mark
+0,2009-12-31 23:59:57.000,1
+1,2010-01-01 00:00:00.000,0
+2,2010-01-01 00:00:00.000,1
+EOF
+
+run_test ${lnav_test} -nq \
+    -c ":load-session" \
+    -c ":goto 1" \
+    -c ":adjust-log-time 2009-07-20T22:59:29" \
+    -c ":save-session" \
+    ${test_dir}/logfile_access_log.0
+
+run_test ${lnav_test} -n \
+    -c ";ATTACH DATABASE 'sessions/.lnav/log_metadata.db' AS meta" \
+    -c ";SELECT count(*) AS marks FROM meta.bookmarks" \
+    -c ":write-csv-to -" \
+    -c ";SELECT count(*) AS offsets FROM meta.time_offset" \
+    -c ":write-csv-to -"
+
+check_output "the cleared time offset was not deleted from the bookmark db?" <<EOF
+marks
+2
+offsets
+0
+EOF
+
+run_test ${lnav_test} -n \
+    -c ":load-session" \
+    -c ";SELECT log_line, log_time, log_mark FROM access_log" \
+    -c ":write-csv-to -" \
+    ${test_dir}/logfile_access_log.0
+
+check_output "a cleared time offset was restored?" <<EOF
+log_line,log_time,log_mark
+0,2009-07-20 22:59:26.000,1
+1,2009-07-20 22:59:29.000,0
+2,2009-07-20 22:59:29.000,1
+EOF
@@ -727,7 +727,7 @@ EOF
 
 
 schema_dump() {
-    ${lnav_test} -n -c ';.schema' ${test_dir}/logfile_access_log.0 | head -n21
+    ${lnav_test} -n -c ';.schema' ${test_dir}/logfile_access_log.0 | head -n23
 }
 
 run_test schema_dump
@@ -749,6 +749,8 @@ CREATE VIRTUAL TABLE regexp_capture USING regexp_capture_impl();
 CREATE VIRTUAL TABLE regexp_capture_into_json USING regexp_capture_into_json_impl();
 CREATE VIRTUAL TABLE xpath USING xpath_impl();
 CREATE VIRTUAL TABLE fstat USING fstat_impl();
+CREATE VIRTUAL TABLE sketch_top_values USING sketch_top_values_impl();
+CREATE VIRTUAL TABLE sketch_stats USING sketch_stats_impl();
 CREATE TABLE lnav_events (
    ts TEXT NOT NULL DEFAULT(strftime('%Y-%m-%dT%H:%M:%f', 'now')),
    content TEXT
@@ -1095,3 +1097,346 @@ run_cap_test ${lnav_test} -n \
 
 run_cap_test ${lnav_test} -Nn \
      -c ";select *,case match_index when 2 then replicate('abc', 1000) else '' end from regexp_capture_into_json('10;50;50;50;', '(\d+);')"
+
+run_test ${lnav_test} -n \
+    -c ";SELECT log_line, log_level, log_body FROM syslog_log ORDER BY log_line DESC LIMIT 2 OFFSET 1" \
+    -c ":write-csv-to -" \
+    ${test_dir}/logfile_syslog.0
+
+check_output "descending order with limit/offset is not working?" <<EOF
+log_line,log_level,log_body
+2,error,lookup(file): lookup for opt failed
+1,info,attempting to mount entry /auto/opt
+EOF
+
+run_test ${lnav_test} -n \
+    -c ";SELECT log_line, log_level FROM syslog_log WHERE log_level = 'error' ORDER BY log_line DESC LIMIT 1" \
+    -c ":write-csv-to -" \
+    ${test_dir}/logfile_syslog.0
+
+check_output "descending order with a level constraint is not working?" <<EOF
+log_line,log_level
+2,error
+EOF
+
+run_test ${lnav_test} -n \
+    -c ";SELECT log_line, log_time FROM syslog_log WHERE log_time < '2007-11-03 09:47:00' ORDER BY log_time DESC LIMIT 2" \
+    -c ":write-csv-to -" \
+    ${test_dir}/logfile_syslog.0
+
+check_output "descending time order with a time constraint is not working?" <<EOF
+log_line,log_time
+2,2007-11-03 09:23:38.000
+1,2007-11-03 09:23:38.000
+EOF
+
+run_test ${lnav_test} -n \
+    -c ";SELECT (SELECT count(*) FROM syslog_log) AS syslog_count, (SELECT count(*) FROM access_log) AS access_count" \
+    -c ":write-csv-to -" \
+    ${test_dir}/logfile_access_log.0
+
+check_output "format table without a matching file does not resolve?" <<EOF
+syslog_count,access_count
+0,3
+EOF
+
+run_test ${lnav_test} -n \
+    -c ";SELECT count(*), min(cmd_name) FROM procstate_procs" \
+    -c ":write-csv-to -" \
+    ${test_dir}/logfile_procstate.0
+
+check_output "format search table does not resolve?" <<EOF
+count(*),min(cmd_name)
+23,/lib/systemd/systemd
+EOF
+
+run_test ${lnav_test} -n \
+    -c ";SELECT count(*) FROM sqlite_master WHERE name IN ('syslog_log', 'access_log', 'procstate_procs')" \
+    -c ":write-csv-to -" \
+    ${test_dir}/logfile_procstate.0
+
+check_output "format tables are changing the schema?" <<EOF
+count(*)
+0
+EOF
+
+mkdir -p sketch-config/formats/sketch
+cat > sketch-config/formats/sketch/format.json <<EOF
+{
+    "\$schema": "https://lnav.org/schemas/format-v1.schema.json",
+    "sketch_log": {
+        "description": "Log format used for testing field sketches",
+        "regex": {
+            "line": {
+                "pattern": "^(?<timestamp>\\\\d{4}-\\\\d{2}-\\\\d{2} \\\\d{2}:\\\\d{2}:\\\\d{2}) user=(?<user>\\\\S+) duration=(?<duration>\\\\d+)\$"
+            }
+        },
+        "value": {
+            "user": {
+                "kind": "string",
+                "identifier": true,
+                "sketch": true
+            },
+            "duration": {
+                "kind": "integer",
+                "sketch": true
+            }
+        },
+        "sample": [
+            {
+                "line": "2013-06-06 19:13:20 user=alice duration=10"
+            }
+        ]
+    }
+}
+EOF
+cat > logfile_sketch.0 <<EOF
+2013-06-06 19:13:20 user=alice duration=10
+2013-06-06 19:13:21 user=bob duration=20
+2013-06-06 19:13:22 user=alice duration=30
+2013-06-06 20:13:23 user=carol duration=40
+2013-06-06 20:13:24 user=alice duration=50
+EOF
+
+run_test ${lnav_test} -n -I sketch-config \
+    -c ";SELECT * FROM sketch_top_values('user')" \
+    -c ":write-csv-to -" \
+    logfile_sketch.0
+
+check_output "sketch_top_values() is not working?" <<EOF
+value,count,max_error
+alice,3,0
+bob,1,0
+carol,1,0
+EOF
+
+run_test ${lnav_test} -n -I sketch-config \
+    -c ";SELECT count, distinct_count, min, round(p50), round(p90), max, quantile_error FROM sketch_stats('duration')" \
+    -c ":write-csv-to -" \
+    -c ";SELECT count, min, max FROM sketch_stats('duration', '2013-06-06 20:00:00')" \
+    -c ":write-csv-to -" \
+    logfile_sketch.0
+
+check_output "sketch_stats() is not working?" <<EOF
+count,distinct_count,min,round(p50),round(p90),max,quantile_error
+5,5,10,30,40,50,0.01
+count,min,max
+2,40,50
+EOF
+
+run_test ${lnav_test} -n -I sketch-config \
+    -c ";SELECT count, min, max FROM sketch_stats WHERE end_time = '2013-06-06 19:30:00' AND field = 'duration'" \
+    -c ":write-csv-to -" \
+    -c ";SELECT value, count FROM sketch_top_values WHERE start_time = '2013-06-06 20:00:00' AND field = 'user' ORDER BY value" \
+    -c ":write-csv-to -" \
+    logfile_sketch.0
+
+check_output "sketch constraints are not mapped to the right arguments?" <<EOF
+count,min,max
+3,10,30
+value,count
+alice,1
+carol,1
+EOF
+
+run_cap_test ${lnav_test} -n -I sketch-config \
+    -c ";SELECT * FROM sketch_stats()" \
+    logfile_sketch.0
+
+run_test ${lnav_test} -n \
+    -c ";SELECT log_line, log_time, log_level, user, message FROM csv_logfile_csv_log" \
+    -c ":write-csv-to -" \
+    ${test_dir}/logfile_csv.0
+
+check_output "CSV table is not working?" <<EOF
+log_line,log_time,log_level,user,message
+0,2021-05-19 08:00:01.000,info,alice,"started, with a comma"
+1,2021-05-19 08:00:02.000,error,bob,"failed with ""quotes"""
+2,2021-05-19 08:00:03.000,warning,carol,plain message
+EOF
+
+run_test ${lnav_test} -n \
+    -c ";SELECT log_line, log_time, log_level, host, message FROM tsv_logfile_tsv_log" \
+    -c ":write-csv-to -" \
+    ${test_dir}/logfile_tsv.0
+
+check_output "TSV table is not working?" <<EOF
+log_line,log_time,log_level,host,message
+0,2021-05-19 08:00:01.000,info,web1,up
+1,2021-05-19 08:00:05.000,error,web2,down
+EOF
+
+mkdir -p dsv-other
+cat > dsv-other/logfile_csv.0 <<EOF
+when,code,host
+2021-05-19 09:00:00,42,web1
+2021-05-19 09:00:01,43,web2
+EOF
+
+run_test ${lnav_test} -n \
+    -c ";SELECT log_line, user FROM csv_logfile_csv_log" \
+    -c ":write-csv-to -" \
+    -c ";SELECT log_line, col_when, code FROM csv_logfile_csv_2_log" \
+    -c ":write-csv-to -" \
+    ${test_dir}/logfile_csv.0 \
+    dsv-other/logfile_csv.0
+
+check_output "CSV files with the same name and different headers share a table?" <<EOF
+log_line,user
+0,alice
+1,bob
+2,carol
+log_line,col_when,code
+3,2021-05-19 09:00:00,42
+4,2021-05-19 09:00:01,43
+EOF
+
+mkdir -p spill-config/configs/spill
+cat > spill-config/configs/spill/config.json <<EOF
+{
+    "tuning": {
+        "db-view": {
+            "max-memory-size": 1
+        }
+    }
+}
+EOF
+
+SPILL_QUERY="WITH RECURSIVE seq(n) AS (SELECT 1 UNION ALL SELECT n + 1 FROM seq WHERE n < 6000) SELECT n, CASE WHEN n % 7 = 0 THEN NULL ELSE 'row ' || n END AS label, CASE WHEN n % 11 = 0 THEN NULL ELSE n * 1.5 END AS num, CASE WHEN n % 13 = 0 THEN '' ELSE NULL END AS empty FROM seq"
+
+run_test ${lnav_test} -n \
+    -c ";${SPILL_QUERY}" \
+    -c ":write-csv-to db-in-memory.csv"
+
+rm -f db-spill.dbg
+run_test ${lnav_test} -n -d db-spill.dbg -I spill-config \
+    -c ";${SPILL_QUERY}" \
+    -c ":write-csv-to -"
+
+check_output "paged query results do not match the in-memory results?" \
+    < db-in-memory.csv
+
+if ! grep -q "paging rows to a temporary file" db-spill.dbg; then
+    echo "query results were not paged to a temporary file?"
+    exit 1
+fi
+
+run_test ${lnav_test} -n -I spill-config \
+    -c ";${SPILL_QUERY}" \
+    -c ":write-csv-to -"
+
+sed -i -n -e '1p' -e '1022,1030p' -e '2047,2050p' -e '6001p' `test_filename`
+
+check_output "rows across page boundaries are not correct?" <<EOF
+n,label,num,empty
+1021,row 1021,1531.5,<NULL>
+1022,<NULL>,1533,<NULL>
+1023,row 1023,<NULL>,<NULL>
+1024,row 1024,1536,<NULL>
+1025,row 1025,1537.5,<NULL>
+1026,row 1026,1539,<NULL>
+1027,row 1027,1540.5,
+1028,row 1028,1542,<NULL>
+1029,<NULL>,1543.5,<NULL>
+2046,row 2046,<NULL>,<NULL>
+2047,row 2047,3070.5,<NULL>
+2048,row 2048,3072,<NULL>
+2049,row 2049,3073.5,<NULL>
+6000,row 6000,9000,<NULL>
+EOF
+
+run_test ${lnav_test} -n \
+    -c ";SELECT median(column1) AS med, lower_quartile(column1) AS lq, upper_quartile(column1) AS uq, mode(column1) AS mo, percentile(column1, 90) AS p90, percentile(column1, 0) AS p0, percentile(column1, 100) AS p100 FROM (VALUES (1), (2), (2), (3), (4), (5), (6), (7), (8), (10))" \
+    -c ":write-csv-to -" \
+    -c ";SELECT median(column1), percentile(column1, 25) FROM (VALUES (1), (2.5), (4))" \
+    -c ":write-csv-to -" \
+    -c ";SELECT median(column1), mode(column1), percentile(column1, 50), approx_percentile(column1, 50) FROM (VALUES (1)) WHERE 0" \
+    -c ":write-csv-to -" \
+    -c ";SELECT mode(column1) FROM (VALUES (1), (1), (2), (2))" \
+    -c ":write-csv-to -" \
+    ${test_dir}/logfile_access_log.0
+
+check_output "order-statistic aggregates are not working?" <<EOF
+med,lq,uq,mo,p90,p0,p100
+4.5,2,7,2,8.2,1,10
+median(column1),"percentile(column1, 25)"
+2.5,1.75
+median(column1),mode(column1),"percentile(column1, 50)","approx_percentile(column1, 50)"
+<NULL>,<NULL>,<NULL>,<NULL>
+mode(column1)
+<NULL>
+EOF
+
+run_test ${lnav_test} -n \
+    -c ";WITH RECURSIVE seq(n) AS (SELECT 1 UNION ALL SELECT n + 1 FROM seq WHERE n < 10000) SELECT median(n) AS med, percentile(n, 99) AS p99, abs(approx_percentile(n, 99) - percentile(n, 99)) / percentile(n, 99) <= 0.01 AS close FROM seq" \
+    -c ":write-csv-to -" \
+    ${test_dir}/logfile_access_log.0
+
+check_output "percentiles over a large input are not working?" <<EOF
+med,p99,close
+5000.5,9900.01,1
+EOF
+
+run_cap_test ${lnav_test} -n \
+    -c ";SELECT percentile(column1, 101) FROM (VALUES (1), (2))" \
+    ${test_dir}/logfile_access_log.0
+
+run_cap_test ${lnav_test} -n \
+    -c ";SELECT approx_percentile(column1, -1) FROM (VALUES (1), (2))" \
+    ${test_dir}/logfile_access_log.0
+
+run_test ${lnav_test} -n \
+    -c ";SELECT log_line, log_time FROM syslog_log WHERE log_line IN (3, 0, 2, 0, 99)" \
+    -c ":write-csv-to -" \
+    -c ";SELECT log_line FROM syslog_log WHERE log_line IN (3, 0, 2) ORDER BY log_line DESC" \
+    -c ":write-csv-to -" \
+    ${test_dir}/logfile_syslog.0
+
+check_output "log_line IN does not return the rows in order?" <<EOF
+log_line,log_time
+0,2007-11-03 09:23:38.000
+2,2007-11-03 09:23:38.000
+3,2007-11-03 09:47:02.000
+log_line
+3
+2
+0
+EOF
+
+run_test ${lnav_test} -n \
+    -c ";SELECT log_line FROM syslog_log WHERE log_line IN (3, 1, 2) LIMIT 2" \
+    -c ":write-csv-to -" \
+    -c ";SELECT log_line FROM syslog_log WHERE log_line IN (3, 1, 2) ORDER BY log_line DESC LIMIT 1" \
+    -c ":write-csv-to -" \
+    -c ";SELECT log_line FROM syslog_log WHERE log_line IN (1, 2) AND log_line >= 2" \
+    -c ":write-csv-to -" \
+    ${test_dir}/logfile_syslog.0
+
+check_output "log_line IN with a LIMIT is not working?" <<EOF
+log_line
+1
+2
+log_line
+3
+log_line
+2
+EOF
+
+run_test ${lnav_test} -n \
+    -c ";SELECT count(*) AS total FROM syslog_log WHERE log_line IN ()" \
+    -c ":write-csv-to -" \
+    -c ";SELECT count(*) AS total FROM syslog_log WHERE log_line IN (SELECT 1 WHERE 0)" \
+    -c ":write-csv-to -" \
+    -c ";SELECT log_line FROM syslog_log WHERE log_line IN (SELECT log_line + 1 FROM syslog_log WHERE log_line < 2)" \
+    -c ":write-csv-to -" \
+    ${test_dir}/logfile_syslog.0
+
+check_output "log_line IN with an empty list or a subquery is not working?" <<EOF
+total
+0
+total
+0
+log_line
+1
+2
+EOF
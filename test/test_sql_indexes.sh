@@ -43,3 +43,22 @@ run_cap_test ${lnav_test} -n \
 run_cap_test ${lnav_test} -n \
     -c ";SELECT * FROM all_logs WHERE log_level > 'error'" \
     ${test_dir}/logfile_access_log.*
+
+run_cap_test ${lnav_test} -n \
+    -c ";SELECT log_line, log_format, log_level FROM all_logs WHERE log_level IN ('error', 'warning')" \
+    ${test_dir}/logfile_access_log.* \
+    ${test_dir}/logfile_procstate.0
+
+run_cap_test ${lnav_test} -n \
+    -c ";SELECT log_line, log_format FROM all_logs WHERE log_format IN ('access_log', 'no_such_format') LIMIT 2" \
+    ${test_dir}/logfile_access_log.* \
+    ${test_dir}/logfile_procstate.0
+
+run_cap_test ${lnav_test} -n \
+    -c ";SELECT log_line, log_unique_path FROM all_logs WHERE log_path IN ('${test_dir}/logfile_access_log.1', '${test_dir}/logfile_procstate.0') ORDER BY log_line DESC" \
+    ${test_dir}/logfile_access_log.* \
+    ${test_dir}/logfile_procstate.0
+
+run_cap_test ${lnav_test} -n \
+    -c ";SELECT count(*) FROM all_logs WHERE log_level IN ()" \
+    ${test_dir}/logfile_access_log.*
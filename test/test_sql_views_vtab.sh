@@ -94,6 +94,61 @@ run_cap_test ${lnav_test} -n \
     -c ";UPDATE lnav_view_filters SET pattern = 'vmkboot'" \
     ${test_dir}/logfile_access_log.0
 
+run_test ${lnav_test} -n \
+    -c ":filter-out vmkboot" \
+    -c ":filter-out tramp" \
+    -c ";UPDATE lnav_view_filters SET pattern = CASE pattern WHEN 'vmkboot' THEN 'vmkernel' ELSE 'cgi' END" \
+    -c ":write-view-to -" \
+    ${test_dir}/logfile_access_log.0
+
+check_output "filters updated by a single statement are not applied?" <<EOF
+192.168.202.254 - - [20/Jul/2009:22:59:29 +0000] "GET /vmw/vSphere/default/vmkboot.gz HTTP/1.0" 404 46210 "-" "gPXE/0.9.7"
+EOF
+
+run_test ${lnav_test} -n \
+    -c ":filter-out vmk" \
+    -c ";DELETE FROM lnav_view_filters; INSERT INTO lnav_view_filters (view_name, pattern) VALUES ('log', 'tramp')" \
+    -c ":write-view-to -" \
+    ${test_dir}/logfile_access_log.0
+
+check_output "a filter inserted after a delete is not applied?" <<EOF
+192.168.202.254 - - [20/Jul/2009:22:59:29 +0000] "GET /vmw/vSphere/default/vmkboot.gz HTTP/1.0" 404 46210 "-" "gPXE/0.9.7"
+192.168.202.254 - - [20/Jul/2009:22:59:29 +0000] "GET /vmw/vSphere/default/vmkernel.gz HTTP/1.0" 200 78929 "-" "gPXE/0.9.7"
+EOF
+
+cat > filter-batch.lnav <<EOF
+:filter-out vmk
+:delete-filter vmk
+:filter-out tramp
+:filter-in gz
+:write-view-to -
+EOF
+
+run_test ${lnav_test} -n \
+    -f filter-batch.lnav \
+    ${test_dir}/logfile_access_log.0
+
+check_output "a filter that reuses a deleted filter's index in a script is not applied?" <<EOF
+192.168.202.254 - - [20/Jul/2009:22:59:29 +0000] "GET /vmw/vSphere/default/vmkboot.gz HTTP/1.0" 404 46210 "-" "gPXE/0.9.7"
+192.168.202.254 - - [20/Jul/2009:22:59:29 +0000] "GET /vmw/vSphere/default/vmkernel.gz HTTP/1.0" 200 78929 "-" "gPXE/0.9.7"
+EOF
+
+cat > filter-batch.lnav <<EOF
+:filter-out vmkboot
+:filter-out tramp
+;SELECT count(*) AS total FROM access_log WHERE log_filters IS NULL
+:write-csv-to -
+EOF
+
+run_test ${lnav_test} -n \
+    -f filter-batch.lnav \
+    ${test_dir}/logfile_access_log.0
+
+check_output "filters added by a script are not applied before a query?" <<EOF
+total
+1
+EOF
+
 run_test ${lnav_test} -n \
     -c ":filter-out vmk" \
     -c ";SELECT * FROM lnav_view_filter_stats" \